@@ -0,0 +1,100 @@
+/*
+	File:		BatchImport.h
+	
+	Description: A headless batch importer: imports every movie in a list of files and folders on a pool
+			     of worker threads, writes each frame out as a PNG file, and records per-file metrics.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef BATCH_IMPORT_H
+#define BATCH_IMPORT_H
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kBatchImportFlag			"-batch"		// pass this as the first argument to run a batch import
+#define kBatchMaxWorkers			16
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// Run a batch import, given the arguments that followed kBatchImportFlag on the command line, and return
+// an exit status for the process. This needs no window server: there are no windows, views or NSTimers,
+// just worker threads and the main event loop, which delivers their responses. Call after EnterMovies.
+//
+//   -workers n      number of worker threads (default: one per processor)
+//   -out folder     where to write the frames, as <file name>.png, or <file name>-<folder hash>.png for
+//                   files that share a name with another in the batch (default: the current folder)
+//   -metrics file   where to write the per-file metrics; CSV, or JSON if the name ends in .json
+//                   (default: metrics.csv in the output folder); a file's status is the error
+//                   importTheMovie returned for it, or the one writing its frame did
+//   -list file      import the files listed, one path per line, in file
+//   -size WxH       decode each frame to fit in W x H rather than at its natural size
+//   -contact k      draw a contact sheet of k frames per movie
+//   -dh type        data handler to use: file (the default), handle, pointer, url, or copy, which copies
+//                   each file from its URL with the transfer engine in QTDataRef.c and opens the copy;
+//                   or progressive, which opens the copy as soon as its movie atom is in, draws each
+//                   frame once its samples are, and then stops the copy
+//   -urlbase url    open (or copy) each file with the url data handler, as url followed by the file's
+//                   name, rather than as a file URL; e.g. serve the folder with Tests/StandInServer.py
+//                   and pass its address, to measure the url data handler against real HTTP
+//   -copyto folder  where -dh copy or progressive puts the copies (default: the output folder); implies
+//                   -dh copy unless -dh progressive comes first
+//   -transfers n    how many copies -dh copy runs at once (default: 8); the copies run on the transfer
+//                   engine's own threads, and the workers import each copy as it's done
+//   -scalebench WxH time shrinking each frame to fit W x H with the box filter in ImageScale.c against
+//                   CopyBits, the way the browser window scales it; use without -size, so that the
+//                   frames are decoded at their natural size
+//
+// Any other arguments are files to import, or folders whose (visible, regular) files are imported.
+// When the batch is done, the throughput and the spread of the per-file import times are printed;
+// run the same batch with different -workers counts to see how it scales, as Tests/WorkerSweep.sh does.
+int runBatchImport (int argc, const char *argv[]);
+
+#endif // BATCH_IMPORT_H
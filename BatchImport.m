@@ -0,0 +1,970 @@
+/*
+	File:		BatchImport.m
+	
+	Description: A headless batch importer built on importTheMovie and WorkerThread.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#import <Cocoa/Cocoa.h>
+#import <Carbon/Carbon.h>
+#import <QuickTime/QuickTime.h>
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#import "BatchImport.h"
+#import "FileObject.h"
+#import "GWorldPool.h"
+#import "ImageScale.h"
+#import "ImportRouting.h"
+#import "MovieImport.h"
+#import "QTDataRef.h"
+#import "WorkerThread.h"
+
+//////////
+//
+// data types
+//
+//////////
+
+// what we need to remember about each file in the batch; the thread data comes first
+// so that importTheMovie can be handed a BatchItem
+typedef struct BatchItem {
+    ThreadData			threadData;
+    UInt32				worker;				// index of the worker the item was sent to
+    UInt64				importTime;			// microseconds spent in importTheMovie
+    OSErr				importErr;			// and what it returned, the last time it was called
+    Boolean				retried;			// did we have to retry on the main thread?
+    Float64				copyThroughput;		// bytes per second, for USE_COPY_DH
+    struct BatchItem *	nextCopied;			// the next copy waiting for a worker to import it
+} BatchItem;
+
+typedef struct {
+    FileCatalogRef		catalog;			// every file in the batch
+    NSMutableArray *	files;				// and a FileObject for each
+    NSCountedSet *		fileNames;			// the name of each, so that frames of files with the same name can be told apart
+    UInt32				nextFile;			// index of the next file to send to a worker
+    UInt32				numDone;
+    UInt32				numFailed;
+    WorkerThreadRef		workers[kBatchMaxWorkers];
+    UInt32				numWorkers;
+    const char *		outFolder;
+    FILE *				metricsFile;
+    Boolean				metricsAsJSON;
+    Rect				frameRect;			// empty to decode at natural size
+    UInt32				numContactFrames;
+    UInt32				dhTag;
+    const char *		urlBase;			// NULL to open files by file URL
+    const char *		copyFolder;			// where USE_COPY_DH copies files to
+    UInt64 *			importTimes;		// of each file imported, for the latency summary
+    UInt32				numImported;
+    SInt64				bytesImported;
+    UInt32				numCopied;
+    Float64				copyThroughput;		// the sum over the files copied
+    UInt32				numTransfers;		// the most copies USE_COPY_DH runs at once
+    UInt32				numCopiesPending;	// copies queued, under way, or done but not yet sent to a worker
+    BatchItem *			copiedHead;			// the copies that are done, in the order they finished
+    BatchItem *			copiedTail;
+    Boolean				idle[kBatchMaxWorkers];	// workers waiting for a copy to import
+    Rect				scaleBenchRect;		// empty unless we're timing the ways of shrinking frames to fit it
+    UInt32				numScaled;
+    UInt64				boxScaleTime;		// microseconds spent in ImageScale_BoxGWorld, over the frames shrunk
+    UInt64				copyBitsScaleTime;	// and in CopyBits, for the same frames
+} BatchState;
+
+//////////
+//
+// static global variables
+//
+//////////
+
+static BatchState		gBatch;
+
+//////////
+//
+// static function declarations
+//
+//////////
+
+static void addBatchFile (const char *thePath);
+static void addBatchFolder (const char *thePath);
+static void addBatchFileList (const char *thePath);
+static BatchItem *newBatchItem (void);
+static void sendNextBatchRequest (UInt32 theWorker);
+static Boolean sendBatchItem (BatchItem *theItem, UInt32 theWorker);
+static void runBatchCopies (void);
+static void addCopiedBatchItem (BatchItem *theItem);
+static void batchCopyDoneProc (QTDRTransferPtr theTransfer, void *theRefCon);
+static void finishBatchItem (BatchItem *theItem);
+static void disposeBatchItem (BatchItem *theItem);
+static void makeFramePath (FileObject *theFileObject, char *outPath, size_t theSize);
+static OSErr writeFramePNG (GWorldPtr theGWorld, const char *thePath);
+static void timeFrameScaling (GWorldPtr theGWorld);
+static void writeMetrics (BatchItem *theItem, OSErr theErr);
+static void printBatchSummary (UInt64 theElapsedTime);
+static int compareImportTimes (const void *theTime1, const void *theTime2);
+static void printBatchUsage (void);
+
+void batchActionRoutine (void *refcon, WorkerRequestRef request);
+void batchResponseMainThreadCallback (void *refcon, WorkerRequestRef request);
+
+#pragma mark-
+
+//////////
+//
+// runBatchImport
+//
+//////////
+
+int runBatchImport (int argc, const char *argv[])
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    const char *metricsPath = NULL;
+    char defaultMetricsPath[PATH_MAX];
+    ImportRoutingStatistics routingStats;
+    UnsignedWide startTime, endTime;
+    size_t length;
+    UInt32 i;
+    int arg;
+    int status = 0;
+
+    memset(&gBatch, 0, sizeof(gBatch));
+    if (FileCatalog_Create(&gBatch.catalog) != noErr) {
+        [pool release];
+        return 1;
+    }
+    gBatch.files = [[NSMutableArray alloc] init];
+    gBatch.outFolder = ".";
+    gBatch.dhTag = USE_FILE_DH;
+    gBatch.numWorkers = MPProcessors();
+    gBatch.numTransfers = kNumTransferWorkers;
+
+    // parse the command line
+    for (arg = 0; arg < argc; arg++) {
+        const char *option = argv[arg];
+        const char *value = (arg + 1 < argc) ? argv[arg + 1] : NULL;
+
+        if (option[0] != '-') {
+            addBatchFile(option);
+            continue;
+        }
+
+        if (value == NULL) {
+            printBatchUsage();
+            status = 2;
+            goto bail;
+        }
+        arg++;
+
+        if (strcmp(option, "-workers") == 0) {
+            gBatch.numWorkers = atoi(value);
+        } else if (strcmp(option, "-transfers") == 0) {
+            gBatch.numTransfers = atoi(value);
+        } else if (strcmp(option, "-out") == 0) {
+            gBatch.outFolder = value;
+        } else if (strcmp(option, "-metrics") == 0) {
+            metricsPath = value;
+        } else if (strcmp(option, "-list") == 0) {
+            addBatchFileList(value);
+        } else if (strcmp(option, "-size") == 0) {
+            int width = 0, height = 0;
+
+            if ((sscanf(value, "%dx%d", &width, &height) != 2) || (width <= 0) || (height <= 0)) {
+                printBatchUsage();
+                status = 2;
+                goto bail;
+            }
+            MacSetRect(&gBatch.frameRect, 0, 0, width, height);
+        } else if (strcmp(option, "-scalebench") == 0) {
+            int width = 0, height = 0;
+
+            if ((sscanf(value, "%dx%d", &width, &height) != 2) || (width <= 0) || (height <= 0)) {
+                printBatchUsage();
+                status = 2;
+                goto bail;
+            }
+            MacSetRect(&gBatch.scaleBenchRect, 0, 0, width, height);
+        } else if (strcmp(option, "-contact") == 0) {
+            gBatch.numContactFrames = atoi(value);
+            if (gBatch.numContactFrames > kMaxContactSheetFrames)
+                gBatch.numContactFrames = kMaxContactSheetFrames;
+        } else if (strcmp(option, "-dh") == 0) {
+            if (strcmp(value, "file") == 0)
+                gBatch.dhTag = USE_FILE_DH;
+            else if (strcmp(value, "handle") == 0)
+                gBatch.dhTag = USE_HANDLE_DH;
+            else if (strcmp(value, "pointer") == 0)
+                gBatch.dhTag = USE_POINTER_DH;
+            else if (strcmp(value, "url") == 0)
+                gBatch.dhTag = USE_URL_DH;
+            else if (strcmp(value, "copy") == 0)
+                gBatch.dhTag = USE_COPY_DH;
+            else if (strcmp(value, "progressive") == 0)
+                gBatch.dhTag = USE_PROGRESSIVE_DH;
+            else {
+                printBatchUsage();
+                status = 2;
+                goto bail;
+            }
+        } else if (strcmp(option, "-urlbase") == 0) {
+            gBatch.urlBase = value;
+            if ((gBatch.dhTag != USE_COPY_DH) && (gBatch.dhTag != USE_PROGRESSIVE_DH))
+                gBatch.dhTag = USE_URL_DH;
+        } else if (strcmp(option, "-copyto") == 0) {
+            gBatch.copyFolder = value;
+            if (gBatch.dhTag != USE_PROGRESSIVE_DH)
+                gBatch.dhTag = USE_COPY_DH;
+        } else {
+            printBatchUsage();
+            status = 2;
+            goto bail;
+        }
+    }
+
+    if ([gBatch.files count] == 0) {
+        printBatchUsage();
+        status = 2;
+        goto bail;
+    }
+
+    if (gBatch.numWorkers < 1)
+        gBatch.numWorkers = 1;
+    if (gBatch.numWorkers > kBatchMaxWorkers)
+        gBatch.numWorkers = kBatchMaxWorkers;
+    if (gBatch.numWorkers > [gBatch.files count])
+        gBatch.numWorkers = [gBatch.files count];
+    if (gBatch.numTransfers < 1)
+        gBatch.numTransfers = 1;
+    if (gBatch.numTransfers > kMaxTransferWorkers)
+        gBatch.numTransfers = kMaxTransferWorkers;
+
+    // every file will be opened (or copied) by URL, so make all their URLs at once, before the workers share the catalog
+    if ((gBatch.dhTag == USE_URL_DH) || (gBatch.dhTag == USE_COPY_DH) || (gBatch.dhTag == USE_PROGRESSIVE_DH))
+        FileCatalog_MakeURLsWithBase(gBatch.catalog, gBatch.urlBase);
+
+    gBatch.importTimes = calloc([gBatch.files count], sizeof(UInt64));
+
+    gBatch.fileNames = [[NSCountedSet alloc] initWithCapacity:[gBatch.files count]];
+    for (i = 0; i < [gBatch.files count]; i++)
+        [gBatch.fileNames addObject:[NSString stringWithUTF8String:[[gBatch.files objectAtIndex:i] fileName]]];
+
+    // set up the output folder, the folder for copies and the metrics file
+    mkdir(gBatch.outFolder, 0755);
+    if (gBatch.copyFolder == NULL)
+        gBatch.copyFolder = gBatch.outFolder;
+    mkdir(gBatch.copyFolder, 0755);
+
+    if (metricsPath == NULL) {
+        snprintf(defaultMetricsPath, sizeof(defaultMetricsPath), "%s/metrics.csv", gBatch.outFolder);
+        metricsPath = defaultMetricsPath;
+    }
+
+    length = strlen(metricsPath);
+    gBatch.metricsAsJSON = (length > 5) && (strcmp(metricsPath + length - 5, ".json") == 0);
+    gBatch.metricsFile = fopen(metricsPath, "w");
+    if (gBatch.metricsFile == NULL) {
+        fprintf(stderr, "can't open metrics file \"%s\"\n", metricsPath);
+        status = 1;
+        goto bail;
+    }
+
+    if (gBatch.metricsAsJSON)
+        fprintf(gBatch.metricsFile, "[\n");
+    else
+        fprintf(gBatch.metricsFile, "path,status,naturalWidth,naturalHeight,frameWidth,frameHeight,importMicroseconds,worker,retried,copyBytesPerSecond\n");
+
+    // start a request on each worker; each response sends that worker the next file, so the
+    // workers share the batch between them however long each file takes. With -dh copy the files are
+    // copied on the transfer engine's own threads first, and each worker waits for the next copy
+    if (gBatch.dhTag == USE_COPY_DH)
+        QTDR_SetMaxConcurrentTransfers(gBatch.numTransfers);
+
+    Microseconds(&startTime);
+    for (i = 0; i < gBatch.numWorkers; i++) {
+        WorkerThreadRef outWorker = NULL;
+
+        if (createWorkerThread(batchActionRoutine, NULL, batchResponseMainThreadCallback, &gBatch, &outWorker) != noErr) {
+            fprintf(stderr, "createWorkerThread failed\n");
+            break;
+        }
+        gBatch.workers[i] = outWorker;
+        sendNextBatchRequest(i);
+    }
+
+    // the workers that did start share the whole batch; with none, nothing would ever finish
+    gBatch.numWorkers = i;
+    if (gBatch.numWorkers == 0) {
+        fprintf(stderr, "no workers to import with\n");
+        status = 1;
+        goto bail;
+    }
+
+    if (gBatch.dhTag == USE_COPY_DH)
+        runBatchCopies();
+
+    // the responses come in on the main event loop; batchResponseMainThreadCallback quits it when we're done
+    while (gBatch.numDone < [gBatch.files count])
+        RunCurrentEventLoop(kEventDurationForever);
+    Microseconds(&endTime);
+
+    if (gBatch.metricsAsJSON)
+        fprintf(gBatch.metricsFile, "\n]\n");
+
+    fprintf(stderr, "imported %u of %u files\n", (unsigned)(gBatch.numDone - gBatch.numFailed), (unsigned)gBatch.numDone);
+    printBatchSummary(UnsignedWideToUInt64(endTime) - UnsignedWideToUInt64(startTime));
+    ImportRouting_GetStatistics(&routingStats);
+    fprintf(stderr, "the routing table sent %u files to the main thread; %u kinds of file need it\n",
+            (unsigned)routingStats.hits, (unsigned)routingStats.numEntries);
+    if (gBatch.numFailed > 0)
+        status = 1;
+
+bail:
+    for (i = 0; i < kBatchMaxWorkers; i++)
+        if (gBatch.workers[i] != NULL)
+            releaseWorkerThread(gBatch.workers[i]);
+    QTDR_ReleaseTransferWorkers();
+
+    if (gBatch.metricsFile != NULL)
+        fclose(gBatch.metricsFile);
+
+    free(gBatch.importTimes);
+    [gBatch.fileNames release];
+    [gBatch.files release];
+    FileCatalog_Release(gBatch.catalog);
+    [pool release];
+
+    return status;
+}
+
+#pragma mark-
+
+//////////
+//
+// building the list of files
+//
+//////////
+
+static void addBatchFile (const char *thePath)
+{
+    FileObject *aFileObject;
+    const char *fileName;
+    char folder[PATH_MAX];
+    size_t folderLength;
+    UInt32 index;
+    struct stat fileStat;
+
+    if (stat(thePath, &fileStat) != 0) {
+        fprintf(stderr, "can't find \"%s\"\n", thePath);
+        return;
+    }
+
+    if (S_ISDIR(fileStat.st_mode)) {
+        addBatchFolder(thePath);
+        return;
+    }
+
+    if (!S_ISREG(fileStat.st_mode))
+        return;
+
+    // split the path into its folder and name, as the catalog wants
+    fileName = strrchr(thePath, '/');
+    if (fileName != NULL) {
+        folderLength = fileName - thePath;
+        fileName++;
+    } else {
+        fileName = thePath;
+        thePath = ".";
+        folderLength = 1;
+    }
+
+    if (folderLength >= sizeof(folder))
+        return;
+
+    memcpy(folder, thePath, folderLength);
+    folder[folderLength] = 0;
+    if (FileCatalog_AddFile(gBatch.catalog, folder, fileName, &index) != noErr)
+        return;
+
+    aFileObject = [[FileObject alloc] initWithCatalog:gBatch.catalog index:index];
+    [gBatch.files addObject:aFileObject];
+    [aFileObject release];
+}
+
+static void addBatchFolder (const char *thePath)
+{
+    NSString *folder = [NSString stringWithCString:thePath];
+    NSEnumerator *enumerator = [[[NSFileManager defaultManager] directoryContentsAtPath:folder] objectEnumerator];
+    NSString *filename;
+
+    // as in selectFolder:, we take the visible files in the folder but don't descend into subfolders
+    while (filename = [enumerator nextObject]) {
+        NSString *path;
+        NSDictionary *fattrs;
+
+        if (([filename length] == 0) || ([filename characterAtIndex:0] == '.'))
+            continue;
+
+        path = [folder stringByAppendingPathComponent:filename];
+        fattrs = [[NSFileManager defaultManager] fileAttributesAtPath:path traverseLink:YES];
+        if ([fattrs objectForKey:NSFileType] == NSFileTypeRegular)
+            addBatchFile([path fileSystemRepresentation]);
+    }
+}
+
+static void addBatchFileList (const char *thePath)
+{
+    FILE *list;
+    char line[PATH_MAX];
+
+    list = fopen(thePath, "r");
+    if (list == NULL) {
+        fprintf(stderr, "can't open file list \"%s\"\n", thePath);
+        return;
+    }
+
+    while (fgets(line, sizeof(line), list) != NULL) {
+        size_t length = strlen(line);
+
+        while ((length > 0) && ((line[length - 1] == '\n') || (line[length - 1] == '\r')))
+            line[--length] = 0;
+
+        if (length > 0)
+            addBatchFile(line);
+    }
+
+    fclose(list);
+}
+
+#pragma mark-
+
+//////////
+//
+// requests and responses
+//
+//////////
+
+// make the item for the next file in the batch, configured the way a document configures its thread data by default;
+// return NULL when there are no more files, or no memory for them, in which case the rest of the batch has failed
+static BatchItem *newBatchItem (void)
+{
+    BatchItem *item;
+
+    if (gBatch.nextFile >= [gBatch.files count])
+        return NULL;
+
+    item = calloc(1, sizeof(BatchItem));
+    if (item == NULL) {
+        // we can't go on without memory; give up on the rest of the batch
+        gBatch.numFailed += [gBatch.files count] - gBatch.nextFile;
+        gBatch.numDone += [gBatch.files count] - gBatch.nextFile;
+        gBatch.nextFile = [gBatch.files count];
+        return NULL;
+    }
+
+    item->threadData.fileObject = [gBatch.files objectAtIndex:gBatch.nextFile++];
+    item->threadData.dhTag = gBatch.dhTag;
+    item->threadData.threadModelTag = USE_POSIX_THREAD;
+    item->threadData.onlySafeComps = true;
+    item->threadData.useFileName = true;
+    item->threadData.movieRect = gBatch.frameRect;
+    item->threadData.decodeAtDisplaySize = !EmptyRect(&gBatch.frameRect);
+    item->threadData.numContactFrames = gBatch.numContactFrames;
+    item->threadData.copyFolder = gBatch.copyFolder;
+
+    // the thumbnail cache belongs to the browser windows; a batch run of a whole folder, at whatever
+    // output size it was given, would only push their frames out
+    item->threadData.skipThumbnailCache = true;
+
+    return item;
+}
+
+// give theWorker the next file to import; with -dh copy that's the next copy to finish, and a worker
+// with none to import is left idle until runBatchCopies has one for it
+static void sendNextBatchRequest (UInt32 theWorker)
+{
+    BatchItem *item;
+
+    while (true) {
+        if (gBatch.dhTag == USE_COPY_DH) {
+            item = gBatch.copiedHead;
+            if (item == NULL) {
+                gBatch.idle[theWorker] = true;
+                return;
+            }
+            gBatch.copiedHead = item->nextCopied;
+            if (gBatch.copiedHead == NULL)
+                gBatch.copiedTail = NULL;
+            gBatch.numCopiesPending--;
+        } else {
+            item = newBatchItem();
+            if (item == NULL)
+                return;
+        }
+
+        if (sendBatchItem(item, theWorker))
+            return;
+    }
+}
+
+// send theItem to theWorker; return false if it was finished here instead, so the worker is still free
+static Boolean sendBatchItem (BatchItem *theItem, UInt32 theWorker)
+{
+    Rect tinyRect = {0, 0, 1, 1};
+    FileObject *aFileObject = theItem->threadData.fileObject;
+    WorkerRequestRef request = NULL;
+    OSErr err = noErr;
+
+    theItem->worker = theWorker;
+
+    err = GWorldPool_Get(&tinyRect, k32ARGBPixelFormat, &theItem->threadData.tinyGW);
+    if (err == noErr)
+        LockPixels(GetPortPixMap(theItem->threadData.tinyGW));
+
+    // if we've learned that files like this one need components that aren't thread-safe,
+    // import it here and now rather than making a worker fail with it first
+    if ((err == noErr) && ImportRouting_NeedsMainThread([aFileObject fileType], [aFileObject mimeType], 0)) {
+        ImportRouting_CountImport(true);
+        theItem->threadData.retry = true;
+        finishBatchItem(theItem);
+        return false;
+    }
+
+    if (err == noErr)
+        err = createWorkerRequest(gBatch.workers[theWorker], &request);
+
+    if (err == noErr) {
+        setWorkerRequestThreadData(request, theItem);
+        theItem->threadData.request = request;
+        theItem->threadData.busy = true;
+        err = sendWorkerRequest(request);
+        if (err == noErr)
+            return true;
+    }
+
+    // count it as done, so that we don't wait for it, and give this worker the next file instead
+    fprintf(stderr, "can't send \"%s\" to a worker (%d)\n", [aFileObject fileName], (int)err);
+    writeMetrics(theItem, err);
+    if (request != NULL)
+        releaseWorkerRequest(request);
+    disposeBatchItem(theItem);
+    gBatch.numDone++;
+    gBatch.numFailed++;
+
+    return false;
+}
+
+// queue copies with the transfer engine, which runs up to -transfers of them at once, and hand the copies that
+// are done to the idle workers. Only a few more copies are queued than can be under way and being imported,
+// so that the batch doesn't hold a transfer and a copy on disk for every file before it imports any
+static void runBatchCopies (void)
+{
+    BatchItem *item;
+    Boolean fedWorker = true;
+    UInt32 i;
+
+    while (fedWorker) {
+        fedWorker = false;
+
+        while ((gBatch.numCopiesPending < gBatch.numTransfers + gBatch.numWorkers) && ((item = newBatchItem()) != NULL)) {
+            gBatch.numCopiesPending++;
+            if ((newImportTransfer(&item->threadData) == noErr) &&
+                    (QTDR_QueueTransfer(item->threadData.transfer, batchCopyDoneProc, item) == noErr))
+                continue;
+
+            // send it on without a copy; importTheMovie will try to make one itself, and report why it can't
+            if (item->threadData.transfer != NULL) {
+                QTDR_DisposeTransfer(item->threadData.transfer);
+                item->threadData.transfer = NULL;
+            }
+            addCopiedBatchItem(item);
+        }
+
+        for (i = 0; (i < gBatch.numWorkers) && (gBatch.copiedHead != NULL); i++) {
+            if (gBatch.idle[i]) {
+                gBatch.idle[i] = false;
+                sendNextBatchRequest(i);
+                fedWorker = true;
+            }
+        }
+    }
+
+    if (gBatch.numDone >= [gBatch.files count])
+        QuitEventLoop(GetMainEventLoop());
+}
+
+static void addCopiedBatchItem (BatchItem *theItem)
+{
+    theItem->nextCopied = NULL;
+    if (gBatch.copiedTail != NULL)
+        gBatch.copiedTail->nextCopied = theItem;
+    else
+        gBatch.copiedHead = theItem;
+    gBatch.copiedTail = theItem;
+}
+
+// called on the main thread when QTDR_QueueTransfer is done with a copy, whether or not it succeeded
+static void batchCopyDoneProc (QTDRTransferPtr theTransfer, void *theRefCon)
+{
+#pragma unused(theTransfer)
+
+    addCopiedBatchItem((BatchItem *)theRefCon);
+    runBatchCopies();
+}
+
+static void disposeBatchItem (BatchItem *theItem)
+{
+    // the Movie may still draw into either GWorld, so dispose of it before they go back to the pool
+    disposeImportState(&theItem->threadData);
+
+    if (theItem->threadData.gWorld != NULL)
+        GWorldPool_Put(theItem->threadData.gWorld);
+
+    if (theItem->threadData.tinyGW != NULL)
+        GWorldPool_Put(theItem->threadData.tinyGW);
+
+    free(theItem);
+}
+
+void batchActionRoutine (void *refcon, WorkerRequestRef request)
+{
+    BatchItem *item = NULL;
+    UnsignedWide startTime, endTime;
+
+    getWorkerRequestThreadData(request, (void **)&item);
+    if (item == NULL)
+        return;
+
+    Microseconds(&startTime);
+    item->importErr = importTheMovie(&item->threadData);
+    Microseconds(&endTime);
+
+    item->importTime = UnsignedWideToUInt64(endTime) - UnsignedWideToUInt64(startTime);
+}
+
+void batchResponseMainThreadCallback (void *refcon, WorkerRequestRef request)
+{
+    BatchItem *item = NULL;
+    UInt32 worker;
+
+    getWorkerRequestThreadData(request, (void **)&item);
+    releaseWorkerRequest(request);
+    if (item == NULL)
+        return;
+
+    item->threadData.request = NULL;
+    worker = item->worker;
+    finishBatchItem(item);
+
+    // keep this worker busy, and with -dh copy keep the copies coming
+    sendNextBatchRequest(worker);
+    if (gBatch.dhTag == USE_COPY_DH)
+        runBatchCopies();
+
+    if (gBatch.numDone >= [gBatch.files count])
+        QuitEventLoop(GetMainEventLoop());
+}
+
+// retry the import on the main thread if need be, write out the frame and the metrics, and dispose of theItem
+static void finishBatchItem (BatchItem *theItem)
+{
+    FileObject *aFileObject = theItem->threadData.fileObject;
+    char framePath[PATH_MAX];
+    OSErr err = noErr;
+
+    // as in the document, files that need components which aren't thread-safe get another go on the main thread
+    if (theItem->threadData.retry) {
+        UnsignedWide startTime, endTime;
+
+        // remember this, so that the next file like this one doesn't go to a worker
+        ImportRouting_NoteNeedsMainThread([aFileObject fileType], [aFileObject mimeType], theItem->threadData.failedCodecType);
+
+        if (theItem->threadData.gWorld != NULL)
+            GWorldPool_Put(theItem->threadData.gWorld);
+        theItem->threadData.gWorld = NULL;
+        theItem->threadData.retry = false;
+        theItem->threadData.onlySafeComps = false;
+        theItem->threadData.threadModelTag = USE_MAIN_THREAD;
+        theItem->retried = true;
+
+        Microseconds(&startTime);
+        theItem->importErr = importTheMovie(&theItem->threadData);
+        Microseconds(&endTime);
+        theItem->importTime += UnsignedWideToUInt64(endTime) - UnsignedWideToUInt64(startTime);
+    }
+    theItem->threadData.busy = false;
+
+    if (theItem->threadData.transfer != NULL) {
+        theItem->copyThroughput = QTDR_GetTransferThroughput(theItem->threadData.transfer);
+        if (QTDR_GetTransferError(theItem->threadData.transfer) == noErr) {
+            gBatch.copyThroughput += theItem->copyThroughput;
+            gBatch.numCopied++;
+        }
+    }
+
+    if (theItem->threadData.imported) {
+        if (!EmptyRect(&gBatch.scaleBenchRect))
+            timeFrameScaling(theItem->threadData.gWorld);
+
+        makeFramePath(aFileObject, framePath, sizeof(framePath));
+        err = writeFramePNG(theItem->threadData.gWorld, framePath);
+        if (err != noErr)
+            fprintf(stderr, "can't write \"%s\" (%d)\n", framePath, (int)err);
+    } else {
+        err = (theItem->importErr != noErr) ? theItem->importErr : badFormat;
+    }
+
+    writeMetrics(theItem, err);
+    if (err != noErr) {
+        gBatch.numFailed++;
+    } else if (gBatch.importTimes != NULL) {
+        gBatch.importTimes[gBatch.numImported++] = theItem->importTime;
+        gBatch.bytesImported += FileCatalog_GetFileSize([aFileObject catalog], [aFileObject catalogIndex]);
+    }
+    gBatch.numDone++;
+
+    disposeBatchItem(theItem);
+}
+
+#pragma mark-
+
+//////////
+//
+// output
+//
+//////////
+
+// the frame of a file goes to <out>/<name>.png, unless another file in the batch has the same name,
+// in which case a hash of the folder it came from goes in as well: <out>/<name>-<hash>.png
+static void makeFramePath (FileObject *theFileObject, char *outPath, size_t theSize)
+{
+    const char *fileName = [theFileObject fileName];
+    const char *pathName = [theFileObject pathName];
+    const char *c;
+    UInt32 hash = 2166136261UL;
+
+    if ([gBatch.fileNames countForObject:[NSString stringWithUTF8String:fileName]] < 2) {
+        snprintf(outPath, theSize, "%s/%s.png", gBatch.outFolder, fileName);
+        return;
+    }
+
+    // FNV-1a, over the folder part of the path name
+    for (c = pathName; c < pathName + strlen(pathName) - strlen(fileName); c++)
+        hash = (hash ^ (UInt8)*c) * 16777619UL;
+
+    snprintf(outPath, theSize, "%s/%s-%08lx.png", gBatch.outFolder, fileName, (unsigned long)hash);
+}
+
+static OSErr writeFramePNG (GWorldPtr theGWorld, const char *thePath)
+{
+    GraphicsExportComponent exporter = NULL;
+    unsigned long sizeWritten;
+    FSRef fileRef;
+    FSSpec fileSpec;
+    int fd;
+    OSErr err = noErr;
+
+    // GraphicsExportSetOutputFile wants an FSSpec, and we can only get one of those for a file that exists
+    fd = open(thePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return ioErr;
+    close(fd);
+
+    err = FSPathMakeRef((const UInt8 *)thePath, &fileRef, NULL);
+    if (err == noErr)
+        err = FSGetCatalogInfo(&fileRef, kFSCatInfoNone, NULL, NULL, &fileSpec, NULL);
+    if (err != noErr)
+        goto bail;
+
+    err = OpenADefaultComponent(GraphicsExporterComponentType, kQTFileTypePNG, &exporter);
+    if (err != noErr)
+        goto bail;
+
+    err = GraphicsExportSetInputGWorld(exporter, theGWorld);
+    if (err == noErr)
+        err = GraphicsExportSetOutputFile(exporter, &fileSpec);
+    if (err == noErr)
+        err = GraphicsExportDoExport(exporter, &sizeWritten);
+
+bail:
+    if (exporter != NULL)
+        CloseComponent(exporter);
+
+    return err;
+}
+
+// shrink theGWorld to fit gBatch.scaleBenchRect both ways a browser window can, and add up how long each took:
+// with the box filter the workers use when they scale frames, and with the CopyBits that updateQDMovieView scales with
+static void timeFrameScaling (GWorldPtr theGWorld)
+{
+    GWorldPtr boxGW = NULL, copyBitsGW = NULL;
+    CGrafPtr savedPort = NULL;
+    GDHandle savedGDevice = NULL;
+    UnsignedWide startTime, middleTime, endTime;
+    Rect srcRect, fitRect;
+
+    GetPortBounds(theGWorld, &srcRect);
+    getAspectFitRect(&srcRect, &gBatch.scaleBenchRect, &fitRect);
+    if ((fitRect.right == srcRect.right - srcRect.left) && (fitRect.bottom == srcRect.bottom - srcRect.top))
+        return;		// it already fits; neither way has anything to do
+
+    if ((GWorldPool_Get(&fitRect, k32ARGBPixelFormat, &boxGW) != noErr) ||
+        (GWorldPool_Get(&fitRect, k32ARGBPixelFormat, &copyBitsGW) != noErr))
+        goto bail;
+
+    GetGWorld(&savedPort, &savedGDevice);
+    LockPixels(GetGWorldPixMap(theGWorld));
+    LockPixels(GetGWorldPixMap(copyBitsGW));
+    SetGWorld(copyBitsGW, NULL);
+
+    Microseconds(&startTime);
+    ImageScale_BoxGWorld(theGWorld, boxGW);
+    Microseconds(&middleTime);
+    CopyBits(GetPortBitMapForCopyBits(theGWorld), GetPortBitMapForCopyBits(copyBitsGW), &srcRect, &fitRect, srcCopy, NULL);
+    Microseconds(&endTime);
+
+    SetGWorld(savedPort, savedGDevice);
+    UnlockPixels(GetGWorldPixMap(copyBitsGW));
+
+    gBatch.boxScaleTime += UnsignedWideToUInt64(middleTime) - UnsignedWideToUInt64(startTime);
+    gBatch.copyBitsScaleTime += UnsignedWideToUInt64(endTime) - UnsignedWideToUInt64(middleTime);
+    gBatch.numScaled++;
+
+bail:
+    if (copyBitsGW != NULL)
+        GWorldPool_Put(copyBitsGW);
+    if (boxGW != NULL)
+        GWorldPool_Put(boxGW);
+}
+
+static void writeMetrics (BatchItem *theItem, OSErr theErr)
+{
+    FileObject *aFileObject = theItem->threadData.fileObject;
+    const char *path = [aFileObject pathName];
+    UInt32 frameWidth = 0, frameHeight = 0;
+    const char *c;
+
+    if (theItem->threadData.gWorld != NULL) {
+        Rect bounds;
+
+        GetPortBounds(theItem->threadData.gWorld, &bounds);
+        frameWidth = bounds.right - bounds.left;
+        frameHeight = bounds.bottom - bounds.top;
+    }
+
+    if (gBatch.metricsAsJSON) {
+        fprintf(gBatch.metricsFile, "%s  {\"path\": \"", (gBatch.numDone > 0) ? ",\n" : "");
+        for (c = path; *c; c++) {
+            if ((*c == '"') || (*c == '\\'))
+                fputc('\\', gBatch.metricsFile);
+            fputc(*c, gBatch.metricsFile);
+        }
+        fprintf(gBatch.metricsFile, "\", \"status\": %d, \"naturalWidth\": %u, \"naturalHeight\": %u, "
+                "\"frameWidth\": %u, \"frameHeight\": %u, \"importMicroseconds\": %llu, \"worker\": %u, \"retried\": %s, "
+                "\"copyBytesPerSecond\": %.0f}",
+                (int)theErr, (unsigned)theItem->threadData.naturalWidth, (unsigned)theItem->threadData.naturalHeight,
+                (unsigned)frameWidth, (unsigned)frameHeight, (unsigned long long)theItem->importTime,
+                (unsigned)theItem->worker, theItem->retried ? "true" : "false", theItem->copyThroughput);
+    } else {
+        fputc('"', gBatch.metricsFile);
+        for (c = path; *c; c++) {
+            if (*c == '"')
+                fputc('"', gBatch.metricsFile);
+            fputc(*c, gBatch.metricsFile);
+        }
+        fprintf(gBatch.metricsFile, "\",%d,%u,%u,%u,%u,%llu,%u,%d,%.0f\n",
+                (int)theErr, (unsigned)theItem->threadData.naturalWidth, (unsigned)theItem->threadData.naturalHeight,
+                (unsigned)frameWidth, (unsigned)frameHeight, (unsigned long long)theItem->importTime,
+                (unsigned)theItem->worker, theItem->retried ? 1 : 0, theItem->copyThroughput);
+    }
+}
+
+// print the aggregate throughput of the batch, and the spread of the per-file import times, so that runs
+// with different numbers of workers or data handlers (or against different servers) can be compared
+static void printBatchSummary (UInt64 theElapsedTime)
+{
+    UInt64 *times = gBatch.importTimes;
+    UInt32 count = gBatch.numImported;
+    double seconds = theElapsedTime / 1000000.0;
+
+    if ((count == 0) || (seconds <= 0))
+        return;
+
+    fprintf(stderr, "%u workers: %.2f s, %.1f files/s, %.2f MB/s\n", (unsigned)gBatch.numWorkers, seconds,
+            count / seconds, gBatch.bytesImported / seconds / (1024.0 * 1024.0));
+
+    qsort(times, count, sizeof(UInt64), compareImportTimes);
+    fprintf(stderr, "import time (ms): min %.1f, median %.1f, 95th percentile %.1f, max %.1f\n",
+            times[0] / 1000.0, times[count / 2] / 1000.0, times[(count * 95) / 100] / 1000.0, times[count - 1] / 1000.0);
+
+    if (gBatch.numCopied > 0)
+        fprintf(stderr, "copied %u files at %.2f MB/s each, on average\n", (unsigned)gBatch.numCopied,
+                gBatch.copyThroughput / gBatch.numCopied / (1024.0 * 1024.0));
+
+    if (gBatch.numScaled > 0)
+        fprintf(stderr, "shrinking %u frames to fit %dx%d (ms per frame): box filter %.3f (%s), CopyBits %.3f\n",
+                (unsigned)gBatch.numScaled, gBatch.scaleBenchRect.right, gBatch.scaleBenchRect.bottom,
+                gBatch.boxScaleTime / 1000.0 / gBatch.numScaled, ImageScale_IsVectorized() ? "vector" : "scalar",
+                gBatch.copyBitsScaleTime / 1000.0 / gBatch.numScaled);
+}
+
+static int compareImportTimes (const void *theTime1, const void *theTime2)
+{
+    UInt64 time1 = *(const UInt64 *)theTime1;
+    UInt64 time2 = *(const UInt64 *)theTime2;
+
+    return (time1 < time2) ? -1 : (time1 > time2);
+}
+
+static void printBatchUsage (void)
+{
+    fprintf(stderr, "usage: ThreadsImportMovie " kBatchImportFlag " [-workers n] [-out folder] [-metrics file.csv|file.json]\n"
+                    "           [-list file] [-size WxH] [-contact k] [-dh file|handle|pointer|url|copy|progressive]\n"
+                    "           [-urlbase url] [-copyto folder] [-transfers n] [-scalebench WxH] file|folder ...\n");
+}
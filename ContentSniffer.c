@@ -0,0 +1,219 @@
+/*
+	File:		ContentSniffer.c
+	
+	Description: Recognize movie, image and audio files (and some files that are none of those)
+			     from the magic bytes at the start of the file.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ContentSniffer.h"
+
+//////////
+//
+// data structures
+//
+//////////
+
+// A signature is one or two runs of bytes at fixed offsets; a file matches if both runs do.
+typedef struct {
+    uint16_t				offset;
+    uint8_t					length;
+    unsigned char			bytes[16];
+} ContentSnifferTest;
+
+typedef struct {
+    ContentSnifferTest		tests[2];		// the second test is skipped if its length is 0
+    ContentSnifferMatch		match;
+} ContentSnifferSignature;
+
+#define FOURCC					CONTENT_SNIFFER_FOURCC
+#define MOVIE(t, m, d)			{ kContentSnifferMovie, t, m, d }
+#define IMAGE(t, m, d)			{ kContentSnifferImage, t, m, d }
+#define AUDIO(t, m, d)			{ kContentSnifferAudio, t, m, d }
+#define NOT_MEDIA(m, d)			{ kContentSnifferNotMedia, 0, m, d }
+
+//////////
+//
+// static global variables
+//
+//////////
+
+// Signatures are tried in order, so the more specific ones must come first
+// (for instance, the ISO file type brands before the plain ISO file type box).
+static const ContentSnifferSignature gSignatures[] = {
+    // QuickTime and MPEG-4 family: a box type at offset 4, and for ISO files a brand at offset 8
+    { { { 4, 8, "ftypqt  " } },					MOVIE(FOURCC('M','o','o','V'), "video/quicktime", "QuickTime movie") },
+    { { { 4, 8, "ftypM4A " } },					AUDIO(FOURCC('M','4','A',' '), "audio/x-m4a", "MPEG-4 audio") },
+    { { { 4, 8, "ftypM4B " } },					AUDIO(FOURCC('M','4','B',' '), "audio/x-m4b", "MPEG-4 audio book") },
+    { { { 4, 7, "ftyp3gp" } },					MOVIE(FOURCC('3','g','p','p'), "video/3gpp", "3GPP movie") },
+    { { { 4, 7, "ftyp3g2" } },					MOVIE(FOURCC('3','g','p','2'), "video/3gpp2", "3GPP2 movie") },
+    { { { 4, 8, "ftypmjp2" } },					MOVIE(FOURCC('m','j','p','2'), "video/mj2", "Motion JPEG 2000 movie") },
+    { { { 4, 8, "ftypjp2 " } },					IMAGE(FOURCC('j','p','2',' '), "image/jp2", "JPEG 2000 image") },
+    { { { 4, 4, "ftyp" } },						MOVIE(FOURCC('m','p','g','4'), "video/mp4", "MPEG-4 movie") },
+    { { { 4, 4, "moov" } },						MOVIE(FOURCC('M','o','o','V'), "video/quicktime", "QuickTime movie") },
+    { { { 4, 4, "mdat" } },						MOVIE(FOURCC('M','o','o','V'), "video/quicktime", "QuickTime movie") },
+    { { { 4, 4, "wide" } },						MOVIE(FOURCC('M','o','o','V'), "video/quicktime", "QuickTime movie") },
+    { { { 4, 4, "free" } },						MOVIE(FOURCC('M','o','o','V'), "video/quicktime", "QuickTime movie") },
+    { { { 4, 4, "skip" } },						MOVIE(FOURCC('M','o','o','V'), "video/quicktime", "QuickTime movie") },
+    { { { 4, 4, "pnot" } },						MOVIE(FOURCC('M','o','o','V'), "video/quicktime", "QuickTime movie") },
+
+    // RIFF and IFF containers
+    { { { 0, 4, "RIFF" }, { 8, 4, "AVI " } },	MOVIE(FOURCC('V','f','W',' '), "video/avi", "AVI movie") },
+    { { { 0, 4, "RIFF" }, { 8, 4, "WAVE" } },	AUDIO(FOURCC('W','A','V','E'), "audio/wav", "WAVE audio") },
+    { { { 0, 4, "FORM" }, { 8, 4, "AIFF" } },	AUDIO(FOURCC('A','I','F','F'), "audio/aiff", "AIFF audio") },
+    { { { 0, 4, "FORM" }, { 8, 4, "AIFC" } },	AUDIO(FOURCC('A','I','F','C'), "audio/aiff", "AIFF-C audio") },
+
+    // MPEG: program streams, elementary video streams, and transport streams (a sync byte every 188 bytes)
+    { { { 0, 4, "\x00\x00\x01\xBA" } },			MOVIE(FOURCC('M','P','E','G'), "video/mpeg", "MPEG program stream") },
+    { { { 0, 4, "\x00\x00\x01\xB3" } },			MOVIE(FOURCC('M','P','E','G'), "video/mpeg", "MPEG video") },
+    { { { 0, 1, "\x47" }, { 188, 1, "\x47" } },	MOVIE(FOURCC('M','P','E','G'), "video/mp2t", "MPEG transport stream") },
+    { { { 0, 3, "ID3" } },						AUDIO(FOURCC('M','P','3',' '), "audio/mpeg", "MP3 audio") },
+    { { { 0, 2, "\xFF\xFB" } },					AUDIO(FOURCC('M','P','3',' '), "audio/mpeg", "MP3 audio") },
+    { { { 0, 2, "\xFF\xF3" } },					AUDIO(FOURCC('M','P','3',' '), "audio/mpeg", "MP3 audio") },
+    { { { 0, 2, "\xFF\xF2" } },					AUDIO(FOURCC('M','P','3',' '), "audio/mpeg", "MP3 audio") },
+
+    // other movies and sounds
+    { { { 0, 3, "FWS" } },						MOVIE(FOURCC('S','W','F','L'), "application/x-shockwave-flash", "Flash movie") },
+    { { { 0, 3, "CWS" } },						MOVIE(FOURCC('S','W','F','L'), "application/x-shockwave-flash", "Flash movie") },
+    { { { 0, 4, "MThd" } },						AUDIO(FOURCC('M','i','d','i'), "audio/midi", "MIDI file") },
+    { { { 0, 4, ".snd" } },						AUDIO(FOURCC('U','L','A','W'), "audio/basic", "Sun audio") },
+
+    // still images
+    { { { 0, 3, "\xFF\xD8\xFF" } },				IMAGE(FOURCC('J','P','E','G'), "image/jpeg", "JPEG image") },
+    { { { 0, 8, "\x89PNG\r\n\x1A\n" } },		IMAGE(FOURCC('P','N','G','f'), "image/png", "PNG image") },
+    { { { 0, 6, "GIF87a" } },					IMAGE(FOURCC('G','I','F','f'), "image/gif", "GIF image") },
+    { { { 0, 6, "GIF89a" } },					IMAGE(FOURCC('G','I','F','f'), "image/gif", "GIF image") },
+    { { { 0, 4, "II*\x00" } },					IMAGE(FOURCC('T','I','F','F'), "image/tiff", "TIFF image") },
+    { { { 0, 4, "MM\x00*" } },					IMAGE(FOURCC('T','I','F','F'), "image/tiff", "TIFF image") },
+    { { { 0, 4, "8BPS" } },						IMAGE(FOURCC('8','B','P','S'), "image/x-photoshop", "Photoshop image") },
+    { { { 0, 8, "\x00\x00\x00\x0CjP  " } },		IMAGE(FOURCC('j','p','2',' '), "image/jp2", "JPEG 2000 image") },
+    { { { 0, 2, "BM" } },						IMAGE(FOURCC('B','M','P','f'), "image/bmp", "BMP image") },
+    { { { 0, 4, "\x00\x00\x01\x00" } },			IMAGE(FOURCC('i','c','o','n'), "image/x-icon", "Windows icon") },
+    { { { 0, 4, "icns" } },						IMAGE(FOURCC('i','c','n','s'), "image/x-icns", "Mac OS icon") },
+
+    // things that are certainly not media; N.B.: XML and other text isn't here, since QuickTime media links (.qtl)
+    // and SMIL presentations are XML, and only QuickTime can tell those from any other XML file
+    { { { 0, 4, "%PDF" } },						NOT_MEDIA("application/pdf", "PDF document") },
+    { { { 0, 4, "PK\x03\x04" } },				NOT_MEDIA("application/zip", "zip archive") },
+    { { { 0, 2, "\x1F\x8B" } },					NOT_MEDIA("application/x-gzip", "gzip archive") },
+    { { { 0, 3, "BZh" } },						NOT_MEDIA("application/x-bzip2", "bzip2 archive") },
+    { { { 0, 6, "7z\xBC\xAF\x27\x1C" } },		NOT_MEDIA("application/x-7z-compressed", "7-Zip archive") },
+    { { { 0, 4, "Rar!" } },						NOT_MEDIA("application/x-rar-compressed", "RAR archive") },
+    { { { 0, 4, "\x7F" "ELF" } },				NOT_MEDIA("application/x-executable", "ELF executable") },
+    { { { 0, 4, "\xFE\xED\xFA\xCE" } },			NOT_MEDIA("application/x-mach-binary", "Mach-O executable") },
+    { { { 0, 4, "\xCE\xFA\xED\xFE" } },			NOT_MEDIA("application/x-mach-binary", "Mach-O executable") },
+    { { { 0, 4, "\xFE\xED\xFA\xCF" } },			NOT_MEDIA("application/x-mach-binary", "Mach-O executable") },
+    { { { 0, 4, "\xCF\xFA\xED\xFE" } },			NOT_MEDIA("application/x-mach-binary", "Mach-O executable") },
+    { { { 0, 4, "\xCA\xFE\xBA\xBE" } },			NOT_MEDIA("application/x-mach-binary", "universal binary or Java class") },
+    { { { 0, 8, "bplist00" } },					NOT_MEDIA("application/x-plist", "binary property list") },
+    { { { 0, 5, "{\\rtf" } },					NOT_MEDIA("text/rtf", "RTF document") },
+    { { { 0, 2, "#!" } },						NOT_MEDIA("text/plain", "script") },
+    { { { 0, 16, "SQLite format 3" } },			NOT_MEDIA("application/x-sqlite3", "SQLite database") }
+};
+
+#pragma mark-
+
+//////////
+//
+// public routines
+//
+//////////
+
+const ContentSnifferMatch *ContentSniffer_SniffBytes (const unsigned char *theHead, size_t theLength)
+{
+    const ContentSnifferSignature *signature;
+    const ContentSnifferTest *test;
+    size_t i, j;
+
+    if (theHead == NULL)
+        return NULL;
+
+    for (i = 0; i < sizeof(gSignatures) / sizeof(gSignatures[0]); i++) {
+        signature = &gSignatures[i];
+
+        for (j = 0; j < 2; j++) {
+            test = &signature->tests[j];
+            if (test->length == 0)
+                continue;
+            if ((test->offset + test->length > theLength) || (memcmp(theHead + test->offset, test->bytes, test->length) != 0))
+                break;
+        }
+
+        if (j == 2)
+            return &signature->match;
+    }
+
+    return NULL;
+}
+
+const ContentSnifferMatch *ContentSniffer_SniffFile (const char *thePath)
+{
+    unsigned char head[kContentSnifferHeadSize];
+    ssize_t length;
+    int fd;
+
+    if (thePath == NULL)
+        return NULL;
+
+    fd = open(thePath, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    length = read(fd, head, sizeof(head));
+    close(fd);
+
+    if (length <= 0)
+        return NULL;
+
+    return ContentSniffer_SniffBytes(head, (size_t)length);
+}
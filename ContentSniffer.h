@@ -0,0 +1,101 @@
+/*
+	File:		ContentSniffer.h
+	
+	Description: Recognize movie, image and audio files (and some files that are none of those)
+			     from the magic bytes at the start of the file.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef CONTENT_SNIFFER_H
+#define CONTENT_SNIFFER_H
+
+// N.B.: this uses only standard C and POSIX, so it can be built (and tested) anywhere
+
+#include <stddef.h>
+#include <stdint.h>
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kContentSnifferHeadSize			512		// bytes read from the start of a file; enough for every signature we know
+
+// what kind of file a match is
+enum {
+    kContentSnifferMovie			= 1,
+    kContentSnifferImage			= 2,
+    kContentSnifferAudio			= 3,
+    kContentSnifferNotMedia			= 4		// something we know QuickTime can't import, like a PDF or an archive
+};
+
+#define CONTENT_SNIFFER_FOURCC(a, b, c, d)	((uint32_t)(a) << 24 | (uint32_t)(b) << 16 | (uint32_t)(c) << 8 | (uint32_t)(d))
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct {
+    int				kind;
+    uint32_t		fileType;		// the Mac OS file type, or 0 for files that aren't media
+    const char *	mimeType;
+    const char *	description;
+} ContentSnifferMatch;
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// Match the first theLength bytes of a file against the signatures we know; returns NULL if none match.
+// The match returned is a constant, and is never freed. Safe to call from any thread.
+const ContentSnifferMatch *ContentSniffer_SniffBytes (const unsigned char *theHead, size_t theLength);
+
+// Read the start of the file at thePath and match it; returns NULL if the file can't be read or no signature matches.
+const ContentSnifferMatch *ContentSniffer_SniffFile (const char *thePath);
+
+#endif // CONTENT_SNIFFER_H
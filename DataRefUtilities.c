@@ -5,7 +5,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -14,7 +14,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -49,6 +49,9 @@
 #include "DataRefUtilities.h"
 
 
+static Handle QTDR_MakeDataRefWithExtensions (const void *theRecord, Size theRecordSize, const char *theFileName, OSType theFileType, StringPtr theMIMEType);
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // Data reference creation utilities.
@@ -121,6 +124,119 @@ Handle QTDR_MakePointerDataRef (void *thePtr, Size theLength)
 }
 
 
+//////////
+//
+// QTDR_MakeHandleDataRefWithExtensions
+// Return a handle data reference for the specified handle, tagged with a filenaming extension and,
+// optionally, file type and MIME type extensions. Pass NULL, 0 or NULL to leave any of them out.
+//
+// The caller is responsible for disposing of the handle returned by this function (by calling DisposeHandle).
+//
+//////////
+
+Handle QTDR_MakeHandleDataRefWithExtensions (Handle theHandle, const char *theFileName, OSType theFileType, StringPtr theMIMEType)
+{
+    return(QTDR_MakeDataRefWithExtensions(&theHandle, sizeof(Handle), theFileName, theFileType, theMIMEType));
+}
+
+
+//////////
+//
+// QTDR_MakePointerDataRefWithExtensions
+// Return a pointer data reference for the specified pointer, tagged with a filenaming extension and,
+// optionally, file type and MIME type extensions. Pass NULL, 0 or NULL to leave any of them out.
+//
+// The caller is responsible for disposing of the handle returned by this function (by calling DisposeHandle).
+//
+//////////
+
+Handle QTDR_MakePointerDataRefWithExtensions (void *thePtr, Size theLength, const char *theFileName, OSType theFileType, StringPtr theMIMEType)
+{
+    PointerDataRefRecord	myRecord;
+    
+    memset(&myRecord, 0, sizeof(myRecord));
+    myRecord.data = thePtr;
+    myRecord.dataLength = theLength;
+    
+    return(QTDR_MakeDataRefWithExtensions(&myRecord, sizeof(myRecord), theFileName, theFileType, theMIMEType));
+}
+
+
+//////////
+//
+// QTDR_MakeDataRefWithExtensions
+// Build a handle or pointer data reference and its extensions (see TN1195) in a single allocation.
+//
+// The size of the finished data reference is worked out first, so the handle is never grown;
+// calling PtrAndHand once per extension can move the handle (and copy its contents) each time.
+// If there's a file type or MIME type but no file name, an empty file name is written, since
+// the other extensions must follow a filenaming extension.
+//
+//////////
+
+static Handle QTDR_MakeDataRefWithExtensions (const void *theRecord, Size theRecordSize, const char *theFileName, OSType theFileType, StringPtr theMIMEType)
+{
+    Handle	myDataRef = NULL;
+    UInt8	*myPtr = NULL;
+    Size	mySize = theRecordSize;
+    Size	myNameLength = 0;
+    Boolean	myAddName = false;
+    UInt32	myAtom[3];
+    
+    if (theFileName != NULL) {
+        myNameLength = (Size)strlen(theFileName);
+        if (myNameLength > 255)
+            myNameLength = 255;
+    }
+    
+    myAddName = (theFileName != NULL) || (theFileType != 0) || (theMIMEType != NULL);
+    if (myAddName)
+        mySize += 1 + myNameLength;
+    if (theFileType != 0)
+        mySize += sizeof(UInt32) * 3;
+    if (theMIMEType != NULL)
+        mySize += sizeof(UInt32) * 2 + theMIMEType[0] + 1;
+    
+    myDataRef = NewHandle(mySize);
+    if (myDataRef == NULL)
+        goto bail;
+    
+    myPtr = (UInt8 *)*myDataRef;
+    
+    BlockMoveData(theRecord, myPtr, theRecordSize);
+    myPtr += theRecordSize;
+    
+    if (myAddName) {
+        // add a filenaming extension; this is a Pascal string, possibly empty
+        *myPtr++ = (UInt8)myNameLength;
+        if (myNameLength > 0)
+            BlockMoveData(theFileName, myPtr, myNameLength);
+        myPtr += myNameLength;
+    }
+    
+    if (theFileType != 0) {
+        // add a file type extension
+        myAtom[0] = EndianU32_NtoB(sizeof(UInt32) * 3);
+        myAtom[1] = EndianU32_NtoB(kDataRefExtensionMacOSFileType);
+        myAtom[2] = EndianU32_NtoB(theFileType);
+        BlockMoveData(myAtom, myPtr, sizeof(UInt32) * 3);
+        myPtr += sizeof(UInt32) * 3;
+    }
+    
+    if (theMIMEType != NULL) {
+        // add a MIME type extension
+        myAtom[0] = EndianU32_NtoB(sizeof(UInt32) * 2 + theMIMEType[0] + 1);
+        myAtom[1] = EndianU32_NtoB(kDataRefExtensionMIMEType);
+        BlockMoveData(myAtom, myPtr, sizeof(UInt32) * 2);
+        myPtr += sizeof(UInt32) * 2;
+        BlockMoveData(theMIMEType, myPtr, theMIMEType[0] + 1);
+    }
+    
+bail:
+    return(myDataRef);
+}
+
+
 //////////
 //
 // QTDR_MakeURLDataRef
@@ -5,7 +5,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -14,7 +14,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -51,4 +51,6 @@
 Handle QTDR_MakeFileDataRef (FSSpecPtr theFile);
 Handle QTDR_MakeHandleDataRef (Handle theHandle);
 Handle QTDR_MakePointerDataRef (void *thePtr, Size theLength);
+Handle QTDR_MakeHandleDataRefWithExtensions (Handle theHandle, const char *theFileName, OSType theFileType, StringPtr theMIMEType);
+Handle QTDR_MakePointerDataRefWithExtensions (void *thePtr, Size theLength, const char *theFileName, OSType theFileType, StringPtr theMIMEType);
 Handle QTDR_MakeURLDataRef (char *theURL);
\ No newline at end of file
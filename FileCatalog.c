@@ -0,0 +1,1123 @@
+/*
+	File:		FileCatalog.c
+	
+	Description: A catalog of the files in a folder: names and URLs in one string arena,
+			     everything else in parallel arrays.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FileCatalog.h"
+#include "ContentSniffer.h"
+#include "DataRefUtilities.h"
+#include "URLUtilities.h"
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kFileCatalogInitialCapacity		256
+
+// entry flags
+#define kFileCatalogProbed				0x01		// the file and MIME types have been probed
+#define kFileCatalogNotMedia			0x02		// the file is something QuickTime can't import
+#define kFileCatalogResolved			0x04		// the path has been resolved to an FSSpec and file data reference
+
+//////////
+//
+// data structures
+//
+//////////
+
+typedef struct FileCatalogArenaBlock {
+    struct FileCatalogArenaBlock *	next;
+    UInt32							size;
+    UInt32							used;
+    char							data[1];
+} FileCatalogArenaBlock;
+
+// One entry per file, spread across parallel arrays so that walking one field of every entry
+// touches only that field. Strings are never moved once they're in the arena.
+struct FileCatalog {
+    UInt32					refCount;
+    pthread_mutex_t			mutex;			// protects the reference count, the arena and the MIME types
+    pthread_mutex_t			entryLocks[kFileCatalogLockStripes];	// protect the per-entry fields below
+
+    FileCatalogArenaBlock *	arena;
+    const char *			folderPath;		// in the arena; NULL if the catalog isn't for a single folder
+    time_t					folderModTime;	// when the folder was last changed, as of the scan
+    StringPtr				mimeTypes[kFileCatalogMaxMIMETypes];	// in the arena; the first is always empty
+    UInt32					numMIMETypes;
+
+    UInt32					count;
+    UInt32					capacity;
+    const char **			pathNames;
+    UInt16 *				fileNameOffsets;	// into the path name
+    const char **			urls;				// NULL until first asked for
+    UInt8 *					flags;
+    OSType *				fileTypes;
+    UInt8 *					mimeTypeIndexes;	// into mimeTypes
+    SInt64 *				fileSizes;
+    time_t *				modTimes;			// the modification time and inode the entry was probed against
+    ino_t *					inodes;
+    FSSpec *				fileSpecs;
+    Handle *				fileDataRefs;
+    UInt32 *				naturalWidths;
+    UInt32 *				naturalHeights;
+    Float64 *				durations;
+};
+
+//////////
+//
+// static function declarations
+//
+//////////
+
+static char *ArenaCopyString (FileCatalogRef theCatalog, const char *theString, UInt32 theLength);
+static Boolean GrowArray (void *theArrayPtr, size_t theElementSize, UInt32 theCapacity);
+static OSErr GrowCatalog (FileCatalogRef theCatalog);
+static UInt8 InternMIMEType (FileCatalogRef theCatalog, ConstStringPtr theMIMEType);
+static OSErr ProbeEntry (FileCatalogRef theCatalog, UInt32 theIndex);
+static OSErr ResolveEntry (FileCatalogRef theCatalog, UInt32 theIndex);
+static UInt32 HashFileName (const char *theFileName);
+static Boolean GetIndexFolder (char *outPath, size_t theSize);
+static Boolean MakeIndexPath (const char *theFolderPath, char *outPath, size_t theSize);
+
+#define ENTRY_LOCK(cat, i)		(&(cat)->entryLocks[(i) % kFileCatalogLockStripes])
+
+#pragma mark-
+
+//////////
+//
+// public routines
+//
+//////////
+
+OSErr FileCatalog_Create (FileCatalogRef *outCatalog)
+{
+    FileCatalogRef catalog;
+    UInt32 i;
+
+    if (outCatalog == NULL)
+        return paramErr;
+
+    *outCatalog = NULL;
+
+    catalog = calloc(1, sizeof(struct FileCatalog));
+    if (catalog == NULL)
+        return memFullErr;
+
+    catalog->refCount = 1;
+    pthread_mutex_init(&catalog->mutex, NULL);
+    for (i = 0; i < kFileCatalogLockStripes; i++)
+        pthread_mutex_init(&catalog->entryLocks[i], NULL);
+
+    catalog->mimeTypes[0] = (StringPtr)ArenaCopyString(catalog, "", 1);
+    if (catalog->mimeTypes[0] == NULL) {
+        FileCatalog_Release(catalog);
+        return memFullErr;
+    }
+    catalog->numMIMETypes = 1;
+
+    *outCatalog = catalog;
+    return noErr;
+}
+
+void FileCatalog_Retain (FileCatalogRef theCatalog)
+{
+    if (theCatalog == NULL)
+        return;
+
+    pthread_mutex_lock(&theCatalog->mutex);
+    theCatalog->refCount++;
+    pthread_mutex_unlock(&theCatalog->mutex);
+}
+
+void FileCatalog_Release (FileCatalogRef theCatalog)
+{
+    FileCatalogArenaBlock *block;
+    UInt32 refCount, i;
+
+    if (theCatalog == NULL)
+        return;
+
+    pthread_mutex_lock(&theCatalog->mutex);
+    refCount = --theCatalog->refCount;
+    pthread_mutex_unlock(&theCatalog->mutex);
+
+    if (refCount > 0)
+        return;
+
+    for (i = 0; i < theCatalog->count; i++)
+        if (theCatalog->fileDataRefs[i] != NULL)
+            DisposeHandle(theCatalog->fileDataRefs[i]);
+
+    while ((block = theCatalog->arena) != NULL) {
+        theCatalog->arena = block->next;
+        free(block);
+    }
+
+    free(theCatalog->pathNames);
+    free(theCatalog->fileNameOffsets);
+    free(theCatalog->urls);
+    free(theCatalog->flags);
+    free(theCatalog->fileTypes);
+    free(theCatalog->mimeTypeIndexes);
+    free(theCatalog->fileSizes);
+    free(theCatalog->modTimes);
+    free(theCatalog->inodes);
+    free(theCatalog->fileSpecs);
+    free(theCatalog->fileDataRefs);
+    free(theCatalog->naturalWidths);
+    free(theCatalog->naturalHeights);
+    free(theCatalog->durations);
+
+    for (i = 0; i < kFileCatalogLockStripes; i++)
+        pthread_mutex_destroy(&theCatalog->entryLocks[i]);
+    pthread_mutex_destroy(&theCatalog->mutex);
+
+    free(theCatalog);
+}
+
+OSErr FileCatalog_AddFile (FileCatalogRef theCatalog, const char *theFolderPath, const char *theFileName, UInt32 *outIndex)
+{
+    UInt32 folderLength, nameLength, index;
+    char *pathName;
+    OSErr err = noErr;
+
+    if ((theCatalog == NULL) || (theFolderPath == NULL) || (theFileName == NULL))
+        return paramErr;
+
+    folderLength = strlen(theFolderPath);
+    nameLength = strlen(theFileName);
+    if (folderLength + 1 > 0xFFFF)
+        return bdNamErr;
+
+    if (theCatalog->count == theCatalog->capacity) {
+        err = GrowCatalog(theCatalog);
+        if (err != noErr)
+            return err;
+    }
+
+    // the path and the name share the same bytes: the name is just the tail of the path
+    pthread_mutex_lock(&theCatalog->mutex);
+    pathName = ArenaCopyString(theCatalog, NULL, folderLength + 1 + nameLength + 1);
+    pthread_mutex_unlock(&theCatalog->mutex);
+    if (pathName == NULL)
+        return memFullErr;
+
+    memcpy(pathName, theFolderPath, folderLength);
+    pathName[folderLength] = '/';
+    memcpy(pathName + folderLength + 1, theFileName, nameLength + 1);
+
+    index = theCatalog->count++;
+    theCatalog->pathNames[index] = pathName;
+    theCatalog->fileNameOffsets[index] = folderLength + 1;
+    theCatalog->urls[index] = NULL;
+    theCatalog->flags[index] = 0;
+    theCatalog->fileTypes[index] = 0;
+    theCatalog->mimeTypeIndexes[index] = 0;
+    theCatalog->fileSizes[index] = 0;
+    theCatalog->modTimes[index] = 0;
+    theCatalog->inodes[index] = 0;
+    theCatalog->fileDataRefs[index] = NULL;
+    theCatalog->naturalWidths[index] = 0;
+    theCatalog->naturalHeights[index] = 0;
+    theCatalog->durations[index] = 0;
+
+    if (outIndex != NULL)
+        *outIndex = index;
+
+    return noErr;
+}
+
+UInt32 FileCatalog_GetCount (FileCatalogRef theCatalog)
+{
+    return (theCatalog != NULL) ? theCatalog->count : 0;
+}
+
+const char *FileCatalog_GetPathName (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return NULL;
+
+    return theCatalog->pathNames[theIndex];
+}
+
+const char *FileCatalog_GetFileName (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return NULL;
+
+    return theCatalog->pathNames[theIndex] + theCatalog->fileNameOffsets[theIndex];
+}
+
+const char *FileCatalog_GetURL (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    const char *pathName;
+    char *url = NULL;
+    size_t pathLength, urlLength;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return NULL;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+
+    // create a url from the full pathname the first time it's needed, straight into the arena
+    // N.B.: we need to encode any special charaters in the pathname
+    if (theCatalog->urls[theIndex] == NULL) {
+        pathName = theCatalog->pathNames[theIndex];
+        pathLength = strlen(pathName);
+        urlLength = URLUtils_GetPOSIXPathURLLength(pathName, pathLength);
+
+        pthread_mutex_lock(&theCatalog->mutex);
+        url = ArenaCopyString(theCatalog, NULL, urlLength + 1);
+        pthread_mutex_unlock(&theCatalog->mutex);
+
+        if (url != NULL) {
+            URLUtils_POSIXPathToURLBuffer(pathName, pathLength, url);
+            theCatalog->urls[theIndex] = url;
+        }
+    }
+    url = (char *)theCatalog->urls[theIndex];
+
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return url;
+}
+
+OSErr FileCatalog_MakeURLs (FileCatalogRef theCatalog)
+{
+    size_t length;
+    char *urls;
+
+    if (theCatalog == NULL)
+        return paramErr;
+
+    length = URLUtils_GetPOSIXPathsURLLength(theCatalog->pathNames, theCatalog->count);
+    if (length == 0)
+        return noErr;
+
+    pthread_mutex_lock(&theCatalog->mutex);
+    urls = ArenaCopyString(theCatalog, NULL, length);
+    pthread_mutex_unlock(&theCatalog->mutex);
+    if (urls == NULL)
+        return memFullErr;
+
+    URLUtils_POSIXPathsToURLs(theCatalog->pathNames, theCatalog->count, urls, theCatalog->urls);
+
+    return noErr;
+}
+
+OSErr FileCatalog_MakeURLsWithBase (FileCatalogRef theCatalog, const char *theBaseURL)
+{
+    size_t baseLength, length = 0;
+    const char *fileName;
+    UInt32 index;
+    char *urls;
+
+    if (theCatalog == NULL)
+        return paramErr;
+
+    if (theBaseURL == NULL)
+        return FileCatalog_MakeURLs(theCatalog);
+
+    // we put a separator between the base and each file name, so drop any the base ends with
+    baseLength = strlen(theBaseURL);
+    while ((baseLength > 0) && (theBaseURL[baseLength - 1] == '/'))
+        baseLength--;
+
+    for (index = 0; index < theCatalog->count; index++) {
+        fileName = theCatalog->pathNames[index] + theCatalog->fileNameOffsets[index];
+        length += baseLength + 1 + URLUtils_GetEncodedLength(fileName, strlen(fileName)) + 1;
+    }
+    if (length == 0)
+        return noErr;
+
+    pthread_mutex_lock(&theCatalog->mutex);
+    urls = ArenaCopyString(theCatalog, NULL, length);
+    pthread_mutex_unlock(&theCatalog->mutex);
+    if (urls == NULL)
+        return memFullErr;
+
+    // the server serves the folder the file was found in, so the URL names the file relative to that folder
+    for (index = 0; index < theCatalog->count; index++) {
+        fileName = theCatalog->pathNames[index] + theCatalog->fileNameOffsets[index];
+        theCatalog->urls[index] = urls;
+        memcpy(urls, theBaseURL, baseLength);
+        urls += baseLength;
+        *urls++ = '/';
+        urls += URLUtils_EncodeBytes(fileName, strlen(fileName), urls) + 1;
+    }
+
+    return noErr;
+}
+
+OSErr FileCatalog_Probe (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    OSErr err;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return paramErr;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    err = ProbeEntry(theCatalog, theIndex);
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return err;
+}
+
+Boolean FileCatalog_IsNotMedia (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    Boolean notMedia;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return false;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    ProbeEntry(theCatalog, theIndex);
+    notMedia = (theCatalog->flags[theIndex] & kFileCatalogNotMedia) != 0;
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return notMedia;
+}
+
+Boolean FileCatalog_IsProbed (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    Boolean probed;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return false;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    probed = (theCatalog->flags[theIndex] & kFileCatalogProbed) != 0;
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return probed;
+}
+
+OSType FileCatalog_GetFileType (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    OSType fileType;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return 0;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    ProbeEntry(theCatalog, theIndex);
+    fileType = theCatalog->fileTypes[theIndex];
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return fileType;
+}
+
+ConstStringPtr FileCatalog_GetMIMEType (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    ConstStringPtr mimeType;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return NULL;
+
+    // MIME types are interned, and never change once they're in the arena
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    ProbeEntry(theCatalog, theIndex);
+    mimeType = theCatalog->mimeTypes[theCatalog->mimeTypeIndexes[theIndex]];
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return mimeType;
+}
+
+SInt64 FileCatalog_GetFileSize (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    SInt64 fileSize;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return 0;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    ProbeEntry(theCatalog, theIndex);
+    fileSize = theCatalog->fileSizes[theIndex];
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return fileSize;
+}
+
+OSErr FileCatalog_GetFileSpec (FileCatalogRef theCatalog, UInt32 theIndex, FSSpec *outFileSpec)
+{
+    OSErr err;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count) || (outFileSpec == NULL))
+        return paramErr;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    err = ProbeEntry(theCatalog, theIndex);
+    if (err == noErr)
+        err = ResolveEntry(theCatalog, theIndex);
+    if (err == noErr)
+        *outFileSpec = theCatalog->fileSpecs[theIndex];
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return err;
+}
+
+Handle FileCatalog_CopyFileDataRef (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    Handle dataRef = NULL;
+
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return NULL;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    if ((ProbeEntry(theCatalog, theIndex) == noErr) && (ResolveEntry(theCatalog, theIndex) == noErr)) {
+        dataRef = theCatalog->fileDataRefs[theIndex];
+        if (HandToHand(&dataRef) != noErr)
+            dataRef = NULL;
+    }
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+
+    return dataRef;
+}
+
+void FileCatalog_SetMovieInfo (FileCatalogRef theCatalog, UInt32 theIndex, UInt32 theWidth, UInt32 theHeight, Float64 theDuration)
+{
+    if ((theCatalog == NULL) || (theIndex >= theCatalog->count))
+        return;
+
+    pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+    theCatalog->naturalWidths[theIndex] = theWidth;
+    theCatalog->naturalHeights[theIndex] = theHeight;
+    theCatalog->durations[theIndex] = theDuration;
+    pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+}
+
+void FileCatalog_GetMovieInfo (FileCatalogRef theCatalog, UInt32 theIndex, UInt32 *outWidth, UInt32 *outHeight, Float64 *outDuration)
+{
+    UInt32 width = 0, height = 0;
+    Float64 duration = 0;
+
+    if ((theCatalog != NULL) && (theIndex < theCatalog->count)) {
+        pthread_mutex_lock(ENTRY_LOCK(theCatalog, theIndex));
+        width = theCatalog->naturalWidths[theIndex];
+        height = theCatalog->naturalHeights[theIndex];
+        duration = theCatalog->durations[theIndex];
+        pthread_mutex_unlock(ENTRY_LOCK(theCatalog, theIndex));
+    }
+
+    if (outWidth != NULL)
+        *outWidth = width;
+    if (outHeight != NULL)
+        *outHeight = height;
+    if (outDuration != NULL)
+        *outDuration = duration;
+}
+
+#pragma mark-
+
+//////////
+//
+// the persistent index
+//
+//////////
+
+OSErr FileCatalog_SetFolder (FileCatalogRef theCatalog, const char *theFolderPath)
+{
+    struct stat folderInfo;
+
+    if ((theCatalog == NULL) || (theFolderPath == NULL))
+        return paramErr;
+
+    if ((stat(theFolderPath, &folderInfo) != 0) || !S_ISDIR(folderInfo.st_mode))
+        return dirNFErr;
+
+    pthread_mutex_lock(&theCatalog->mutex);
+    theCatalog->folderPath = ArenaCopyString(theCatalog, theFolderPath, strlen(theFolderPath) + 1);
+    theCatalog->folderModTime = folderInfo.st_mtime;
+    pthread_mutex_unlock(&theCatalog->mutex);
+
+    return (theCatalog->folderPath != NULL) ? noErr : memFullErr;
+}
+
+OSErr FileCatalog_Save (FileCatalogRef theCatalog)
+{
+    FileCatalogIndexHeader header;
+    FileCatalogIndexEntry entry;
+    char indexPath[PATH_MAX];
+    char tempPath[PATH_MAX];
+    static const char padding[8] = { 0 };
+    size_t paddingLength;
+    const char *fileName;
+    UInt32 nameOffset = 0;
+    UInt32 i;
+    FILE *file;
+    OSErr err = noErr;
+
+    if ((theCatalog == NULL) || (theCatalog->folderPath == NULL))
+        return paramErr;
+
+    if (!MakeIndexPath(theCatalog->folderPath, indexPath, sizeof(indexPath)))
+        return fnfErr;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = kFileCatalogIndexMagic;
+    header.version = kFileCatalogIndexVersion;
+    header.folderModDate = theCatalog->folderModTime;
+    header.folderPathLength = strlen(theCatalog->folderPath);
+    header.numEntries = theCatalog->count;
+
+    // write the index under a private name and rename it into place, so that another document
+    // opening the same folder only ever sees a complete index
+    snprintf(tempPath, sizeof(tempPath), "%s.%d.%lx.tmp", indexPath, (int)getpid(), (unsigned long)pthread_self());
+    file = fopen(tempPath, "wb");
+    if (file == NULL)
+        return ioErr;
+
+    pthread_mutex_lock(&theCatalog->mutex);
+    header.numMIMETypes = theCatalog->numMIMETypes;
+    for (i = 1; i < theCatalog->numMIMETypes; i++)
+        header.mimeTypesLength += theCatalog->mimeTypes[i][0] + 1;
+    pthread_mutex_unlock(&theCatalog->mutex);
+    for (i = 0; i < theCatalog->count; i++)
+        header.namesLength += strlen(theCatalog->pathNames[i] + theCatalog->fileNameOffsets[i]) + 1;
+
+    paddingLength = kFileCatalogIndexPad(header.folderPathLength) - header.folderPathLength;
+    if ((fwrite(&header, sizeof(header), 1, file) != 1) ||
+        (fwrite(theCatalog->folderPath, header.folderPathLength, 1, file) != 1) ||
+        ((paddingLength > 0) && (fwrite(padding, paddingLength, 1, file) != 1)))
+        err = ioErr;
+
+    // the entries, with each entry's lock held while it's copied out
+    for (i = 0; (i < theCatalog->count) && (err == noErr); i++) {
+        fileName = theCatalog->pathNames[i] + theCatalog->fileNameOffsets[i];
+
+        memset(&entry, 0, sizeof(entry));
+        entry.nameOffset = nameOffset;
+        nameOffset += strlen(fileName) + 1;
+
+        pthread_mutex_lock(ENTRY_LOCK(theCatalog, i));
+        entry.flags = theCatalog->flags[i] & (kFileCatalogProbed | kFileCatalogNotMedia);
+        entry.mimeTypeIndex = theCatalog->mimeTypeIndexes[i];
+        entry.fileType = theCatalog->fileTypes[i];
+        entry.fileSize = theCatalog->fileSizes[i];
+        entry.modDate = theCatalog->modTimes[i];
+        entry.inode = theCatalog->inodes[i];
+        entry.naturalWidth = theCatalog->naturalWidths[i];
+        entry.naturalHeight = theCatalog->naturalHeights[i];
+        entry.duration = theCatalog->durations[i];
+        pthread_mutex_unlock(ENTRY_LOCK(theCatalog, i));
+
+        // the MIME types might have grown since we counted them; those entries will just be probed again
+        if (entry.mimeTypeIndex >= header.numMIMETypes) {
+            entry.flags = 0;
+            entry.mimeTypeIndex = 0;
+        }
+
+        if (fwrite(&entry, sizeof(entry), 1, file) != 1)
+            err = ioErr;
+    }
+
+    // then the MIME types, as Pascal strings, and the file names, as C strings
+    for (i = 1; (i < header.numMIMETypes) && (err == noErr); i++)
+        if (fwrite(theCatalog->mimeTypes[i], theCatalog->mimeTypes[i][0] + 1, 1, file) != 1)
+            err = ioErr;
+
+    for (i = 0; (i < theCatalog->count) && (err == noErr); i++) {
+        fileName = theCatalog->pathNames[i] + theCatalog->fileNameOffsets[i];
+        if (fwrite(fileName, strlen(fileName) + 1, 1, file) != 1)
+            err = ioErr;
+    }
+
+    if (fclose(file) != 0)
+        err = ioErr;
+
+    if ((err == noErr) && (rename(tempPath, indexPath) != 0))
+        err = ioErr;
+
+    if (err != noErr)
+        unlink(tempPath);
+
+    return err;
+}
+
+OSErr FileCatalog_Load (const char *theFolderPath, FileCatalogRef *outCatalog, Boolean *outStale)
+{
+    FileCatalogRef catalog = NULL;
+    FileCatalogIndexHeader *header;
+    FileCatalogIndexEntry *entries;
+    const UInt8 *mimeTypes, *mimeType;
+    const char *names;
+    char indexPath[PATH_MAX];
+    struct stat folderInfo, indexInfo;
+    UInt8 *index = MAP_FAILED;
+    size_t indexSize = 0;
+    size_t pathLength, entriesOffset, namesOffset;
+    UInt8 mimeTypeMap[kFileCatalogMaxMIMETypes];
+    UInt32 i, entryIndex;
+    int fd = -1;
+    OSErr err = fnfErr;
+
+    if ((theFolderPath == NULL) || (outCatalog == NULL) || (outStale == NULL))
+        return paramErr;
+
+    *outCatalog = NULL;
+    *outStale = true;
+
+    if ((stat(theFolderPath, &folderInfo) != 0) || !MakeIndexPath(theFolderPath, indexPath, sizeof(indexPath)))
+        return fnfErr;
+
+    fd = open(indexPath, O_RDONLY);
+    if (fd < 0)
+        goto bail;
+
+    if ((fstat(fd, &indexInfo) != 0) || (indexInfo.st_size < (off_t)sizeof(FileCatalogIndexHeader)))
+        goto bail;
+
+    indexSize = indexInfo.st_size;
+    index = mmap(NULL, indexSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (index == MAP_FAILED)
+        goto bail;
+
+    // make sure the index is for this folder, and that it's all there; the hash in its name could collide
+    err = badFileFormat;
+    header = (FileCatalogIndexHeader *)index;
+    pathLength = strlen(theFolderPath);
+    if ((header->magic != kFileCatalogIndexMagic) || (header->version != kFileCatalogIndexVersion))
+        goto bail;
+    if ((header->folderPathLength != pathLength) || (header->numMIMETypes == 0) || (header->numMIMETypes > kFileCatalogMaxMIMETypes))
+        goto bail;
+
+    entriesOffset = sizeof(FileCatalogIndexHeader) + kFileCatalogIndexPad(pathLength);
+    namesOffset = entriesOffset + (size_t)header->numEntries * sizeof(FileCatalogIndexEntry) + header->mimeTypesLength;
+    if ((indexSize != namesOffset + header->namesLength) || (header->namesLength == 0 && header->numEntries != 0))
+        goto bail;
+    if (memcmp(index + sizeof(FileCatalogIndexHeader), theFolderPath, pathLength) != 0)
+        goto bail;
+    if ((header->namesLength > 0) && (index[indexSize - 1] != 0))
+        goto bail;
+
+    entries = (FileCatalogIndexEntry *)(index + entriesOffset);
+    mimeTypes = index + entriesOffset + (size_t)header->numEntries * sizeof(FileCatalogIndexEntry);
+    names = (const char *)(index + namesOffset);
+
+    err = FileCatalog_Create(&catalog);
+    if (err != noErr)
+        goto bail;
+
+    // the folder's mod date changes whenever a file is added, removed or renamed, so if it hasn't,
+    // the list of files is still good; the caller can tell whether to scan the folder again
+    catalog->folderPath = ArenaCopyString(catalog, theFolderPath, pathLength + 1);
+    catalog->folderModTime = header->folderModDate;
+    *outStale = (header->folderModDate != (SInt64)folderInfo.st_mtime);
+
+    // intern the MIME types, checking they're all inside the index
+    err = badFileFormat;
+    mimeTypeMap[0] = 0;
+    for (mimeType = mimeTypes, i = 1; i < header->numMIMETypes; i++) {
+        if ((mimeType >= (const UInt8 *)names) || (mimeType + mimeType[0] + 1 > (const UInt8 *)names))
+            goto bail;
+        mimeTypeMap[i] = InternMIMEType(catalog, mimeType);
+        mimeType += mimeType[0] + 1;
+    }
+
+    for (i = 0; i < header->numEntries; i++) {
+        if ((entries[i].nameOffset >= header->namesLength) || (entries[i].mimeTypeIndex >= header->numMIMETypes))
+            goto bail;
+
+        if (FileCatalog_AddFile(catalog, theFolderPath, names + entries[i].nameOffset, &entryIndex) != noErr) {
+            err = memFullErr;
+            goto bail;
+        }
+
+        // these entries have been probed, but not resolved; the first stat of each tells whether it's still good
+        catalog->flags[entryIndex] = entries[i].flags & (kFileCatalogProbed | kFileCatalogNotMedia);
+        catalog->fileTypes[entryIndex] = entries[i].fileType;
+        catalog->mimeTypeIndexes[entryIndex] = mimeTypeMap[entries[i].mimeTypeIndex];
+        catalog->fileSizes[entryIndex] = entries[i].fileSize;
+        catalog->modTimes[entryIndex] = entries[i].modDate;
+        catalog->inodes[entryIndex] = entries[i].inode;
+        catalog->naturalWidths[entryIndex] = entries[i].naturalWidth;
+        catalog->naturalHeights[entryIndex] = entries[i].naturalHeight;
+        catalog->durations[entryIndex] = entries[i].duration;
+    }
+
+    *outCatalog = catalog;
+    catalog = NULL;
+    err = noErr;
+
+bail:
+    if (catalog != NULL)
+        FileCatalog_Release(catalog);
+
+    if (index != MAP_FAILED)
+        munmap(index, indexSize);
+
+    if (fd >= 0)
+        close(fd);
+
+    return err;
+}
+
+void FileCatalog_AdoptProbes (FileCatalogRef theCatalog, FileCatalogRef theOldCatalog)
+{
+    SInt32 *table;
+    UInt32 tableSize, mask, slot, i, j;
+    const char *fileName;
+
+    if ((theCatalog == NULL) || (theOldCatalog == NULL) || (theOldCatalog->count == 0))
+        return;
+
+    // hash the old catalog's file names into an open-addressed table of entry indexes
+    for (tableSize = 64; tableSize < theOldCatalog->count * 2; tableSize *= 2)
+        ;
+    mask = tableSize - 1;
+
+    table = malloc(tableSize * sizeof(SInt32));
+    if (table == NULL)
+        return;
+    memset(table, 0xFF, tableSize * sizeof(SInt32));
+
+    for (j = 0; j < theOldCatalog->count; j++) {
+        fileName = theOldCatalog->pathNames[j] + theOldCatalog->fileNameOffsets[j];
+        for (slot = HashFileName(fileName) & mask; table[slot] >= 0; slot = (slot + 1) & mask)
+            ;
+        table[slot] = j;
+    }
+
+    // copy over what the old catalog knew about any file that's still here; a stat will tell whether it's still good
+    for (i = 0; i < theCatalog->count; i++) {
+        fileName = theCatalog->pathNames[i] + theCatalog->fileNameOffsets[i];
+        for (slot = HashFileName(fileName) & mask; table[slot] >= 0; slot = (slot + 1) & mask) {
+            j = table[slot];
+            if (strcmp(theOldCatalog->pathNames[j] + theOldCatalog->fileNameOffsets[j], fileName) != 0)
+                continue;
+
+            if (theOldCatalog->flags[j] & kFileCatalogProbed) {
+                pthread_mutex_lock(ENTRY_LOCK(theCatalog, i));
+                theCatalog->flags[i] = theOldCatalog->flags[j] & (kFileCatalogProbed | kFileCatalogNotMedia);
+                theCatalog->fileTypes[i] = theOldCatalog->fileTypes[j];
+                theCatalog->mimeTypeIndexes[i] = InternMIMEType(theCatalog, theOldCatalog->mimeTypes[theOldCatalog->mimeTypeIndexes[j]]);
+                theCatalog->fileSizes[i] = theOldCatalog->fileSizes[j];
+                theCatalog->modTimes[i] = theOldCatalog->modTimes[j];
+                theCatalog->inodes[i] = theOldCatalog->inodes[j];
+                theCatalog->naturalWidths[i] = theOldCatalog->naturalWidths[j];
+                theCatalog->naturalHeights[i] = theOldCatalog->naturalHeights[j];
+                theCatalog->durations[i] = theOldCatalog->durations[j];
+                pthread_mutex_unlock(ENTRY_LOCK(theCatalog, i));
+            }
+            break;
+        }
+    }
+
+    free(table);
+}
+
+#pragma mark-
+
+//////////
+//
+// static routines
+//
+//////////
+
+// Carve theLength bytes out of the arena, copying theString into them if it isn't NULL.
+// N.B.: call with theCatalog->mutex held
+static char *ArenaCopyString (FileCatalogRef theCatalog, const char *theString, UInt32 theLength)
+{
+    FileCatalogArenaBlock *block = theCatalog->arena;
+    char *bytes;
+
+    if ((block == NULL) || (block->size - block->used < theLength)) {
+        UInt32 size = (theLength > kFileCatalogArenaBlockSize) ? theLength : kFileCatalogArenaBlockSize;
+
+        block = malloc(sizeof(FileCatalogArenaBlock) + size);
+        if (block == NULL)
+            return NULL;
+
+        block->size = size;
+        block->used = 0;
+
+        // an oversized string gets a block of its own, behind the current one
+        if ((theCatalog->arena != NULL) && (size > kFileCatalogArenaBlockSize)) {
+            block->next = theCatalog->arena->next;
+            theCatalog->arena->next = block;
+        } else {
+            block->next = theCatalog->arena;
+            theCatalog->arena = block;
+        }
+    }
+
+    bytes = block->data + block->used;
+    block->used += theLength;
+
+    if (theString != NULL)
+        memcpy(bytes, theString, theLength);
+
+    return bytes;
+}
+
+static Boolean GrowArray (void *theArrayPtr, size_t theElementSize, UInt32 theCapacity)
+{
+    void *array = realloc(*(void **)theArrayPtr, theElementSize * theCapacity);
+
+    if (array == NULL)
+        return false;
+
+    *(void **)theArrayPtr = array;
+    return true;
+}
+
+static OSErr GrowCatalog (FileCatalogRef theCatalog)
+{
+    UInt32 capacity = (theCatalog->capacity == 0) ? kFileCatalogInitialCapacity : theCatalog->capacity * 2;
+
+    // the capacity only goes up once every array has grown, so a failure part way through is harmless
+    if (!GrowArray(&theCatalog->pathNames, sizeof(const char *), capacity) ||
+        !GrowArray(&theCatalog->fileNameOffsets, sizeof(UInt16), capacity) ||
+        !GrowArray(&theCatalog->urls, sizeof(const char *), capacity) ||
+        !GrowArray(&theCatalog->flags, sizeof(UInt8), capacity) ||
+        !GrowArray(&theCatalog->fileTypes, sizeof(OSType), capacity) ||
+        !GrowArray(&theCatalog->mimeTypeIndexes, sizeof(UInt8), capacity) ||
+        !GrowArray(&theCatalog->fileSizes, sizeof(SInt64), capacity) ||
+        !GrowArray(&theCatalog->modTimes, sizeof(time_t), capacity) ||
+        !GrowArray(&theCatalog->inodes, sizeof(ino_t), capacity) ||
+        !GrowArray(&theCatalog->fileSpecs, sizeof(FSSpec), capacity) ||
+        !GrowArray(&theCatalog->fileDataRefs, sizeof(Handle), capacity) ||
+        !GrowArray(&theCatalog->naturalWidths, sizeof(UInt32), capacity) ||
+        !GrowArray(&theCatalog->naturalHeights, sizeof(UInt32), capacity) ||
+        !GrowArray(&theCatalog->durations, sizeof(Float64), capacity))
+        return memFullErr;
+
+    theCatalog->capacity = capacity;
+    return noErr;
+}
+
+// Return the index of theMIMEType in the catalog's MIME types, adding it if it's new.
+// A folder only ever holds a handful of different types, so a linear search is fine;
+// if there are more than we can keep, the extras are treated as unknown.
+static UInt8 InternMIMEType (FileCatalogRef theCatalog, ConstStringPtr theMIMEType)
+{
+    UInt32 i;
+
+    if ((theMIMEType == NULL) || (theMIMEType[0] == 0))
+        return 0;
+
+    pthread_mutex_lock(&theCatalog->mutex);
+
+    for (i = 1; i < theCatalog->numMIMETypes; i++)
+        if (memcmp(theCatalog->mimeTypes[i], theMIMEType, theMIMEType[0] + 1) == 0)
+            break;
+
+    if (i == theCatalog->numMIMETypes) {
+        if (i < kFileCatalogMaxMIMETypes) {
+            theCatalog->mimeTypes[i] = (StringPtr)ArenaCopyString(theCatalog, (const char *)theMIMEType, theMIMEType[0] + 1);
+            if (theCatalog->mimeTypes[i] != NULL)
+                theCatalog->numMIMETypes++;
+            else
+                i = 0;
+        } else {
+            i = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&theCatalog->mutex);
+
+    return i;
+}
+
+// Probe the entry's file and MIME types, unless we've done so already (in this session or, if the catalog
+// was loaded from an index, an earlier one) and a stat shows the file is unchanged.
+// N.B.: call with the entry's lock held
+static OSErr ProbeEntry (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    const char *pathName = theCatalog->pathNames[theIndex];
+    const ContentSnifferMatch *match;
+    struct stat fileInfo;
+    OSType fileType = 0;
+    Str255 mimeType;
+
+    if (stat(pathName, &fileInfo) != 0)
+        return fnfErr;
+
+    if ((theCatalog->flags[theIndex] & kFileCatalogProbed) &&
+            (fileInfo.st_mtime == theCatalog->modTimes[theIndex]) && (fileInfo.st_ino == theCatalog->inodes[theIndex]))
+        return noErr;
+
+    theCatalog->flags[theIndex] = 0;
+    theCatalog->fileTypes[theIndex] = 0;
+    theCatalog->mimeTypeIndexes[theIndex] = 0;
+    theCatalog->naturalWidths[theIndex] = 0;
+    theCatalog->naturalHeights[theIndex] = 0;
+    theCatalog->durations[theIndex] = 0;
+    if (theCatalog->fileDataRefs[theIndex] != NULL) {
+        DisposeHandle(theCatalog->fileDataRefs[theIndex]);
+        theCatalog->fileDataRefs[theIndex] = NULL;
+    }
+
+    // most files can be recognized from their first few bytes, which is much cheaper than asking a data handler
+    mimeType[0] = 0;
+    match = ContentSniffer_SniffFile(pathName);
+    if (match != NULL) {
+        fileType = match->fileType;
+        mimeType[0] = (strlen(match->mimeType) < sizeof(Str255)) ? strlen(match->mimeType) : sizeof(Str255) - 1;
+        BlockMoveData(match->mimeType, &mimeType[1], mimeType[0]);
+        if (match->kind == kContentSnifferNotMedia)
+            theCatalog->flags[theIndex] |= kFileCatalogNotMedia;
+    } else if (ResolveEntry(theCatalog, theIndex) == noErr) {
+        DataHandler handler = NULL;
+
+        OpenAComponent(GetDataHandler(theCatalog->fileDataRefs[theIndex], rAliasType, kDataHCanRead), &handler);
+        if (handler) {
+            DataHSetDataRef(handler, theCatalog->fileDataRefs[theIndex]);
+            DataHGetMacOSFileType(handler, &fileType);
+            DataHGetMIMEType(handler, mimeType);
+            CloseComponent(handler);
+        }
+    }
+
+    theCatalog->fileTypes[theIndex] = fileType;
+    theCatalog->mimeTypeIndexes[theIndex] = InternMIMEType(theCatalog, mimeType);
+    theCatalog->fileSizes[theIndex] = fileInfo.st_size;
+    theCatalog->modTimes[theIndex] = fileInfo.st_mtime;
+    theCatalog->inodes[theIndex] = fileInfo.st_ino;
+    theCatalog->flags[theIndex] |= kFileCatalogProbed;
+
+    return noErr;
+}
+
+// Resolve the entry's path to an FSSpec and file data reference, unless we've done so already.
+// These can't be kept in the index, so an entry loaded from one is probed but not resolved.
+// N.B.: call with the entry's lock held
+static OSErr ResolveEntry (FileCatalogRef theCatalog, UInt32 theIndex)
+{
+    const char *pathName = theCatalog->pathNames[theIndex];
+    FSRef fileRef;
+    OSErr err = noErr;
+
+    if (theCatalog->flags[theIndex] & kFileCatalogResolved)
+        return noErr;
+
+    err = FSPathMakeRef((const UInt8 *)pathName, &fileRef, NULL);
+    if (err != noErr) {
+        fprintf(stderr, "FSPathMakeRef(\"%s\") failed (%d)\n", pathName, (int)err);
+        return err;
+    }
+
+    err = FSGetCatalogInfo(&fileRef, kFSCatInfoNone, NULL, NULL, &theCatalog->fileSpecs[theIndex], NULL);
+    if (err != noErr) {
+        fprintf(stderr, "FSGetCatalogInfo(\"%s\") failed (%d)\n", pathName, (int)err);
+        return err;
+    }
+
+    theCatalog->fileDataRefs[theIndex] = QTDR_MakeFileDataRef(&theCatalog->fileSpecs[theIndex]);
+    if (theCatalog->fileDataRefs[theIndex] == NULL)
+        return memFullErr;
+
+    theCatalog->flags[theIndex] |= kFileCatalogResolved;
+
+    return noErr;
+}
+
+// get the path of the index folder, creating it if necessary
+static Boolean GetIndexFolder (char *outPath, size_t theSize)
+{
+    char *home = getenv("HOME");
+    char *sep;
+
+    if ((home == NULL) || (snprintf(outPath, theSize, "%s/%s", home, kFileCatalogIndexFolder) >= (int)theSize))
+        return false;
+
+    // create each folder along the way
+    for (sep = strchr(outPath + strlen(home) + 1, '/'); ; sep = strchr(sep + 1, '/')) {
+        if (sep != NULL)
+            *sep = 0;
+        if ((mkdir(outPath, 0755) != 0) && (errno != EEXIST))
+            return false;
+        if (sep == NULL)
+            break;
+        *sep = '/';
+    }
+
+    return true;
+}
+
+// a 32-bit FNV-1a hash of a file name
+static UInt32 HashFileName (const char *theFileName)
+{
+    UInt32 hash = 2166136261U;
+    const UInt8 *p;
+
+    for (p = (const UInt8 *)theFileName; *p; p++)
+        hash = (hash ^ *p) * 16777619U;
+
+    return hash;
+}
+
+// build the path of the index for a folder; the index name is a 64-bit FNV-1a hash of the folder path
+static Boolean MakeIndexPath (const char *theFolderPath, char *outPath, size_t theSize)
+{
+    char folder[PATH_MAX];
+    UInt64 hash = 14695981039346656037ULL;
+    const UInt8 *p;
+
+    if (!GetIndexFolder(folder, sizeof(folder)))
+        return false;
+
+    for (p = (const UInt8 *)theFolderPath; *p; p++)
+        hash = (hash ^ *p) * 1099511628211ULL;
+
+    return (snprintf(outPath, theSize, "%s/%016llx%s", folder, (unsigned long long)hash, kFileCatalogIndexFileSuffix) < (int)theSize);
+}
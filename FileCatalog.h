@@ -0,0 +1,188 @@
+/*
+	File:		FileCatalog.h
+	
+	Description: A catalog of the files in a folder: names and URLs in one string arena,
+			     everything else in parallel arrays.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef FILE_CATALOG_H
+#define FILE_CATALOG_H
+
+#include <Carbon/Carbon.h>
+#include <QuickTime/QuickTime.h>
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kFileCatalogArenaBlockSize		(64 * 1024)		// strings are carved out of blocks this big
+#define kFileCatalogLockStripes			16				// entries share this many locks
+#define kFileCatalogMaxMIMETypes		256				// distinct MIME types kept per catalog
+
+#define kFileCatalogIndexFolder			"Library/Caches/ThreadsImportMovie/Catalogs"	// relative to $HOME
+#define kFileCatalogIndexFileSuffix		".cat"
+
+#define kFileCatalogIndexMagic			FOUR_CHAR_CODE('TIMf')
+#define kFileCatalogIndexVersion		1
+
+#define kFileCatalogIndexPad(n)			(((n) + 7) & ~7)	// the folder path is padded so the entries are aligned
+
+//////////
+//
+// data types
+//
+//////////
+
+struct FileCatalog;
+typedef struct FileCatalog *FileCatalogRef;
+
+// An index is a single file: this header, the folder path (padded to a multiple of 8 bytes), an entry
+// for each file, the MIME types the entries refer to (as Pascal strings, leaving out the empty one),
+// and then the file names (as C strings). Indexes are mapped rather than read, and written to a
+// temporary file and renamed into place, like thumbnail cache entries.
+typedef struct {
+    UInt32			magic;
+    UInt32			version;
+    SInt64			folderModDate;		// modification date (seconds since 1970) of the folder when it was scanned
+    UInt32			folderPathLength;
+    UInt32			numEntries;
+    UInt32			numMIMETypes;		// including the empty one
+    UInt32			mimeTypesLength;
+    UInt32			namesLength;
+    UInt32			reserved;
+} FileCatalogIndexHeader;
+
+typedef struct {
+    UInt32			nameOffset;			// into the file names
+    OSType			fileType;
+    SInt64			fileSize;
+    SInt64			modDate;			// the modification date and inode the file was probed against
+    UInt64			inode;
+    UInt32			naturalWidth;
+    UInt32			naturalHeight;
+    Float64			duration;
+    UInt8			flags;				// has the file been probed? is it known not to be media?
+    UInt8			mimeTypeIndex;		// into the MIME types; 0 for none
+    UInt8			reserved[6];
+} FileCatalogIndexEntry;
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// Create an empty catalog, with a reference count of 1.
+OSErr FileCatalog_Create (FileCatalogRef *outCatalog);
+
+void FileCatalog_Retain (FileCatalogRef theCatalog);
+void FileCatalog_Release (FileCatalogRef theCatalog);
+
+// Add the file theFileName in the folder theFolderPath; *outIndex is its index in the catalog.
+// N.B.: add every file before the catalog is handed to other threads; the rest of these routines
+// are thread-safe, but adding a file may move the arrays they read.
+OSErr FileCatalog_AddFile (FileCatalogRef theCatalog, const char *theFolderPath, const char *theFileName, UInt32 *outIndex);
+
+UInt32 FileCatalog_GetCount (FileCatalogRef theCatalog);
+
+// The strings returned by these live as long as the catalog does.
+const char *FileCatalog_GetPathName (FileCatalogRef theCatalog, UInt32 theIndex);
+const char *FileCatalog_GetFileName (FileCatalogRef theCatalog, UInt32 theIndex);
+const char *FileCatalog_GetURL (FileCatalogRef theCatalog, UInt32 theIndex);
+
+// Make the URL for every file in the catalog at once, in one block of the arena, rather than one at a time
+// as FileCatalog_GetURL is called. Like FileCatalog_AddFile, call this before the catalog is handed to other threads.
+OSErr FileCatalog_MakeURLs (FileCatalogRef theCatalog);
+
+// Like FileCatalog_MakeURLs, but make each URL theBaseURL followed by the file's encoded name, rather than a file
+// URL; e.g. with "http://127.0.0.1:8000", "/Movies/my dog.mov" becomes "http://127.0.0.1:8000/my%20dog.mov". This
+// lets the URL data handler be measured against an HTTP server that serves the folder the files were found in.
+OSErr FileCatalog_MakeURLsWithBase (FileCatalogRef theCatalog, const char *theBaseURL);
+
+// Resolve the file's path and probe its file and MIME types (from its first few bytes if we recognize them,
+// or else by asking a data handler), unless that's been done already and a stat shows the file hasn't
+// changed since. The getters below probe as needed.
+OSErr FileCatalog_Probe (FileCatalogRef theCatalog, UInt32 theIndex);
+
+// Has the file been probed? Never touches the file system.
+Boolean FileCatalog_IsProbed (FileCatalogRef theCatalog, UInt32 theIndex);
+
+// Is the file something we know QuickTime can't import (a PDF, an archive, an executable...)?
+// Files we don't recognize aren't rejected; QuickTime gets to try them.
+Boolean FileCatalog_IsNotMedia (FileCatalogRef theCatalog, UInt32 theIndex);
+
+OSType FileCatalog_GetFileType (FileCatalogRef theCatalog, UInt32 theIndex);
+ConstStringPtr FileCatalog_GetMIMEType (FileCatalogRef theCatalog, UInt32 theIndex);
+SInt64 FileCatalog_GetFileSize (FileCatalogRef theCatalog, UInt32 theIndex);
+OSErr FileCatalog_GetFileSpec (FileCatalogRef theCatalog, UInt32 theIndex, FSSpec *outFileSpec);
+
+// Return a copy of the file's file data reference; the caller is responsible for disposing of it.
+Handle FileCatalog_CopyFileDataRef (FileCatalogRef theCatalog, UInt32 theIndex);
+
+// The natural size and duration (in seconds) of the movie in the file, once it's been opened; all 0 until then.
+void FileCatalog_SetMovieInfo (FileCatalogRef theCatalog, UInt32 theIndex, UInt32 theWidth, UInt32 theHeight, Float64 theDuration);
+void FileCatalog_GetMovieInfo (FileCatalogRef theCatalog, UInt32 theIndex, UInt32 *outWidth, UInt32 *outHeight, Float64 *outDuration);
+
+// Saving and loading a catalog of a folder's files, so that the folder needn't be scanned and
+// its files probed all over again the next time it's opened.
+
+// Make this the catalog of a folder, recording when the folder was last changed; call this before
+// scanning the folder, so that changes made during the scan make the index stale.
+OSErr FileCatalog_SetFolder (FileCatalogRef theCatalog, const char *theFolderPath);
+
+// Write the index for the catalog's folder.
+OSErr FileCatalog_Save (FileCatalogRef theCatalog);
+
+// Read the index for a folder, if there is one. *outStale is true if the folder has changed since it was
+// scanned, in which case the catalog's list of files is out of date, but what it knows about each file
+// can still be handed to a new catalog with FileCatalog_AdoptProbes. Either way, each file is checked
+// with a stat the first time it's probed, and probed again only if it has changed.
+OSErr FileCatalog_Load (const char *theFolderPath, FileCatalogRef *outCatalog, Boolean *outStale);
+
+// Copy what theOldCatalog knows about each of its files into the entry for the same file name in theCatalog.
+void FileCatalog_AdoptProbes (FileCatalogRef theCatalog, FileCatalogRef theOldCatalog);
+
+#endif // FILE_CATALOG_H
@@ -5,7 +5,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -14,7 +14,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -57,6 +57,7 @@
 #import <QuickTime/QuickTime.h>
 #import <pthread.h>
 
+#include "FileCatalog.h"
 #include "WorkerThread.h"
 
 //////////
@@ -73,6 +74,8 @@
 #define USE_POINTER_DH      2101
 #define USE_FILE_DH			2102
 #define USE_URL_DH			2103
+#define USE_COPY_DH			2104			// copy the file from its URL with the transfer engine, then open the copy
+#define USE_PROGRESSIVE_DH	2105			// open the copy while it's being made, and draw as soon as the frame's data is in
 
 //////////
 //
@@ -81,7 +84,7 @@
 //////////
 
 typedef struct {
-    Movie			movie;
+    Movie			movie;			// the Movie, detached from the worker thread, kept for a retry on the main thread
     GWorldPtr       gWorld;
     GWorldPtr       tinyGW;
     UnsignedWide    startTime;
@@ -92,14 +95,29 @@ typedef struct {
     WorkerRequestRef request;
     UInt32			dhTag;			// the data handler type for this import operation
     UInt32			threadModelTag; // the threading model for this import operation
+    UInt32			numContactFrames; // number of frames in a contact sheet, or 0 for a single frame
     Boolean			busy;			// is this import operation currently busy?
     Boolean			onlySafeComps;  // do we require only safe components?
     Boolean			useFileName;    // do we add a file name extension to handle data references?
     Boolean			useFileType;    // do we add a file type extension to handle data references?
     Boolean			useMIMEType;    // do we add a MIME type extension to handle data references?
+    Boolean			decodeAtDisplaySize; // do we decode into a GWorld the size of movieRect, rather than the natural size?
+    Boolean			scaleOnWorker;  // do we box-filter natural-size frames down to movieRect on the worker?
+    Boolean			skipThumbnailCache; // do we leave the on-disk thumbnail cache alone?
     Boolean			cancelled;		// has this import operation been cancelled
     Boolean			retry;			// retry on main thread, allowing non-safe components
+    Handle			drHandle;		// the data reference, kept for the retry
+    OSType			drType;
+    OSType			codecType;		// the codec of the Movie's first visual track, once it's open
+    OSType			failedCodecType; // the codec that needed the main thread, when we know which one it was
+    Handle			movieHandle;	// the Movie data for handle and pointer data references, kept for the retry
+    void *			moviePointer;
+    Boolean			imported;		// does gWorld hold a successfully imported frame?
+    Boolean			cachedFrame;	// is gWorld owned by the document's frame cache?
+    Boolean			prefetch;		// is this a speculative import of an upcoming row, for the frame cache?
     Boolean			closeWhenSafe;  // close this document when it's safe to do so
+    const char *	copyFolder;		// where USE_COPY_DH (or USE_PROGRESSIVE_DH) puts its copy of the file (default: the current folder)
+    void *			transfer;		// the QTDRTransferPtr that made that copy
 } ThreadData;
 
 //////////
@@ -108,20 +126,25 @@ typedef struct {
 //
 //////////
 
+// A FileObject is a view of one entry in a FileCatalog; the catalog holds everything we know about the file.
 @interface FileObject : NSObject {
-    char *			_pathname;
-    char *			_filename;
-    char *			_urlname;
-    OSType			_filetype;
-    Str255			_mimetype;
+    FileCatalogRef	_catalog;		// retained
+    UInt32			_index;
 }
 
-- (void)setPathName:(char *)name;
-- (void)setFileName:(char *)name;
+- (id)initWithCatalog:(FileCatalogRef)catalog index:(UInt32)index;
+- (FileCatalogRef)catalog;
+- (UInt32)catalogIndex;
 - (char *)pathName;
 - (char *)fileName;
 - (char *)url;
 - (OSType)fileType;
 - (StringPtr)mimeType;
+- (BOOL)isProbed;
+- (BOOL)isNotMedia;
+- (void)probe;
+- (OSErr)getFileSpec:(FSSpec *)fileSpec;
+- (Handle)copyFileDataRef;
+- (void)setNaturalWidth:(UInt32)width height:(UInt32)height duration:(Float64)duration;
 - (void)dealloc;
 @end
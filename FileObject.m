@@ -5,7 +5,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -14,7 +14,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -57,16 +57,6 @@
 #import <QuickTime/QuickTime.h>
 
 #import "FileObject.h"
-#import "URLUtilities.h"
-#import "DataRefUtilities.h"
-
-//////////
-//
-// global variables
-//
-//////////
-
-char * gFileURLPrefix = "file://";
 
 //////////
 //
@@ -76,110 +66,96 @@ char * gFileURLPrefix = "file://";
 
 @implementation FileObject
 
-- (void)setPathName:(char *)name
+- (id)initWithCatalog:(FileCatalogRef)catalog index:(UInt32)index
 {
-    char *tempString = NULL;
-    Handle drHandle = NULL;
-    FSSpec fileSpec;
-    FSRef fileRef;
-    ComponentResult err = noErr;
-    
-    if (_pathname != NULL)
-        free(_pathname);
-        
-    _pathname = name;
-    
-    // now create a url from the full pathname
-    if (_urlname != NULL)
-        free(_urlname);
-    
-    // N.B.: we need to encode any special charaters in the pathname
-    tempString = URLUtils_EncodeString(_pathname);
-    _urlname = malloc(strlen(gFileURLPrefix) + strlen(tempString) + 1);
-    if (_urlname != NULL) {
-        memcpy(_urlname, gFileURLPrefix, strlen(gFileURLPrefix));
-        memcpy(_urlname + strlen(gFileURLPrefix), tempString, strlen(tempString));
-        _urlname[strlen(gFileURLPrefix) + strlen(tempString)] = 0;
+    if (self = [super init]) {
+        FileCatalog_Retain(catalog);
+        _catalog = catalog;
+        _index = index;
     }
-
-    // get the file type and MIME type
-    err = FSPathMakeRef(name, &fileRef, NULL);
-    if (err != noErr) {
-        fprintf(stderr, "FSPathMakeRef(\"%s\") failed (%d)\n", name, (int)err);
-        goto bail;
-    }
-
-    err = FSGetCatalogInfo(&fileRef, kFSCatInfoNone, NULL, NULL, &fileSpec, NULL);
-    if (err != noErr) {
-        fprintf(stderr, "FSGetCatalogInfo(\"%s\") failed (%d)\n", name, (int)err);
-        goto bail;
-    }
-
-    drHandle = QTDR_MakeFileDataRef(&fileSpec);
-    if (drHandle != NULL) {
-        DataHandler handler = NULL;
-        ComponentResult err = noErr;
-        
-	err = OpenAComponent(GetDataHandler(drHandle, rAliasType, kDataHCanRead), &handler);
-        if (handler) {
-            DataHSetDataRef(handler, drHandle);
-            DataHGetMacOSFileType(handler, &_filetype);
-            DataHGetMIMEType(handler, _mimetype);
-            CloseComponent(handler);
-        }
-        
-        DisposeHandle(drHandle);
-    }
-
-bail:
-    free(tempString);
+    
+    return self;
 }
 
-- (void)setFileName:(char *)name
+- (FileCatalogRef)catalog
 {
-    if (_filename != NULL)
-        free(_filename);
+    return _catalog;
+}
 
-    _filename = name;
+- (UInt32)catalogIndex
+{
+    return _index;
 }
 
 - (char *)pathName
 {
-    return _pathname;
+    return (char *)FileCatalog_GetPathName(_catalog, _index);
 }
 
 - (char *)fileName
 {
-    return _filename;
+    return (char *)FileCatalog_GetFileName(_catalog, _index);
 }
 
 - (char *)url
 {
-    return _urlname;
+    return (char *)FileCatalog_GetURL(_catalog, _index);
 }
 
 - (OSType)fileType
 {
-    return _filetype;
+    return FileCatalog_GetFileType(_catalog, _index);
 }
 
 - (StringPtr)mimeType
 {
-    return (StringPtr)&_mimetype;
+    return (StringPtr)FileCatalog_GetMIMEType(_catalog, _index);
 }
 
-- (void)dealloc
+// have the file and MIME types been probed? this never blocks on the file system, so the main thread
+// can use it to decide whether it's worth asking for them
+- (BOOL)isProbed
+{
+    return FileCatalog_IsProbed(_catalog, _index);
+}
+
+// is this something we know QuickTime can't import? probes the file if need be
+- (BOOL)isNotMedia
+{
+    return FileCatalog_IsNotMedia(_catalog, _index);
+}
+
+// resolve the path and probe the file and MIME types now, rather than when they're first asked for;
+// this is meant to be called on a worker thread
+- (void)probe
+{
+    FileCatalog_Probe(_catalog, _index);
+}
+
+// return the file, as resolved when it was probed; the path is only resolved
+// again if the file has been modified or replaced since
+- (OSErr)getFileSpec:(FSSpec *)fileSpec
 {
-    if (_filename != NULL)
-        free(_filename);
+    return FileCatalog_GetFileSpec(_catalog, _index, fileSpec);
+}
 
-    if (_pathname != NULL)
-        free(_pathname);
+// return a copy of the cached file data reference, or NULL
+// the caller is responsible for disposing of the handle returned (by calling DisposeHandle)
+- (Handle)copyFileDataRef
+{
+    return FileCatalog_CopyFileDataRef(_catalog, _index);
+}
 
-    if (_urlname != NULL)
-        free(_urlname);
+- (void)setNaturalWidth:(UInt32)width height:(UInt32)height duration:(Float64)duration
+{
+    FileCatalog_SetMovieInfo(_catalog, _index, width, height, duration);
+}
+
+- (void)dealloc
+{
+    FileCatalog_Release(_catalog);
     
     [super dealloc];
 }
 
-@end
\ No newline at end of file
+@end
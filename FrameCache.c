@@ -0,0 +1,330 @@
+/*
+	File:		FrameCache.c
+	
+	Description: A byte-budgeted, least-recently-used cache of finished frames.
+			     Frames that are in use are never evicted; eviction skips over them until they are released.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "FrameCache.h"
+#include "GWorldPool.h"
+
+//////////
+//
+// data structures
+//
+//////////
+
+typedef struct FrameCacheEntry {
+    struct FrameCacheEntry *	prev;			// toward the most recently used end of the list
+    struct FrameCacheEntry *	next;			// toward the least recently used end of the list
+    const void *				key;
+    UInt32						variant;
+    GWorldPtr					gWorld;
+    UInt32						naturalWidth;
+    UInt32						naturalHeight;
+    UInt64						numBytes;
+    SInt32						useCount;		// number of outstanding lookups; in-use frames are never evicted
+} FrameCacheEntry;
+
+typedef struct FrameCache {
+    FrameCacheEntry *			mostRecent;
+    FrameCacheEntry *			leastRecent;
+    UInt64						maxBytes;
+    FrameCacheStatistics		stats;
+} FrameCache;
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static FrameCacheEntry *findFrameCacheEntry ( FrameCacheRef cache, const void *key, UInt32 variant, GWorldPtr gWorld );
+static void unlinkFrameCacheEntry ( FrameCacheRef cache, FrameCacheEntry *entry );
+static void linkFrameCacheEntry ( FrameCacheRef cache, FrameCacheEntry *entry );
+static void disposeFrameCacheEntry ( FrameCacheRef cache, FrameCacheEntry *entry );
+static void trimFrameCache ( FrameCacheRef cache );
+
+#pragma mark-
+
+//////////
+//
+// frame cache routines
+//
+//////////
+
+OSErr createFrameCache (
+    UInt64 maxBytes,
+    FrameCacheRef *outCache )
+{
+    FrameCacheRef cache;
+
+    if ( !outCache ) return paramErr;
+
+    cache = calloc( 1, sizeof( FrameCache ) );
+    if ( !cache ) return memFullErr;
+
+    cache->maxBytes = maxBytes;
+
+    *outCache = cache;
+    return noErr;
+}
+
+void disposeFrameCache ( FrameCacheRef cache )
+{
+    if ( !cache ) return;
+
+    while ( cache->mostRecent )
+        disposeFrameCacheEntry( cache, cache->mostRecent );
+
+    free( cache );
+}
+
+void flushFrameCache ( FrameCacheRef cache )
+{
+    FrameCacheEntry *entry, *next;
+
+    if ( !cache ) return;
+
+    for ( entry = cache->mostRecent; entry; entry = next ) {
+        next = entry->next;
+        if ( entry->useCount == 0 )
+            disposeFrameCacheEntry( cache, entry );
+        else
+            entry->key = NULL;	// can't be looked up any more; disposed of when it's released
+    }
+
+    cache->stats.hits = 0;
+    cache->stats.misses = 0;
+    cache->stats.evictions = 0;
+}
+
+OSErr lookupFrameCacheFrame (
+    FrameCacheRef cache,
+    const void *key,
+    UInt32 variant,
+    GWorldPtr *outGWorld,
+    UInt32 *outNaturalWidth,
+    UInt32 *outNaturalHeight )
+{
+    FrameCacheEntry *entry;
+
+    if ( !cache || !outGWorld ) return paramErr;
+
+    entry = findFrameCacheEntry( cache, key, variant, NULL );
+    if ( !entry ) {
+        cache->stats.misses++;
+        return fnfErr;
+    }
+
+    cache->stats.hits++;
+
+    // move the entry to the most recently used end of the list
+    unlinkFrameCacheEntry( cache, entry );
+    linkFrameCacheEntry( cache, entry );
+    entry->useCount++;
+
+    *outGWorld = entry->gWorld;
+    if ( outNaturalWidth ) *outNaturalWidth = entry->naturalWidth;
+    if ( outNaturalHeight ) *outNaturalHeight = entry->naturalHeight;
+    return noErr;
+}
+
+Boolean containsFrameCacheFrame (
+    FrameCacheRef cache,
+    const void *key,
+    UInt32 variant )
+{
+    if ( !cache || !key ) return false;
+
+    return ( findFrameCacheEntry( cache, key, variant, NULL ) != NULL );
+}
+
+OSErr addFrameCacheFrame (
+    FrameCacheRef cache,
+    const void *key,
+    UInt32 variant,
+    GWorldPtr gWorld,
+    UInt32 naturalWidth,
+    UInt32 naturalHeight )
+{
+    FrameCacheEntry *entry;
+    Rect bounds;
+
+    if ( !cache || !gWorld ) return paramErr;
+
+    entry = calloc( 1, sizeof( FrameCacheEntry ) );
+    if ( !entry ) return memFullErr;
+
+    GetPortBounds( gWorld, &bounds );
+
+    entry->key = key;
+    entry->variant = variant;
+    entry->gWorld = gWorld;
+    entry->naturalWidth = naturalWidth;
+    entry->naturalHeight = naturalHeight;
+    entry->numBytes = (UInt64)GetPixRowBytes( GetGWorldPixMap( gWorld ) ) * ( bounds.bottom - bounds.top );
+    entry->useCount = 1;
+
+    // a newer frame for the same key replaces the old one; if the old one is still in use, it can no
+    // longer be looked up, and is disposed of when it's released
+    {
+        FrameCacheEntry *old = findFrameCacheEntry( cache, key, variant, NULL );
+        if ( old ) {
+            if ( old->useCount == 0 )
+                disposeFrameCacheEntry( cache, old );
+            else
+                old->key = NULL;
+        }
+    }
+
+    linkFrameCacheEntry( cache, entry );
+    trimFrameCache( cache );
+    return noErr;
+}
+
+void releaseFrameCacheFrame (
+    FrameCacheRef cache,
+    GWorldPtr gWorld )
+{
+    FrameCacheEntry *entry;
+
+    if ( !cache || !gWorld ) return;
+
+    entry = findFrameCacheEntry( cache, NULL, 0, gWorld );
+    if ( !entry || ( entry->useCount == 0 ) ) {
+        DebugStr("\preleaseFrameCacheFrame: frame is not in use" );
+        return;
+    }
+
+    if ( --entry->useCount == 0 ) {
+        if ( entry->key == NULL )
+            disposeFrameCacheEntry( cache, entry );
+        else
+            trimFrameCache( cache );	// frames that were over budget while in use get evicted now
+    }
+}
+
+void getFrameCacheStatistics (
+    FrameCacheRef cache,
+    FrameCacheStatistics *outStats )
+{
+    if ( !cache || !outStats ) return;
+
+    *outStats = cache->stats;
+}
+
+#pragma mark-
+
+//////////
+//
+// static functions
+//
+//////////
+
+// find an entry by key and variant or, if key is NULL, by GWorld
+static FrameCacheEntry *findFrameCacheEntry ( FrameCacheRef cache, const void *key, UInt32 variant, GWorldPtr gWorld )
+{
+    FrameCacheEntry *entry;
+
+    for ( entry = cache->mostRecent; entry; entry = entry->next ) {
+        if ( key ? ( ( entry->key == key ) && ( entry->variant == variant ) ) : ( entry->gWorld == gWorld ) )
+            return entry;
+    }
+
+    return NULL;
+}
+
+static void unlinkFrameCacheEntry ( FrameCacheRef cache, FrameCacheEntry *entry )
+{
+    if ( entry->prev ) entry->prev->next = entry->next;
+    else cache->mostRecent = entry->next;
+
+    if ( entry->next ) entry->next->prev = entry->prev;
+    else cache->leastRecent = entry->prev;
+
+    entry->prev = entry->next = NULL;
+    cache->stats.numFrames--;
+    cache->stats.numBytes -= entry->numBytes;
+}
+
+// link an entry in at the most recently used end of the list
+static void linkFrameCacheEntry ( FrameCacheRef cache, FrameCacheEntry *entry )
+{
+    entry->prev = NULL;
+    entry->next = cache->mostRecent;
+    if ( cache->mostRecent ) cache->mostRecent->prev = entry;
+    else cache->leastRecent = entry;
+    cache->mostRecent = entry;
+
+    cache->stats.numFrames++;
+    cache->stats.numBytes += entry->numBytes;
+}
+
+static void disposeFrameCacheEntry ( FrameCacheRef cache, FrameCacheEntry *entry )
+{
+    unlinkFrameCacheEntry( cache, entry );
+    GWorldPool_Put( entry->gWorld );
+    free( entry );
+}
+
+// evict least recently used frames that aren't in use until we're within budget
+static void trimFrameCache ( FrameCacheRef cache )
+{
+    FrameCacheEntry *entry, *prev;
+
+    for ( entry = cache->leastRecent; entry && ( cache->stats.numBytes > cache->maxBytes ); entry = prev ) {
+        prev = entry->prev;
+        if ( entry->useCount == 0 ) {
+            disposeFrameCacheEntry( cache, entry );
+            cache->stats.evictions++;
+        }
+    }
+}
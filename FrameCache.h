@@ -0,0 +1,139 @@
+/*
+	File:		FrameCache.h
+	
+	Description: A byte-budgeted, least-recently-used cache of finished frames, keyed by an opaque pointer
+			     (the document uses its FileObjects). Frames handed out by the cache stay valid until released.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <Carbon/Carbon.h>
+#include <QuickTime/QuickTime.h>
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kFrameCacheDefaultMaxBytes		(32 * 1024 * 1024)
+
+//////////
+//
+// data types
+//
+//////////
+
+// This is the interface to a frame cache.
+struct FrameCache;
+typedef struct FrameCache *FrameCacheRef;
+
+typedef struct {
+    UInt32			hits;
+    UInt32			misses;
+    UInt32			evictions;
+    UInt32			numFrames;		// number of frames currently in the cache
+    UInt64			numBytes;		// number of pixel bytes currently in the cache
+} FrameCacheStatistics;
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// The frame cache is not thread-safe; call all of these routines on the main thread.
+
+OSErr createFrameCache(
+	UInt64 maxBytes,
+	FrameCacheRef *outCache );
+
+// Disposes of the cache and every frame in it, whether or not it is still in use.
+void disposeFrameCache(
+	FrameCacheRef cache );
+
+// Dispose of every frame that is not currently in use, and reset the statistics. Frames that
+// are in use can no longer be looked up, and are disposed of when they are released.
+void flushFrameCache(
+	FrameCacheRef cache );
+
+// Look up the frame for key. variant tells different renderings of the same key apart (for instance,
+// a single frame and a contact sheet); frames only match lookups with the same variant. On a hit, the
+// frame is marked in use and must be returned with releaseFrameCacheFrame; returns fnfErr on a miss.
+OSErr lookupFrameCacheFrame(
+	FrameCacheRef cache,
+	const void *key,
+	UInt32 variant,
+	GWorldPtr *outGWorld,
+	UInt32 *outNaturalWidth,
+	UInt32 *outNaturalHeight );
+
+// Find out whether there's a frame for key, without counting a lookup or marking the frame used.
+Boolean containsFrameCacheFrame(
+	FrameCacheRef cache,
+	const void *key,
+	UInt32 variant );
+
+// Hand gWorld over to the cache as the frame for key and variant, in place of any frame it already has
+// for them. The cache takes ownership of the GWorld; it starts out in use by the caller, who must return
+// it with releaseFrameCacheFrame.
+OSErr addFrameCacheFrame(
+	FrameCacheRef cache,
+	const void *key,
+	UInt32 variant,
+	GWorldPtr gWorld,
+	UInt32 naturalWidth,
+	UInt32 naturalHeight );
+
+// Say that the caller is done with a frame it got from lookupFrameCacheFrame or addFrameCacheFrame.
+void releaseFrameCacheFrame(
+	FrameCacheRef cache,
+	GWorldPtr gWorld );
+
+void getFrameCacheStatistics(
+	FrameCacheRef cache,
+	FrameCacheStatistics *outStats );
+
+#endif // FRAME_CACHE_H
@@ -0,0 +1,178 @@
+/*
+	File:		GWorldPool.c
+	
+	Description: A process-wide pool of offscreen GWorlds, bucketed by size and pixel format.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#include <pthread.h>
+
+#include "GWorldPool.h"
+
+//////////
+//
+// data structures
+//
+//////////
+
+typedef struct {
+    GWorldPtr			gWorld;
+    short				width;
+    short				height;
+    OSType				pixelFormat;
+    UInt32				numBytes;
+} GWorldPoolEntry;
+
+//////////
+//
+// static global variables
+//
+//////////
+
+static pthread_mutex_t	gPoolMutex = PTHREAD_MUTEX_INITIALIZER;		// protects everything below
+static GWorldPoolEntry	gPool[kGWorldPoolMaxEntries];				// idle GWorlds, least recently returned first
+static UInt32			gPoolCount = 0;
+static UInt32			gPoolBytes = 0;
+
+#pragma mark-
+
+//////////
+//
+// public routines
+//
+//////////
+
+OSErr GWorldPool_Get (const Rect *theBounds, OSType thePixelFormat, GWorldPtr *outGWorld)
+{
+    short width, height;
+    SInt32 i;
+
+    if ((theBounds == NULL) || (outGWorld == NULL))
+        return paramErr;
+
+    width = theBounds->right - theBounds->left;
+    height = theBounds->bottom - theBounds->top;
+    *outGWorld = NULL;
+
+    // take the most recently returned GWorld in the right bucket
+    pthread_mutex_lock(&gPoolMutex);
+    for (i = gPoolCount - 1; i >= 0; i--) {
+        if ((gPool[i].width == width) && (gPool[i].height == height) && (gPool[i].pixelFormat == thePixelFormat)) {
+            *outGWorld = gPool[i].gWorld;
+            gPoolBytes -= gPool[i].numBytes;
+            gPoolCount--;
+            BlockMoveData(&gPool[i + 1], &gPool[i], (gPoolCount - i) * sizeof(GWorldPoolEntry));
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gPoolMutex);
+
+    if (*outGWorld != NULL) {
+        Rect bounds;
+
+        // callers expect the bounds they asked for, not the ones the GWorld was last used with
+        GetPortBounds(*outGWorld, &bounds);
+        if ((bounds.left != theBounds->left) || (bounds.top != theBounds->top))
+            UpdateGWorld(outGWorld, thePixelFormat, theBounds, NULL, NULL, 0);
+        return noErr;
+    }
+
+    return QTNewGWorld(outGWorld, thePixelFormat, theBounds, NULL, NULL, 0);
+}
+
+void GWorldPool_Put (GWorldPtr theGWorld)
+{
+    GWorldPoolEntry entry;
+    PixMapHandle pixMap;
+    Rect bounds;
+
+    if (theGWorld == NULL)
+        return;
+
+    pixMap = GetGWorldPixMap(theGWorld);
+    GetPortBounds(theGWorld, &bounds);
+
+    entry.gWorld = theGWorld;
+    entry.width = bounds.right - bounds.left;
+    entry.height = bounds.bottom - bounds.top;
+    entry.pixelFormat = GETPIXMAPPIXELFORMAT(*pixMap);
+    entry.numBytes = GetPixRowBytes(pixMap) * entry.height;
+
+    UnlockPixels(pixMap);
+
+    // GWorlds that would take up most of the pool aren't worth keeping
+    if (entry.numBytes > kGWorldPoolMaxBytes / 2) {
+        DisposeGWorld(theGWorld);
+        return;
+    }
+
+    pthread_mutex_lock(&gPoolMutex);
+
+    // make room by disposing of the least recently returned GWorlds
+    while ((gPoolCount == kGWorldPoolMaxEntries) || (gPoolBytes + entry.numBytes > kGWorldPoolMaxBytes)) {
+        DisposeGWorld(gPool[0].gWorld);
+        gPoolBytes -= gPool[0].numBytes;
+        gPoolCount--;
+        BlockMoveData(&gPool[1], &gPool[0], gPoolCount * sizeof(GWorldPoolEntry));
+    }
+
+    gPool[gPoolCount++] = entry;
+    gPoolBytes += entry.numBytes;
+
+    pthread_mutex_unlock(&gPoolMutex);
+}
+
+void GWorldPool_Flush (void)
+{
+    pthread_mutex_lock(&gPoolMutex);
+    while (gPoolCount > 0)
+        DisposeGWorld(gPool[--gPoolCount].gWorld);
+    gPoolBytes = 0;
+    pthread_mutex_unlock(&gPoolMutex);
+}
@@ -0,0 +1,83 @@
+/*
+	File:		GWorldPool.h
+	
+	Description: A process-wide pool of offscreen GWorlds, bucketed by size and pixel format.
+			     Folders usually hold many movies of the same dimensions, so most imports can reuse a GWorld
+			     instead of allocating and clearing a new one.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef GWORLD_POOL_H
+#define GWORLD_POOL_H
+
+#include <Carbon/Carbon.h>
+#include <QuickTime/QuickTime.h>
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kGWorldPoolMaxEntries		16					// at most this many idle GWorlds are kept
+#define kGWorldPoolMaxBytes			(32 * 1024 * 1024)	// and at most this many bytes of idle pixels
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// All of these routines are thread-safe.
+
+// Get a GWorld with the given bounds and pixel format, from the pool if there's a matching one,
+// or else by calling QTNewGWorld. The contents of a pooled GWorld are whatever was last drawn into it.
+OSErr GWorldPool_Get (const Rect *theBounds, OSType thePixelFormat, GWorldPtr *outGWorld);
+
+// Return a GWorld to the pool; if the pool is full, the least recently returned GWorld is disposed of.
+void GWorldPool_Put (GWorldPtr theGWorld);
+
+// Dispose of every idle GWorld in the pool.
+void GWorldPool_Flush (void);
+
+#endif // GWORLD_POOL_H
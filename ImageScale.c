@@ -0,0 +1,305 @@
+/*
+	File:		ImageScale.c
+	
+	Description: Box-filter resampling of 32-bit pixel buffers.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ImageScale.h"
+
+#if IMAGE_SCALE_SSE2
+#include <emmintrin.h>
+#endif
+
+//////////
+//
+// constants
+//
+//////////
+
+// the most source pixels the 32-bit sums can add up before a component could overflow
+#define kMaxPixelsPerSum			(0xFFFFFFFFUL / 0xFF)
+
+//////////
+//
+// static function declarations
+//
+//////////
+
+static OSErr BoxResample (const void *theSrcBase, long theSrcRowBytes, UInt32 theSrcWidth, UInt32 theSrcHeight,
+						  void *theDstBase, long theDstRowBytes, UInt32 theDstWidth, UInt32 theDstHeight, Boolean theUseVector);
+static void AddRowScalar (const UInt8 *theSrc, const UInt32 *theXStart, UInt32 theDstWidth, UInt32 *theSums);
+#if IMAGE_SCALE_SSE2
+static void AddRowSSE2 (const UInt8 *theSrc, const UInt32 *theXStart, UInt32 theDstWidth, UInt32 *theSums);
+#endif
+
+#pragma mark-
+
+//////////
+//
+// public routines
+//
+//////////
+
+OSErr ImageScale_Box32 (const void *theSrcBase, long theSrcRowBytes, UInt32 theSrcWidth, UInt32 theSrcHeight,
+						void *theDstBase, long theDstRowBytes, UInt32 theDstWidth, UInt32 theDstHeight)
+{
+    return BoxResample(theSrcBase, theSrcRowBytes, theSrcWidth, theSrcHeight, theDstBase, theDstRowBytes, theDstWidth, theDstHeight, true);
+}
+
+OSErr ImageScale_Box32Reference (const void *theSrcBase, long theSrcRowBytes, UInt32 theSrcWidth, UInt32 theSrcHeight,
+								 void *theDstBase, long theDstRowBytes, UInt32 theDstWidth, UInt32 theDstHeight)
+{
+    return BoxResample(theSrcBase, theSrcRowBytes, theSrcWidth, theSrcHeight, theDstBase, theDstRowBytes, theDstWidth, theDstHeight, false);
+}
+
+Boolean ImageScale_IsVectorized (void)
+{
+#if IMAGE_SCALE_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+OSErr ImageScale_BoxGWorld (GWorldPtr theSrcGWorld, GWorldPtr theDstGWorld)
+{
+    PixMapHandle srcPixMap, dstPixMap;
+    Rect srcRect, dstRect;
+    GWorldFlags srcState, dstState;
+    OSErr err = noErr;
+
+    if ((theSrcGWorld == NULL) || (theDstGWorld == NULL))
+        return paramErr;
+
+    srcPixMap = GetGWorldPixMap(theSrcGWorld);
+    dstPixMap = GetGWorldPixMap(theDstGWorld);
+    if ((GetPixDepth(srcPixMap) != 32) || (GetPixDepth(dstPixMap) != 32))
+        return paramErr;
+
+    GetPortBounds(theSrcGWorld, &srcRect);
+    GetPortBounds(theDstGWorld, &dstRect);
+
+    srcState = GetPixelsState(srcPixMap);
+    dstState = GetPixelsState(dstPixMap);
+    LockPixels(srcPixMap);
+    LockPixels(dstPixMap);
+
+    err = ImageScale_Box32(GetPixBaseAddr(srcPixMap), GetPixRowBytes(srcPixMap), srcRect.right - srcRect.left, srcRect.bottom - srcRect.top,
+                           GetPixBaseAddr(dstPixMap), GetPixRowBytes(dstPixMap), dstRect.right - dstRect.left, dstRect.bottom - dstRect.top);
+
+    SetPixelsState(dstPixMap, dstState);
+    SetPixelsState(srcPixMap, srcState);
+
+    return err;
+}
+
+#pragma mark-
+
+//////////
+//
+// static routines
+//
+//////////
+
+static OSErr BoxResample (const void *theSrcBase, long theSrcRowBytes, UInt32 theSrcWidth, UInt32 theSrcHeight,
+						  void *theDstBase, long theDstRowBytes, UInt32 theDstWidth, UInt32 theDstHeight, Boolean theUseVector)
+{
+    UInt32 *xStart = NULL;		// for each destination column, the first source column it covers; xStart[theDstWidth] == theSrcWidth
+    UInt32 *sums = NULL;		// per-component sums of the source rows added since the last flush into totals
+    UInt64 *totals = NULL;		// per-component sums for the destination row we're working on
+    void (*addRow) (const UInt8 *, const UInt32 *, UInt32, UInt32 *) = AddRowScalar;
+    UInt32 dx, dy, sy;
+    UInt32 y0, y1;
+    UInt32 maxSpan, rowsPerFlush, rowsAdded;
+    OSErr err = noErr;
+
+    if ((theSrcBase == NULL) || (theDstBase == NULL) || (theSrcWidth == 0) || (theSrcHeight == 0) || (theDstWidth == 0) || (theDstHeight == 0))
+        return paramErr;
+
+#if IMAGE_SCALE_SSE2
+    if (theUseVector)
+        addRow = AddRowSSE2;
+#else
+#pragma unused(theUseVector)
+#endif
+
+    xStart = malloc((theDstWidth + 1) * sizeof(UInt32));
+    sums = malloc(theDstWidth * 4 * sizeof(UInt32));
+    totals = malloc(theDstWidth * 4 * sizeof(UInt64));
+    if ((xStart == NULL) || (sums == NULL) || (totals == NULL)) {
+        err = memFullErr;
+        goto bail;
+    }
+
+    // work out the horizontal spans once; every destination pixel covers at least one source pixel
+    for (dx = 0; dx <= theDstWidth; dx++)
+        xStart[dx] = (UInt32)(((UInt64)dx * theSrcWidth) / theDstWidth);
+    for (dx = 0; dx < theDstWidth; dx++)
+        if (xStart[dx] >= theSrcWidth)
+            xStart[dx] = theSrcWidth - 1;
+
+    // the row loops add into 32-bit sums, which hold the components of kMaxPixelsPerSum pixels; when a destination
+    // pixel covers more than that (a huge source shrunk to a few pixels), flush them into 64-bit totals as we go
+    maxSpan = 1;
+    for (dx = 0; dx < theDstWidth; dx++)
+        if (xStart[dx + 1] > xStart[dx] + maxSpan)
+            maxSpan = xStart[dx + 1] - xStart[dx];
+    if (maxSpan > kMaxPixelsPerSum) {
+        err = paramErr;
+        goto bail;
+    }
+    rowsPerFlush = kMaxPixelsPerSum / maxSpan;
+
+    for (dy = 0; dy < theDstHeight; dy++) {
+        UInt8 *dst = (UInt8 *)theDstBase + dy * theDstRowBytes;
+        UInt64 count;
+
+        y0 = (UInt32)(((UInt64)dy * theSrcHeight) / theDstHeight);
+        y1 = (UInt32)(((UInt64)(dy + 1) * theSrcHeight) / theDstHeight);
+        if (y0 >= theSrcHeight)
+            y0 = theSrcHeight - 1;
+        if (y1 <= y0)
+            y1 = y0 + 1;
+
+        // add up the source rows this destination row covers
+        memset(sums, 0, theDstWidth * 4 * sizeof(UInt32));
+        memset(totals, 0, theDstWidth * 4 * sizeof(UInt64));
+        rowsAdded = 0;
+        for (sy = y0; sy < y1; sy++) {
+            (*addRow)((const UInt8 *)theSrcBase + sy * theSrcRowBytes, xStart, theDstWidth, sums);
+            if ((++rowsAdded == rowsPerFlush) || (sy + 1 == y1)) {
+                for (dx = 0; dx < theDstWidth * 4; dx++)
+                    totals[dx] += sums[dx];
+                if (sy + 1 < y1)
+                    memset(sums, 0, theDstWidth * 4 * sizeof(UInt32));
+                rowsAdded = 0;
+            }
+        }
+
+        // and divide by the area each destination pixel covers, rounding to nearest
+        for (dx = 0; dx < theDstWidth; dx++, dst += 4) {
+            UInt64 *total = totals + dx * 4;
+            UInt64 width = (xStart[dx + 1] > xStart[dx]) ? xStart[dx + 1] - xStart[dx] : 1;
+
+            count = width * (y1 - y0);
+            dst[0] = (total[0] + count / 2) / count;
+            dst[1] = (total[1] + count / 2) / count;
+            dst[2] = (total[2] + count / 2) / count;
+            dst[3] = (total[3] + count / 2) / count;
+        }
+    }
+
+bail:
+    if (totals != NULL)
+        free(totals);
+
+    if (sums != NULL)
+        free(sums);
+
+    if (xStart != NULL)
+        free(xStart);
+
+    return err;
+}
+
+// add one source row into the sums for each destination pixel, one component at a time
+static void AddRowScalar (const UInt8 *theSrc, const UInt32 *theXStart, UInt32 theDstWidth, UInt32 *theSums)
+{
+    UInt32 *sum = theSums;
+    UInt32 dx, sx;
+
+    for (dx = 0; dx < theDstWidth; dx++, sum += 4) {
+        UInt32 x1 = (theXStart[dx + 1] > theXStart[dx]) ? theXStart[dx + 1] : theXStart[dx] + 1;
+        const UInt8 *p = theSrc + theXStart[dx] * 4;
+
+        for (sx = theXStart[dx]; sx < x1; sx++, p += 4) {
+            sum[0] += p[0];
+            sum[1] += p[1];
+            sum[2] += p[2];
+            sum[3] += p[3];
+        }
+    }
+}
+
+#if IMAGE_SCALE_SSE2
+// the same, but with all four components of a pixel in one vector, widened from bytes to 32-bit lanes;
+// we take two source pixels per step, so the sums are exactly those AddRowScalar makes
+static void AddRowSSE2 (const UInt8 *theSrc, const UInt32 *theXStart, UInt32 theDstWidth, UInt32 *theSums)
+{
+    const __m128i zero = _mm_setzero_si128();
+    UInt32 *sum = theSums;
+    UInt32 dx, sx;
+
+    for (dx = 0; dx < theDstWidth; dx++, sum += 4) {
+        UInt32 x1 = (theXStart[dx + 1] > theXStart[dx]) ? theXStart[dx + 1] : theXStart[dx] + 1;
+        const UInt8 *p = theSrc + theXStart[dx] * 4;
+        __m128i acc = _mm_loadu_si128((const __m128i *)sum);
+        __m128i pixels;
+        SInt32 pixel;
+
+        for (sx = theXStart[dx]; sx + 2 <= x1; sx += 2, p += 8) {
+            pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), zero);
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(pixels, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(pixels, zero));
+        }
+
+        if (sx < x1) {
+            memcpy(&pixel, p, sizeof(pixel));
+            pixels = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero);
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(pixels, zero));
+        }
+
+        _mm_storeu_si128((__m128i *)sum, acc);
+    }
+}
+#endif
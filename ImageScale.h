@@ -0,0 +1,95 @@
+/*
+	File:		ImageScale.h
+	
+	Description: Box-filter resampling of 32-bit pixel buffers, for shrinking imported frames on the worker
+			     thread instead of with CopyBits on the main thread.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef IMAGE_SCALE_H
+#define IMAGE_SCALE_H
+
+#include <Carbon/Carbon.h>
+
+//////////
+//
+// compiler flags
+//
+//////////
+
+// build the SSE2 version of the resampling loop where the compiler targets a processor that has SSE2
+#ifndef IMAGE_SCALE_SSE2
+#if defined(__SSE2__)
+#define IMAGE_SCALE_SSE2			1
+#else
+#define IMAGE_SCALE_SSE2			0
+#endif
+#endif
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// Resample a 32-bit-per-pixel buffer into another with a box filter: each destination pixel is the
+// average of the source pixels it covers, which is what you want when shrinking a frame to fit a view.
+// The four components of each pixel are averaged independently, so the pixel format doesn't matter as
+// long as it's 4 bytes per pixel. When a dimension grows instead, pixels are simply replicated. Any
+// number of source pixels can fold into one destination pixel, as long as no more than 16,843,009 of
+// them are in one source row; otherwise this returns paramErr.
+OSErr ImageScale_Box32 (const void *theSrcBase, long theSrcRowBytes, UInt32 theSrcWidth, UInt32 theSrcHeight,
+						void *theDstBase, long theDstRowBytes, UInt32 theDstWidth, UInt32 theDstHeight);
+
+// The same, but always with the portable scalar loop; ImageScale_Box32 gives exactly the same result, and
+// this is what it's tested and timed against.
+OSErr ImageScale_Box32Reference (const void *theSrcBase, long theSrcRowBytes, UInt32 theSrcWidth, UInt32 theSrcHeight,
+								 void *theDstBase, long theDstRowBytes, UInt32 theDstWidth, UInt32 theDstHeight);
+
+// Does ImageScale_Box32 use a vector unit on this processor?
+Boolean ImageScale_IsVectorized (void);
+
+// Resample the whole of one 32-bit GWorld into the whole of another; this is safe to call on any thread.
+OSErr ImageScale_BoxGWorld (GWorldPtr theSrcGWorld, GWorldPtr theDstGWorld);
+
+#endif // IMAGE_SCALE_H
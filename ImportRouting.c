@@ -0,0 +1,295 @@
+/*
+	File:		ImportRouting.c
+	
+	Description: Remembers which kinds of files need components that aren't thread-safe.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#include <pthread.h>
+#include <string.h>
+
+#include "ImportRouting.h"
+
+//////////
+//
+// data structures
+//
+//////////
+
+typedef struct {
+    OSType				fileType;
+    OSType				codecType;			// 0 if the file couldn't be opened at all
+    char				mimeType[kImportRoutingMaxMIMETypeLength + 1];
+} ImportRoute;
+
+//////////
+//
+// static global variables
+//
+//////////
+
+static pthread_mutex_t	gRoutingMutex = PTHREAD_MUTEX_INITIALIZER;	// protects everything below
+static ImportRoute		gRoutes[kImportRoutingMaxEntries];
+static UInt32			gNumRoutes = 0;
+static Boolean			gRoutesLoaded = false;
+static UInt32			gHits = 0;
+static UInt32			gMisses = 0;
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void makeRoute (OSType theFileType, ConstStr255Param theMIMEType, OSType theCodecType, ImportRoute *outRoute);
+static SInt32 findRoute (const ImportRoute *theRoute);
+static void loadRoutes (void);
+static void saveRoutes (void);
+
+#pragma mark-
+
+//////////
+//
+// public routines
+//
+//////////
+
+Boolean ImportRouting_NeedsMainThread (OSType theFileType, ConstStr255Param theMIMEType, OSType theCodecType)
+{
+    ImportRoute route;
+    Boolean needsMainThread = false;
+
+    makeRoute(theFileType, theMIMEType, theCodecType, &route);
+
+    pthread_mutex_lock(&gRoutingMutex);
+    loadRoutes();
+
+    if ((theCodecType != 0) || (route.fileType != 0) || (route.mimeType[0] != 0))
+        needsMainThread = (findRoute(&route) >= 0);
+    pthread_mutex_unlock(&gRoutingMutex);
+
+    return needsMainThread;
+}
+
+void ImportRouting_NoteNeedsMainThread (OSType theFileType, ConstStr255Param theMIMEType, OSType theCodecType)
+{
+    ImportRoute route;
+
+    makeRoute(theFileType, theMIMEType, theCodecType, &route);
+
+    // an untyped file that can't be opened tells us nothing about other untyped files
+    if ((theCodecType == 0) && (route.fileType == 0) && (route.mimeType[0] == 0))
+        return;
+
+    pthread_mutex_lock(&gRoutingMutex);
+    loadRoutes();
+
+    if (findRoute(&route) < 0) {
+        // when the table is full, forget the oldest entry
+        if (gNumRoutes == kImportRoutingMaxEntries) {
+            gNumRoutes--;
+            BlockMoveData(&gRoutes[1], &gRoutes[0], gNumRoutes * sizeof(ImportRoute));
+        }
+        gRoutes[gNumRoutes++] = route;
+        saveRoutes();
+    }
+
+    pthread_mutex_unlock(&gRoutingMutex);
+}
+
+void ImportRouting_CountImport (Boolean theSentToMainThread)
+{
+    pthread_mutex_lock(&gRoutingMutex);
+    if (theSentToMainThread)
+        gHits++;
+    else
+        gMisses++;
+    pthread_mutex_unlock(&gRoutingMutex);
+}
+
+void ImportRouting_GetStatistics (ImportRoutingStatistics *outStats)
+{
+    if (outStats == NULL)
+        return;
+
+    pthread_mutex_lock(&gRoutingMutex);
+    loadRoutes();
+    outStats->hits = gHits;
+    outStats->misses = gMisses;
+    outStats->numEntries = gNumRoutes;
+    pthread_mutex_unlock(&gRoutingMutex);
+}
+
+#pragma mark-
+
+//////////
+//
+// static routines
+//
+//////////
+
+static void makeRoute (OSType theFileType, ConstStr255Param theMIMEType, OSType theCodecType, ImportRoute *outRoute)
+{
+    UInt32 length = 0;
+
+    memset(outRoute, 0, sizeof(ImportRoute));
+    outRoute->fileType = theFileType;
+    outRoute->codecType = theCodecType;
+
+    if (theMIMEType != NULL) {
+        length = theMIMEType[0];
+        if (length > kImportRoutingMaxMIMETypeLength)
+            length = kImportRoutingMaxMIMETypeLength;
+        BlockMoveData(theMIMEType + 1, outRoute->mimeType, length);
+    }
+    outRoute->mimeType[length] = 0;
+}
+
+// find the entry that matches theRoute; codec entries match on the codec alone. Called with gRoutingMutex held.
+static SInt32 findRoute (const ImportRoute *theRoute)
+{
+    SInt32 i;
+
+    for (i = 0; i < (SInt32)gNumRoutes; i++) {
+        if (theRoute->codecType != 0) {
+            if (gRoutes[i].codecType == theRoute->codecType)
+                return i;
+        } else if ((gRoutes[i].codecType == 0) && (gRoutes[i].fileType == theRoute->fileType) &&
+                   (strcmp(gRoutes[i].mimeType, theRoute->mimeType) == 0)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// the table is kept as an array of dictionaries, with fileType, MIMEType and codecType keys. Called with gRoutingMutex held.
+static void loadRoutes (void)
+{
+    CFPropertyListRef routes;
+    CFIndex i, count;
+
+    if (gRoutesLoaded)
+        return;
+    gRoutesLoaded = true;
+
+    routes = CFPreferencesCopyAppValue(kImportRoutingPrefsKey, kCFPreferencesCurrentApplication);
+    if (routes == NULL)
+        return;
+
+    if (CFGetTypeID(routes) == CFArrayGetTypeID()) {
+        count = CFArrayGetCount((CFArrayRef)routes);
+        for (i = 0; (i < count) && (gNumRoutes < kImportRoutingMaxEntries); i++) {
+            CFDictionaryRef dict = (CFDictionaryRef)CFArrayGetValueAtIndex((CFArrayRef)routes, i);
+            CFNumberRef fileType, codecType;
+            CFStringRef mimeType;
+            ImportRoute *route = &gRoutes[gNumRoutes];
+
+            if (CFGetTypeID(dict) != CFDictionaryGetTypeID())
+                continue;
+
+            memset(route, 0, sizeof(ImportRoute));
+            fileType = (CFNumberRef)CFDictionaryGetValue(dict, CFSTR("fileType"));
+            codecType = (CFNumberRef)CFDictionaryGetValue(dict, CFSTR("codecType"));
+            mimeType = (CFStringRef)CFDictionaryGetValue(dict, CFSTR("MIMEType"));
+            if (fileType != NULL)
+                CFNumberGetValue(fileType, kCFNumberSInt32Type, &route->fileType);
+            if (codecType != NULL)
+                CFNumberGetValue(codecType, kCFNumberSInt32Type, &route->codecType);
+            if (mimeType != NULL)
+                CFStringGetCString(mimeType, route->mimeType, sizeof(route->mimeType), kCFStringEncodingASCII);
+
+            gNumRoutes++;
+        }
+    }
+
+    CFRelease(routes);
+}
+
+// called with gRoutingMutex held
+static void saveRoutes (void)
+{
+    CFMutableArrayRef routes;
+    UInt32 i;
+
+    routes = CFArrayCreateMutable(kCFAllocatorDefault, gNumRoutes, &kCFTypeArrayCallBacks);
+    if (routes == NULL)
+        return;
+
+    for (i = 0; i < gNumRoutes; i++) {
+        CFMutableDictionaryRef dict;
+        CFNumberRef number;
+        CFStringRef string;
+
+        dict = CFDictionaryCreateMutable(kCFAllocatorDefault, 3, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        if (dict == NULL)
+            continue;
+
+        number = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &gRoutes[i].fileType);
+        CFDictionarySetValue(dict, CFSTR("fileType"), number);
+        CFRelease(number);
+
+        number = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &gRoutes[i].codecType);
+        CFDictionarySetValue(dict, CFSTR("codecType"), number);
+        CFRelease(number);
+
+        string = CFStringCreateWithCString(kCFAllocatorDefault, gRoutes[i].mimeType, kCFStringEncodingASCII);
+        if (string != NULL) {
+            CFDictionarySetValue(dict, CFSTR("MIMEType"), string);
+            CFRelease(string);
+        }
+
+        CFArrayAppendValue(routes, dict);
+        CFRelease(dict);
+    }
+
+    CFPreferencesSetAppValue(kImportRoutingPrefsKey, routes, kCFPreferencesCurrentApplication);
+    CFPreferencesAppSynchronize(kCFPreferencesCurrentApplication);
+    CFRelease(routes);
+}
@@ -0,0 +1,104 @@
+/*
+	File:		ImportRouting.h
+	
+	Description: Remembers which kinds of files need components that aren't thread-safe, so that imports of
+			     them can go straight to the main thread instead of failing on a worker thread first.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef IMPORT_ROUTING_H
+#define IMPORT_ROUTING_H
+
+#include <Carbon/Carbon.h>
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kImportRoutingPrefsKey			CFSTR("UnsafeComponentRoutes")	// where the table is kept in our preferences
+#define kImportRoutingMaxEntries		256
+#define kImportRoutingMaxMIMETypeLength	63
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct {
+    UInt32			hits;			// imports the table sent to the main thread
+    UInt32			misses;			// imports it let go ahead on a worker thread
+    UInt32			numEntries;		// kinds of file we've learned about
+} ImportRoutingStatistics;
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// The table is keyed by Mac OS file type, MIME type and codec type. An entry with a codec type of 0 records
+// that files of that file type and MIME type couldn't even be opened with thread-safe components; an entry
+// with a codec type records that the codec couldn't draw with them, and matches that codec in any file.
+// All of these routines are thread-safe; the table is loaded from our preferences on first use and saved
+// whenever it changes.
+
+// Before opening a file, pass a codec type of 0 to find out whether the file type and MIME type alone call for the
+// main thread; after opening it, pass the codec type too. Files with neither a file type nor a MIME type are only
+// ever matched by codec.
+Boolean ImportRouting_NeedsMainThread (OSType theFileType, ConstStr255Param theMIMEType, OSType theCodecType);
+
+// Record that an import of a file like this one failed with componentNotThreadSafeErr. Only pass a codec type
+// when that codec is known to be the one that failed; with 0, the route is by file type and MIME type alone.
+void ImportRouting_NoteNeedsMainThread (OSType theFileType, ConstStr255Param theMIMEType, OSType theCodecType);
+
+// Count the table's decision for one import, as a hit if it sent the import to the main thread. A file can be
+// looked up more than once (by file type before it goes to a worker, by codec once it's open, or just to decide
+// whether to prefetch it), so ImportRouting_NeedsMainThread doesn't count; the caller that acts on the answer does.
+void ImportRouting_CountImport (Boolean theSentToMainThread);
+
+void ImportRouting_GetStatistics (ImportRoutingStatistics *outStats);
+
+#endif // IMPORT_ROUTING_H
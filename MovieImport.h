@@ -0,0 +1,109 @@
+/*
+	File:		MovieImport.h
+	
+	Description: Imports a frame (or a contact sheet of frames) from a movie file into an offscreen GWorld.
+			     Shared by the document window and the headless batch importer.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef MOVIE_IMPORT_H
+#define MOVIE_IMPORT_H
+
+#import <Carbon/Carbon.h>
+#import <QuickTime/QuickTime.h>
+#import "FileObject.h"
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kMaxContactSheetFrames	16		// the most frames we'll draw into a contact sheet
+#define kThumbnailVariantFitted	0x80000000	// set in a thumbnail variant for frames fit to the view
+#define kThumbnailVariantMaxSize	0x1FFF		// the largest view width or height a thumbnail variant holds
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// Import the file described by threadData->fileObject, using the data handler, threading model and
+// rendering options in threadData, into a new threadData->gWorld; threadData->tinyGW must already be
+// set up as a scratch port. This can be called on the main thread or on a worker thread.
+OSErr importTheMovie (ThreadData *threadData);
+
+// Create (but don't start) the transfer that USE_COPY_DH imports through: a copy of the file from its URL into
+// threadData->copyFolder, named for the file and a hash of its URL and path, stored in threadData->transfer. Returns
+// dupFNErr, without touching anything, if the copy would be the file itself. importTheMovie calls this and runs the transfer itself
+// if threadData->transfer is NULL; otherwise it opens the copy the transfer has already made. USE_PROGRESSIVE_DH
+// uses the same transfer, but importTheMovie only starts it, opens the Movie while it runs, and then stops it; it
+// disposes of the transfer before a retry on the main thread, which starts one of its own that resumes the copy.
+OSErr newImportTransfer (ThreadData *threadData);
+
+// Dispose of the intermediate state (data reference, Movie data, Movie and transfer) that importTheMovie keeps in
+// threadData when it sets threadData->retry; call this when disposing of thread data whose retry might not have happened.
+void disposeImportState (ThreadData *threadData);
+
+// Return the ThumbnailCache variant for the frame importTheMovie draws for threadData. A single frame decoded at its
+// natural size depends only on the file; a contact sheet, or a frame decoded at or shrunk to display size, also
+// depends on the size of threadData->movieRect, so those variants include it (up to kThumbnailVariantMaxSize).
+UInt32 getThumbnailVariant (const ThreadData *threadData);
+
+// Return in outRect the bounds of the GWorld importTheMovie draws into for a movie of the given natural size with
+// threadData's settings (before a frame is shrunk to fit on the worker).
+void getImportFrameRect (const ThreadData *threadData, UInt32 naturalWidth, UInt32 naturalHeight, Rect *outRect);
+
+// Is theGWorld, a frame of a movie of the given natural size, the size of the frame importTheMovie makes for threadData?
+Boolean isFrameForThreadData (const ThreadData *threadData, GWorldPtr theGWorld, UInt32 naturalWidth, UInt32 naturalHeight);
+
+// Look up the frame for threadData->fileObject in the ThumbnailCache, as getThumbnailVariant of threadData, into
+// threadData->gWorld and its natural size; a frame that isn't the size isFrameForThreadData expects is a miss (fnfErr).
+OSErr lookupThumbnail (ThreadData *threadData);
+
+// Return in outRect the largest rectangle, with its origin at (0, 0), that has the aspect ratio of theSrcRect and
+// fits into theBounds; a source that already fits, or empty bounds, leave it at its own size.
+void getAspectFitRect (const Rect *theSrcRect, const Rect *theBounds, Rect *outRect);
+
+#endif // MOVIE_IMPORT_H
@@ -0,0 +1,963 @@
+/*
+	File:		MovieImport.m
+	
+	Description: Imports a frame (or a contact sheet of frames) from a movie file into an offscreen GWorld.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#import <limits.h>
+#import <fcntl.h>
+#import <unistd.h>
+#import <sys/stat.h>
+
+#import "MovieImport.h"
+#import "DataRefUtilities.h"
+#import "GWorldPool.h"
+#import "ImageScale.h"
+#import "ImportRouting.h"
+#import "QTDataRef.h"
+#import "ThumbnailCache.h"
+
+//////////
+//
+// static function declarations
+//
+//////////
+
+static void shrinkFrameToFit (ThreadData *threadData);
+static void getContactSheetGrid (UInt32 numFrames, UInt32 *outColumns, UInt32 *outRows);
+static OSType getMovieCodecType (Movie theMovie);
+static OSType getTrackCodecType (Track theTrack);
+
+#pragma mark-
+
+//////////
+//
+// importTheMovie
+// Open the movie and draw a frame from the middle of it (or a grid of evenly spaced frames) into threadData->gWorld.
+//
+//////////
+
+OSErr importTheMovie (ThreadData *threadData)
+{
+    FileObject *aFileObject = nil;
+    FSSpec fileSpec;
+    Rect naturalBounds;
+    Rect dstRect;
+    Rect tileRect;
+    short tileWidth, tileHeight;
+    UInt32 numFrames, numColumns, numRows, frame;
+    TimeValue duration, frameTime;
+    OSType drType;
+    UInt32 dhTag;
+    Movie movie = NULL;
+    void *moviePointer = NULL;
+    Handle movieHandle = NULL;
+    Handle drHandle = NULL;
+    short fileResNum = -1;
+    ComponentResult err = noErr;
+    CGrafPtr savedPort = NULL;
+    GDHandle savedGDevice = NULL;
+
+    if (threadData == NULL)
+        return paramErr;
+
+    aFileObject = threadData->fileObject;
+    if (aFileObject == nil) return paramErr;
+
+    dhTag = threadData->dhTag;
+    
+    // override the thread mode (for testing/demo purposes)
+    CSSetComponentsThreadMode(threadData->onlySafeComps ? kCSAcceptThreadSafeComponentsOnlyMode : kCSAcceptAllComponentsMode);
+    
+    // get the current port and device
+    GetGWorld(&savedPort, &savedGDevice);
+    
+    if (threadData->cancelled)
+        goto bail;
+
+    // if we're retrying on the main thread, pick up where the worker left off: the file has been read
+    // and the data reference built already, and the Movie may even be open
+    if (threadData->drHandle != NULL) {
+        drHandle = threadData->drHandle;
+        drType = threadData->drType;
+        movieHandle = threadData->movieHandle;
+        moviePointer = threadData->moviePointer;
+        threadData->drHandle = NULL;
+        threadData->movieHandle = NULL;
+        threadData->moviePointer = NULL;
+        
+        if (threadData->movie != NULL) {
+            movie = threadData->movie;
+            threadData->movie = NULL;
+            AttachMovieToCurrentThread(movie);
+        }
+        
+        goto openMovie;
+    }
+
+    // don't open any components for files we know QuickTime can't import
+    if ([aFileObject isNotMedia]) {
+        err = noMovieFound;
+        fprintf(stderr, "\"%s\" isn't a movie or image file (%d)\n", [aFileObject fileName], (int)err);
+        goto bail;
+    }
+
+    //////////
+    //
+    // create the appropriate type of data reference
+    //
+    //////////
+    
+    switch (dhTag) {
+        case USE_POINTER_DH:
+        case USE_HANDLE_DH: {
+            short fileRefNum;
+            long numbytes;
+                
+            // the file object resolved the path when the folder was scanned
+            err = [aFileObject getFileSpec:&fileSpec];
+            if (err != noErr) {
+                fprintf(stderr, "getFileSpec(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+ 
+            err = FSpOpenDF(&fileSpec, fsRdPerm, &fileRefNum);
+            if (err != noErr) {
+                fprintf(stderr, "FSpOpenDF(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+ 
+            err = GetEOF(fileRefNum, &numbytes);
+            if (err != noErr) {
+                fprintf(stderr, "GetEOF(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+
+            if (dhTag == USE_HANDLE_DH) {
+                movieHandle = NewHandleClear(numbytes);
+                HLock(movieHandle);
+                moviePointer = (void *)*movieHandle;
+            } else {
+                moviePointer = calloc(1, numbytes);
+            }
+                
+            if (moviePointer == NULL) {
+                fprintf(stderr, "NewHandleClear or calloc(\"%s\") failed (%d)\n", [aFileObject fileName], (int)memFullErr);
+                goto bail;
+            }
+ 
+            err = FSRead(fileRefNum, &numbytes, moviePointer);
+            FSClose(fileRefNum);
+            if (err != noErr) {
+                fprintf(stderr, "FSRead(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+            
+            // tag the data reference with the file name, type and MIME type as requested; the extensions
+            // are built along with the data reference itself, in a single allocation
+            // for more information regarding tagging Handle and Pointer Data References see TN1195
+            // http://developer.apple.com/technotes/tn/tn1195.html
+            if (dhTag == USE_HANDLE_DH) {
+                drHandle = QTDR_MakeHandleDataRefWithExtensions(movieHandle,
+                                                                threadData->useFileName ? [aFileObject fileName] : NULL,
+                                                                threadData->useFileType ? [aFileObject fileType] : 0,
+                                                                threadData->useMIMEType ? [aFileObject mimeType] : NULL);
+                drType = HandleDataHandlerSubType;
+            } else {
+                drHandle = QTDR_MakePointerDataRefWithExtensions(moviePointer, numbytes,
+                                                                 threadData->useFileName ? [aFileObject fileName] : NULL,
+                                                                 threadData->useFileType ? [aFileObject fileType] : 0,
+                                                                 threadData->useMIMEType ? [aFileObject mimeType] : NULL);
+                drType = PointerDataHandlerSubType;
+            }
+            
+            if (drHandle == NULL) {
+                err = memFullErr;
+                fprintf(stderr, "QTDR_MakeHandleDataRefWithExtensions or QTDR_MakePointerDataRefWithExtensions(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+            
+            break;
+        }
+            
+        case USE_FILE_DH:
+            // copy the file data reference the file object built when the folder was scanned
+            drHandle = [aFileObject copyFileDataRef];
+            if (drHandle == NULL) {
+                err = fnfErr;
+                fprintf(stderr, "copyFileDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+            
+            drType = rAliasType;
+            break;
+            
+        case USE_URL_DH: {
+            char *url = [aFileObject url];
+            
+            if (url != NULL) {
+                drHandle = QTDR_MakeURLDataRef(url);
+                if (drHandle == NULL) {
+                    fprintf(stderr, "QTDR_MakeURLDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                    goto bail;
+                }
+            }
+            
+            drType = URLDataHandlerSubType;
+            break;
+        }
+            
+        case USE_COPY_DH: {
+            QTDRTransferPtr transfer;
+            
+            // a copy that failed for want of a thread-safe data handler gets another go on the main thread;
+            // the transfer reports that (badComponentType) as an OSErr
+            if ((threadData->transfer != NULL) && !threadData->onlySafeComps &&
+                    (QTDR_GetTransferError(threadData->transfer) == (OSErr)badComponentType)) {
+                QTDR_DisposeTransfer(threadData->transfer);
+                threadData->transfer = NULL;
+            }
+            
+            // copy the file from its URL into a local file with the transfer engine, unless someone
+            // (such as the batch importer) has made the copy already, and then open the copy
+            if (threadData->transfer == NULL) {
+                err = newImportTransfer(threadData);
+                if (err == noErr)
+                    QTDR_RunTransfer(threadData->transfer);
+            }
+            
+            transfer = threadData->transfer;
+            if (err == noErr)
+                err = QTDR_GetTransferError(transfer);
+            if ((err == (OSErr)badComponentType) && threadData->onlySafeComps) {
+                threadData->retry = true;
+                goto bail;
+            }
+            if (err != noErr) {
+                fprintf(stderr, "copying \"%s\" failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+            
+            drHandle = QTDR_MakeFileDataRef(&transfer->file);
+            if (drHandle == NULL) {
+                err = memFullErr;
+                fprintf(stderr, "QTDR_MakeFileDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+            
+            drType = rAliasType;
+            break;
+        }
+            
+        case USE_PROGRESSIVE_DH: {
+            // start copying the file from its URL, but don't wait for the copy; the Movie is opened from it below,
+            // as soon as the movie atom is in, and each frame waits only for its own samples. The transfer has to
+            // be tasked on the thread that started it, so a retry on the main thread gets here with no transfer
+            // (the worker stops its own; see below) and starts another, which resumes from the worker's checkpoint
+            if (threadData->transfer == NULL) {
+                err = newImportTransfer(threadData);
+                if (err == noErr)
+                    err = QTDR_StartTransfer(threadData->transfer);
+            }
+            
+            if ((err == (OSErr)badComponentType) && threadData->onlySafeComps) {
+                threadData->retry = true;
+                goto bail;
+            }
+            if (err != noErr) {
+                fprintf(stderr, "starting the copy of \"%s\" failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+            
+            // the Movie is opened from the transfer, not from a data reference
+            drType = rAliasType;
+            break;
+        }
+    }
+    
+openMovie:
+    Microseconds(&threadData->startTime);
+
+    //////////
+    //
+    // open the file using the data reference and draw it into a new GWorld
+    //
+    //////////
+    
+    if (threadData->cancelled)
+        goto bail;
+        
+    // gotta have a valid port for when we open movies
+    SetGWorld(threadData->tinyGW, NULL);
+    
+    if ((movie == NULL) && (dhTag == USE_PROGRESSIVE_DH))
+        err = QTDR_GetMovieFromTransfer(threadData->transfer, &movie);
+    else if (movie == NULL)
+        err = NewMovieFromDataRef(&movie, newMovieActive, &fileResNum, drHandle, drType);
+    if (err != noErr) {
+        // if we get componentNotThreadSafeErr, we need to retry importing on the main thread
+        if (err == componentNotThreadSafeErr) {
+            if (threadData->onlySafeComps) {
+                // set a flag to indicate we need to retry on main thread, allowing non-safe components
+                threadData->retry = true;
+                goto bail;
+            } else {
+                // this should *really* never happen....
+                fprintf(stderr, "NewMovieFromDataRef(\"%s\") returned componentNotThreadSafeErr but with any components allowed!\n", [aFileObject fileName]);
+                goto bail;
+            }
+        }
+
+	fprintf(stderr, "NewMovieFromDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+        goto bail;
+    }
+    
+    GetMovieNaturalBoundsRect(movie, &naturalBounds);
+    err = GetMoviesError();
+    if (err != noErr) {
+	fprintf(stderr, "GetMovieNaturalBounds(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+        goto bail;
+    }
+    
+    // if we've learned that this codec isn't thread-safe, don't bother trying to draw with it here;
+    // go straight to the retry on the main thread, which will pick up the Movie we've just opened
+    threadData->codecType = getMovieCodecType(movie);
+    if (threadData->onlySafeComps) {
+        Boolean needsMainThread = (threadData->codecType != 0) &&
+                ImportRouting_NeedsMainThread([aFileObject fileType], [aFileObject mimeType], threadData->codecType);
+
+        // this is the last word on whether the table sends this import to the main thread
+        ImportRouting_CountImport(needsMainThread);
+        if (needsMainThread) {
+            threadData->failedCodecType = threadData->codecType;
+            threadData->retry = true;
+            goto bail;
+        }
+    }
+    
+    // save the natural width and height of the Movie
+    threadData->naturalWidth = naturalBounds.right - naturalBounds.left;
+    threadData->naturalHeight = naturalBounds.bottom - naturalBounds.top;
+    
+    // and remember them, along with the duration, in the file catalog
+    [aFileObject setNaturalWidth:threadData->naturalWidth height:threadData->naturalHeight
+                        duration:(Float64)GetMovieDuration(movie) / GetMovieTimeScale(movie)];
+    
+    // create a GWorld for the natural bounds of the movie
+    // when we draw we preservethe aspect ratio of the Movie depending on the
+    // NSQuickDrawView bounds and the Movies natural bounds
+    dstRect = naturalBounds;
+    OffsetRect(&dstRect, -naturalBounds.left, -naturalBounds.top);
+
+    // a contact sheet is a grid of frames, as close to square as we can make it, all drawn from the one Movie
+    // we just opened; that saves opening the file and setting up the decompressor again for every frame
+    numFrames = (threadData->numContactFrames > 1) ? threadData->numContactFrames : 1;
+    if (numFrames > kMaxContactSheetFrames)
+        numFrames = kMaxContactSheetFrames;
+    getContactSheetGrid(numFrames, &numColumns, &numRows);
+
+    // size the GWorld for the sheet, or the frame, that we're going to draw
+    getImportFrameRect(threadData, dstRect.right, dstRect.bottom, &dstRect);
+    tileWidth = dstRect.right / numColumns;
+    tileHeight = dstRect.bottom / numRows;
+    
+    // movies in a folder tend to share dimensions, so this usually reuses a GWorld from an earlier import
+    err = GWorldPool_Get(&dstRect, k32ARGBPixelFormat, &threadData->gWorld);
+    if (err != noErr) {
+	fprintf(stderr, "GWorldPool_Get(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+        goto bail;
+    }
+    
+    LockPixels( GetGWorldPixMap( threadData->gWorld ) );
+
+    SetGWorld( threadData->gWorld, NULL );
+    EraseRect( &dstRect );
+    
+    SetMovieGWorld( movie, threadData->gWorld, NULL );
+    err = GetMoviesError();
+    if( err ) {
+        fprintf(stderr, "SetMovieGWorld(\"%s\") returned %d\n", [aFileObject fileName], (int)err);
+        goto bail;
+    }
+
+    // draw a frame from the middle of the movie into the GWorld; for a contact sheet, draw a frame from the middle
+    // of each tile's share of the movie into that tile
+    duration = GetMovieDuration(movie);
+    for (frame = 0; frame < numFrames; frame++) {
+        if (threadData->cancelled) {
+            err = userCanceledErr;
+            break;
+        }
+
+        tileRect.left = (frame % numColumns) * tileWidth;
+        tileRect.top = (frame / numColumns) * tileHeight;
+        tileRect.right = tileRect.left + tileWidth;
+        tileRect.bottom = tileRect.top + tileHeight;
+
+        SetMovieBox( movie, &tileRect );
+        err = GetMoviesError();
+        if( err ) {
+            fprintf(stderr, "SetMovieBox(\"%s\") returned %d\n", [aFileObject fileName], (int)err);
+            goto bail;
+        }
+
+        frameTime = (TimeValue)(((SInt64)duration * (2 * frame + 1)) / (2 * numFrames));
+        
+        // a Movie that's still being copied has to have the samples for this frame in before we can draw it
+        if (dhTag == USE_PROGRESSIVE_DH) {
+            err = QTDR_WaitForMovieTime(threadData->transfer, movie, frameTime);
+            if (err != noErr) {
+                fprintf(stderr, "QTDR_WaitForMovieTime(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+                goto bail;
+            }
+        }
+
+        SetMovieTimeValue(movie, frameTime);
+        MoviesTask(movie, 0);
+        err = GetMoviesError();
+        if (err == noErr) 
+            err = GetMovieStatus(movie, NULL);
+        if (err != noErr)
+            break;
+    }
+        
+    if (err != noErr) {
+        // if we get componentNotThreadSafeErr, then we need to retry importing on the main thread
+        if (err == componentNotThreadSafeErr) {
+            if (threadData->onlySafeComps == true) {
+                // set a flag to indicate we need to retry on main thread, allowing non-safe components;
+                // only blame a codec if it's a visual track that failed, otherwise the route is by file type
+                Track problemTrack = NULL;
+
+                GetMovieStatus(movie, &problemTrack);
+                if ((problemTrack != NULL) && MediaHasCharacteristic(GetTrackMedia(problemTrack), VisualMediaCharacteristic))
+                    threadData->failedCodecType = getTrackCodecType(problemTrack);
+                threadData->retry = true;
+                goto bail;
+            } else {
+                // this should *really* never happen....
+                fprintf(stderr, "MoviesTask(\"%s\") returned componentNotThreadSafeErr but with any components allowed!\n", [aFileObject fileName]);
+                goto bail;
+            }
+        }
+    
+        // if we get codecAbortErr or we know we cancelled, workerResponseMainThreadCallback cleans up
+        if ((err != codecAbortErr) && (!threadData->cancelled)) {
+            fprintf(stderr, "MoviesTask(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
+        }
+    } else {
+        // stop drawing into the GWorld before we (maybe) swap it for a smaller one
+        SetMovieGWorld(movie, threadData->tinyGW, NULL);
+        SetGWorld(threadData->tinyGW, NULL);
+
+        if (threadData->scaleOnWorker && !threadData->decodeAtDisplaySize)
+            shrinkFrameToFit(threadData);
+
+        threadData->imported = true;
+
+        // remember the frame so that we never have to import this version of the file again
+        if (!threadData->cancelled && !threadData->skipThumbnailCache)
+            ThumbnailCache_Store([aFileObject pathName], getThumbnailVariant(threadData), threadData->gWorld, threadData->naturalWidth, threadData->naturalHeight);
+    }
+    
+bail:
+
+    //////////
+    //
+    // clean up
+    //
+    //////////
+
+    // if we're going to retry on the main thread, hand the data reference, the Movie data and the Movie
+    // itself over to the retry, so that it only has to redo the step that needed a non-thread-safe component;
+    // a progressive import's Movie reads from a transfer that only this thread can task, so it starts over
+    if (threadData->retry && (dhTag != USE_PROGRESSIVE_DH)) {
+        threadData->drHandle = drHandle;
+        threadData->drType = drType;
+        threadData->movieHandle = movieHandle;
+        threadData->moviePointer = (dhTag == USE_POINTER_DH) ? moviePointer : NULL;
+        drHandle = NULL;
+        movieHandle = NULL;
+        moviePointer = NULL;
+
+        // the GWorld is about to be thrown away, so point the Movie at the scratch port before letting go of it
+        if (movie != NULL) {
+            SetMovieGWorld(movie, threadData->tinyGW, NULL);
+            if (DetachMovieFromCurrentThread(movie) == noErr) {
+                threadData->movie = movie;
+                movie = NULL;
+            }
+        }
+    }
+
+    // we're done with the data reference
+    if (drHandle != NULL) {
+        DisposeHandle(drHandle);
+        drHandle = NULL;
+    }
+    
+    // we're done with the Movie data
+    if (dhTag == USE_POINTER_DH && moviePointer != NULL)
+        free(moviePointer);
+    
+    if (movieHandle != NULL) {
+        DisposeHandle(movieHandle);
+        movieHandle = NULL;
+    }
+    
+    // we're done with the movie
+    if (movie != 0) {
+        DisposeMovie(movie);
+        movie = 0;
+    }
+    
+    // a progressive import only needs part of the copy, so stop the rest of it; the copy's checkpoint lets a
+    // later import pick up where it stopped. That includes a retry on the main thread, which can't task this
+    // thread's data handlers, so we let go of the transfer altogether and the retry starts its own
+    if ((dhTag == USE_PROGRESSIVE_DH) && (threadData->transfer != NULL)) {
+        QTDR_CancelTransfer(threadData->transfer);
+        while (!QTDR_TaskTransfer(threadData->transfer))
+            usleep(kQTDR_TaskInterval);
+        QTDR_CloseTransfer(threadData->transfer);
+        
+        if (threadData->retry) {
+            QTDR_DisposeTransfer(threadData->transfer);
+            threadData->transfer = NULL;
+        }
+    }
+    
+    // set the saved port and device
+    SetGWorld(savedPort, savedGDevice);
+
+    return err;
+}
+
+//////////
+//
+// getThumbnailVariant
+// Pack what the frame depends on into a ThumbnailCache variant: the number of contact sheet frames in the low
+// five bits and, for frames that were fit to the view, kThumbnailVariantFitted and the size of the view above them.
+//
+//////////
+
+UInt32 getThumbnailVariant (const ThreadData *threadData)
+{
+    UInt32 variant = threadData->numContactFrames & 0x1F;
+    UInt32 width, height;
+    
+    if ((threadData->numContactFrames > 1) || threadData->decodeAtDisplaySize || threadData->scaleOnWorker) {
+        width = threadData->movieRect.right - threadData->movieRect.left;
+        height = threadData->movieRect.bottom - threadData->movieRect.top;
+        // views too big for their fields all get the largest value; lookupThumbnail checks the frame's size
+        if (width > kThumbnailVariantMaxSize)
+            width = kThumbnailVariantMaxSize;
+        if (height > kThumbnailVariantMaxSize)
+            height = kThumbnailVariantMaxSize;
+        variant |= kThumbnailVariantFitted | (width << 5) | (height << 18);
+    }
+    
+    return variant;
+}
+
+//////////
+//
+// getImportFrameRect
+// Return the bounds of the GWorld importTheMovie draws into for a movie of the given natural size.
+//
+//////////
+
+void getImportFrameRect (const ThreadData *threadData, UInt32 naturalWidth, UInt32 naturalHeight, Rect *outRect)
+{
+    UInt32 numFrames, numColumns, numRows;
+    short tileWidth, tileHeight;
+    Rect naturalRect;
+    
+    MacSetRect(&naturalRect, 0, 0, naturalWidth, naturalHeight);
+    
+    numFrames = (threadData->numContactFrames > 1) ? threadData->numContactFrames : 1;
+    if (numFrames > kMaxContactSheetFrames)
+        numFrames = kMaxContactSheetFrames;
+    getContactSheetGrid(numFrames, &numColumns, &numRows);
+
+    if (numFrames > 1) {
+        // the sheet as a whole fits the NSQuickDrawView, and each tile keeps the aspect ratio of the Movie;
+        // the unscaled sheet can be far bigger than a Rect can hold, so size it in floats and only store the fitted result
+        float sheetWidth = (float)naturalWidth * numColumns;
+        float sheetHeight = (float)naturalHeight * numRows;
+        float boundsWidth = threadData->movieRect.right - threadData->movieRect.left;
+        float boundsHeight = threadData->movieRect.bottom - threadData->movieRect.top;
+        float scale = 1.0;
+
+        if ((boundsWidth <= 0) || (boundsHeight <= 0)) {
+            boundsWidth = SHRT_MAX;
+            boundsHeight = SHRT_MAX;
+        }
+        if (sheetWidth * scale > boundsWidth)
+            scale = boundsWidth / sheetWidth;
+        if (sheetHeight * scale > boundsHeight)
+            scale = boundsHeight / sheetHeight;
+
+        tileWidth = (sheetWidth * scale) / numColumns;
+        tileHeight = (sheetHeight * scale) / numRows;
+        if (tileWidth == 0)
+            tileWidth = 1;
+        if (tileHeight == 0)
+            tileHeight = 1;
+        MacSetRect(outRect, 0, 0, tileWidth * numColumns, tileHeight * numRows);
+    } else if (threadData->decodeAtDisplaySize) {
+        // or, if we're decoding at display size, the smaller of qdViewBounds and naturalBounds, while preserving
+        // the aspect ratio of the Movie; updateQDMovieView then just blits it 1:1
+        getAspectFitRect(&naturalRect, &threadData->movieRect, outRect);
+    } else {
+        *outRect = naturalRect;
+    }
+}
+
+//////////
+//
+// isFrameForThreadData
+// Is theGWorld, a frame of a movie of the given natural size, the frame importTheMovie would make for threadData?
+// A frame shrunk to fit on the worker is the natural-size frame fit to threadData->movieRect.
+//
+//////////
+
+Boolean isFrameForThreadData (const ThreadData *threadData, GWorldPtr theGWorld, UInt32 naturalWidth, UInt32 naturalHeight)
+{
+    Rect frameRect, expectedRect, naturalRect;
+    
+    GetPortBounds(theGWorld, &frameRect);
+    getImportFrameRect(threadData, naturalWidth, naturalHeight, &expectedRect);
+    if (threadData->scaleOnWorker && !threadData->decodeAtDisplaySize) {
+        naturalRect = expectedRect;
+        getAspectFitRect(&naturalRect, &threadData->movieRect, &expectedRect);
+    }
+    
+    return ((frameRect.right - frameRect.left) == expectedRect.right) && ((frameRect.bottom - frameRect.top) == expectedRect.bottom);
+}
+
+//////////
+//
+// lookupThumbnail
+// Look up the frame for threadData in the ThumbnailCache, as ThumbnailCache_Lookup does, but only take a frame of
+// the size importTheMovie would make now: views too big for the variant to tell apart share a variant.
+//
+//////////
+
+OSErr lookupThumbnail (ThreadData *threadData)
+{
+    GWorldPtr gWorld = NULL;
+    UInt32 naturalWidth, naturalHeight;
+    OSErr err;
+    
+    err = ThumbnailCache_Lookup([(FileObject *)threadData->fileObject pathName], getThumbnailVariant(threadData), &gWorld, &naturalWidth, &naturalHeight);
+    if (err != noErr)
+        return err;
+    
+    if (!isFrameForThreadData(threadData, gWorld, naturalWidth, naturalHeight)) {
+        GWorldPool_Put(gWorld);
+        return fnfErr;
+    }
+    
+    threadData->gWorld = gWorld;
+    threadData->naturalWidth = naturalWidth;
+    threadData->naturalHeight = naturalHeight;
+    return noErr;
+}
+
+//////////
+//
+// getContactSheetGrid
+// Return the number of columns and rows of a contact sheet of numFrames frames, as close to square as we can make it.
+//
+//////////
+
+static void getContactSheetGrid (UInt32 numFrames, UInt32 *outColumns, UInt32 *outRows)
+{
+    UInt32 numColumns;
+    
+    for (numColumns = 1; numColumns * numColumns < numFrames; numColumns++)
+        ;
+    *outColumns = numColumns;
+    *outRows = (numFrames + numColumns - 1) / numColumns;
+}
+
+//////////
+//
+// getAspectFitRect
+// Fit theSrcRect into theBounds, preserving its aspect ratio.
+//
+//////////
+
+void getAspectFitRect (const Rect *theSrcRect, const Rect *theBounds, Rect *outRect)
+{
+    float srcWidth, srcHeight;
+    float boundsWidth, boundsHeight;
+    
+    srcWidth = theSrcRect->right - theSrcRect->left;
+    srcHeight = theSrcRect->bottom - theSrcRect->top;
+    boundsWidth = theBounds->right - theBounds->left;
+    boundsHeight = theBounds->bottom - theBounds->top;
+    
+    outRect->top = 0;
+    outRect->left = 0;
+    
+    if (((srcWidth <= boundsWidth) && (srcHeight <= boundsHeight)) || (boundsWidth <= 0) || (boundsHeight <= 0)) {
+        outRect->right = srcWidth;
+        outRect->bottom = srcHeight;
+    } else {
+        float srcRatio = srcWidth / srcHeight;
+        float boundsRatio = boundsWidth / boundsHeight;
+        
+        if (srcRatio > boundsRatio) {
+            // the source is wider than will fit; rescale
+            outRect->right = boundsWidth;
+            outRect->bottom = boundsWidth / srcRatio;
+        } else {
+            // the source is taller than will fit; rescale
+            outRect->right = boundsHeight * srcRatio;
+            outRect->bottom = boundsHeight;
+        }
+    }
+    
+    // enforce a minimum rectangle
+    if (outRect->right == 0)
+        outRect->right = 1;
+    
+    if (outRect->bottom == 0)
+        outRect->bottom = 1;
+}
+
+//////////
+//
+// shrinkFrameToFit
+// Replace the natural-size frame in threadData->gWorld with a box-filtered copy that fits threadData->movieRect,
+// so that the main thread gets a better-looking frame that it can blit 1:1; if anything goes wrong, we just
+// leave the natural-size frame for updateQDMovieView to scale.
+//
+//////////
+
+static void shrinkFrameToFit (ThreadData *threadData)
+{
+    GWorldPtr scaledGW = NULL;
+    Rect srcRect, fitRect;
+    
+    GetPortBounds(threadData->gWorld, &srcRect);
+    getAspectFitRect(&srcRect, &threadData->movieRect, &fitRect);
+    if ((fitRect.right == srcRect.right - srcRect.left) && (fitRect.bottom == srcRect.bottom - srcRect.top))
+        return;
+    
+    if (GWorldPool_Get(&fitRect, k32ARGBPixelFormat, &scaledGW) != noErr)
+        return;
+    
+    if (ImageScale_BoxGWorld(threadData->gWorld, scaledGW) != noErr) {
+        GWorldPool_Put(scaledGW);
+        return;
+    }
+    
+    GWorldPool_Put(threadData->gWorld);
+    threadData->gWorld = scaledGW;
+}
+
+//////////
+//
+// getMovieCodecType
+// Return the codec type of the first enabled visual track in theMovie, or 0 if there isn't one.
+//
+//////////
+
+static OSType getMovieCodecType (Movie theMovie)
+{
+    Track track;
+    
+    track = GetMovieIndTrackType(theMovie, 1, VisualMediaCharacteristic, movieTrackCharacteristic | movieTrackEnabledOnly);
+    if (track == NULL)
+        return 0;
+    
+    return getTrackCodecType(track);
+}
+
+//////////
+//
+// getTrackCodecType
+// Return the codec type of the first sample description of theTrack, or 0 if we can't get it.
+//
+//////////
+
+static OSType getTrackCodecType (Track theTrack)
+{
+    SampleDescriptionHandle sampleDesc = NULL;
+    OSType codecType = 0;
+    
+    sampleDesc = (SampleDescriptionHandle)NewHandle(0);
+    if (sampleDesc == NULL)
+        return 0;
+    
+    GetMediaSampleDescription(GetTrackMedia(theTrack), 1, sampleDesc);
+    if ((GetMoviesError() == noErr) && (GetHandleSize((Handle)sampleDesc) >= (Size)sizeof(SampleDescription)))
+        codecType = (**sampleDesc).dataFormat;
+    
+    DisposeHandle((Handle)sampleDesc);
+    
+    return codecType;
+}
+
+//////////
+//
+// newImportTransfer
+// Create the transfer that copies the file described by threadData->fileObject from its URL into threadData->copyFolder,
+// and store it in threadData->transfer. The transfer isn't started. The copy is named for the file with a hash of its URL
+// and path name before the extension ("dog-1a2b3c4d.mov"), so that files of the same name from different folders (or
+// different servers) don't share a copy or a checkpoint; and a copy that would be the file itself is refused.
+//
+//////////
+
+OSErr newImportTransfer (ThreadData *threadData)
+{
+    FileObject *aFileObject = threadData->fileObject;
+    const char *folder = (threadData->copyFolder != NULL) ? threadData->copyFolder : ".";
+    char *url = [aFileObject url];
+    const char *fileName = [aFileObject fileName];
+    const char *extension = strrchr(fileName, '.');
+    const char *c;
+    char path[PATH_MAX];
+    char sourcePath[PATH_MAX];
+    char resolvedPath[PATH_MAX];
+    struct stat sourceStat, copyStat;
+    UInt32 hash = 2166136261UL;
+    FSRef fileRef;
+    FSSpec fileSpec;
+    int fd;
+    OSErr err = noErr;
+
+    if (url == NULL)
+        return paramErr;
+
+    // FNV-1a, over the URL and then the path name
+    for (c = url; *c; c++)
+        hash = (hash ^ (UInt8)*c) * 16777619UL;
+    for (c = [aFileObject pathName]; *c; c++)
+        hash = (hash ^ (UInt8)*c) * 16777619UL;
+
+    if ((extension == NULL) || (extension == fileName))
+        extension = fileName + strlen(fileName);
+    if (realpath(folder, resolvedPath) == NULL)
+        return fnfErr;
+    if (snprintf(path, sizeof(path), "%s/%.*s-%08lx%s", resolvedPath, (int)(extension - fileName), fileName,
+                 (unsigned long)hash, extension) >= (int)sizeof(path))
+        return bdNamErr;
+
+    // the transfer deletes a copy it can't resume, so never let the copy be the file it's a copy of: not by
+    // name (after following links), and not by being a hard link to it
+    if (realpath([aFileObject pathName], sourcePath) == NULL)
+        sourcePath[0] = 0;
+    if (realpath(path, resolvedPath) == NULL)
+        strcpy(resolvedPath, path);
+    if (strcmp(resolvedPath, sourcePath) == 0)
+        return dupFNErr;
+    if ((stat(path, &copyStat) == 0) && (stat([aFileObject pathName], &sourceStat) == 0) &&
+            (copyStat.st_dev == sourceStat.st_dev) && (copyStat.st_ino == sourceStat.st_ino))
+        return dupFNErr;
+
+    // the transfer wants an FSSpec, and we can only get one of those for a file that exists; we don't truncate
+    // the file, since the transfer either replaces it or, if it's an interrupted copy, picks up where it stopped
+    fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0)
+        return ioErr;
+    close(fd);
+
+    err = FSPathMakeRef((const UInt8 *)path, &fileRef, NULL);
+    if (err == noErr)
+        err = FSGetCatalogInfo(&fileRef, kFSCatInfoNone, NULL, NULL, &fileSpec, NULL);
+    if (err == noErr)
+        err = QTDR_NewTransfer(url, &fileSpec, (QTDRTransferPtr *)&threadData->transfer);
+
+    return err;
+}
+
+//////////
+//
+// disposeImportState
+// Dispose of whatever importTheMovie kept in threadData for a retry that's no longer going to happen.
+//
+//////////
+
+void disposeImportState (ThreadData *threadData)
+{
+    if (threadData == NULL)
+        return;
+    
+    if (threadData->movie != NULL) {
+        // a Movie has to belong to the thread that disposes of it
+        AttachMovieToCurrentThread(threadData->movie);
+        DisposeMovie(threadData->movie);
+        threadData->movie = NULL;
+    }
+    
+    if (threadData->drHandle != NULL) {
+        DisposeHandle(threadData->drHandle);
+        threadData->drHandle = NULL;
+    }
+    
+    if (threadData->moviePointer != NULL) {
+        free(threadData->moviePointer);
+        threadData->moviePointer = NULL;
+    }
+    
+    if (threadData->movieHandle != NULL) {
+        DisposeHandle(threadData->movieHandle);
+        threadData->movieHandle = NULL;
+    }
+    
+    // the copy itself stays on disk
+    if (threadData->transfer != NULL) {
+        QTDR_DisposeTransfer(threadData->transfer);
+        threadData->transfer = NULL;
+    }
+}
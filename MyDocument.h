@@ -5,7 +5,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -14,7 +14,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -57,6 +57,7 @@
 #import <QuickTime/QuickTime.h>
 #import <pthread.h>
 #import "FileObject.h"
+#import "FrameCache.h"
 #import "WorkerThread.h"
 
 @class AutoRunSettings;
@@ -72,6 +73,20 @@
 // timer periods
 #define kAutoRunInterval		0.10
 
+// prefetching
+#define kMaxPrefetchDepth		8
+#define kNumPrefetchWorkers		2
+#define kPrefetchLookahead		1.0		// try to keep this many seconds of imports queued up
+
+// probing file and MIME types
+#define kNumProbeWorkers		2
+#define kProbeBatchSize			64		// files probed per worker request
+
+// user defaults keys
+#define kDecodeAtDisplaySizeKey	@"DecodeAtDisplaySize"
+#define kScaleOnWorkerKey		@"ScaleOnWorker"
+#define kContactSheetFramesKey	@"ContactSheetFrames"
+
 
 //////////
 //
@@ -113,11 +128,30 @@
     BOOL            _useFileName;		// do we add a file name extension to handle data references?
     BOOL            _useFileType;		// do we add a file type extension to handle data references?
     BOOL            _useMIMEType;		// do we add a MIME type extension to handle data references?
+    BOOL            _decodeAtDisplaySize;	// do we decode frames at the size they're drawn, rather than their natural size?
+    BOOL            _scaleOnWorker;		// do we shrink natural-size frames to fit on the worker, rather than with CopyBits?
+    UInt32          _numContactFrames;	// number of frames in a contact sheet, or 0 to import a single frame
     
     UInt32          _randomAutoRun;		// do we auto-run randomly?
     UInt32          _autoRunIterations;	// number of times we loop through image file list
 
-    WorkerThreadRef	_worker;            // a worker thread handler
+    WorkerThreadRef	_worker;            // a worker thread handler, for the import of the selected row only
+    FrameCacheRef   _frameCache;        // recently imported frames, keyed by FileObject and thumbnail variant
+
+    WorkerThreadRef	_prefetchWorkers[kNumPrefetchWorkers];	// worker threads that import upcoming rows in the background
+    UInt32          _nextPrefetchWorker;
+    ThreadData     *_prefetches[kMaxPrefetchDepth];	// prefetches for upcoming rows that are still wanted
+    UInt32          _numPrefetches;
+    UInt32          _numPrefetchesInFlight;			// including cancelled ones that haven't come back yet
+    UInt32          _prefetchDepth;					// how many upcoming rows to prefetch
+    double          _avgImportTime;					// moving average of import times, in seconds
+    UInt32          _randomRows[kMaxPrefetchDepth];	// upcoming rows, drawn ahead of time when auto-running randomly
+    UInt32          _numRandomRows;
+    BOOL            _closeWhenSafe;					// close this document once all imports have come back
+
+    WorkerThreadRef	_probeWorkers[kNumProbeWorkers];	// worker threads that probe file and MIME types in the background
+    UInt32          _numProbesInFlight;
+    volatile BOOL   _cancelProbes;
 }
 
 // document methods
@@ -135,6 +169,24 @@
 //- (void)updateQDImageView:(BOOL)updateTimer;
 - (void)cycleMovies:(NSTimer *)timer;
 
+// import requests and prefetching
+- (ThreadData *)newThreadDataForFileObject:(FileObject *)fileObject;
+- (OSErr)sendImportRequest:(ThreadData *)threadData toWorker:(WorkerThreadRef)worker;
+- (UInt32)randomRowOtherThan:(UInt32)row;
+- (UInt32)upcomingRow:(UInt32)index;
+- (void)updatePrefetches;
+- (void)cancelPrefetches;
+- (void)removePrefetchAtIndex:(UInt32)index;
+- (ThreadData *)takePrefetchForFileObject:(FileObject *)fileObject;
+- (void)prefetchDidFinish:(ThreadData *)threadData cancelled:(BOOL)cancelled;
+- (void)noteImportTime:(ThreadData *)threadData;
+- (void)closeWhenSafe;
+
+// probing file and MIME types
+- (void)probeFileArray;
+- (void)probeDidFinish;
+- (void)saveCatalog;
+
 // button action handlers
 - (IBAction)autoRun:(id)sender;
 - (IBAction)selectFolder:(id)sender;
@@ -160,6 +212,9 @@
 - (IBAction)useMainThread:(id)sender;
 
 - (IBAction)toggleThreadGuard:(id)sender;
+- (IBAction)toggleDecodeAtDisplaySize:(id)sender;
+- (IBAction)toggleScaleOnWorker:(id)sender;
+- (IBAction)useContactSheet:(id)sender;
 
 - (IBAction)useFileName:(id)sender;
 - (IBAction)useFileType:(id)sender;
@@ -175,6 +230,9 @@
 - (void *)currThreadData;
 - (void)setCurrThreadData:(ThreadData *)threadData;
 - (void)disposeThreadData:(ThreadData *)threadData;
+- (UInt32)thumbnailVariant;
+- (void)cacheFrame:(ThreadData *)threadData;
+- (void)showImportStatistics;
 
 - (NSMutableArray *)fileArray;
 - (void)setFileArray:(NSMutableArray *)array;
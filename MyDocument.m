@@ -5,7 +5,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -14,7 +14,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -54,7 +54,10 @@
 
 #import "MyDocument.h"
 #import "AutoRunSettings.h"
-#import "DataRefUtilities.h"
+#import "GWorldPool.h"
+#import "ImportRouting.h"
+#import "MovieImport.h"
+#import "ThumbnailCache.h"
 #import "WorkerThread.h"
 
 //////////
@@ -63,13 +66,29 @@
 //
 //////////
 
-static OSErr importTheMovie (ThreadData *threadData);
 static OSErr movieProgressProc (Movie theMovie, short message, short whatOperation, Fixed percentDone, long refcon);
 
 void workerActionRoutine (void *refcon, WorkerRequestRef request);
 void workerCancelRoutine (void *refcon, WorkerRequestRef request);
 void workerResponseMainThreadCallback (void *refcon, WorkerRequestRef request);
 
+void probeActionRoutine (void *refcon, WorkerRequestRef request);
+void probeResponseMainThreadCallback (void *refcon, WorkerRequestRef request);
+
+//////////
+//
+// data types
+//
+//////////
+
+// a run of files in a catalog for a probe worker to probe
+typedef struct {
+    FileCatalogRef	catalog;		// retained, in case the document lets go of its files
+    UInt32			first;
+    UInt32			count;
+    volatile BOOL *	cancelled;		// points to the document's _cancelProbes
+} ProbeBatch;
+
 //////////
 //
 // static global variables
@@ -91,6 +110,7 @@ static unsigned long	gOSVersion = 0;
 - (id)init
 {
     WorkerThreadRef outWorker = NULL; 
+    UInt32 i;
     
     [super init];
     if (self) {
@@ -103,6 +123,11 @@ static unsigned long	gOSVersion = 0;
         _useFileName = YES;                     // tag Handle and Pointer data references with file name extension
         _useFileType = NO;
         _useMIMEType = NO;
+        _decodeAtDisplaySize = [[NSUserDefaults standardUserDefaults] boolForKey:kDecodeAtDisplaySizeKey];
+        _scaleOnWorker = [[NSUserDefaults standardUserDefaults] boolForKey:kScaleOnWorkerKey];
+        _numContactFrames = [[NSUserDefaults standardUserDefaults] integerForKey:kContactSheetFramesKey];
+        if (_numContactFrames > kMaxContactSheetFrames)
+            _numContactFrames = kMaxContactSheetFrames;
         
         // allocate progress proc UPP, if necessary
         if (gMovieProgressProcUPP == NULL)
@@ -130,6 +155,21 @@ static unsigned long	gOSVersion = 0;
                 (void *)self,
                 &outWorker);
         _worker = outWorker;
+
+        // create worker threads for the prefetches, so that they never queue up in front of the selected row
+        for (i = 0; i < kNumPrefetchWorkers; i++)
+            createWorkerThread(workerActionRoutine, workerCancelRoutine, workerResponseMainThreadCallback, (void *)self, &_prefetchWorkers[i]);
+
+        // create worker threads to probe file and MIME types, so scanning a folder doesn't have to
+        for (i = 0; i < kNumProbeWorkers; i++)
+            createWorkerThread(probeActionRoutine, NULL, probeResponseMainThreadCallback, (void *)self, &_probeWorkers[i]);
+
+        // keep recently imported frames around so that revisiting a row is free
+        createFrameCache(kFrameCacheDefaultMaxBytes, &_frameCache);
+
+        // start out prefetching a couple of rows; this adapts as we see how long imports take
+        _prefetchDepth = 2;
+        _avgImportTime = kAutoRunInterval;
     }
     
     return self;
@@ -137,17 +177,26 @@ static unsigned long	gOSVersion = 0;
 
 - (void)dealloc
 {    
+    UInt32 i;
+    
     // stop auto-running
     [self setAutoRunTimer:nil];
 
-    // remove the worker thread handler
+    // remove the worker thread handlers
     releaseWorkerThread(_worker);
+    for (i = 0; i < kNumPrefetchWorkers; i++)
+        releaseWorkerThread(_prefetchWorkers[i]);
+    for (i = 0; i < kNumProbeWorkers; i++)
+        releaseWorkerThread(_probeWorkers[i]);
 
     // remove the notification that monitors selections in the file table view
     [[NSNotificationCenter defaultCenter]	removeObserver:self
                                                 name:NSTableViewSelectionDidChangeNotification
                                                 object:tableView];
                                                 
+    // save the catalog, which now knows the size and duration of the movies we've opened
+    [self saveCatalog];
+
     // clean up the list of Movies
     [self setFileArray:nil];
 
@@ -156,6 +205,9 @@ static unsigned long	gOSVersion = 0;
         if (_currThreadData->threadModelTag == USE_MAIN_THREAD)
             [self setCurrThreadData:nil];
     
+    disposeFrameCache(_frameCache);
+    _frameCache = NULL;
+
     [autoRunSettings release];
     
     [super dealloc];
@@ -214,6 +266,14 @@ static unsigned long	gOSVersion = 0;
     WorkerRequestRef wkrRequest = NULL;
 
     // the window wants to close; make sure the threads are closed down
+    [self cancelPrefetches];
+    if (_numPrefetchesInFlight > 0)
+        _closeWhenSafe = YES;
+
+    _cancelProbes = YES;
+    if (_numProbesInFlight > 0)
+        _closeWhenSafe = YES;
+
     if (_currThreadData != NULL) {
         if (_currThreadData->threadModelTag == USE_POSIX_THREAD) {
             if (_currThreadData->busy) {
@@ -224,6 +284,7 @@ static unsigned long	gOSVersion = 0;
                     // and mark the document as wanting to be closed when it's safe to do so
                     cancelWorkerRequest(wkrRequest);
                     _currThreadData->closeWhenSafe = YES;
+                    _closeWhenSafe = YES;
                     return NO;
                 }
             }
@@ -233,7 +294,7 @@ static unsigned long	gOSVersion = 0;
         }
     }
 
-    return YES;
+    return !_closeWhenSafe;
 }
 
     //////////
@@ -252,9 +313,6 @@ static unsigned long	gOSVersion = 0;
     Rect srcRect;
     Rect dstRect;
     Rect viewRect;
-    float MovieWidth, MovieHeight;
-    float viewWidth, viewHeight;
-    float newWidth, newHeight;
     NSMutableString *sizeString = [NSMutableString string];
     UnsignedWide endTime;
     
@@ -294,43 +352,16 @@ static unsigned long	gOSVersion = 0;
     
     // set the thread data passed in as the current thread data
     [self setCurrThreadData:threadData];
+    [self cacheFrame:threadData];
     
     if (threadData->gWorld != NULL) {
         GetPortBounds(threadData->gWorld, &srcRect);
         LockPixels(GetGWorldPixMap(threadData->gWorld));
 
-        // scale the destination rectangle so that the Movie fits into the NSQuickDrawView while retaining its aspect ratio
-        MovieWidth = srcRect.right - srcRect.left;
-        MovieHeight = srcRect.bottom - srcRect.top;
-        viewWidth = viewRect.right - viewRect.left;
-        viewHeight = viewRect.bottom - viewRect.top;
-        
-        dstRect.top = 0;
-        dstRect.left = 0;
-        
-        if ((threadData->naturalWidth <= viewWidth) && (threadData->naturalHeight <= viewHeight)) {
-            dstRect.right = MovieWidth;
-            dstRect.bottom = MovieHeight;
-        } else {
-            float MovieRatio = MovieWidth / MovieHeight;
-            float viewRatio = viewWidth / viewHeight;
-            
-            if (MovieRatio > viewRatio) {
-                // the Movie is wider than will fit; rescale
-                newHeight = viewWidth / MovieRatio;
-                newWidth = newHeight * MovieRatio;
-                
-                dstRect.right = newWidth;
-                dstRect.bottom = newHeight;
-            } else {
-                // the Movie is taller than will fit; rescale
-                newWidth = viewHeight * MovieRatio;
-                newHeight = newWidth / MovieRatio;
-                
-                dstRect.right = newWidth;
-                dstRect.bottom = newHeight;
-            }
-        }
+        // scale the destination rectangle so that the Movie fits into the NSQuickDrawView while retaining its aspect ratio;
+        // if the frame was decoded at display size, this is the same size as the GWorld and CopyBits doesn't need to scale
+        getAspectFitRect(&srcRect, &viewRect, &dstRect);
+
         LockPixels(GetPortPixMap(port));
         
         CopyBits(GetPortBitMapForCopyBits(threadData->gWorld), GetPortBitMapForCopyBits(port), &srcRect, &dstRect, srcCopy, NULL);
@@ -355,16 +386,11 @@ static unsigned long	gOSVersion = 0;
     // if the current Movie has been drawn, select the next item in the list of Movies; at the end, loop back to the beginning
     if (_doneDrawing) {
         if (_randomAutoRun) {
-            // select a random row between 0 and [tableView numberOfRows] - 1
-            double randNum = (rand()/(double)RAND_MAX) * [tableView numberOfRows];
-            UInt32 nextRow = (UInt32)randNum;
-
-            if (currRow == nextRow) {
-                nextRow++;
-                if (nextRow >= [tableView numberOfRows]) {
-                    nextRow = 0;
-                }
-            }
+            // select the random row that was drawn ahead of time (so that it could be prefetched)
+            UInt32 nextRow = [self upcomingRow:0];
+
+            _numRandomRows--;
+            memmove(&_randomRows[0], &_randomRows[1], _numRandomRows * sizeof(UInt32));
                 
             _doneDrawing = false;
             [tableView selectRow:nextRow byExtendingSelection:NO];
@@ -383,6 +409,7 @@ static unsigned long	gOSVersion = 0;
                 // stop the auto-run
                 [self setAutoRunTimer:nil];
                 [autorunBtn setTitle:@"Auto-Run"]; 
+                [self showImportStatistics];
             }
         }
     }
@@ -396,6 +423,7 @@ static unsigned long	gOSVersion = 0;
 
 - (IBAction)autoRun:(id)sender {
     gNumIteration = 0;						// reset iteration counter
+    _numRandomRows = 0;						// forget any random rows drawn ahead of time
     [tableView selectRow:0 byExtendingSelection:NO];
     
     if (_autorunTimer == nil) {
@@ -418,9 +446,12 @@ static unsigned long	gOSVersion = 0;
 {
     NSOpenPanel *oPanel = [NSOpenPanel openPanel];
     NSString *filename;
+    NSString *folderPath;
     NSEnumerator *enumerator = nil;
-    UInt32 count = 0;
-    UInt32 dirPathLength = 0;
+    FileCatalogRef catalog = NULL;
+    FileCatalogRef oldCatalog = NULL;
+    Boolean stale = true;
+    UInt32 index;
     int result;
 
     // elicit a folder from the user
@@ -442,45 +473,57 @@ static unsigned long	gOSVersion = 0;
     // allocate and retain a file array
     [self setFileArray:[NSMutableArray array]];
 
-    dirPathLength = [[[oPanel filenames] objectAtIndex:0] cStringLength];
-    
-    // put filenames and full pathnames into the file array
-    enumerator = [[[NSFileManager defaultManager] directoryContentsAtPath: [[oPanel filenames] objectAtIndex:0]] objectEnumerator];
-    while (filename = [enumerator nextObject]) {
-        if ([filename length] > 0) {
-            // don't allow any "hidden" files
-            if ([filename characterAtIndex:0] == '.')
-                continue;
-         
-            FileObject *aFileObject = [[FileObject alloc] init];           
-            char *cFileName, *cPathName;
+    // the file objects share a catalog of the folder's files; they each keep it retained
+    // if we've opened this folder before and it hasn't changed, its saved catalog is all we need
+    folderPath = [[oPanel filenames] objectAtIndex:0];
+    if ((FileCatalog_Load([folderPath fileSystemRepresentation], &oldCatalog, &stale) == noErr) && !stale) {
+        catalog = oldCatalog;
+        oldCatalog = NULL;
+    } else {
+        if (FileCatalog_Create(&catalog) != noErr) {
+            FileCatalog_Release(oldCatalog);
+            return;
+        }
+        FileCatalog_SetFolder(catalog, [folderPath fileSystemRepresentation]);
         
-            cFileName = malloc([filename cStringLength] + 1);
-            cPathName = malloc([filename cStringLength] + dirPathLength + 2);
-            if ((cFileName != NULL) && (cPathName != NULL)) {
-                [filename getCString:cFileName];
-                [[[oPanel filenames] objectAtIndex:0] getCString:cPathName];
-                *(cPathName + dirPathLength) = '/';
-                [filename getCString:cPathName + dirPathLength + 1];
-                
-                [aFileObject setPathName: cPathName];
-                [aFileObject setFileName: cFileName];
-            }
-            
-            // don't put directories in the list
-            NSDictionary *fattrs = [[NSFileManager defaultManager] fileAttributesAtPath:[NSString stringWithCString:cPathName] traverseLink:YES];        
-            if (fattrs) {
-                NSString *fileType = [fattrs objectForKey:NSFileType];
-                if (fileType == NSFileTypeRegular) {
-                    [_fileArray insertObject:aFileObject atIndex:count];
-                    count++;
+        // put the files into the catalog
+        enumerator = [[[NSFileManager defaultManager] directoryContentsAtPath:folderPath] objectEnumerator];
+        while (filename = [enumerator nextObject]) {
+            if ([filename length] > 0) {
+                // don't allow any "hidden" files
+                if ([filename characterAtIndex:0] == '.')
+                    continue;
+             
+                // don't put directories in the list
+                NSDictionary *fattrs = [[NSFileManager defaultManager] fileAttributesAtPath:[folderPath stringByAppendingPathComponent:filename] traverseLink:YES];        
+                if (fattrs) {
+                    NSString *fileType = [fattrs objectForKey:NSFileType];
+                    if (fileType == NSFileTypeRegular)
+                        FileCatalog_AddFile(catalog, [folderPath fileSystemRepresentation], [filename fileSystemRepresentation], NULL);
                 }
-                
-                [aFileObject release];	// was retained by the array, so release this instance
             }
         }
+        
+        // keep what we learned about the files that are still here the last time we opened the folder
+        if (oldCatalog != NULL) {
+            FileCatalog_AdoptProbes(catalog, oldCatalog);
+            FileCatalog_Release(oldCatalog);
+        }
+    }
+    
+    // and put a file object for each file into the file array
+    for (index = 0; index < FileCatalog_GetCount(catalog); index++) {
+        FileObject *aFileObject = [[FileObject alloc] initWithCatalog:catalog index:index];
+        
+        [_fileArray addObject:aFileObject];
+        [aFileObject release];	// was retained by the array, so release this instance
     }
 
+    FileCatalog_Release(catalog);
+
+    // probe the file and MIME types in the background
+    [self probeFileArray];
+
     // select the first item in the list, and reload the data
     [tableView selectRow:0 byExtendingSelection:NO];
     [tableView reloadData];
@@ -536,28 +579,59 @@ static unsigned long	gOSVersion = 0;
         // start the progress indicator animation
         [progressBar startAnimation:nil];
         
+        // if the file is already being prefetched, adopt that import rather than starting another one
+        threadData = [self takePrefetchForFileObject:_fileObject];
+        if (threadData != NULL) {
+            [self setCurrThreadData:threadData];
+            [self updatePrefetches];
+            return;
+        }
+
         // each import operation gets its own thread data
-        threadData = calloc(1, sizeof(ThreadData));
+        threadData = [self newThreadDataForFileObject:_fileObject];
         if (threadData == NULL)
             return;
 
-        // configure the thread data to the current settings
-        threadData->dhTag = _dhTag;
-        threadData->threadModelTag = _threadModelTag;
-        threadData->fileObject = _fileObject;
-        threadData->movieRect = [self qdViewBounds];
-        threadData->onlySafeComps = _onlySafeComps;
-        threadData->useFileName = _useFileName;
-        threadData->useFileType = _useFileType;
-        threadData->useMIMEType = _useMIMEType;
+        // if we've imported this version of the file before, at this size, draw the cached frame without involving QuickTime
+        if (lookupFrameCacheFrame(_frameCache, _fileObject, getThumbnailVariant(threadData), &threadData->gWorld, &threadData->naturalWidth, &threadData->naturalHeight) == noErr) {
+            if (isFrameForThreadData(threadData, threadData->gWorld, threadData->naturalWidth, threadData->naturalHeight)) {
+                threadData->imported = true;
+                threadData->cachedFrame = true;
+                [self updateQDMovieView:threadData updateTime:YES];
+                [self showImportStatistics];
+                [self updatePrefetches];
+                return;
+            }
+
+            // a view too big for the variant to tell apart from the one the frame was made for
+            releaseFrameCacheFrame(_frameCache, threadData->gWorld);
+            threadData->gWorld = NULL;
+        }
+
+        if (lookupThumbnail(threadData) == noErr) {
+            threadData->imported = true;
+            [self updateQDMovieView:threadData updateTime:YES];
+            [self updatePrefetches];
+            return;
+        }
 
        // create a scratch GWorld
-        err = NewGWorld(&threadData->tinyGW, 32, &tinyRect, NULL, NULL, 0);
+        err = GWorldPool_Get(&tinyRect, k32ARGBPixelFormat, &threadData->tinyGW);
         LockPixels(GetPortPixMap(threadData->tinyGW));
         
         [self setCurrThreadData:threadData];
         
-        switch (_threadModelTag) {
+        // if we've learned that files like this one need components that aren't thread-safe,
+        // don't make the worker thread fail with it first (if it hasn't been probed yet, the worker will find out)
+        if ((threadData->threadModelTag == USE_POSIX_THREAD) && threadData->onlySafeComps && [_fileObject isProbed] &&
+                ImportRouting_NeedsMainThread([_fileObject fileType], [_fileObject mimeType], 0)) {
+            [statusField setStringValue:@"Imported on main thread with any components, as learned from an earlier retry"];
+            ImportRouting_CountImport(true);
+            threadData->threadModelTag = USE_MAIN_THREAD;
+            threadData->onlySafeComps = false;
+        }
+        
+        switch (threadData->threadModelTag) {
             case USE_MAIN_THREAD:
                 // import the file on the main thread
                 threadData->busy = true;
@@ -570,6 +644,7 @@ static unsigned long	gOSVersion = 0;
                 
                 if (threadData->retry) {
                     [statusField setStringValue:@"Retried import on main thread with any components!"];
+                    ImportRouting_NoteNeedsMainThread([_fileObject fileType], [_fileObject mimeType], threadData->failedCodecType);
                     threadData->onlySafeComps = false;
         
                     importTheMovie(threadData);
@@ -581,23 +656,333 @@ static unsigned long	gOSVersion = 0;
                 break;
 
             case USE_POSIX_THREAD:
-                // import the file on a pthread; create, configure, and send a new worker request
-                err = createWorkerRequest(_worker, &wkrRequest);
-                if (err == noErr) {
-                    setWorkerRequestThreadData(wkrRequest, threadData);
-                    setWorkerRequestDoc(wkrRequest, (UInt32)self);
-                    threadData->request = wkrRequest;
-                }
-
-                if (err == noErr) {
-                    threadData->busy = true;
-                    err = sendWorkerRequest(wkrRequest);
-                }
+                // import the file on a pthread of its own; the rows after this one are prefetched on the others
+                [self sendImportRequest:threadData toWorker:_worker];
+                [self updatePrefetches];
                 break;
         }
     }
 }
 
+    //////////
+    //
+    // import requests and prefetching
+    //
+    //////////
+
+- (ThreadData *)newThreadDataForFileObject:(FileObject *)fileObject
+{
+    // each import operation gets its own thread data
+    ThreadData *threadData = calloc(1, sizeof(ThreadData));
+    if (threadData == NULL)
+        return NULL;
+
+    // configure the thread data to the current settings
+    threadData->dhTag = _dhTag;
+    threadData->threadModelTag = _threadModelTag;
+    threadData->fileObject = fileObject;
+    threadData->movieRect = [self qdViewBounds];
+    threadData->onlySafeComps = _onlySafeComps;
+    threadData->useFileName = _useFileName;
+    threadData->useFileType = _useFileType;
+    threadData->useMIMEType = _useMIMEType;
+    threadData->decodeAtDisplaySize = _decodeAtDisplaySize;
+    threadData->scaleOnWorker = _scaleOnWorker;
+    threadData->numContactFrames = _numContactFrames;
+    Microseconds(&threadData->startTime);
+
+    return threadData;
+}
+
+- (OSErr)sendImportRequest:(ThreadData *)threadData toWorker:(WorkerThreadRef)worker
+{
+    WorkerRequestRef wkrRequest = NULL;
+    OSErr err = noErr;
+
+    // import the file on a pthread; create, configure, and send a new worker request
+    err = createWorkerRequest(worker, &wkrRequest);
+    if (err == noErr) {
+        setWorkerRequestThreadData(wkrRequest, threadData);
+        setWorkerRequestDoc(wkrRequest, (UInt32)self);
+        threadData->request = wkrRequest;
+    }
+
+    if (err == noErr) {
+        threadData->busy = true;
+        err = sendWorkerRequest(wkrRequest);
+    }
+
+    return err;
+}
+
+- (UInt32)randomRowOtherThan:(UInt32)row
+{
+    // select a random row between 0 and [tableView numberOfRows] - 1
+    UInt32 numRows = [tableView numberOfRows];
+    double randNum = (rand()/(double)RAND_MAX) * numRows;
+    UInt32 nextRow = (UInt32)randNum;
+
+    if (nextRow >= numRows)
+        nextRow = numRows - 1;
+
+    if (row == nextRow) {
+        nextRow++;
+        if (nextRow >= numRows) {
+            nextRow = 0;
+        }
+    }
+
+    return nextRow;
+}
+
+- (UInt32)upcomingRow:(UInt32)index
+{
+    // when auto-running randomly, draw the upcoming rows ahead of time so that we know what to prefetch
+    if (_randomAutoRun && (_autorunTimer != nil)) {
+        while (_numRandomRows <= index) {
+            UInt32 prevRow = (_numRandomRows > 0) ? _randomRows[_numRandomRows - 1] : (UInt32)[tableView selectedRow];
+            _randomRows[_numRandomRows++] = [self randomRowOtherThan:prevRow];
+        }
+        return _randomRows[index];
+    }
+
+    return ([tableView selectedRow] + 1 + index) % [tableView numberOfRows];
+}
+
+- (void)updatePrefetches
+{
+    FileObject *wanted[kMaxPrefetchDepth];
+    FileObject *fileObject;
+    ThreadData *threadData;
+    Rect tinyRect = {0,0,1,1};
+    UInt32 numRows = [tableView numberOfRows];
+    UInt32 numWanted = 0;
+    UInt32 variant;
+    UInt32 i, j;
+
+    // prefetches run on the prefetch worker threads; on the main thread they would only get in the way
+    if ((_threadModelTag != USE_POSIX_THREAD) || _closeWhenSafe || (numRows < 2))
+        return;
+
+    // the window of rows to prefetch is the next _prefetchDepth rows
+    for (i = 0; (i < _prefetchDepth) && (i < numRows - 1); i++) {
+        fileObject = [_fileArray objectAtIndex:[self upcomingRow:i]];
+        if (fileObject != _fileObject)
+            wanted[numWanted++] = fileObject;
+    }
+
+    // cancel prefetches that have fallen out of the window; prefetchDidFinish disposes of them when they come back
+    for (i = 0; i < _numPrefetches; ) {
+        for (j = 0; (j < numWanted) && (wanted[j] != _prefetches[i]->fileObject); j++)
+            ;
+        if (j == numWanted) {
+            cancelWorkerRequest(_prefetches[i]->request);
+            [self removePrefetchAtIndex:i];
+        } else {
+            i++;
+        }
+    }
+
+    // start prefetching rows in the window that are neither cached at the current size nor already being prefetched
+    variant = [self thumbnailVariant];
+    for (j = 0; j < numWanted; j++) {
+        if (containsFrameCacheFrame(_frameCache, wanted[j], variant))
+            continue;
+
+        // there's no point prefetching files we know can't be imported
+        if ([wanted[j] isProbed] && [wanted[j] isNotMedia])
+            continue;
+
+        // files that need the main thread have to wait until they're selected
+        if (_onlySafeComps && [wanted[j] isProbed] && ImportRouting_NeedsMainThread([wanted[j] fileType], [wanted[j] mimeType], 0))
+            continue;
+
+        for (i = 0; (i < _numPrefetches) && (_prefetches[i]->fileObject != wanted[j]); i++)
+            ;
+        if (i < _numPrefetches)
+            continue;
+
+        threadData = [self newThreadDataForFileObject:wanted[j]];
+        if (threadData == NULL)
+            break;
+
+        threadData->prefetch = true;
+        GWorldPool_Get(&tinyRect, k32ARGBPixelFormat, &threadData->tinyGW);
+        LockPixels(GetPortPixMap(threadData->tinyGW));
+
+        // spread the prefetches over the prefetch workers, so that one slow file doesn't hold up the rest
+        if ([self sendImportRequest:threadData toWorker:_prefetchWorkers[_nextPrefetchWorker]] != noErr) {
+            [self disposeThreadData:threadData];
+            break;
+        }
+        _nextPrefetchWorker = (_nextPrefetchWorker + 1) % kNumPrefetchWorkers;
+
+        _prefetches[_numPrefetches++] = threadData;
+        _numPrefetchesInFlight++;
+    }
+}
+
+- (void)cancelPrefetches
+{
+    while (_numPrefetches > 0) {
+        cancelWorkerRequest(_prefetches[0]->request);
+        [self removePrefetchAtIndex:0];
+    }
+}
+
+- (void)removePrefetchAtIndex:(UInt32)index
+{
+    _numPrefetches--;
+    memmove(&_prefetches[index], &_prefetches[index + 1], (_numPrefetches - index) * sizeof(ThreadData *));
+}
+
+- (ThreadData *)takePrefetchForFileObject:(FileObject *)fileObject
+{
+    ThreadData *threadData;
+    UInt32 i;
+
+    // turn a prefetch that's still in progress into the current import
+    for (i = 0; i < _numPrefetches; i++) {
+        threadData = _prefetches[i];
+        if (threadData->fileObject == fileObject) {
+            [self removePrefetchAtIndex:i];
+            threadData->prefetch = false;
+            _numPrefetchesInFlight--;
+            return threadData;
+        }
+    }
+
+    return NULL;
+}
+
+- (void)prefetchDidFinish:(ThreadData *)threadData cancelled:(BOOL)cancelled
+{
+    UInt32 i;
+
+    _numPrefetchesInFlight--;
+    for (i = 0; i < _numPrefetches; i++) {
+        if (_prefetches[i] == threadData) {
+            [self removePrefetchAtIndex:i];
+            break;
+        }
+    }
+
+    // even a prefetch that was cancelled too late to stop it is worth keeping
+    threadData->busy = false;
+    if (!cancelled && threadData->imported) {
+        [self noteImportTime:threadData];
+        [self cacheFrame:threadData];
+    }
+
+    // the frame (if any) stays in the frame cache
+    [self disposeThreadData:threadData];
+
+    if (_closeWhenSafe)
+        [self closeWhenSafe];
+    else
+        [self updatePrefetches];
+}
+
+- (void)noteImportTime:(ThreadData *)threadData
+{
+    UnsignedWide endTime;
+    double importTime;
+
+    Microseconds(&endTime);
+    importTime = (endTime.lo - threadData->startTime.lo) / 1000000.0;
+    _avgImportTime = 0.75 * _avgImportTime + 0.25 * importTime;
+
+    // prefetch deep enough to keep about kPrefetchLookahead seconds of imports queued up:
+    // cheap imports can run far ahead, while expensive ones shouldn't waste much work on rows we may skip
+    if (_avgImportTime * kMaxPrefetchDepth <= kPrefetchLookahead)
+        _prefetchDepth = kMaxPrefetchDepth;
+    else if (_avgImportTime >= kPrefetchLookahead)
+        _prefetchDepth = 1;
+    else
+        _prefetchDepth = (UInt32)(kPrefetchLookahead / _avgImportTime);
+}
+
+- (void)closeWhenSafe
+{
+    // close the document once no imports are outstanding
+    _closeWhenSafe = YES;
+    if ((_numPrefetchesInFlight == 0) && (_numProbesInFlight == 0) && ((_currThreadData == NULL) || !_currThreadData->busy))
+        [self close];
+}
+
+    //////////
+    //
+    // probing file and MIME types
+    //
+    //////////
+
+- (void)saveCatalog
+{
+    if ([_fileArray count] > 0)
+        FileCatalog_Save([[_fileArray objectAtIndex:0] catalog]);
+}
+
+- (void)probeFileArray
+{
+    WorkerRequestRef wkrRequest = NULL;
+    ProbeBatch *batch = NULL;
+    FileCatalogRef catalog;
+    UInt32 numFiles;
+    UInt32 first, i = 0;
+    OSErr err = noErr;
+
+    if ([_fileArray count] == 0)
+        return;
+
+    catalog = [[_fileArray objectAtIndex:0] catalog];
+    numFiles = FileCatalog_GetCount(catalog);
+
+    // hand the files out to the probe workers in batches; files that are wanted before their batch
+    // comes up just get probed by whoever wants them (for a catalog loaded from an index, probing
+    // a file that hasn't changed is just a stat)
+    for (first = 0; first < numFiles; first += kProbeBatchSize) {
+        batch = malloc(sizeof(ProbeBatch));
+        if (batch == NULL)
+            break;
+
+        FileCatalog_Retain(catalog);
+        batch->catalog = catalog;
+        batch->first = first;
+        batch->count = (numFiles - first < kProbeBatchSize) ? numFiles - first : kProbeBatchSize;
+        batch->cancelled = &_cancelProbes;
+
+        err = createWorkerRequest(_probeWorkers[i], &wkrRequest);
+        if (err == noErr) {
+            setWorkerRequestThreadData(wkrRequest, (void *)batch);
+            setWorkerRequestDoc(wkrRequest, (UInt32)self);
+            err = sendWorkerRequest(wkrRequest);
+            if (err != noErr)
+                releaseWorkerRequest(wkrRequest);
+        }
+
+        if (err != noErr) {
+            FileCatalog_Release(batch->catalog);
+            free(batch);
+            break;
+        }
+
+        _numProbesInFlight++;
+        i = (i + 1) % kNumProbeWorkers;
+    }
+}
+
+- (void)probeDidFinish
+{
+    _numProbesInFlight--;
+
+    // every file has been checked, so save the catalog for the next time this folder is opened
+    if ((_numProbesInFlight == 0) && !_cancelProbes)
+        [self saveCatalog];
+
+    if (_closeWhenSafe)
+        [self closeWhenSafe];
+}
+
 // table data source methods
 
 - (int)numberOfRowsInTableView:(NSTableView *)tableView
@@ -663,6 +1048,21 @@ static unsigned long	gOSVersion = 0;
         isValid = YES;
     }
     
+    if (action == @selector(toggleDecodeAtDisplaySize:)) {
+        [item setState: _decodeAtDisplaySize ? NSOnState : NSOffState];
+        isValid = YES;
+    }
+    
+    if (action == @selector(toggleScaleOnWorker:)) {
+        [item setState: _scaleOnWorker ? NSOnState : NSOffState];
+        isValid = YES;
+    }
+    
+    if (action == @selector(useContactSheet:)) {
+        [item setState: ([item tag] == _numContactFrames) ? NSOnState : NSOffState];
+        isValid = YES;
+    }
+    
     if (action == @selector(doAutoRunSettingsBox:)) {
         isValid = YES;
     }
@@ -735,6 +1135,36 @@ static unsigned long	gOSVersion = 0;
     [self updateWindowTitle];
 }
 
+- (IBAction)toggleDecodeAtDisplaySize:(id)sender
+{
+    _decodeAtDisplaySize = !_decodeAtDisplaySize;
+    [[NSUserDefaults standardUserDefaults] setBool:_decodeAtDisplaySize forKey:kDecodeAtDisplaySizeKey];
+
+    // the prefetches under way decode at the other size; the frames we already have stay cached under their own variant
+    [self cancelPrefetches];
+}
+
+- (IBAction)toggleScaleOnWorker:(id)sender
+{
+    _scaleOnWorker = !_scaleOnWorker;
+    [[NSUserDefaults standardUserDefaults] setBool:_scaleOnWorker forKey:kScaleOnWorkerKey];
+
+    // the prefetches under way scale the other way; the frames we already have stay cached under their own variant
+    [self cancelPrefetches];
+}
+
+- (IBAction)useContactSheet:(id)sender
+{
+    // the menu item's tag is the number of frames in the sheet; 0 means a single frame
+    _numContactFrames = [sender tag];
+    if (_numContactFrames > kMaxContactSheetFrames)
+        _numContactFrames = kMaxContactSheetFrames;
+    [[NSUserDefaults standardUserDefaults] setInteger:_numContactFrames forKey:kContactSheetFramesKey];
+
+    // the prefetches under way draw the other kind of frame; the frames we already have stay cached under their own variant
+    [self cancelPrefetches];
+}
+
 - (IBAction)useFileName:(id)sender
 {
     _useFileName = !_useFileName;
@@ -834,16 +1264,70 @@ static unsigned long	gOSVersion = 0;
 - (void)disposeThreadData:(ThreadData *)threadData
 {
     if (threadData) {
-        if (threadData->gWorld)
-            DisposeGWorld(threadData->gWorld);
+        // a retry that never happened leaves the worker's data reference and Movie behind; the Movie may
+        // still draw into either GWorld, so it goes before they go back to the pool for another thread
+        disposeImportState(threadData);
+
+        if (threadData->gWorld) {
+            if (threadData->cachedFrame)
+                releaseFrameCacheFrame(_frameCache, threadData->gWorld);
+            else
+                GWorldPool_Put(threadData->gWorld);
+        }
         
         if (threadData->tinyGW)
-            DisposeGWorld(threadData->tinyGW);
+            GWorldPool_Put(threadData->tinyGW);
 
         free(threadData);
     }
 }
 
+- (UInt32)thumbnailVariant
+{
+    ThreadData settings;
+
+    // the variant of the frames an import started now would make
+    memset(&settings, 0, sizeof(settings));
+    settings.movieRect = [self qdViewBounds];
+    settings.decodeAtDisplaySize = _decodeAtDisplaySize;
+    settings.scaleOnWorker = _scaleOnWorker;
+    settings.numContactFrames = _numContactFrames;
+    return getThumbnailVariant(&settings);
+}
+
+- (void)cacheFrame:(ThreadData *)threadData
+{
+    // hand a freshly imported frame over to the frame cache; it stays in use until the thread data is disposed of
+    if (threadData->imported && !threadData->cachedFrame && (threadData->gWorld != NULL)) {
+        if (addFrameCacheFrame(_frameCache, threadData->fileObject, getThumbnailVariant(threadData), threadData->gWorld, threadData->naturalWidth, threadData->naturalHeight) == noErr)
+            threadData->cachedFrame = true;
+    }
+}
+
+- (void)showImportStatistics
+{
+    FrameCacheStatistics stats;
+    ImportRoutingStatistics routingStats;
+    NSMutableString *status = [NSMutableString string];
+    UInt32 lookups;
+
+    getFrameCacheStatistics(_frameCache, &stats);
+    lookups = stats.hits + stats.misses;
+    if (lookups > 0)
+        [status appendFormat:@"Frame cache: %u%% hits, %u evictions",
+                                (unsigned)(stats.hits * 100 / lookups), (unsigned)stats.evictions];
+
+    // and how often the routing table kept a file off the worker threads, for all documents
+    ImportRouting_GetStatistics(&routingStats);
+    if ((routingStats.hits + routingStats.misses) > 0)
+        [status appendFormat:@"%@Routing: %u to main thread, %u to workers, %u kinds of file",
+                                ([status length] > 0) ? @"; " : @"", (unsigned)routingStats.hits,
+                                (unsigned)routingStats.misses, (unsigned)routingStats.numEntries];
+
+    if ([status length] > 0)
+        [statusField setStringValue:status];
+}
+
 - (NSMutableArray *)fileArray
 {
     return _fileArray;
@@ -851,6 +1335,11 @@ static unsigned long	gOSVersion = 0;
 
 - (void)setFileArray:(NSMutableArray *)array
 {
+    // the cached frames and prefetches are for the FileObjects in the old array
+    [self cancelPrefetches];
+    _numRandomRows = 0;
+    flushFrameCache(_frameCache);
+
     [_fileArray release];
     [array retain];
     _fileArray = array;
@@ -877,390 +1366,6 @@ static unsigned long	gOSVersion = 0;
 //
 //////////
 
-static OSErr importTheMovie (ThreadData *threadData)
-{
-    FileObject *aFileObject = nil;
-    FSSpec fileSpec;
-    FSRef fileRef;
-    Rect naturalBounds;
-    Rect dstRect;
-    OSType drType;
-    UInt32 dhTag;
-    char strLenByte = 0;
-    Movie movie = NULL;
-    void *moviePointer = NULL;
-    Handle movieHandle = NULL;
-    Handle drHandle = NULL;
-    short fileResNum = -1;
-    long atoms[3];
-    ComponentResult err = noErr;
-    CGrafPtr savedPort = NULL;
-    GDHandle savedGDevice = NULL;
-
-    if (threadData == NULL)
-        return paramErr;
-
-    aFileObject = threadData->fileObject;
-    if (aFileObject == nil) return paramErr;
-
-    dhTag = threadData->dhTag;
-    
-    // override the thread mode (for testing/demo purposes)
-    CSSetComponentsThreadMode(threadData->onlySafeComps ? kCSAcceptThreadSafeComponentsOnlyMode : kCSAcceptAllComponentsMode);
-    
-    // get the current port and device
-    GetGWorld(&savedPort, &savedGDevice);
-    
-    if (threadData->cancelled)
-        goto bail;
-
-    //////////
-    //
-    // create the appropriate type of data reference
-    //
-    //////////
-    
-    switch (dhTag) {
-        case USE_POINTER_DH:
-        case USE_HANDLE_DH: {
-            short fileRefNum;
-            long numbytes;
-                
-            err = FSPathMakeRef([aFileObject pathName], &fileRef, NULL);
-            if (err != noErr) {
-                fprintf(stderr, "FSPathMakeRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
- 
-            err = FSGetCatalogInfo(&fileRef, kFSCatInfoNone, NULL, NULL, &fileSpec, NULL);
-            if (err != noErr) {
-                fprintf(stderr, "FSGetCatalogInfo(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
- 
-            err = FSpOpenDF(&fileSpec, fsRdPerm, &fileRefNum);
-            if (err != noErr) {
-                fprintf(stderr, "FSpOpenDF(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
- 
-            err = GetEOF(fileRefNum, &numbytes);
-            if (err != noErr) {
-                fprintf(stderr, "GetEOF(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
-
-            if (dhTag == USE_HANDLE_DH) {
-                movieHandle = NewHandleClear(numbytes);
-                HLock(movieHandle);
-                moviePointer = (void *)*movieHandle;
-            } else {
-                moviePointer = calloc(1, numbytes);
-            }
-                
-            if (moviePointer == NULL) {
-                fprintf(stderr, "NewHandleClear or calloc(\"%s\") failed (%d)\n", [aFileObject fileName], (int)memFullErr);
-                goto bail;
-            }
- 
-            err = FSRead(fileRefNum, &numbytes, moviePointer);
-            FSClose(fileRefNum);
-            if (err != noErr) {
-                fprintf(stderr, "FSRead(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
-            
-            if (dhTag == USE_HANDLE_DH) {
-                drHandle = QTDR_MakeHandleDataRef(movieHandle);
-                drType = HandleDataHandlerSubType;
-            } else {
-                drHandle = QTDR_MakePointerDataRef(moviePointer, numbytes);
-                drType = PointerDataHandlerSubType;
-            }
-            
-            if (drHandle == NULL) {
-                fprintf(stderr, "QTDR_MakeHandleDataRef or QTDR_MakePointerDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
-            
-            // for more information regarding tagging Handle and Pointer Data References see TN1195
-            // http://developer.apple.com/technotes/tn/tn1195.html
-            if (threadData->useFileName) {
-                // add a filenaming extension
-                strLenByte = strlen([aFileObject fileName]);
-                err = PtrAndHand(&strLenByte, drHandle, 1);
-                err = PtrAndHand([aFileObject fileName], drHandle, strlen([aFileObject fileName]));
-            } else if (threadData->useFileType || threadData->useMIMEType) {
-                // when adding other extensions file name must be included even if it's just empty
-                strLenByte = 0;
-                err = PtrAndHand(&strLenByte, drHandle, sizeof(strLenByte));
-            }
-
-            if (threadData->useFileType) {
-                // add a file type extension
-                OSType fileType = 0;
-                
-                fileType = [aFileObject fileType];
-                if (fileType) {
-                    atoms[0] = EndianU32_NtoB(sizeof(long) * 3);
-                    atoms[1] = EndianU32_NtoB(kDataRefExtensionMacOSFileType);
-                    atoms[2] = EndianU32_NtoB(fileType);
-                
-                    err = PtrAndHand(atoms, drHandle, sizeof(long) * 3);
-                    if (err) goto bail;
-                } 
-            }
-
-            if (threadData->useMIMEType) {
-                // add a MIME type extension
-                StringPtr mimeTypePStringPtr;
-                
-                mimeTypePStringPtr = [aFileObject mimeType];
-
-                atoms[0] = EndianU32_NtoB(sizeof(long) * 2 + mimeTypePStringPtr[0] + 1);
-                atoms[1] = EndianU32_NtoB(kDataRefExtensionMIMEType);
-                
-                err = PtrAndHand(atoms, drHandle, sizeof(long) * 2);
-                if (err) goto bail;
-                
-                err = PtrAndHand(mimeTypePStringPtr, drHandle, mimeTypePStringPtr[0] + 1);
-                if (err) goto bail;
-            }
-            
-            break;
-        }
-            
-        case USE_FILE_DH:
-            err = FSPathMakeRef([aFileObject pathName], &fileRef, NULL);
-            if (err != noErr) {
-                fprintf(stderr, "FSPathMakeRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
- 
-            err = FSGetCatalogInfo(&fileRef, kFSCatInfoNone, NULL, NULL, &fileSpec, NULL);
-            if (err != noErr) {
-                fprintf(stderr, "FSGetCatalogInfo(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
- 
-            drHandle = QTDR_MakeFileDataRef(&fileSpec);
-            if (drHandle == NULL) {
-                fprintf(stderr, "QTDR_MakeFileDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                goto bail;
-            }
-            
-            drType = rAliasType;
-            break;
-            
-        case USE_URL_DH: {
-            char *url = [aFileObject url];
-            
-            if (url != NULL) {
-                drHandle = QTDR_MakeURLDataRef(url);
-                if (drHandle == NULL) {
-                    fprintf(stderr, "QTDR_MakeURLDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-                    goto bail;
-                }
-            }
-            
-            drType = URLDataHandlerSubType;
-            break;
-        }
-    }
-    
-    Microseconds(&threadData->startTime);
-
-    //////////
-    //
-    // open the file using the data reference and draw it into a new GWorld
-    //
-    //////////
-    
-    if (threadData->cancelled)
-        goto bail;
-        
-    // gotta have a valid port for when we open movies
-    SetGWorld(threadData->tinyGW, NULL);
-    
-    err = NewMovieFromDataRef(&movie, newMovieActive, &fileResNum, drHandle, drType);
-    if (err != noErr) {
-        // if we get componentNotThreadSafeErr, we need to retry importing on the main thread
-        if (err == componentNotThreadSafeErr) {
-            if (threadData->onlySafeComps) {
-                // set a flag to indicate we need to retry on main thread, allowing non-safe components
-                threadData->retry = true;
-                goto bail;
-            } else {
-                // this should *really* never happen....
-                fprintf(stderr, "NewMovieFromDataRef(\"%s\") returned componentNotThreadSafeErr but with any components allowed!\n", [aFileObject fileName]);
-                goto bail;
-            }
-        }
-
-	fprintf(stderr, "NewMovieFromDataRef(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-        goto bail;
-    }
-    
-    GetMovieNaturalBoundsRect(movie, &naturalBounds);
-    err = GetMoviesError();
-    if (err != noErr) {
-	fprintf(stderr, "GetMovieNaturalBounds(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-        goto bail;
-    }
-    
-    // save the natural width and height of the Movie
-    threadData->naturalWidth = naturalBounds.right - naturalBounds.left;
-    threadData->naturalHeight = naturalBounds.bottom - naturalBounds.top;
-    
-    // create a GWorld for the natural bounds of the movie
-    // when we draw we preservethe aspect ratio of the Movie depending on the
-    // NSQuickDrawView bounds and the Movies natural bounds
-    dstRect = naturalBounds;
-    OffsetRect(&dstRect, -naturalBounds.left, -naturalBounds.top);
-        
-/*    // create a GWorld for the smaller of qdViewBounds and naturalBounds, while preserving the aspect ratio of the Movie
-    float movieWidth, movieHeight;
-    float viewWidth, viewHeight;
-    float newWidth, newHeight;
-
-    qdViewBounds = threadData->movieRect;
-
-    movieWidth = naturalBounds.right - naturalBounds.left;
-    movieHeight = naturalBounds.bottom - naturalBounds.top;
-    viewWidth = qdViewBounds.right - qdViewBounds.left;
-    viewHeight = qdViewBounds.bottom - qdViewBounds.top;
-    
-    dstRect.top = 0;
-    dstRect.left = 0;
-    
-    if (((movieWidth) <= (viewWidth)) && ((movieHeight) <= (viewHeight))) {
-        dstRect.right = movieWidth;
-        dstRect.bottom = movieHeight;
-    } else {
-        float movieRatio = movieWidth / movieHeight;
-        float viewRatio = viewWidth / viewHeight;
-        
-        if (movieRatio > viewRatio) {
-            // the Movie is wider than will fit; rescale
-            newHeight = viewWidth / movieRatio;
-            newWidth = newHeight * movieRatio;
-            
-            dstRect.right = newWidth;
-            dstRect.bottom = newHeight;
-        } else {
-            // the Movie is taller than will fit; rescale
-            newWidth = viewHeight * movieRatio;
-            newHeight = newWidth / movieRatio;
-            
-            dstRect.right = newWidth;
-            dstRect.bottom = newHeight;
-        }
-    }
-    
-    // enforce a minimum rectangle
-    if (dstRect.right == 0)
-        dstRect.right = viewWidth;
-    
-    if (dstRect.bottom == 0)
-        dstRect.bottom = viewHeight;
-*/
-    
-    err = QTNewGWorld(&threadData->gWorld, 32, &dstRect, NULL, NULL, 0);
-    if (err != noErr) {
-	fprintf(stderr, "QTNewGWorld(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-        goto bail;
-    }
-    
-    LockPixels( GetGWorldPixMap( threadData->gWorld ) );
-
-    SetGWorld( threadData->gWorld, NULL );
-    EraseRect( &dstRect );
-    
-    SetMovieGWorld( movie, threadData->gWorld, NULL );
-    err = GetMoviesError();
-    if( err ) {
-        fprintf(stderr, "SetMovieGWorld(\"%s\") returned %d\n", [aFileObject fileName], (int)err);
-        goto bail;
-    }
-
-    SetMovieBox( movie, &dstRect );
-    err = GetMoviesError();
-    if( err ) {
-        fprintf(stderr, "SetMovieBox(\"%s\") returned %d\n", [aFileObject fileName], (int)err);
-        goto bail;
-    }
-
-    // draw a frame from the middle of the movie into the GWorld
-    SetMovieTimeValue(movie, GetMovieDuration(movie)/2);
-    MoviesTask(movie, 0);
-    err = GetMoviesError();
-    if (err == noErr) 
-        err = GetMovieStatus(movie, NULL);
-        
-    if (err != noErr) {
-        // if we get componentNotThreadSafeErr, then we need to retry importing on the main thread
-        if (err == componentNotThreadSafeErr) {
-            if (threadData->onlySafeComps == true) {
-                // set a flag to indicate we need to retry on main thread, allowing non-safe components
-                threadData->retry = true;
-                goto bail;
-            } else {
-                // this should *really* never happen....
-                fprintf(stderr, "MoviesTask(\"%s\") returned componentNotThreadSafeErr but with any components allowed!\n", [aFileObject fileName]);
-                goto bail;
-            }
-        }
-    
-        // if we get codecAbortErr or we know we cancelled, AND if we are not the current image, dispose of the memory
-        if ((err == codecAbortErr) || (threadData->cancelled)) {
-            UInt32 doc = 0L;
-            MyDocument *docCtrlr = nil;
-
-            getWorkerRequestDoc(threadData->request, &doc);
-            docCtrlr = (MyDocument *)doc;
-
-            if (threadData != [docCtrlr currThreadData])
-                [docCtrlr disposeThreadData:threadData];
-        } else {
-            fprintf(stderr, "MoviesTask(\"%s\") failed (%d)\n", [aFileObject fileName], (int)err);
-        }
-    }
-    
-bail:
-
-    //////////
-    //
-    // clean up
-    //
-    //////////
-
-    // we're done with the data reference
-    if (drHandle != NULL) {
-        DisposeHandle(drHandle);
-        drHandle = NULL;
-    }
-    
-    // we're done with the Movie data
-    if (dhTag == USE_POINTER_DH && moviePointer != NULL)
-        free(moviePointer);
-    
-    if (movieHandle != NULL) {
-        DisposeHandle(movieHandle);
-        movieHandle = NULL;
-    }
-    
-    // we're done with the movie
-    if (movie != 0) {
-        DisposeMovie(movie);
-        movie = 0;
-    }
-    
-    // set the saved port and device
-    SetGWorld(savedPort, savedGDevice);
-
-    return err;
-}
-
 static OSErr movieProgressProc (Movie theMovie, short message, short whatOperation, Fixed percentDone, long refcon)
 {
     ThreadData *threadData = (ThreadData *)refcon;
@@ -1291,8 +1396,18 @@ void workerActionRoutine (void *refcon, WorkerRequestRef request)
     if (request == NULL) return;
     
     getWorkerRequestThreadData(request, (void **)&threadData);
-    if (threadData != NULL)
-        importTheMovie(threadData);
+    if (threadData == NULL)
+        return;
+
+    // a prefetch for a file we've imported in an earlier session just needs to load the cached frame
+    if (threadData->prefetch) {
+        if (lookupThumbnail(threadData) == noErr) {
+            threadData->imported = true;
+            return;
+        }
+    }
+
+    importTheMovie(threadData);
 }
 
 
@@ -1334,19 +1449,40 @@ void workerResponseMainThreadCallback (void *refcon, WorkerRequestRef request)
     if (docCtrlr == NULL)
         return;
 
-    if (wasWorkerRequestCancelled(request)) {
-        // the request was cancelled
-        
+    // prefetches go into the frame cache rather than onto the screen
+    if (threadData->prefetch) {
+        BOOL cancelled = wasWorkerRequestCancelled(request) || threadData->cancelled;
+
+        releaseWorkerRequest(request);
+        [docCtrlr prefetchDidFinish:threadData cancelled:cancelled];
+        return;
+    }
+
+    if (wasWorkerRequestCancelled(request) || (threadData != [docCtrlr currThreadData])) {
+        // the request was cancelled or superseded by a newer selection; keep the frame if we got one,
+        // but nobody else is going to dispose of the thread data
+        threadData->busy = false;
+        if (threadData != [docCtrlr currThreadData]) {
+            if (!wasWorkerRequestCancelled(request) && threadData->imported)
+                [docCtrlr cacheFrame:threadData];
+
+            [docCtrlr disposeThreadData:threadData];
+            threadData = NULL;
+        }
     } else {
         // the request completed, but we might still need to retry on the main thread
         if (threadData->retry) {
             // we need to retry the import on the main thread with any components
             if (threadData->gWorld != NULL)
-                DisposeGWorld(threadData->gWorld);
+                GWorldPool_Put(threadData->gWorld);
             
             threadData->gWorld = NULL;
             threadData->retry = false;
 
+            // remember this, so that the next file like this one goes straight to the main thread
+            ImportRouting_NoteNeedsMainThread([(FileObject *)threadData->fileObject fileType],
+                                              [(FileObject *)threadData->fileObject mimeType], threadData->failedCodecType);
+
             [[docCtrlr statusField] setStringValue:@"Retried import on main thread with any components!"];
             threadData->onlySafeComps = false;
             threadData->threadModelTag = USE_MAIN_THREAD;
@@ -1359,6 +1495,7 @@ void workerResponseMainThreadCallback (void *refcon, WorkerRequestRef request)
         } else {
             // the request completed successfully; hand off the GWorld to the window for redrawing
             threadData->busy = false;
+            [docCtrlr noteImportTime:threadData];
             [docCtrlr updateQDMovieView:threadData updateTime:YES];
             [[docCtrlr statusField] setStringValue:@""];
         }
@@ -1367,7 +1504,48 @@ void workerResponseMainThreadCallback (void *refcon, WorkerRequestRef request)
     
     releaseWorkerRequest(request);
     
-    if (threadData->closeWhenSafe) {
-        [docCtrlr close];
+    if ((threadData != NULL) && threadData->closeWhenSafe) {
+        [docCtrlr closeWhenSafe];
     }
-}
\ No newline at end of file
+}
+
+// The probeActionRoutine is called on a probe worker thread to resolve a run of files and probe their
+// file and MIME types, so that the main thread never has to open a data handler for each file in a folder.
+
+void probeActionRoutine (void *refcon, WorkerRequestRef request)
+{
+    ProbeBatch *batch = NULL;
+    UInt32 i;
+
+    if (request == NULL) return;
+    
+    getWorkerRequestThreadData(request, (void **)&batch);
+    if (batch == NULL)
+        return;
+
+    for (i = batch->first; (i < batch->first + batch->count) && !*batch->cancelled; i++)
+        FileCatalog_Probe(batch->catalog, i);
+}
+
+
+// The probeResponseMainThreadCallback is called on the main thread after a run of files has been probed.
+
+void probeResponseMainThreadCallback (void *refcon, WorkerRequestRef request)
+{
+    UInt32 doc = 0L;
+    ProbeBatch *batch = NULL;
+    
+    if (request == NULL) return;
+
+    getWorkerRequestThreadData(request, (void **)&batch);
+    getWorkerRequestDoc(request, &doc);
+    releaseWorkerRequest(request);
+
+    if (batch != NULL) {
+        FileCatalog_Release(batch->catalog);
+        free(batch);
+    }
+
+    if (doc != 0L)
+        [(MyDocument *)doc probeDidFinish];
+}
@@ -6,7 +6,7 @@
 //
 //	Written by: QuickTime Engieering
 //
-//	Copyright:	 2000-2003 by Apple Computer, Inc., all rights reserved.
+//	Copyright:	© 2000-2003 by Apple Computer, Inc., all rights reserved.
 //
 //	Change History (most recent first):
 //	   
@@ -26,6 +26,12 @@
 //////////
 
 #include "QTDataRef.h"
+#include "DataRefUtilities.h"
+#include "URLUtilities.h"
+
+#if !TARGET_OS_WIN32
+#include <unistd.h>
+#endif
 
 //////////
 //
@@ -33,49 +39,76 @@
 //
 //////////
 
+#if QTDR_SAMPLE_APPLICATION
 extern short 				gAppResFile;						// file reference number for this application's resource file
 extern ModalFilterUPP		gModalFilterUPP;					// UPP to our custom dialog event filter
+#endif
 
-Ptr							gDataBuffer = NULL;					// buffer that holds data being transferred
-ComponentInstance			gDataReader = NULL;					// the data handler that reads data from the URL
-ComponentInstance			gDataWriter = NULL;					// the data handler that writes data to a file
-DataHCompletionUPP			gReadDataHCompletionUPP = NULL;
-DataHCompletionUPP			gWriteDataHCompletionUPP = NULL;
-long						gBytesToTransfer = 0L;				// the number of bytes to transfer
-long						gBytesTransferred = 0L;				// the number of bytes already transferred
+long						gNumDataBuffers = kNumDataBuffers;	// the number of buffers each new transfer uses
+long						gDataBufferSize = kDataBufferSize;	// the size of each of those buffers
+long						gNumTransferStreams = kNumTransferStreams;	// the number of streams each new transfer uses
+QTDRTransferPtr				gTransfer = NULL;					// the transfer started by QTDR_CopyRemoteFileToLocalFile
 Boolean						gDoneTransferring = false;			// are we done transferring data?
 
+#if QTDR_USE_WORKER_THREADS
+WorkerThreadRef				gTransferWorkers[kMaxTransferWorkers];		// the threads that run queued transfers
+long						gNumTransfersQueued[kMaxTransferWorkers];	// the number of transfers given to each thread
+long						gNumTransferWorkers = 0L;
+long						gMaxConcurrentTransfers = kNumTransferWorkers;
+#endif
+
 #if TARGET_OS_WIN32
 UINT						gTimerID;							// ID of the timer that tasks the data handlers
 #endif
 
+// the state of a read made by QTDR_ReadDataSync
+typedef struct {
+	volatile Boolean		done;
+	OSErr					err;
+} QTDRSyncReadRecord;
 
-///////////////////////////////////////////////////////////////////////////////////////////////////////////
-//
-// Data reference creation utilities.
-//
-// Use these functions to create data references.
-//
-///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //////////
 //
-// QTDR_MakeFileDataRef
-// Return a file data reference for the specified file.
-//
-// The caller is responsible for disposing of the handle returned by this function (by calling DisposeHandle).
+// static function prototypes
 //
 //////////
 
-Handle QTDR_MakeFileDataRef (FSSpecPtr theFile)
-{
-	Handle			myDataRef = NULL;
-
-  	QTNewAlias(theFile, (AliasHandle *)&myDataRef, true);
+static OSErr					QTDR_AppendAtomToDataRef (Handle theDataRef, OSType theType, const void *theData, Size theDataSize);
+static void						QTDR_FinishDataRequest (QTDRTransferPtr theTransfer, OSErr theErr);
+static void						QTDR_ReadNextChunk (QTDRDataBufferRecord *theBuffer);
+static OSErr					QTDR_ReadDataSync (ComponentInstance theHandler, Ptr theBuffer, SInt64 theOffset, long theSize);
+static PASCAL_RTN void			QTDR_SyncReadCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr);
+static void						QTDR_OpenTransferStreams (QTDRTransferPtr theTransfer);
+static void						QTDR_FallBackToOneStream (QTDRTransferPtr theTransfer);
+static Boolean					QTDR_IsChunkDone (QTDRTransferPtr theTransfer, long theChunk);
+static long						QTDR_GetChunkSize (QTDRTransferPtr theTransfer, long theChunk);
+static void						QTDR_MakeCheckpointFileSpec (FSSpecPtr theFile, FSSpecPtr theCheckpointFile);
+static OSErr					QTDR_ReadCheckpoint (QTDRTransferPtr theTransfer);
+static OSErr					QTDR_WriteCheckpoint (QTDRTransferPtr theTransfer);
+static void						QTDR_DiscardCheckpoint (QTDRTransferPtr theTransfer);
+static UInt32					QTDR_ChecksumBytes (const void *theBytes, long theSize);
+static Boolean					QTDR_IsSampleUnchanged (QTDRTransferPtr theTransfer);
+static Boolean					QTDR_ResumeFailed (QTDRTransferPtr theTransfer);
+#if QTDR_USE_WORKER_THREADS
+static void						QTDR_TransferActionRoutine (void *theRefCon, WorkerRequestRef theRequest);
+static void						QTDR_TransferCancelRoutine (void *theRefCon, WorkerRequestRef theRequest);
+static void						QTDR_TransferResponseCallback (void *theRefCon, WorkerRequestRef theRequest);
+#endif
+#if QTDR_SAMPLE_APPLICATION
+static OSErr					QTDR_AddVideoSamplesToMedia (Media theMedia, short theTrackWidth, short theTrackHeight);
+static void						QTDR_DrawFrame (short theTrackWidth, short theTrackHeight, long theNumSample, GWorldPtr theGWorld);
+#endif
 
-	return(myDataRef);
-}
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Data reference creation utilities.
+//
+// Use these functions to create data references. QTDR_MakeFileDataRef, QTDR_MakeHandleDataRef and
+// QTDR_MakeURLDataRef are in DataRefUtilities.c, which this application shares with the import code.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //////////
 //
@@ -116,59 +149,6 @@ bail:
 }
 
 
-//////////
-//
-// QTDR_MakeHandleDataRef
-// Return a handle data reference for the specified handle.
-//
-// The caller is responsible for disposing of the handle returned by this function (by calling DisposeHandle).
-//
-//////////
-
-Handle QTDR_MakeHandleDataRef (Handle theHandle)
-{
-	Handle			myDataRef = NULL;
-
-	myDataRef = NewHandleClear(sizeof(Handle));
-	if (myDataRef != NULL)
-		BlockMove(&theHandle, *myDataRef, sizeof(Handle));
-
-	// the following single line can replace the preceding three lines
-//	PtrToHand(&theHandle, &myDataRef, sizeof(Handle));
-
-	return(myDataRef);
-}
-
-
-//////////
-//
-// QTDR_MakeURLDataRef
-// Return a URL data reference for the specified URL.
-//
-// The caller is responsible for disposing of the handle returned by this function (by calling DisposeHandle).
-//
-//////////
-
-Handle QTDR_MakeURLDataRef (char *theURL)
-{
-	Handle			myDataRef = NULL;
-	Size			mySize = 0;
-
-	// get the size of the URL, plus the terminating null byte
-	mySize = (Size)strlen(theURL) + 1;
-	if (mySize == 1)
-		goto bail;
-	
-	// allocate a new handle and copy the URL into the handle
-	myDataRef = NewHandleClear(mySize);
-    if (myDataRef != NULL)
-		BlockMove(theURL, *myDataRef, mySize);
-
-bail:
-	return(myDataRef);
-}
-
-
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // Movie-retrieval utilities.
@@ -273,6 +253,7 @@ Movie QTDR_GetMovieFromURL (char *theURL)
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#if QTDR_SAMPLE_APPLICATION
 //////////
 //
 // QTDR_GetURLFromUser
@@ -372,6 +353,7 @@ bail:
 
 	return(myURL);
 }
+#endif
 
 
 //////////
@@ -389,44 +371,8 @@ bail:
 
 char *QTDR_GetURLBasename (char *theURL)
 {
-	char	*myBasename = NULL;
-	short	myLength = 0;
-	short	myIndex;
-
-	// make sure we got a URL passed in
-	if (theURL == NULL)
-		goto bail;
-		
-	// get the length of the URL
-	myLength = strlen(theURL);
-	
-	// find the position of the rightmost URL separator in theURL
-	if (strchr(theURL, kURLSeparator) != NULL) {
-
-		myIndex = myLength - 1;
-		while (theURL[myIndex] != kURLSeparator)
-			myIndex--;
-			
-		// calculate the length of the basename
-		myLength = myLength - myIndex - 1;
-
-	} else {
-		// there is no rightmost URL separator in theURL;
-		// set myIndex so that myIndex + 1 == 0, for the call to BlockMove below
-		myIndex = -1;
-	}
-	
-	// allocate space to hold the string that we return to the caller
-	myBasename = malloc(myLength + 1);
-	if (myBasename == NULL)
-		goto bail;
-		
-	// copy into myBasename the substring of theURL from myIndex + 1 to the end
-	BlockMove(&theURL[myIndex + 1], myBasename, myLength);
-	myBasename[myLength] = '\0';
-	
-bail:	
-	return(myBasename);
+	// let the URL parser find the rightmost URL separator
+	return(URLUtils_GetURLBasename(theURL));
 }
 
 
@@ -472,20 +418,11 @@ OSErr QTDR_AddFilenamingExtension (Handle theDataRef, StringPtr theFileName)
 
 OSErr QTDR_AddMacOSFileTypeDataRefExtension (Handle theDataRef, OSType theType)
 {
-	unsigned long	myAtomHeader[2];
 	OSType			myType;
-	OSErr			myErr = noErr;
-	
-	myAtomHeader[0] = EndianU32_NtoB(sizeof(myAtomHeader) + sizeof(theType));
-	myAtomHeader[1] = EndianU32_NtoB(kDataRefExtensionMacOSFileType);
 	
 	myType = EndianU32_NtoB(theType);
 	
-	myErr = PtrAndHand(myAtomHeader, theDataRef, sizeof(myAtomHeader));
-	if (myErr == noErr)
-		myErr = PtrAndHand(&myType, theDataRef, sizeof(myType));
-		
-	return(myErr);
+	return(QTDR_AppendAtomToDataRef(theDataRef, kDataRefExtensionMacOSFileType, &myType, sizeof(myType)));
 }
 
 
@@ -500,20 +437,10 @@ OSErr QTDR_AddMacOSFileTypeDataRefExtension (Handle theDataRef, OSType theType)
 
 OSErr QTDR_AddMIMETypeDataRefExtension (Handle theDataRef, StringPtr theMIMEType)
 {
-	unsigned long	myAtomHeader[2];
-	OSErr			myErr = noErr;
-	
 	if (theMIMEType == NULL)
 		return(paramErr);
 		
-	myAtomHeader[0] = EndianU32_NtoB(sizeof(myAtomHeader) + theMIMEType[0] + 1);
-	myAtomHeader[1] = EndianU32_NtoB(kDataRefExtensionMIMEType);
-	
-	myErr = PtrAndHand(myAtomHeader, theDataRef, sizeof(myAtomHeader));
-	if (myErr == noErr)
-		myErr = PtrAndHand(theMIMEType, theDataRef, theMIMEType[0] + 1);
-	
-	return(myErr);
+	return(QTDR_AppendAtomToDataRef(theDataRef, kDataRefExtensionMIMEType, theMIMEType, theMIMEType[0] + 1));
 }
 
 
@@ -528,19 +455,46 @@ OSErr QTDR_AddMIMETypeDataRefExtension (Handle theDataRef, StringPtr theMIMEType
 
 OSErr QTDR_AddInitDataDataRefExtension (Handle theDataRef, Ptr theInitDataPtr)
 {
-	unsigned long	myAtomHeader[2];
+	if (theInitDataPtr == NULL)
+		return(paramErr);
+		
+	return(QTDR_AppendAtomToDataRef(theDataRef, kDataRefExtensionInitializationData, theInitDataPtr, GetPtrSize(theInitDataPtr)));
+}
+
+
+//////////
+//
+// QTDR_AppendAtomToDataRef
+// Append an atom (header and data) to the end of a data reference.
+//
+// The handle is resized once for the whole atom and the header and data are copied in place,
+// rather than growing it twice with PtrAndHand, which can move and copy the handle each time.
+//
+//////////
+
+static OSErr QTDR_AppendAtomToDataRef (Handle theDataRef, OSType theType, const void *theData, Size theDataSize)
+{
+	UInt32			myAtomHeader[2];
+	Size			myOldSize = 0;
 	OSErr			myErr = noErr;
 	
-	if (theInitDataPtr == NULL)
+	if (theDataRef == NULL)
 		return(paramErr);
 		
-	myAtomHeader[0] = EndianU32_NtoB(sizeof(myAtomHeader) + GetPtrSize(theInitDataPtr));
-	myAtomHeader[1] = EndianU32_NtoB(kDataRefExtensionInitializationData);
+	myAtomHeader[0] = EndianU32_NtoB(sizeof(myAtomHeader) + theDataSize);
+	myAtomHeader[1] = EndianU32_NtoB(theType);
 	
-	myErr = PtrAndHand(myAtomHeader, theDataRef, sizeof(myAtomHeader));
-	if (myErr == noErr)
-		myErr = PtrAndHand(theInitDataPtr, theDataRef, GetPtrSize(theInitDataPtr));
+	myOldSize = GetHandleSize(theDataRef);
+	
+	SetHandleSize(theDataRef, myOldSize + sizeof(myAtomHeader) + theDataSize);
+	myErr = MemError();
+	if (myErr != noErr)
+		goto bail;
 		
+	BlockMoveData(myAtomHeader, *theDataRef + myOldSize, sizeof(myAtomHeader));
+	BlockMoveData(theData, *theDataRef + myOldSize + sizeof(myAtomHeader), theDataSize);
+	
+bail:
 	return(myErr);
 }
 
@@ -555,30 +509,104 @@ OSErr QTDR_AddInitDataDataRefExtension (Handle theDataRef, Ptr theInitDataPtr)
 
 //////////
 //
-// QTDR_CopyRemoteFileToLocalFile
-// Copy a remote file (located at the specified URL) into a local file.
+// QTDR_NewTransfer
+// Create a transfer that copies a remote file (located at the specified URL) into a local file. Nothing is
+// read or written until the transfer is started (by QTDR_StartTransfer, QTDR_RunTransfer, or QTDR_QueueTransfer).
+//
+// Each transfer keeps its own data handlers, buffers, and progress, so any number of them can be under way
+// at once. The transfer uses the buffer settings last passed to QTDR_SetTransferBuffers.
+//
+// The caller is responsible for disposing of the transfer (by calling QTDR_DisposeTransfer).
 //
 //////////
 
-OSErr QTDR_CopyRemoteFileToLocalFile (char *theURL, FSSpecPtr theFile)
+OSErr QTDR_NewTransfer (char *theURL, FSSpecPtr theFile, QTDRTransferPtr *theTransfer)
+{
+	QTDRTransferPtr		myTransfer = NULL;
+	OSErr				myErr = noErr;
+	
+	if ((theURL == NULL) || (theFile == NULL) || (theTransfer == NULL))
+		return(paramErr);
+		
+	*theTransfer = NULL;
+	
+	myTransfer = (QTDRTransferPtr)NewPtrClear(sizeof(QTDRTransferRecord));
+	myErr = MemError();
+	if (myErr != noErr)
+		goto bail;
+		
+	myTransfer->url = malloc(strlen(theURL) + 1);
+	if (myTransfer->url == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+	
+	strcpy(myTransfer->url, theURL);
+	myTransfer->file = *theFile;
+	myTransfer->numBuffers = gNumDataBuffers;
+	myTransfer->numStreams = gNumTransferStreams;
+	myTransfer->bufferSize = gDataBufferSize;
+	myTransfer->worker = -1;
+	
+	myTransfer->readUPP = NewDataHCompletionUPP(QTDR_ReadDataCompletionProc);
+	myTransfer->writeUPP = NewDataHCompletionUPP(QTDR_WriteDataCompletionProc);
+	
+	*theTransfer = myTransfer;
+
+bail:
+	if ((myErr != noErr) && (myTransfer != NULL))
+		QTDR_DisposeTransfer(myTransfer);
+		
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDR_StartTransfer
+// Open the data handlers for the specified transfer and start reading and writing data. The transfer
+// proceeds as its data handlers are tasked, by QTDR_TaskTransfer or by the application's idle-time tasking.
+//
+// As it goes, the transfer keeps a checkpoint file next to the local file, which records the chunks it has
+// written. If an earlier transfer of the same URL into the same file was interrupted, this one picks up
+// where that one stopped, provided the remote file and the local file are still the sizes they were and
+// the chunk of the remote file the checkpoint keeps a checksum of hasn't changed.
+//
+//////////
+
+OSErr QTDR_StartTransfer (QTDRTransferPtr theTransfer)
 {
-	Handle				myReaderRef = NULL;			// data reference for the remote file
-	Handle				myWriterRef = NULL;			// data reference for the local file
+	long				myIndex;
+	SInt64				myFileSize;
+	wide				mySize;
 	ComponentResult		myErr = badComponentType;
 
+	if (theTransfer == NULL)
+		return(paramErr);
+		
+	theTransfer->bytesResumed = 0L;
+	theTransfer->sampleSize = 0L;
+	
 	//////////
 	//
-	// create the local file with the desired type and creator
+	// create the local file with the desired type and creator, unless we're resuming an earlier copy
 	//
 	//////////
 	
-	// delete the target local file, if it already exists;
-	// if it doesn't exist yet, we'll get an error (fnfErr), which we just ignore
-	FSpDelete(theFile);
+	QTDR_MakeCheckpointFileSpec(&theTransfer->file, &theTransfer->checkpointFile);
 	
-	myErr = FSpCreate(theFile, kTransFileCreator, kTransFileType, smSystemScript);
-	if (myErr != noErr)
-		goto bail;
+	// if a checkpoint says that an earlier copy of this URL into this file got partway, keep the local file
+	// (and the chunks the checkpoint says are in it); the checkpoint is checked again once we know the sizes
+	if (QTDR_ReadCheckpoint(theTransfer) != noErr) {
+		// delete the target local file and any stale checkpoint, if they already exist;
+		// if they don't exist yet, we'll get an error (fnfErr), which we just ignore
+		FSpDelete(&theTransfer->file);
+		FSpDelete(&theTransfer->checkpointFile);
+	
+		myErr = FSpCreate(&theTransfer->file, kTransFileCreator, kTransFileType, smSystemScript);
+		if (myErr != noErr)
+			goto bail;
+	}
 	
 	//////////
 	//
@@ -586,12 +614,14 @@ OSErr QTDR_CopyRemoteFileToLocalFile (char *theURL, FSSpecPtr theFile)
 	//
 	//////////
 	
-	myReaderRef = QTDR_MakeURLDataRef(theURL);
-    if (myReaderRef == NULL)
+	myErr = badComponentType;
+	
+	theTransfer->readerRef = QTDR_MakeURLDataRef(theTransfer->url);
+    if (theTransfer->readerRef == NULL)
     	goto bail;
 
-	myWriterRef = QTDR_MakeFileDataRef(theFile);
-    if (myWriterRef == NULL)
+	theTransfer->writerRef = QTDR_MakeFileDataRef(&theTransfer->file);
+    if (theTransfer->writerRef == NULL)
     	goto bail;
 
 	//////////
@@ -600,35 +630,38 @@ OSErr QTDR_CopyRemoteFileToLocalFile (char *theURL, FSSpecPtr theFile)
 	//
 	//////////
 	
-	gDataReader = OpenComponent(GetDataHandler(myReaderRef, URLDataHandlerSubType, kDataHCanRead));
-	if (gDataReader == NULL)
+	theTransfer->streams[0].reader = OpenComponent(GetDataHandler(theTransfer->readerRef, URLDataHandlerSubType, kDataHCanRead));
+	if (theTransfer->streams[0].reader == NULL)
 		goto bail;
 
-	gDataWriter = OpenComponent(GetDataHandler(myWriterRef, rAliasType, kDataHCanWrite));
-	if (gDataWriter == NULL)
+	theTransfer->writer = OpenComponent(GetDataHandler(theTransfer->writerRef, rAliasType, kDataHCanWrite));
+	if (theTransfer->writer == NULL)
 		goto bail;
 		
 	// set the data reference for the URL data handler
-	myErr = DataHSetDataRef(gDataReader, myReaderRef);
+	myErr = DataHSetDataRef(theTransfer->streams[0].reader, theTransfer->readerRef);
 	if (myErr != noErr)
 		goto bail;
 	
 	// set the data reference for the file data handler
-	myErr = DataHSetDataRef(gDataWriter, myWriterRef);
+	myErr = DataHSetDataRef(theTransfer->writer, theTransfer->writerRef);
 	if (myErr != noErr)
 		goto bail;
 	
 	//////////
 	//
-	// allocate a data buffer; the URL data handler copies data into this buffer,
-	// and the file data handler copies data out of it
+	// allocate the data buffers; the URL data handler copies data into these buffers,
+	// and the file data handler copies data out of them
 	//
 	//////////
 	
-	gDataBuffer = NewPtrClear(kDataBufferSize);
-	myErr = MemError();
-	if (myErr != noErr)
-		goto bail;
+	for (myIndex = 0; myIndex < theTransfer->numBuffers; myIndex++) {
+		theTransfer->buffers[myIndex].transfer = theTransfer;
+		theTransfer->buffers[myIndex].data = NewPtrClear(theTransfer->bufferSize);
+		myErr = MemError();
+		if (myErr != noErr)
+			goto bail;
+	}
 		
 	//////////
 	//
@@ -637,40 +670,88 @@ OSErr QTDR_CopyRemoteFileToLocalFile (char *theURL, FSSpecPtr theFile)
 	//////////
 	
 	// open a read-only path to the remote data reference
-	myErr = DataHOpenForRead(gDataReader);
+	myErr = DataHOpenForRead(theTransfer->streams[0].reader);
 	if (myErr != noErr)
 		goto bail;
 
 	// get the size of the remote file
-	myErr = DataHGetFileSize(gDataReader, &gBytesToTransfer); 
+	myFileSize = theTransfer->bytesToTransfer;
+	myErr = DataHGetFileSize64(theTransfer->streams[0].reader, &mySize); 
 	if (myErr != noErr)
 		goto bail;
+		
+	theTransfer->bytesToTransfer = WideToSInt64(mySize);
+	
+	// a checkpoint is no good if the remote file has changed size since it was written, or if it has been
+	// replaced by another file of the same size
+	if ((theTransfer->chunkMap != NULL) && ((theTransfer->bytesToTransfer != myFileSize) || !QTDR_IsSampleUnchanged(theTransfer)))
+		QTDR_DiscardCheckpoint(theTransfer);
 	
 	// open a write-only path to the local data reference
-	myErr = DataHOpenForWrite(gDataWriter);
+	myErr = DataHOpenForWrite(theTransfer->writer);
+	if (myErr != noErr)
+		goto bail;
+		
+	// nor is it any good if the local file isn't the size the checkpoint left it at
+	if (theTransfer->chunkMap != NULL)
+		if ((DataHGetFileSize64(theTransfer->writer, &mySize) != noErr) || (theTransfer->bytesToTransfer != WideToSInt64(mySize)))
+			QTDR_DiscardCheckpoint(theTransfer);
+		
+	// make the local file full size up front, so that the streams can write their ranges in any order
+	mySize = SInt64ToWide(theTransfer->bytesToTransfer);
+	myErr = DataHSetFileSize64(theTransfer->writer, &mySize);
 	if (myErr != noErr)
 		goto bail;
 		
+	// if we aren't resuming, start a new map of the chunks written so far
+	if (theTransfer->chunkMap == NULL) {
+		theTransfer->numChunks = (long)((theTransfer->bytesToTransfer + theTransfer->bufferSize - 1) / theTransfer->bufferSize);
+		theTransfer->chunkMap = (UInt8 *)NewPtrClear((theTransfer->numChunks + 7) / 8 + 1);
+		myErr = MemError();
+		if (myErr != noErr)
+			goto bail;
+	}
+		
+	// open more connections to the remote file, if it's big enough to be worth fetching in pieces
+	QTDR_OpenTransferStreams(theTransfer);
+		
 	//////////
 	//
 	// start reading and writing data
 	//
 	//////////
 	
-	gDoneTransferring = false;
-	gBytesTransferred = 0L;
-	
-	gReadDataHCompletionUPP = NewDataHCompletionUPP(QTDR_ReadDataCompletionProc);
-	gWriteDataHCompletionUPP = NewDataHCompletionUPP(QTDR_WriteDataCompletionProc);
-		
-	// start retrieving the data; we do this by calling our own write completion routine,
-	// pretending that we've just successfully finished writing 0 bytes of data
-	QTDR_WriteDataCompletionProc(gDataBuffer, 0L, noErr);
+	theTransfer->done = false;
+	theTransfer->bytesTransferred = 0L;
+	theTransfer->numChunksSinceCheckpoint = 0L;
+	theTransfer->err = noErr;
+	
+	// count whatever an earlier copy already wrote
+	for (myIndex = 0; myIndex < theTransfer->numChunks; myIndex++)
+		if (QTDR_IsChunkDone(theTransfer, myIndex))
+			theTransfer->bytesTransferred += QTDR_GetChunkSize(theTransfer, myIndex);
+	theTransfer->bytesResumed = theTransfer->bytesTransferred;
+
+	Microseconds(&theTransfer->startTime);
+	theTransfer->endTime = theTransfer->startTime;
+	
+	// start retrieving the data; we do this by calling our own write completion routine once for each
+	// buffer, pretending that we've just successfully finished writing 0 bytes of data from it; this
+	// puts a read into every buffer at once, so that several reads and writes are always in flight
+	theTransfer->numRequestsInFlight = theTransfer->numBuffers;
+	for (myIndex = 0; myIndex < theTransfer->numBuffers; myIndex++) {
+		theTransfer->buffers[myIndex].stream = myIndex % theTransfer->numStreams;
+		theTransfer->buffers[myIndex].size = 0L;
+		QTDR_WriteDataCompletionProc(theTransfer->buffers[myIndex].data, (long)&theTransfer->buffers[myIndex], noErr);
+	}
 
 bail:
 	// if we encountered any error, close the data handler components
-	if (myErr != noErr)
-		QTDR_CloseDownHandlers();
+	if (myErr != noErr) {
+		QTDR_CloseTransfer(theTransfer);
+		theTransfer->err = (OSErr)myErr;
+		theTransfer->done = true;
+	}
 	
 	return((OSErr)myErr);
 }
@@ -678,115 +759,1498 @@ bail:
 
 //////////
 //
-// QTDR_ReadDataCompletionProc
-// This procedure is called when the data handler has completed a read operation.
-//
-// The theRefCon parameter contains the number of bytes just read.
+// QTDR_TaskTransfer
+// Give the data handlers for the specified transfer time to do their work; return true if the transfer is done.
 //
 //////////
 
-PASCAL_RTN void QTDR_ReadDataCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr)
+Boolean QTDR_TaskTransfer (QTDRTransferPtr theTransfer)
 {
-#pragma unused(theErr)
-
-	// we just finished reading some data, so schedule a write operation			
-	DataHWrite(	gDataWriter,
-				theRequest,						// the data buffer
-				gBytesTransferred,				// write from the current offset
-				theRefCon,						// the number of bytes to write
-				gWriteDataHCompletionUPP,
-				theRefCon);
+	long		myIndex;
+	
+	if (theTransfer == NULL)
+		return(true);
+		
+	if (!theTransfer->done) {
+		for (myIndex = 0; myIndex < kMaxTransferStreams; myIndex++)
+			if (theTransfer->streams[myIndex].reader != NULL)
+				DataHTask(theTransfer->streams[myIndex].reader);
+		if (theTransfer->writer != NULL)
+			DataHTask(theTransfer->writer);
+	}
+	
+	return(theTransfer->done);
 }
 
 
 //////////
 //
-// QTDR_WriteDataCompletionProc
-// This procedure is called when the data handler has completed a write operation.
+// QTDR_RunTransfer
+// Start the specified transfer and task it until it's done or cancelled, and then close its data handlers.
+// Return the first error the transfer ran into (userCanceledErr, if it was cancelled). If the transfer
+// resumed an earlier copy and failed before getting any further, it's run once more from the start.
 //
-// The theRefCon parameter contains the number of bytes just written.
+// This function doesn't return until the transfer is done, so call it on a worker thread (as
+// QTDR_QueueTransfer does), not the main thread.
 //
 //////////
 
-PASCAL_RTN void QTDR_WriteDataCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr)
+OSErr QTDR_RunTransfer (QTDRTransferPtr theTransfer)
 {
-#pragma unused(theErr)
-
-	long		myNumBytesToRead;
-	wide		myWide;
-
-	// increment our tally of the number of bytes written so far
-	gBytesTransferred += theRefCon;
+	OSErr		myErr = noErr;
 
-	if (gBytesTransferred < gBytesToTransfer) {
-		// there is still data to read and write, so schedule a read operation
+	if (theTransfer == NULL)
+		return(paramErr);
+		
+	if (theTransfer->cancelled)
+		myErr = userCanceledErr;
+	else
+		myErr = QTDR_StartTransfer(theTransfer);
+	if (myErr != noErr)
+		goto bail;
+		
+	while (!QTDR_TaskTransfer(theTransfer))
+#if TARGET_OS_WIN32
+		Sleep(kQTDR_TaskInterval / 1000);
+#else
+		usleep(kQTDR_TaskInterval);
+#endif
+		
+	myErr = theTransfer->err;
 	
-		// determine how big a chunk to read
-		if (gBytesToTransfer - gBytesTransferred > kDataBufferSize)
-			myNumBytesToRead = kDataBufferSize;
-		else
-			myNumBytesToRead = gBytesToTransfer - gBytesTransferred;
-
-		myWide.lo = gBytesTransferred;			// read from the current offset 
-		myWide.hi = 0;
+	// a resumed copy that failed before writing anything more has thrown away its checkpoint (see
+	// QTDR_CloseTransfer), so try once more, from the start of the file
+	if (QTDR_ResumeFailed(theTransfer)) {
+		QTDR_CloseTransfer(theTransfer);
 		
-		// schedule a read operation
-		DataHReadAsync(gDataReader,
-						theRequest,				// the data buffer
-						myNumBytesToRead,
-						&myWide,
-						gReadDataHCompletionUPP,
-						myNumBytesToRead);
-
-	} else {
-		// we've transferred all the data, so set a flag to tell us to close down the data handlers
-		gDoneTransferring = true;
+		myErr = QTDR_StartTransfer(theTransfer);
+		if (myErr != noErr)
+			goto bail;
+			
+		while (!QTDR_TaskTransfer(theTransfer))
+#if TARGET_OS_WIN32
+			Sleep(kQTDR_TaskInterval / 1000);
+#else
+			usleep(kQTDR_TaskInterval);
+#endif
+			
+		myErr = theTransfer->err;
 	}
 	
+bail:
+	QTDR_CloseTransfer(theTransfer);
+	theTransfer->err = myErr;
+	theTransfer->done = true;
+	
+	return(myErr);
 }
 
 
 //////////
 //
-// QTDR_CloseDownHandlers
-// Close our read/write access to our data references and then close down the read/write data handlers.
+// QTDR_CancelTransfer
+// Stop the specified transfer: no new reads are started, and the transfer is done (with the error
+// userCanceledErr) as soon as the reads and writes already under way have completed.
+//
+// A transfer sent to QTDR_QueueTransfer must be cancelled on the main thread.
 //
 //////////
 
-void QTDR_CloseDownHandlers (void)
+void QTDR_CancelTransfer (QTDRTransferPtr theTransfer)
 {
-	if (gDataReader != NULL) {
-		DataHCloseForRead(gDataReader);
-		CloseComponent(gDataReader);
-		gDataReader = NULL;
-	}
-
-	if (gDataWriter != NULL) {
-		DataHCloseForWrite(gDataWriter);
-		CloseComponent(gDataWriter);
-		gDataWriter = NULL;
-	}
-	
-	// dispose of the data buffer
-	if (gDataBuffer != NULL)
-		DisposePtr(gDataBuffer);
-		
-	// dispose of the routine descriptors
-	if (gReadDataHCompletionUPP != NULL)
-		DisposeDataHCompletionUPP(gReadDataHCompletionUPP);
+	if (theTransfer == NULL)
+		return;
 		
-	if (gWriteDataHCompletionUPP != NULL)
-		DisposeDataHCompletionUPP(gWriteDataHCompletionUPP);
+	theTransfer->cancelled = true;
 	
-	gDoneTransferring = false;
-	
-#if TARGET_OS_WIN32
-	// kill the timer that tasks the data handlers
-	KillTimer(NULL, gTimerID);
+#if QTDR_USE_WORKER_THREADS
+	// if the transfer is still waiting for a worker, make sure it never starts
+	if (theTransfer->request != NULL)
+		cancelWorkerRequest((WorkerRequestRef)theTransfer->request);
 #endif
 }
 
 
+//////////
+//
+// QTDR_GetTransferProgress
+// Return the number of bytes of the specified transfer that have been written so far, and the total
+// number of bytes to transfer (which is 0 until the transfer has started).
+//
+//////////
+
+void QTDR_GetTransferProgress (QTDRTransferPtr theTransfer, SInt64 *theBytesTransferred, SInt64 *theBytesToTransfer)
+{
+	if (theBytesTransferred != NULL)
+		*theBytesTransferred = (theTransfer != NULL) ? theTransfer->bytesTransferred : 0L;
+	if (theBytesToTransfer != NULL)
+		*theBytesToTransfer = (theTransfer != NULL) ? theTransfer->bytesToTransfer : 0L;
+}
+
+
+//////////
+//
+// QTDR_IsTransferDone
+// Is the specified transfer done (successfully or otherwise)?
+//
+//////////
+
+Boolean QTDR_IsTransferDone (QTDRTransferPtr theTransfer)
+{
+	return((theTransfer == NULL) || theTransfer->done);
+}
+
+
+//////////
+//
+// QTDR_GetTransferError
+// Return the first error that the specified transfer ran into, or noErr.
+//
+//////////
+
+OSErr QTDR_GetTransferError (QTDRTransferPtr theTransfer)
+{
+	return((theTransfer != NULL) ? theTransfer->err : paramErr);
+}
+
+
+//////////
+//
+// QTDR_GetTransferThroughput
+// Return the throughput of the specified transfer so far (or overall, if it's done), in bytes per second.
+//
+//////////
+
+Float64 QTDR_GetTransferThroughput (QTDRTransferPtr theTransfer)
+{
+	UnsignedWide	myNow;
+	Float64			myMicroseconds;
+	
+	if (theTransfer == NULL)
+		return(0);
+		
+	// use the time now if the transfer is still under way
+	if (!theTransfer->done)
+		Microseconds(&myNow);
+	else
+		myNow = theTransfer->endTime;
+		
+	myMicroseconds = UnsignedWideToUInt64(myNow) - UnsignedWideToUInt64(theTransfer->startTime);
+	if (myMicroseconds <= 0)
+		return(0);
+		
+	return(theTransfer->bytesTransferred * 1000000.0 / myMicroseconds);
+}
+
+
+//////////
+//
+// QTDR_CloseTransfer
+// Close the specified transfer's read/write access to its data references, close down its data handlers,
+// save or remove its checkpoint, and dispose of its data buffers.
+//
+//////////
+
+void QTDR_CloseTransfer (QTDRTransferPtr theTransfer)
+{
+	long		myIndex;
+
+	if (theTransfer == NULL)
+		return;
+		
+	for (myIndex = 0; myIndex < kMaxTransferStreams; myIndex++)
+		if (theTransfer->streams[myIndex].reader != NULL) {
+			DataHCloseForRead(theTransfer->streams[myIndex].reader);
+			CloseComponent(theTransfer->streams[myIndex].reader);
+			theTransfer->streams[myIndex].reader = NULL;
+		}
+
+	if (theTransfer->writer != NULL) {
+		DataHCloseForWrite(theTransfer->writer);
+		CloseComponent(theTransfer->writer);
+		theTransfer->writer = NULL;
+	}
+	
+	// once the copy is complete, we don't need its checkpoint any more; nor do we if resuming from it got
+	// nowhere (a server that won't serve byte ranges can't send the middle of a file, for instance), since
+	// the next copy should start from scratch; otherwise, save the checkpoint so that the copy can be resumed
+	if (theTransfer->chunkMap != NULL) {
+		if ((theTransfer->done && (theTransfer->err == noErr)) || QTDR_ResumeFailed(theTransfer))
+			FSpDelete(&theTransfer->checkpointFile);
+		else
+			QTDR_WriteCheckpoint(theTransfer);
+			
+		DisposePtr((Ptr)theTransfer->chunkMap);
+		theTransfer->chunkMap = NULL;
+	}
+	
+	// dispose of the data buffers
+	for (myIndex = 0; myIndex < kMaxDataBuffers; myIndex++)
+		if (theTransfer->buffers[myIndex].data != NULL) {
+			DisposePtr(theTransfer->buffers[myIndex].data);
+			theTransfer->buffers[myIndex].data = NULL;
+		}
+}
+
+
+//////////
+//
+// QTDR_DisposeTransfer
+// Close down the specified transfer (if it isn't already) and dispose of it.
+//
+//////////
+
+void QTDR_DisposeTransfer (QTDRTransferPtr theTransfer)
+{
+	if (theTransfer == NULL)
+		return;
+		
+	QTDR_CloseTransfer(theTransfer);
+	
+	// dispose of the data references
+	if (theTransfer->readerRef != NULL)
+		DisposeHandle(theTransfer->readerRef);
+		
+	if (theTransfer->writerRef != NULL)
+		DisposeHandle(theTransfer->writerRef);
+	
+	// dispose of the routine descriptors
+	if (theTransfer->readUPP != NULL)
+		DisposeDataHCompletionUPP(theTransfer->readUPP);
+		
+	if (theTransfer->writeUPP != NULL)
+		DisposeDataHCompletionUPP(theTransfer->writeUPP);
+		
+	free(theTransfer->url);
+	DisposePtr((Ptr)theTransfer);
+}
+
+
+//////////
+//
+// QTDR_CopyRemoteFileToLocalFile
+// Copy a remote file (located at the specified URL) into a local file.
+//
+// The copy proceeds as the application tasks the data handlers; when gDoneTransferring is true, call
+// QTDR_CloseDownHandlers. Use QTDR_NewTransfer to run more than one copy at a time.
+//
+//////////
+
+OSErr QTDR_CopyRemoteFileToLocalFile (char *theURL, FSSpecPtr theFile)
+{
+	OSErr		myErr = noErr;
+	
+	// there's only one of these transfers at a time
+	if (gTransfer != NULL) {
+		QTDR_DisposeTransfer(gTransfer);
+		gTransfer = NULL;
+	}
+	gDoneTransferring = false;
+	
+	myErr = QTDR_NewTransfer(theURL, theFile, &gTransfer);
+	if (myErr != noErr)
+		goto bail;
+		
+	myErr = QTDR_StartTransfer(gTransfer);
+
+bail:
+	// if we encountered any error, close the data handler components
+	if (myErr != noErr)
+		QTDR_CloseDownHandlers();
+	
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDR_ReadDataCompletionProc
+// This procedure is called when the data handler has completed a read operation.
+//
+// The theRefCon parameter points to the buffer record for the data just read.
+//
+//////////
+
+PASCAL_RTN void QTDR_ReadDataCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr)
+{
+	QTDRDataBufferRecord	*myBuffer = (QTDRDataBufferRecord *)theRefCon;
+	QTDRTransferPtr			myTransfer = myBuffer->transfer;
+	wide					myWide;
+	
+	// if a read from one of the extra streams fails, the server probably can't serve byte ranges;
+	// go on with just the first stream, and give it this buffer
+	if ((theErr != noErr) && (myBuffer->stream != 0) && (myTransfer->err == noErr) && !myTransfer->cancelled) {
+		QTDR_FallBackToOneStream(myTransfer);
+		QTDR_ReadNextChunk(myBuffer);
+		return;
+	}
+	
+	if ((theErr != noErr) || (myTransfer->err != noErr) || myTransfer->cancelled) {
+		QTDR_FinishDataRequest(myTransfer, myTransfer->cancelled ? userCanceledErr : theErr);
+		return;
+	}
+
+	// we just finished reading some data, so schedule a write operation; the write goes to the offset
+	// the data was read from, so it doesn't matter in which order the buffers or the streams come back
+	myWide = SInt64ToWide(myBuffer->offset);	// write to the offset we read from
+	
+	DataHWrite64(myTransfer->writer,
+				theRequest,						// the data buffer
+				&myWide,
+				myBuffer->size,					// the number of bytes to write
+				myTransfer->writeUPP,
+				theRefCon);
+}
+
+
+//////////
+//
+// QTDR_WriteDataCompletionProc
+// This procedure is called when the data handler has completed a write operation.
+//
+// The theRefCon parameter points to the buffer record for the data just written.
+//
+//////////
+
+PASCAL_RTN void QTDR_WriteDataCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr)
+{
+#pragma unused(theRequest)
+
+	QTDRDataBufferRecord	*myBuffer = (QTDRDataBufferRecord *)theRefCon;
+	QTDRTransferPtr			myTransfer = myBuffer->transfer;
+	long					myChunk;
+
+	if ((theErr != noErr) || (myTransfer->err != noErr) || myTransfer->cancelled) {
+		QTDR_FinishDataRequest(myTransfer, myTransfer->cancelled ? userCanceledErr : theErr);
+		return;
+	}
+	
+	if (myBuffer->size > 0) {
+		myChunk = (long)(myBuffer->offset / myTransfer->bufferSize);
+		
+		// keep a checksum of the first chunk written, for the checkpoint
+		if (myTransfer->sampleSize == 0) {
+			myTransfer->sampleOffset = myBuffer->offset;
+			myTransfer->sampleSize = myBuffer->size;
+			myTransfer->sampleChecksum = QTDR_ChecksumBytes(myBuffer->data, myBuffer->size);
+		}
+		
+		// increment our tally of the number of bytes written so far; after a fall back to one stream,
+		// a chunk can be written twice, but we count it only once
+		if (!QTDR_IsChunkDone(myTransfer, myChunk)) {
+			myTransfer->chunkMap[myChunk >> 3] |= (1 << (myChunk & 7));
+			myTransfer->bytesTransferred += myBuffer->size;
+		}
+		
+		// every so often, record which chunks are done
+		if (++myTransfer->numChunksSinceCheckpoint >= kCheckpointInterval) {
+			QTDR_WriteCheckpoint(myTransfer);
+			myTransfer->numChunksSinceCheckpoint = 0L;
+		}
+	}
+
+	// reuse this buffer for the next chunk, if there is one
+	QTDR_ReadNextChunk(myBuffer);
+}
+
+
+//////////
+//
+// QTDR_ReadNextChunk
+// Schedule a read of the next chunk of the specified buffer's stream (or of the range someone is waiting
+// for) into the buffer; if the stream has no more data to read, retire the buffer.
+//
+//////////
+
+static void QTDR_ReadNextChunk (QTDRDataBufferRecord *theBuffer)
+{
+	QTDRTransferPtr			myTransfer = theBuffer->transfer;
+	QTDRStreamRecord		*myStream;
+	wide					myWide;
+
+	// once we've fallen back to a single stream, every buffer reads from it
+	if (myTransfer->fellBack)
+		theBuffer->stream = 0;
+		
+	myStream = &myTransfer->streams[theBuffer->stream];
+	
+	// skip any chunks that are already in the local file
+	while ((myStream->nextByteToRead < myStream->endOfRange) && QTDR_IsChunkDone(myTransfer, (long)(myStream->nextByteToRead / myTransfer->bufferSize)))
+		myStream->nextByteToRead += myTransfer->bufferSize;
+		
+	while ((myTransfer->wantedNextByte < myTransfer->wantedEndOfRange) && QTDR_IsChunkDone(myTransfer, (long)(myTransfer->wantedNextByte / myTransfer->bufferSize)))
+		myTransfer->wantedNextByte += myTransfer->bufferSize;
+		
+	if ((theBuffer->stream != 0) && !myTransfer->fellBack && (myTransfer->wantedNextByte < myTransfer->wantedEndOfRange)) {
+		// someone is waiting for a range (see QTDR_RequestTransferRange), so read its next chunk first; we
+		// only do this on the extra streams, so that if the server won't serve the range, we fall back as usual
+		theBuffer->offset = myTransfer->wantedNextByte;
+		theBuffer->size = QTDR_GetChunkSize(myTransfer, (long)(theBuffer->offset / myTransfer->bufferSize));
+		myTransfer->wantedNextByte += myTransfer->bufferSize;
+		
+	} else if (myStream->nextByteToRead < myStream->endOfRange) {
+		// there is still data to read in this stream's range
+	
+		// determine how big a chunk to read
+		if (myStream->endOfRange - myStream->nextByteToRead > myTransfer->bufferSize)
+			theBuffer->size = myTransfer->bufferSize;
+		else
+			theBuffer->size = (long)(myStream->endOfRange - myStream->nextByteToRead);
+
+		theBuffer->offset = myStream->nextByteToRead;
+		myStream->nextByteToRead += theBuffer->size;
+		
+	} else {
+		// there's nothing left for this buffer to do
+		QTDR_FinishDataRequest(myTransfer, noErr);
+		return;
+	}
+		
+	myWide = SInt64ToWide(theBuffer->offset);	// read from the chunk's offset 
+	
+	// schedule a read operation
+	DataHReadAsync(myStream->reader,
+					theBuffer->data,		// the data buffer
+					theBuffer->size,
+					&myWide,
+					myTransfer->readUPP,
+					(long)theBuffer);
+}
+
+
+//////////
+//
+// QTDR_ReadDataSync
+// Read the specified bytes through the specified data handler, which must be open for reading, and task
+// the data handler until the read has completed.
+//
+//////////
+
+static OSErr QTDR_ReadDataSync (ComponentInstance theHandler, Ptr theBuffer, SInt64 theOffset, long theSize)
+{
+	QTDRSyncReadRecord	myRead;
+	DataHCompletionUPP	myUPP = NULL;
+	wide				myWide;
+	OSErr				myErr = noErr;
+	
+	myUPP = NewDataHCompletionUPP(QTDR_SyncReadCompletionProc);
+	myRead.done = false;
+	myRead.err = noErr;
+	myWide = SInt64ToWide(theOffset);
+	
+	myErr = (OSErr)DataHReadAsync(theHandler, theBuffer, theSize, &myWide, myUPP, (long)&myRead);
+	if (myErr == noErr) {
+		while (!myRead.done) {
+			DataHTask(theHandler);
+			if (myRead.done)
+				break;
+				
+#if TARGET_OS_WIN32
+			Sleep(kQTDR_TaskInterval / 1000);
+#else
+			usleep(kQTDR_TaskInterval);
+#endif
+		}
+		
+		myErr = myRead.err;
+	}
+	
+	DisposeDataHCompletionUPP(myUPP);
+	
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDR_SyncReadCompletionProc
+// This procedure is called when the data handler has completed a read made by QTDR_ReadDataSync.
+//
+// The theRefCon parameter points to the record of that read.
+//
+//////////
+
+static PASCAL_RTN void QTDR_SyncReadCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr)
+{
+#pragma unused(theRequest)
+
+	QTDRSyncReadRecord		*myRead = (QTDRSyncReadRecord *)theRefCon;
+	
+	myRead->err = theErr;
+	myRead->done = true;
+}
+
+
+//////////
+//
+// QTDR_OpenTransferStreams
+// If the remote file is big enough, open another data handler (and so another connection) for each extra
+// stream the transfer may use, and split the file into one byte range per stream; otherwise, and if no
+// other data handler can be opened, read the whole file through the first one.
+//
+//////////
+
+static void QTDR_OpenTransferStreams (QTDRTransferPtr theTransfer)
+{
+	ComponentInstance	myReader;
+	long				myNumStreams = theTransfer->numStreams;
+	SInt64				myRangeSize;
+	long				myIndex;
+	
+	if (myNumStreams > theTransfer->numBuffers)
+		myNumStreams = theTransfer->numBuffers;
+	if (theTransfer->bytesToTransfer < kMinRangedTransferSize)
+		myNumStreams = 1;
+		
+	for (myIndex = 1; myIndex < myNumStreams; myIndex++) {
+		myReader = OpenComponent(GetDataHandler(theTransfer->readerRef, URLDataHandlerSubType, kDataHCanRead));
+		if (myReader == NULL)
+			break;
+			
+		if ((DataHSetDataRef(myReader, theTransfer->readerRef) != noErr) || (DataHOpenForRead(myReader) != noErr)) {
+			CloseComponent(myReader);
+			break;
+		}
+		
+		theTransfer->streams[myIndex].reader = myReader;
+	}
+	
+	theTransfer->numStreams = myIndex;
+	theTransfer->fellBack = false;
+	
+	// split the file into ranges that are a whole number of buffers long; the last range takes what's left
+	myRangeSize = theTransfer->bytesToTransfer / theTransfer->numStreams;
+	myRangeSize -= myRangeSize % theTransfer->bufferSize;
+	
+	for (myIndex = 0; myIndex < theTransfer->numStreams; myIndex++) {
+		theTransfer->streams[myIndex].nextByteToRead = myIndex * myRangeSize;
+		theTransfer->streams[myIndex].endOfRange = (myIndex + 1) * myRangeSize;
+	}
+	
+	theTransfer->streams[theTransfer->numStreams - 1].endOfRange = theTransfer->bytesToTransfer;
+}
+
+
+//////////
+//
+// QTDR_FallBackToOneStream
+// Stop reading from all but the first stream, and have the first stream read the rest of the file.
+//
+// The first stream reads from where it is to the end of the file, skipping the chunks the other streams
+// have already written; a chunk that was still in flight gets read again, which is harmless.
+//
+//////////
+
+static void QTDR_FallBackToOneStream (QTDRTransferPtr theTransfer)
+{
+	long		myIndex;
+	
+	if (theTransfer->fellBack)
+		return;
+		
+	for (myIndex = 1; myIndex < theTransfer->numStreams; myIndex++)
+		theTransfer->streams[myIndex].endOfRange = theTransfer->streams[myIndex].nextByteToRead;
+		
+	theTransfer->streams[0].endOfRange = theTransfer->bytesToTransfer;
+	theTransfer->fellBack = true;
+}
+
+
+//////////
+//
+// QTDR_FinishDataRequest
+// Retire one buffer's chain of reads and writes, remembering the first error; when the last buffer is
+// retired, the transfer is done.
+//
+//////////
+
+static void QTDR_FinishDataRequest (QTDRTransferPtr theTransfer, OSErr theErr)
+{
+	if ((theErr != noErr) && (theTransfer->err == noErr))
+		theTransfer->err = theErr;
+		
+	theTransfer->numRequestsInFlight--;
+	
+	if (theTransfer->numRequestsInFlight == 0) {
+		Microseconds(&theTransfer->endTime);
+		theTransfer->done = true;
+		
+		// set a flag to tell us to close down the data handlers
+		if (theTransfer == gTransfer)
+			gDoneTransferring = true;
+	}
+}
+
+
+//////////
+//
+// QTDR_IsChunkDone
+// Has the specified chunk of the specified transfer been written to the local file?
+//
+//////////
+
+static Boolean QTDR_IsChunkDone (QTDRTransferPtr theTransfer, long theChunk)
+{
+	if (theTransfer->chunkMap == NULL)
+		return(false);
+		
+	return((theTransfer->chunkMap[theChunk >> 3] & (1 << (theChunk & 7))) != 0);
+}
+
+
+//////////
+//
+// QTDR_GetChunkSize
+// Return the size of the specified chunk of the specified transfer; every chunk but the last is a full buffer.
+//
+//////////
+
+static long QTDR_GetChunkSize (QTDRTransferPtr theTransfer, long theChunk)
+{
+	SInt64		myOffset = (SInt64)theChunk * theTransfer->bufferSize;
+	
+	if (theTransfer->bytesToTransfer - myOffset < theTransfer->bufferSize)
+		return((long)(theTransfer->bytesToTransfer - myOffset));
+		
+	return(theTransfer->bufferSize);
+}
+
+
+//////////
+//
+// QTDR_MakeCheckpointFileSpec
+// Return, through theCheckpointFile, a file specification for the checkpoint file of the specified local file;
+// it's in the same folder, and its name is the local file's name (shortened if need be) with kCheckpointSuffix.
+//
+//////////
+
+static void QTDR_MakeCheckpointFileSpec (FSSpecPtr theFile, FSSpecPtr theCheckpointFile)
+{
+	Str255		myName;
+	short		mySuffixLength = strlen(kCheckpointSuffix);
+	short		myLength = theFile->name[0];
+	
+	if (myLength > kCheckpointMaxNameLength - mySuffixLength)
+		myLength = kCheckpointMaxNameLength - mySuffixLength;
+		
+	BlockMoveData(&theFile->name[1], &myName[1], myLength);
+	BlockMoveData(kCheckpointSuffix, &myName[myLength + 1], mySuffixLength);
+	myName[0] = myLength + mySuffixLength;
+
+	// the checkpoint file usually doesn't exist yet, so ignore the fnfErr we get in that case
+	FSMakeFSSpec(theFile->vRefNum, theFile->parID, myName, theCheckpointFile);
+}
+
+
+//////////
+//
+// QTDR_ReadCheckpoint
+// Read the checkpoint file of the specified transfer, if there is one, and make sure it was written by a
+// transfer of the same URL and that the local file is still there. If so, set the transfer's chunk map,
+// chunk (buffer) size, the remote file size the checkpoint was written for, and the checksum of the chunk
+// it keeps one of, and return noErr.
+//
+//////////
+
+static OSErr QTDR_ReadCheckpoint (QTDRTransferPtr theTransfer)
+{
+	QTDRCheckpointHeader	myHeader;
+	FInfo					myFileInfo;
+	char					*myURL = NULL;
+	short					myRefNum = 0;
+	long					myCount;
+	long					myNumChunks;
+	OSErr					myErr = noErr;
+	
+	// the local file has to still be there
+	myErr = FSpGetFInfo(&theTransfer->file, &myFileInfo);
+	if (myErr != noErr)
+		goto bail;
+		
+	myErr = FSpOpenDF(&theTransfer->checkpointFile, fsRdPerm, &myRefNum);
+	if (myErr != noErr) {
+		myRefNum = 0;
+		goto bail;
+	}
+	
+	myCount = sizeof(myHeader);
+	myErr = FSRead(myRefNum, &myCount, &myHeader);
+	if (myErr != noErr)
+		goto bail;
+		
+	// the checkpoint is stored big-endian
+	myHeader.signature = EndianU32_BtoN(myHeader.signature);
+	myHeader.version = EndianS32_BtoN(myHeader.version);
+	myHeader.fileSize = EndianS64_BtoN(myHeader.fileSize);
+	myHeader.chunkSize = EndianS32_BtoN(myHeader.chunkSize);
+	myHeader.urlLength = EndianS32_BtoN(myHeader.urlLength);
+	myHeader.sampleOffset = EndianS64_BtoN(myHeader.sampleOffset);
+	myHeader.sampleSize = EndianS32_BtoN(myHeader.sampleSize);
+	myHeader.sampleChecksum = EndianU32_BtoN(myHeader.sampleChecksum);
+	
+	myErr = paramErr;
+	if ((myHeader.signature != kCheckpointSignature) || (myHeader.version != kCheckpointVersion))
+		goto bail;
+	if ((myHeader.fileSize < 0) || (myHeader.chunkSize < 1) || (myHeader.urlLength != (long)strlen(theTransfer->url)))
+		goto bail;
+	if ((myHeader.sampleSize < 0) || (myHeader.sampleSize > myHeader.chunkSize) || (myHeader.sampleOffset < 0) ||
+		(myHeader.sampleOffset + myHeader.sampleSize > myHeader.fileSize))
+		goto bail;
+		
+	// make sure the checkpoint is for the same URL
+	myURL = malloc(myHeader.urlLength + 1);
+	if (myURL == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+	
+	myCount = myHeader.urlLength;
+	myErr = FSRead(myRefNum, &myCount, myURL);
+	if (myErr != noErr)
+		goto bail;
+		
+	myErr = paramErr;
+	if (memcmp(myURL, theTransfer->url, myHeader.urlLength) != 0)
+		goto bail;
+		
+	// read the chunk map
+	myNumChunks = (long)((myHeader.fileSize + myHeader.chunkSize - 1) / myHeader.chunkSize);
+	
+	theTransfer->chunkMap = (UInt8 *)NewPtrClear((myNumChunks + 7) / 8 + 1);
+	myErr = MemError();
+	if (myErr != noErr)
+		goto bail;
+		
+	myCount = (myNumChunks + 7) / 8;
+	myErr = FSRead(myRefNum, &myCount, theTransfer->chunkMap);
+	if (myErr != noErr)
+		goto bail;
+	
+	theTransfer->numChunks = myNumChunks;
+	theTransfer->bufferSize = myHeader.chunkSize;
+	theTransfer->bytesToTransfer = myHeader.fileSize;
+	theTransfer->sampleOffset = myHeader.sampleOffset;
+	theTransfer->sampleSize = myHeader.sampleSize;
+	theTransfer->sampleChecksum = myHeader.sampleChecksum;
+	
+bail:
+	if (myRefNum != 0)
+		FSClose(myRefNum);
+		
+	free(myURL);
+	
+	if ((myErr != noErr) && (theTransfer->chunkMap != NULL)) {
+		DisposePtr((Ptr)theTransfer->chunkMap);
+		theTransfer->chunkMap = NULL;
+	}
+	
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDR_WriteCheckpoint
+// Write the checkpoint file of the specified transfer, creating it if need be.
+//
+// A chunk is marked as done only after its write to the local file has completed, so the checkpoint never
+// claims more than the local file holds; at worst, a resumed copy fetches a few chunks again.
+//
+//////////
+
+static OSErr QTDR_WriteCheckpoint (QTDRTransferPtr theTransfer)
+{
+	QTDRCheckpointHeader	myHeader;
+	short					myRefNum = 0;
+	long					myCount;
+	long					myPosition;
+	OSErr					myErr = noErr;
+	
+	if (theTransfer->chunkMap == NULL)
+		return(paramErr);
+		
+	myErr = FSpOpenDF(&theTransfer->checkpointFile, fsWrPerm, &myRefNum);
+	if (myErr == fnfErr) {
+		myErr = FSpCreate(&theTransfer->checkpointFile, kTransFileCreator, kCheckpointFileType, smSystemScript);
+		if (myErr == noErr)
+			myErr = FSpOpenDF(&theTransfer->checkpointFile, fsWrPerm, &myRefNum);
+	}
+	
+	if (myErr != noErr) {
+		myRefNum = 0;
+		goto bail;
+	}
+	
+	myHeader.signature = EndianU32_NtoB(kCheckpointSignature);
+	myHeader.version = EndianS32_NtoB(kCheckpointVersion);
+	myHeader.fileSize = EndianS64_NtoB(theTransfer->bytesToTransfer);
+	myHeader.chunkSize = EndianS32_NtoB(theTransfer->bufferSize);
+	myHeader.urlLength = EndianS32_NtoB(strlen(theTransfer->url));
+	myHeader.sampleOffset = EndianS64_NtoB(theTransfer->sampleOffset);
+	myHeader.sampleSize = EndianS32_NtoB(theTransfer->sampleSize);
+	myHeader.sampleChecksum = EndianU32_NtoB(theTransfer->sampleChecksum);
+	
+	myCount = sizeof(myHeader);
+	myErr = FSWrite(myRefNum, &myCount, &myHeader);
+	if (myErr != noErr)
+		goto bail;
+		
+	myCount = strlen(theTransfer->url);
+	myErr = FSWrite(myRefNum, &myCount, theTransfer->url);
+	if (myErr != noErr)
+		goto bail;
+		
+	myCount = (theTransfer->numChunks + 7) / 8;
+	myErr = FSWrite(myRefNum, &myCount, theTransfer->chunkMap);
+	if (myErr != noErr)
+		goto bail;
+		
+	// an earlier checkpoint might have been longer
+	myErr = GetFPos(myRefNum, &myPosition);
+	if (myErr == noErr)
+		myErr = SetEOF(myRefNum, myPosition);
+	
+bail:
+	if (myRefNum != 0)
+		FSClose(myRefNum);
+		
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDR_DiscardCheckpoint
+// Forget the chunks the specified transfer's checkpoint says are done, and delete the checkpoint file.
+//
+//////////
+
+static void QTDR_DiscardCheckpoint (QTDRTransferPtr theTransfer)
+{
+	if (theTransfer->chunkMap != NULL) {
+		DisposePtr((Ptr)theTransfer->chunkMap);
+		theTransfer->chunkMap = NULL;
+	}
+	
+	theTransfer->numChunks = 0L;
+	theTransfer->sampleSize = 0L;
+	FSpDelete(&theTransfer->checkpointFile);
+}
+
+
+//////////
+//
+// QTDR_ChecksumBytes
+// Return a checksum (the 32-bit FNV-1a hash) of the specified bytes.
+//
+//////////
+
+static UInt32 QTDR_ChecksumBytes (const void *theBytes, long theSize)
+{
+	const UInt8		*myBytes = (const UInt8 *)theBytes;
+	UInt32			myChecksum = 2166136261U;
+	long			myIndex;
+	
+	for (myIndex = 0; myIndex < theSize; myIndex++) {
+		myChecksum ^= myBytes[myIndex];
+		myChecksum *= 16777619U;
+	}
+	
+	return(myChecksum);
+}
+
+
+//////////
+//
+// QTDR_IsSampleUnchanged
+// Fetch again the chunk of the remote file that the specified transfer's checkpoint keeps a checksum of, and
+// return true if it has the same checksum; that is, if the remote file is (almost certainly) the one the
+// checkpoint was written for. We read the chunk through a data handler of our own, so that the transfer's
+// streams don't see it as their first read.
+//
+//////////
+
+static Boolean QTDR_IsSampleUnchanged (QTDRTransferPtr theTransfer)
+{
+	ComponentInstance	myReader = NULL;
+	Ptr					myData = NULL;
+	Boolean				isUnchanged = false;
+	
+	// a checkpoint written before any chunk was has nothing in the local file to lose
+	if (theTransfer->sampleSize == 0)
+		return(true);
+		
+	if (theTransfer->sampleOffset + theTransfer->sampleSize > theTransfer->bytesToTransfer)
+		return(false);
+		
+	myData = NewPtr(theTransfer->sampleSize);
+	if (myData == NULL)
+		goto bail;
+		
+	myReader = OpenComponent(GetDataHandler(theTransfer->readerRef, URLDataHandlerSubType, kDataHCanRead));
+	if (myReader == NULL)
+		goto bail;
+		
+	if ((DataHSetDataRef(myReader, theTransfer->readerRef) == noErr) && (DataHOpenForRead(myReader) == noErr)) {
+		if (QTDR_ReadDataSync(myReader, myData, theTransfer->sampleOffset, theTransfer->sampleSize) == noErr)
+			isUnchanged = (QTDR_ChecksumBytes(myData, theTransfer->sampleSize) == theTransfer->sampleChecksum);
+			
+		DataHCloseForRead(myReader);
+	}
+	
+bail:
+	if (myReader != NULL)
+		CloseComponent(myReader);
+		
+	if (myData != NULL)
+		DisposePtr(myData);
+		
+	return(isUnchanged);
+}
+
+
+//////////
+//
+// QTDR_ResumeFailed
+// Did the specified transfer resume an earlier copy, and then fail (other than by being cancelled) without
+// writing anything more?
+//
+//////////
+
+static Boolean QTDR_ResumeFailed (QTDRTransferPtr theTransfer)
+{
+	return(theTransfer->done && (theTransfer->err != noErr) && (theTransfer->err != userCanceledErr) &&
+			(theTransfer->bytesResumed > 0) && (theTransfer->bytesTransferred == theTransfer->bytesResumed));
+}
+
+
+//////////
+//
+// QTDR_SetTransferStreams
+// Set the number of streams (connections to the remote file) used by transfers created from now on.
+//
+// A remote file of at least kMinRangedTransferSize bytes is split into that many byte ranges, which are
+// fetched at once; a smaller file, or one whose server won't serve byte ranges, is fetched by one stream.
+//
+//////////
+
+OSErr QTDR_SetTransferStreams (long theNumStreams)
+{
+	if ((theNumStreams < 1) || (theNumStreams > kMaxTransferStreams))
+		return(paramErr);
+		
+	gNumTransferStreams = theNumStreams;
+	
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDR_SetTransferBuffers
+// Set the number and size of the buffers used by transfers created from now on.
+//
+// With a single buffer, each read waits for the previous write and vice versa; with several, that many
+// reads and writes can be in flight at once, which keeps a link with any latency busy.
+//
+//////////
+
+OSErr QTDR_SetTransferBuffers (long theNumBuffers, long theBufferSize)
+{
+	if ((theNumBuffers < 1) || (theNumBuffers > kMaxDataBuffers) || (theBufferSize < 1))
+		return(paramErr);
+		
+	gNumDataBuffers = theNumBuffers;
+	gDataBufferSize = theBufferSize;
+	
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDR_CloseDownHandlers
+// Close our read/write access to our data references and then close down the read/write data handlers.
+//
+//////////
+
+void QTDR_CloseDownHandlers (void)
+{
+	if (gTransfer != NULL) {
+		QTDR_DisposeTransfer(gTransfer);
+		gTransfer = NULL;
+	}
+	
+	gDoneTransferring = false;
+	
+#if TARGET_OS_WIN32
+	// kill the timer that tasks the data handlers
+	KillTimer(NULL, gTimerID);
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Progressive file-transfer functions.
+//
+// These functions let you open a movie, and draw frames from it, while it's still being copied; they wait
+// only for the data they need (the movie atom, and the samples for a particular time), and they ask the
+// transfer to fetch that data ahead of the rest of the file. They task the transfer while they wait, so
+// call them on the thread that started the transfer (with QTDR_StartTransfer), and don't also run it with
+// QTDR_RunTransfer or QTDR_QueueTransfer.
+//
+// A transfer of a file smaller than kMinRangedTransferSize, or from a server that won't serve byte ranges,
+// can't fetch data out of order; these functions still work with it, but they wait for the data to arrive
+// in order.
+//
+// Nothing makes QuickTime itself wait: a movie opened with QTDR_GetMovieFromTransfer reads the local file
+// through an ordinary file data handler, and data that hasn't arrived reads as zeros, not as an error.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTDR_IsRangeTransferred
+// Have the specified bytes of the remote file been written to the local file?
+//
+//////////
+
+Boolean QTDR_IsRangeTransferred (QTDRTransferPtr theTransfer, SInt64 theOffset, SInt64 theSize)
+{
+	long		myChunk;
+	
+	if (theTransfer == NULL)
+		return(false);
+		
+	if ((theOffset < 0) || (theSize < 0) || (theOffset + theSize > theTransfer->bytesToTransfer))
+		return(false);
+		
+	// once a transfer has finished without error and been closed, there's no chunk map, but every byte is there
+	if (theTransfer->chunkMap == NULL)
+		return(theTransfer->done && (theTransfer->err == noErr));
+		
+	for (myChunk = (long)(theOffset / theTransfer->bufferSize); (SInt64)myChunk * theTransfer->bufferSize < theOffset + theSize; myChunk++)
+		if (!QTDR_IsChunkDone(theTransfer, myChunk))
+			return(false);
+			
+	return(true);
+}
+
+
+//////////
+//
+// QTDR_RequestTransferRange
+// Ask the specified transfer to fetch the specified bytes of the remote file before any others; this replaces
+// any range asked for earlier.
+//
+//////////
+
+void QTDR_RequestTransferRange (QTDRTransferPtr theTransfer, SInt64 theOffset, SInt64 theSize)
+{
+	if ((theTransfer == NULL) || (theTransfer->bufferSize < 1))
+		return;
+		
+	if (theOffset < 0)
+		theOffset = 0;
+	if (theOffset + theSize > theTransfer->bytesToTransfer)
+		theSize = theTransfer->bytesToTransfer - theOffset;
+		
+	// start at the beginning of the chunk the range starts in
+	theTransfer->wantedNextByte = theOffset - (theOffset % theTransfer->bufferSize);
+	theTransfer->wantedEndOfRange = theOffset + theSize;
+}
+
+
+//////////
+//
+// QTDR_WaitForTransferRange
+// Ask the specified transfer to fetch the specified bytes of the remote file first, and task the transfer
+// until they've been written to the local file. Return eofErr if the range is outside the file, and the
+// transfer's error if it ends (or has ended) without the range being written.
+//
+//////////
+
+OSErr QTDR_WaitForTransferRange (QTDRTransferPtr theTransfer, SInt64 theOffset, SInt64 theSize)
+{
+	if (theTransfer == NULL)
+		return(paramErr);
+		
+	if ((theOffset < 0) || (theSize < 0) || (theOffset + theSize > theTransfer->bytesToTransfer))
+		return(eofErr);
+		
+	QTDR_RequestTransferRange(theTransfer, theOffset, theSize);
+	
+	while (!QTDR_IsRangeTransferred(theTransfer, theOffset, theSize)) {
+		// the tasking that writes the last of the range may also be the one that finishes the transfer
+		if (QTDR_TaskTransfer(theTransfer) && !QTDR_IsRangeTransferred(theTransfer, theOffset, theSize))
+			return((theTransfer->err != noErr) ? theTransfer->err : eofErr);
+			
+#if TARGET_OS_WIN32
+		Sleep(kQTDR_TaskInterval / 1000);
+#else
+		usleep(kQTDR_TaskInterval);
+#endif
+	}
+	
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDR_GetMovieFromTransfer
+// Open the movie that the specified transfer is copying into its local file, as soon as the movie atom has
+// arrived. We find the movie atom by walking the top-level atoms of the file, waiting only for the header
+// of each one; so when the movie atom is at the end of the file, we don't have to wait for the media data.
+//
+// The movie is opened from a file data reference to the local file, which knows nothing of the transfer; the
+// local file is already full size, so a read of data that hasn't arrived yet returns zeros. Before drawing the
+// movie at a time, wait for that time with QTDR_WaitForMovieTime, and don't let the movie read anything else
+// (by playing it, or by tasking it at idle time) until the transfer is done.
+//
+// The caller is responsible for disposing of the movie returned by this function (by calling DisposeMovie).
+//
+//////////
+
+OSErr QTDR_GetMovieFromTransfer (QTDRTransferPtr theTransfer, Movie *theMovie)
+{
+	UInt32				myHeader[4];
+	SInt64				myOffset = 0;
+	SInt64				myAtomSize;
+	long				myCount;
+	ComponentInstance	myReader = NULL;
+	Handle				myDataRef = NULL;
+	ComponentResult		myErr = noErr;
+	
+	if ((theTransfer == NULL) || (theMovie == NULL))
+		return(paramErr);
+		
+	*theMovie = NULL;
+	
+	myDataRef = QTDR_MakeFileDataRef(&theTransfer->file);
+	if (myDataRef == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+	
+	// the local file is open for writing by the transfer, so we read the atom headers through a data handler
+	// of our own
+	myErr = badComponentType;
+	myReader = OpenComponent(GetDataHandler(myDataRef, rAliasType, kDataHCanRead));
+	if (myReader == NULL)
+		goto bail;
+		
+	myErr = DataHSetDataRef(myReader, myDataRef);
+	if (myErr == noErr)
+		myErr = DataHOpenForRead(myReader);
+	if (myErr != noErr)
+		goto bail;
+	
+	myErr = noMovieFound;
+	
+	while (myOffset + 8 <= theTransfer->bytesToTransfer) {
+		// wait for the atom's header, which is 16 bytes long if the atom has a 64-bit size
+		myCount = sizeof(myHeader);
+		if (myCount > theTransfer->bytesToTransfer - myOffset)
+			myCount = (long)(theTransfer->bytesToTransfer - myOffset);
+		
+		myErr = QTDR_WaitForTransferRange(theTransfer, myOffset, myCount);
+		if (myErr == noErr)
+			myErr = QTDR_ReadDataSync(myReader, (Ptr)myHeader, myOffset, myCount);
+		if (myErr != noErr)
+			goto bail;
+			
+		myAtomSize = EndianU32_BtoN(myHeader[0]);
+		if (myAtomSize == 0) {
+			// the atom extends to the end of the file
+			myAtomSize = theTransfer->bytesToTransfer - myOffset;
+		} else if (myAtomSize == 1) {
+			// the atom has a 64-bit size
+			if (myCount < 16)
+				break;
+			myAtomSize = (SInt64)(((UInt64)EndianU32_BtoN(myHeader[2]) << 32) | EndianU32_BtoN(myHeader[3]));
+		}
+		
+		if ((myAtomSize < 8) || (myAtomSize > theTransfer->bytesToTransfer - myOffset))
+			break;
+			
+		if (EndianU32_BtoN(myHeader[1]) == MovieAID) {
+			// wait for the rest of the movie atom, and then open the movie
+			myErr = QTDR_WaitForTransferRange(theTransfer, myOffset, myAtomSize);
+			if (myErr != noErr)
+				goto bail;
+				
+			myErr = NewMovieFromDataRef(theMovie, newMovieActive, NULL, myDataRef, rAliasType);
+			goto bail;
+		}
+		
+		myOffset += myAtomSize;
+		myErr = noMovieFound;
+	}
+	
+bail:
+	if (myReader != NULL) {
+		DataHCloseForRead(myReader);
+		CloseComponent(myReader);
+	}
+		
+	if (myDataRef != NULL)
+		DisposeHandle(myDataRef);
+		
+	return((OSErr)myErr);
+}
+
+
+//////////
+//
+// QTDR_WaitForMovieTime
+// Task the specified transfer until the local file holds all the data needed to draw the specified movie
+// (opened by QTDR_GetMovieFromTransfer) at the specified time: for each enabled visual track, the samples
+// from the sync sample at or before that time up to the sample at that time.
+//
+// This waits for what's needed to decode the samples up to that time, in decode order. It doesn't wait for
+// the samples of other tracks, such as sound, nor for a sample after that time that a codec which reorders
+// frames may need to display it; those read as zeros until they arrive (see QTDR_GetMovieFromTransfer).
+//
+// If the movie's media data isn't all in the movie file, we don't know which of it is needed, so we wait
+// for the whole transfer.
+//
+//////////
+
+OSErr QTDR_WaitForMovieTime (QTDRTransferPtr theTransfer, Movie theMovie, TimeValue theTime)
+{
+	Track				myTrack = NULL;
+	Media				myMedia = NULL;
+	TimeValue			myMediaTime;
+	TimeValue			mySampleTime;
+	SampleReference64Record	mySampleRef;
+	long				myNumEntries;
+	long				myIndex;
+	OSErr				myErr = noErr;
+	
+	if ((theTransfer == NULL) || (theMovie == NULL))
+		return(paramErr);
+		
+	if (!QTDR_IsMovieSelfContained(theMovie))
+		return(QTDR_WaitForTransferRange(theTransfer, 0L, theTransfer->bytesToTransfer));
+		
+	for (myIndex = 1; ; myIndex++) {
+		myTrack = GetMovieIndTrackType(theMovie, myIndex, VisualMediaCharacteristic, movieTrackCharacteristic | movieTrackEnabledOnly);
+		if (myTrack == NULL)
+			break;
+			
+		myMedia = GetTrackMedia(myTrack);
+		myMediaTime = TrackTimeToMediaTime(theTime, myTrack);
+		if ((myMedia == NULL) || (myMediaTime < 0))
+			continue;			// nothing of this track is showing at that time
+			
+		// back up to the sync sample that the sample at that time depends on
+		GetMediaNextInterestingTime(myMedia, nextTimeSyncSample | nextTimeEdgeOK, myMediaTime, -fixed1, &mySampleTime, NULL);
+		if ((GetMoviesError() != noErr) || (mySampleTime < 0))
+			mySampleTime = myMediaTime;
+			
+		// wait for the data of each sample from there on
+		while (mySampleTime <= myMediaTime) {
+			myErr = GetMediaSampleReferences64(myMedia, mySampleTime, &mySampleTime, &mySampleRef, 1, &myNumEntries);
+			if ((myErr != noErr) || (myNumEntries < 1) || (mySampleRef.numberOfSamples < 1) || (mySampleRef.durationPerSample < 1))
+				break;
+				
+			myErr = QTDR_WaitForTransferRange(theTransfer, WideToSInt64(mySampleRef.dataOffset), (SInt64)mySampleRef.dataSize * mySampleRef.numberOfSamples);
+			if (myErr != noErr)
+				return(myErr);
+				
+			mySampleTime += mySampleRef.durationPerSample * mySampleRef.numberOfSamples;
+		}
+	}
+	
+	return(noErr);
+}
+
+
+#if QTDR_USE_WORKER_THREADS
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Concurrent file-transfer functions.
+//
+// These functions run transfers on a pool of worker threads, each thread tasking one transfer at a time;
+// the size of the pool is the limit on the number of transfers under way at once. They must be called on
+// the main thread.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTDR_SetMaxConcurrentTransfers
+// Set the number of transfers that QTDR_QueueTransfer lets run at once; the rest wait their turn.
+// This returns paramErr once the first transfer has been queued, until QTDR_ReleaseTransferWorkers.
+//
+//////////
+
+OSErr QTDR_SetMaxConcurrentTransfers (long theMaxTransfers)
+{
+	if ((theMaxTransfers < 1) || (theMaxTransfers > kMaxTransferWorkers))
+		return(paramErr);
+		
+	if (gNumTransferWorkers > 0)
+		return(paramErr);
+		
+	gMaxConcurrentTransfers = theMaxTransfers;
+	
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDR_QueueTransfer
+// Run the specified transfer on a worker thread, as soon as one is free. When the transfer is done
+// (or cancelled before it could start), theDoneProc is called on the main thread.
+//
+// Don't dispose of the transfer until theDoneProc has been called.
+//
+//////////
+
+OSErr QTDR_QueueTransfer (QTDRTransferPtr theTransfer, QTDRTransferDoneProcPtr theDoneProc, void *theRefCon)
+{
+	WorkerRequestRef	myRequest = NULL;
+	long				myIndex;
+	long				myWorker = 0;
+	OSErr				myErr = noErr;
+	
+	if ((theTransfer == NULL) || (theTransfer->request != NULL))
+		return(paramErr);
+		
+	// create the worker threads the first time they're needed
+	while (gNumTransferWorkers < gMaxConcurrentTransfers) {
+		myErr = createWorkerThread(QTDR_TransferActionRoutine, QTDR_TransferCancelRoutine, QTDR_TransferResponseCallback, NULL, &gTransferWorkers[gNumTransferWorkers]);
+		if (myErr != noErr)
+			break;
+		gNumTransferWorkers++;
+	}
+	
+	if (gNumTransferWorkers == 0)
+		return(myErr);
+		
+	// give the transfer to the worker with the fewest transfers waiting
+	for (myIndex = 1; myIndex < gNumTransferWorkers; myIndex++)
+		if (gNumTransfersQueued[myIndex] < gNumTransfersQueued[myWorker])
+			myWorker = myIndex;
+			
+	myErr = createWorkerRequest(gTransferWorkers[myWorker], &myRequest);
+	if (myErr != noErr)
+		return(myErr);
+		
+	setWorkerRequestThreadData(myRequest, theTransfer);
+	
+	theTransfer->doneProc = theDoneProc;
+	theTransfer->doneRefCon = theRefCon;
+	theTransfer->request = myRequest;
+	theTransfer->worker = myWorker;
+	gNumTransfersQueued[myWorker]++;
+	
+	myErr = sendWorkerRequest(myRequest);
+	if (myErr != noErr) {
+		gNumTransfersQueued[myWorker]--;
+		theTransfer->request = NULL;
+		releaseWorkerRequest(myRequest);
+	}
+	
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDR_ReleaseTransferWorkers
+// Release the worker threads that run queued transfers; each one goes away once its queue is empty.
+//
+//////////
+
+void QTDR_ReleaseTransferWorkers (void)
+{
+	long		myIndex;
+	
+	for (myIndex = 0; myIndex < gNumTransferWorkers; myIndex++) {
+		releaseWorkerThread(gTransferWorkers[myIndex]);
+		gTransferWorkers[myIndex] = NULL;
+		gNumTransfersQueued[myIndex] = 0;
+	}
+	
+	gNumTransferWorkers = 0;
+}
+
+
+//////////
+//
+// QTDR_TransferActionRoutine
+// Run a queued transfer; this is called on a worker thread.
+//
+//////////
+
+static void QTDR_TransferActionRoutine (void *theRefCon, WorkerRequestRef theRequest)
+{
+#pragma unused(theRefCon)
+
+	QTDRTransferPtr		myTransfer = NULL;
+	
+	if (getWorkerRequestThreadData(theRequest, (void **)&myTransfer) == noErr)
+		QTDR_RunTransfer(myTransfer);
+}
+
+
+//////////
+//
+// QTDR_TransferCancelRoutine
+// Cancel a queued transfer that's already running; this is called on the main thread.
+//
+//////////
+
+static void QTDR_TransferCancelRoutine (void *theRefCon, WorkerRequestRef theRequest)
+{
+#pragma unused(theRefCon)
+
+	QTDRTransferPtr		myTransfer = NULL;
+	
+	if (getWorkerRequestThreadData(theRequest, (void **)&myTransfer) == noErr)
+		myTransfer->cancelled = true;
+}
+
+
+//////////
+//
+// QTDR_TransferResponseCallback
+// Tell the client that a queued transfer is done; this is called on the main thread.
+//
+//////////
+
+static void QTDR_TransferResponseCallback (void *theRefCon, WorkerRequestRef theRequest)
+{
+#pragma unused(theRefCon)
+
+	QTDRTransferPtr		myTransfer = NULL;
+	
+	getWorkerRequestThreadData(theRequest, (void **)&myTransfer);
+	if (myTransfer != NULL) {
+		gNumTransfersQueued[myTransfer->worker]--;
+		
+		// a transfer cancelled before it started was never run at all
+		if (wasWorkerRequestCancelled(theRequest) && !myTransfer->done) {
+			myTransfer->err = userCanceledErr;
+			myTransfer->done = true;
+		}
+		
+		myTransfer->request = NULL;
+	}
+	
+	releaseWorkerRequest(theRequest);
+	
+	if ((myTransfer != NULL) && (myTransfer->doneProc != NULL))
+		(*myTransfer->doneProc)(myTransfer, myTransfer->doneRefCon);
+}
+#endif // QTDR_USE_WORKER_THREADS
+
+
 //////////
 //
 // QTDR_TimerProc
@@ -803,6 +2267,7 @@ void CALLBACK QTDR_TimerProc (HWND theWnd, UINT theMessage, UINT theID, DWORD th
 #endif
 
 
+#if QTDR_SAMPLE_APPLICATION
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // Other functions.
@@ -1311,6 +2776,7 @@ bail:
 	if (myImporter != NULL)
 		CloseComponent(myImporter);
 } 
+#endif // QTDR_SAMPLE_APPLICATION
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
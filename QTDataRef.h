@@ -6,7 +6,7 @@
 //
 //	Written by:	QuickTime Engineering
 //
-//	Copyright:	 2000-2003 by Apple Computer, Inc., all rights reserved.
+//	Copyright:	© 2000-2003 by Apple Computer, Inc., all rights reserved.
 //
 //	Change History (most recent first):
 //	   
@@ -16,7 +16,12 @@
 
 #pragma once
 
+#ifdef __APPLE_CC__
+#include <Carbon/Carbon.h>
+#include <QuickTime/QuickTime.h>
+#else
 #include <Movies.h>
+#endif
 
 #include <string.h>
 #include <stdlib.h>
@@ -24,20 +29,41 @@
 
 //////////
 //
-// header files
+// compiler flags
 //
 //////////
 
-#include "ComApplication.h"
+#define USE_ADDEMPTYTRACKTOMOVIE	0			// do we use AddEmptyTrackTOMovie when building a reference movie file?
+
+// the URL dialog and the movie-building functions need the application framework (ComApplication) of the
+// sample this file came from; ThreadsImportMovie has no such framework, and builds only the rest
+#ifndef QTDR_SAMPLE_APPLICATION
+#define QTDR_SAMPLE_APPLICATION		0
+#endif
+
+// QTDR_QueueTransfer runs transfers on the pthreads in WorkerThread.c, which there are none of on Windows
+#ifndef QTDR_USE_WORKER_THREADS
+#define QTDR_USE_WORKER_THREADS		(!TARGET_OS_WIN32)
+#endif
 
 
 //////////
 //
-// compiler flags
+// header files
 //
 //////////
 
-#define USE_ADDEMPTYTRACKTOMOVIE	0			// do we use AddEmptyTrackTOMovie when building a reference movie file?
+#if QTDR_SAMPLE_APPLICATION
+#include "ComApplication.h"
+#endif
+#if QTDR_USE_WORKER_THREADS
+#include "WorkerThread.h"
+#endif
+
+// ComApplication.h defines this when the sample's framework is built in
+#ifndef PASCAL_RTN
+#define PASCAL_RTN					pascal
+#endif
 
 
 //////////
@@ -72,13 +98,29 @@
 
 #define kURLSeparator				(char)'/'		// URL path separator
 
-#define kDataBufferSize				1024*10			// the size, in bytes, of our data buffer
+#define kDataBufferSize				1024*64			// the default size, in bytes, of each of our data buffers
+#define kNumDataBuffers				4				// the default number of data buffers
+#define kMaxDataBuffers				32				// the most data buffers a transfer can use
+#define kNumTransferStreams			4				// the default number of streams a transfer fetches a big file with
+#define kMaxTransferStreams			8				// the most streams a transfer can use
+#define kMinRangedTransferSize		(1024*1024*4)	// files smaller than this are fetched by one stream
+#define kNumTransferWorkers			8				// the default number of transfers QTDR_QueueTransfer runs at once
+#define kMaxTransferWorkers			32				// the most transfers QTDR_QueueTransfer runs at once
 
 // type and creator for the transferred file
 #define kTransFileType				FOUR_CHAR_CODE('TEXT')
 #define kTransFileCreator			FOUR_CHAR_CODE('CWIE')
 
+// a transfer's checkpoint file, which records the chunks it has written so that it can be resumed
+#define kCheckpointFileType			FOUR_CHAR_CODE('QTDc')
+#define kCheckpointSignature		FOUR_CHAR_CODE('QTDc')
+#define kCheckpointVersion			2				// 2 has 64-bit sizes and a sample of the data
+#define kCheckpointSuffix			".qtdc"
+#define kCheckpointMaxNameLength	31				// the longest HFS file name
+#define kCheckpointInterval			64				// how many chunks a transfer writes between checkpoints
+
 #define kQTDR_TimeOut				10
+#define kQTDR_TaskInterval			1000			// how long, in microseconds, QTDR_RunTransfer waits between taskings
 
 #define kVideoTimeScale 			600							// 600 units per second
 #define kVideoFrameDuration 		kVideoTimeScale/10			// each frame is 1/10 second
@@ -93,23 +135,104 @@
 #define kPICTFileHeaderSize			512
 
 
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTDRTransferRecord		QTDRTransferRecord, *QTDRTransferPtr;
+
+// called on the main thread when a transfer sent to QTDR_QueueTransfer is done
+typedef void (*QTDRTransferDoneProcPtr) (QTDRTransferPtr theTransfer, void *theRefCon);
+
+// one of the buffers that a file transfer cycles between reading and writing
+typedef struct QTDRDataBufferRecord {
+	QTDRTransferPtr			transfer;				// the transfer the buffer belongs to
+	long					stream;					// the stream the buffer reads from
+	Ptr						data;					// the buffer itself
+	SInt64					offset;					// the offset in the file of the data in the buffer
+	long					size;					// the number of bytes of data in the buffer
+} QTDRDataBufferRecord;
+
+// the start of a checkpoint file; it's followed by the URL (without a terminating null), and then by
+// one bit for each chunk of the file, set if the chunk has been written. The URL data handler can't tell
+// us when the remote file was last modified, so the checkpoint keeps a checksum of one chunk that was
+// written instead; a resumed copy fetches that chunk again, and starts over if it has changed
+typedef struct QTDRCheckpointHeader {
+	OSType					signature;				// kCheckpointSignature
+	SInt32					version;				// kCheckpointVersion
+	SInt64					fileSize;				// the size of the remote file
+	SInt32					chunkSize;				// the size of each chunk (the transfer's buffer size)
+	SInt32					urlLength;				// the length of the URL that follows
+	SInt64					sampleOffset;			// the offset of the chunk the checksum is of
+	SInt32					sampleSize;				// its size, or 0 if no chunk had been written
+	UInt32					sampleChecksum;			// its checksum
+} QTDRCheckpointHeader;
+
+// one connection to the remote file, which reads one byte range of it
+typedef struct QTDRStreamRecord {
+	ComponentInstance		reader;					// the data handler that reads this range from the URL
+	SInt64					nextByteToRead;			// the offset of the next chunk to read
+	SInt64					endOfRange;				// the offset just past the end of the range
+} QTDRStreamRecord;
+
+// everything about one copy of a remote file into a local file
+struct QTDRTransferRecord {
+	char *					url;					// the remote file
+	FSSpec					file;					// the local file
+	Handle					readerRef;				// data reference for the remote file
+	Handle					writerRef;				// data reference for the local file
+	QTDRStreamRecord		streams[kMaxTransferStreams];	// the connections to the remote file
+	long					numStreams;				// the number of streams in use
+	Boolean					fellBack;				// did we fall back to a single stream?
+	ComponentInstance		writer;					// the data handler that writes data to the file
+	DataHCompletionUPP		readUPP;
+	DataHCompletionUPP		writeUPP;
+	QTDRDataBufferRecord	buffers[kMaxDataBuffers];
+	long					numBuffers;
+	long					bufferSize;
+	SInt64					bytesToTransfer;		// the number of bytes to transfer
+	SInt64					bytesTransferred;		// the number of bytes already transferred
+	SInt64					bytesResumed;			// the bytes of those an earlier, interrupted copy wrote
+	long					numRequestsInFlight;	// the number of buffers with a read or write not yet completed
+	FSSpec					checkpointFile;			// the file that records which chunks are done
+	UInt8 *					chunkMap;				// one bit for each chunk of the file, set once it's written
+	long					numChunks;
+	long					numChunksSinceCheckpoint;
+	SInt64					sampleOffset;			// the chunk the checkpoint keeps a checksum of
+	long					sampleSize;
+	UInt32					sampleChecksum;
+	SInt64					wantedNextByte;			// the next chunk of the range someone is waiting for
+	SInt64					wantedEndOfRange;		// the offset just past the end of that range
+	OSErr					err;					// the first error reported by a read or write
+	UnsignedWide			startTime;				// when the transfer started, in microseconds
+	UnsignedWide			endTime;				// when it finished
+	volatile Boolean		done;					// are we done transferring data?
+	volatile Boolean		cancelled;				// should we stop?
+	QTDRTransferDoneProcPtr	doneProc;				// the rest are used by QTDR_QueueTransfer
+	void *					doneRefCon;
+	void *					request;				// the worker request, until it's done
+	long					worker;					// the worker it was given to
+};
+
+
 //////////
 //
 // function prototypes
 //
 //////////
 
-Handle							QTDR_MakeFileDataRef (FSSpecPtr theFile);
 Handle							QTDR_MakeResourceDataRef (FSSpecPtr theFile, OSType theResType, SInt16 theResID);
-Handle							QTDR_MakeHandleDataRef (Handle theHandle);
-Handle							QTDR_MakeURLDataRef (char *theURL);
 
 Movie							QTDR_GetMovieFromFile (FSSpecPtr theFile);
 Movie							QTDR_GetMovieFromResource (FSSpecPtr theFile, OSType theResType, SInt16 theResID);
 Movie							QTDR_GetMovieFromHandle (Handle theHandle);
 Movie							QTDR_GetMovieFromURL (char *theURL);
 
+#if QTDR_SAMPLE_APPLICATION
 char *							QTDR_GetURLFromUser (short thePromptStringIndex);
+#endif
 char *							QTDR_GetURLBasename (char *theURL);
 
 OSErr							QTDR_AddFilenamingExtension (Handle theDataRef, StringPtr theFileName);
@@ -117,20 +240,43 @@ OSErr							QTDR_AddMacOSFileTypeDataRefExtension (Handle theDataRef, OSType the
 OSErr							QTDR_AddMIMETypeDataRefExtension (Handle theDataRef, StringPtr theMIMEType);
 OSErr							QTDR_AddInitDataDataRefExtension (Handle theDataRef, Ptr theInitDataPtr);
 
+OSErr							QTDR_NewTransfer (char *theURL, FSSpecPtr theFile, QTDRTransferPtr *theTransfer);
+OSErr							QTDR_StartTransfer (QTDRTransferPtr theTransfer);
+Boolean							QTDR_TaskTransfer (QTDRTransferPtr theTransfer);
+OSErr							QTDR_RunTransfer (QTDRTransferPtr theTransfer);
+void							QTDR_CancelTransfer (QTDRTransferPtr theTransfer);
+void							QTDR_GetTransferProgress (QTDRTransferPtr theTransfer, SInt64 *theBytesTransferred, SInt64 *theBytesToTransfer);
+Boolean							QTDR_IsTransferDone (QTDRTransferPtr theTransfer);
+OSErr							QTDR_GetTransferError (QTDRTransferPtr theTransfer);
+Float64							QTDR_GetTransferThroughput (QTDRTransferPtr theTransfer);
+void							QTDR_CloseTransfer (QTDRTransferPtr theTransfer);
+void							QTDR_DisposeTransfer (QTDRTransferPtr theTransfer);
 OSErr							QTDR_CopyRemoteFileToLocalFile (char *theURL, FSSpecPtr theFile);
 PASCAL_RTN void					QTDR_ReadDataCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr);
 PASCAL_RTN void					QTDR_WriteDataCompletionProc (Ptr theRequest, long theRefCon, OSErr theErr);
+OSErr							QTDR_SetTransferStreams (long theNumStreams);
+OSErr							QTDR_SetTransferBuffers (long theNumBuffers, long theBufferSize);
 void							QTDR_CloseDownHandlers (void);
+Boolean							QTDR_IsRangeTransferred (QTDRTransferPtr theTransfer, SInt64 theOffset, SInt64 theSize);
+void							QTDR_RequestTransferRange (QTDRTransferPtr theTransfer, SInt64 theOffset, SInt64 theSize);
+OSErr							QTDR_WaitForTransferRange (QTDRTransferPtr theTransfer, SInt64 theOffset, SInt64 theSize);
+OSErr							QTDR_GetMovieFromTransfer (QTDRTransferPtr theTransfer, Movie *theMovie);
+OSErr							QTDR_WaitForMovieTime (QTDRTransferPtr theTransfer, Movie theMovie, TimeValue theTime);
+#if QTDR_USE_WORKER_THREADS
+OSErr							QTDR_SetMaxConcurrentTransfers (long theMaxTransfers);
+OSErr							QTDR_QueueTransfer (QTDRTransferPtr theTransfer, QTDRTransferDoneProcPtr theDoneProc, void *theRefCon);
+void							QTDR_ReleaseTransferWorkers (void);
+#endif
 #if TARGET_OS_WIN32
 void CALLBACK					QTDR_TimerProc (HWND theWnd, UINT theMessage, UINT theID, DWORD theTime);
 #endif
 
+#if QTDR_SAMPLE_APPLICATION
 OSErr							QTDR_CreateReferenceCopy (Movie theSrcMovie, FSSpecPtr theDstMovieFile, FSSpecPtr theDstMediaFile);
 OSErr							QTDR_PlayMovieFromRAM (Movie theMovie);
 
 OSErr							QTDR_CreateMovieInRAM (void);
 OSErr							QTDR_CreateTrackInRAM (Movie theMovie);
-static OSErr					QTDR_AddVideoSamplesToMedia (Media theMedia, short theTrackWidth, short theTrackHeight);
-static void						QTDR_DrawFrame (short theTrackWidth, short theTrackHeight, long theNumSample, GWorldPtr theGWorld);
+#endif
 
 Boolean							QTDR_IsMovieSelfContained (Movie theMovie);
@@ -0,0 +1,116 @@
+/*
+	File:		ContentSnifferTest.c
+
+	Description: Table-driven checks of ContentSniffer_SniffBytes against the first bytes of the
+				kinds of file a movie folder holds, including the XML-based QuickTime formats that
+				must be left for QuickTime to decide about.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ContentSniffer.h"
+
+#define FOURCC		CONTENT_SNIFFER_FOURCC
+#define NO_MATCH	0
+
+typedef struct {
+	const char			*name;
+	const char			*bytes;
+	size_t				length;			// 0 means strlen(bytes)
+	int					kind;			// NO_MATCH if ContentSniffer_SniffBytes must return NULL
+	uint32_t			fileType;
+	const char			*mimeType;
+} SniffCase;
+
+static const SniffCase gCases[] = {
+	// QuickTime and ISO files
+	{ "QuickTime ftyp",		"\x00\x00\x00\x14" "ftypqt  \x20\x05\x03\x00", 16, kContentSnifferMovie, FOURCC('M','o','o','V'), "video/quicktime" },
+	{ "QuickTime moov",		"\x00\x00\x10\x00" "moov\x00\x00\x00\x6Cmvhd", 16, kContentSnifferMovie, FOURCC('M','o','o','V'), "video/quicktime" },
+	{ "QuickTime wide",		"\x00\x00\x00\x08" "wide\x00\x10\x00\x00mdat", 16, kContentSnifferMovie, FOURCC('M','o','o','V'), "video/quicktime" },
+	{ "MPEG-4 isom",		"\x00\x00\x00\x18" "ftypisom\x00\x00\x02\x00", 16, kContentSnifferMovie, FOURCC('m','p','g','4'), "video/mp4" },
+	{ "MPEG-4 audio",		"\x00\x00\x00\x20" "ftypM4A \x00\x00\x00\x00", 16, kContentSnifferAudio, FOURCC('M','4','A',' '), "audio/x-m4a" },
+	{ "3GPP",				"\x00\x00\x00\x14" "ftyp3gp4\x00\x00\x00\x00", 16, kContentSnifferMovie, FOURCC('3','g','p','p'), "video/3gpp" },
+
+	// RIFF, IFF and MPEG
+	{ "AVI",				"RIFF\x00\x10\x00\x00" "AVI LIST", 16, kContentSnifferMovie, FOURCC('V','f','W',' '), "video/avi" },
+	{ "WAVE",				"RIFF\x24\x00\x00\x00" "WAVEfmt ", 16, kContentSnifferAudio, FOURCC('W','A','V','E'), "audio/wav" },
+	{ "AIFF",				"FORM\x00\x00\x10\x00" "AIFFCOMM", 16, kContentSnifferAudio, FOURCC('A','I','F','F'), "audio/aiff" },
+	{ "RIFF other",			"RIFF\x00\x10\x00\x00" "RMIDdata", 16, NO_MATCH, 0, NULL },
+	{ "MPEG program",		"\x00\x00\x01\xBA\x44\x00\x04\x00", 8, kContentSnifferMovie, FOURCC('M','P','E','G'), "video/mpeg" },
+	{ "MP3 with ID3",		"ID3\x03\x00\x00\x00\x00", 8, kContentSnifferAudio, FOURCC('M','P','3',' '), "audio/mpeg" },
+	{ "MP3 frame",			"\xFF\xFB\x90\x64", 4, kContentSnifferAudio, FOURCC('M','P','3',' '), "audio/mpeg" },
+
+	// still images
+	{ "JPEG",				"\xFF\xD8\xFF\xE0\x00\x10JFIF", 10, kContentSnifferImage, FOURCC('J','P','E','G'), "image/jpeg" },
+	{ "PNG",				"\x89PNG\r\n\x1A\n\x00\x00\x00\x0DIHDR", 16, kContentSnifferImage, FOURCC('P','N','G','f'), "image/png" },
+	{ "GIF",				"GIF89a\x10\x00", 8, kContentSnifferImage, FOURCC('G','I','F','f'), "image/gif" },
+	{ "TIFF",				"MM\x00*\x00\x00\x00\x08", 8, kContentSnifferImage, FOURCC('T','I','F','F'), "image/tiff" },
+
+	// not media
+	{ "PDF",				"%PDF-1.4\n", 0, kContentSnifferNotMedia, 0, "application/pdf" },
+	{ "zip",				"PK\x03\x04\x14\x00", 6, kContentSnifferNotMedia, 0, "application/zip" },
+	{ "RTF",				"{\\rtf1\\ansi", 0, kContentSnifferNotMedia, 0, "text/rtf" },
+
+	// XML-based QuickTime formats are left to QuickTime, as is any other XML
+	{ "QuickTime media link", "<?xml version=\"1.0\"?>\n<?quicktime type=\"application/x-quicktime-media-link\"?>\n<embed src=\"movie.mov\" />\n", 0, NO_MATCH, 0, NULL },
+	{ "SMIL with XML header", "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<smil xmlns=\"http://www.w3.org/2001/SMIL20/Language\">\n", 0, NO_MATCH, 0, NULL },
+	{ "SMIL",				"<smil>\n<head>\n</head>\n", 0, NO_MATCH, 0, NULL },
+	{ "plain XML",			"<?xml version=\"1.0\"?>\n<plist version=\"1.0\">\n", 0, NO_MATCH, 0, NULL },
+
+	// too short, or nothing we know
+	{ "empty",				"", 0, NO_MATCH, 0, NULL },
+	{ "short ftyp",			"\x00\x00\x00\x14" "fty", 7, NO_MATCH, 0, NULL },
+	{ "text",				"Hello, world\n", 0, NO_MATCH, 0, NULL }
+};
+
+int main (void)
+{
+	const ContentSnifferMatch	*myMatch;
+	unsigned char				myHead[kContentSnifferHeadSize];
+	int							myFailures = 0;
+	size_t						myIndex;
+
+	for (myIndex = 0; myIndex < sizeof(gCases) / sizeof(gCases[0]); myIndex++) {
+		const SniffCase		*myCase = &gCases[myIndex];
+		size_t				myLength = (myCase->length != 0) ? myCase->length : strlen(myCase->bytes);
+
+		memcpy(myHead, myCase->bytes, myLength);
+		myMatch = ContentSniffer_SniffBytes(myHead, myLength);
+
+		if (myCase->kind == NO_MATCH) {
+			if (myMatch != NULL) {
+				printf("FAIL %s: expected no match, got %s\n", myCase->name, myMatch->description);
+				myFailures++;
+			}
+		} else if (myMatch == NULL) {
+			printf("FAIL %s: expected %s, got no match\n", myCase->name, myCase->mimeType);
+			myFailures++;
+		} else if ((myMatch->kind != myCase->kind) || (myMatch->fileType != myCase->fileType) || (strcmp(myMatch->mimeType, myCase->mimeType) != 0)) {
+			printf("FAIL %s: expected %s, got %s (%s)\n", myCase->name, myCase->mimeType, myMatch->mimeType, myMatch->description);
+			myFailures++;
+		}
+	}
+
+	// a transport stream needs its second sync byte, 188 bytes in
+	memset(myHead, 0, sizeof(myHead));
+	myHead[0] = 0x47;
+	if (ContentSniffer_SniffBytes(myHead, 188) != NULL) {
+		printf("FAIL transport stream: matched without a second sync byte\n");
+		myFailures++;
+	}
+	myHead[188] = 0x47;
+	myMatch = ContentSniffer_SniffBytes(myHead, 189);
+	if ((myMatch == NULL) || (strcmp(myMatch->mimeType, "video/mp2t") != 0)) {
+		printf("FAIL transport stream: not matched\n");
+		myFailures++;
+	}
+
+	if (ContentSniffer_SniffBytes(NULL, 16) != NULL) {
+		printf("FAIL NULL head: matched\n");
+		myFailures++;
+	}
+
+	printf("ContentSnifferTest: %d cases, %d failures\n", (int)(sizeof(gCases) / sizeof(gCases[0])) + 3, myFailures);
+	return(myFailures == 0 ? 0 : 1);
+}
@@ -0,0 +1,207 @@
+/*
+	File:		DataRefTest.c
+
+	Description: Checks that QTDR_MakeHandleDataRefWithExtensions and QTDR_MakePointerDataRefWithExtensions
+				build, byte for byte, the data references that importTheMovie used to build by making the
+				bare data reference and then adding each extension (see TN1195) with PtrAndHand, for every
+				combination of file name, file type and MIME type. Run with -bench to time the two against
+				each other; the handles here come from MacStubs.c, which grows a handle with realloc, so the
+				Memory Manager's cost of moving a handle isn't measured, only that of the extra calls.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DataRefUtilities.h"
+
+// a Pascal string, spelled out since gcc and clang don't know \p
+static unsigned char gMIMEType[] = "\017video/quicktime";
+
+static const char *gFileNames[] = { NULL, "", "dog.mov", "a file name that goes on for quite a while, as some do.mov" };
+static const OSType gFileTypes[] = { 0, 'MooV' };
+static const StringPtr gMIMETypes[] = { NULL, gMIMEType };
+
+#define kNumFileNames		(sizeof(gFileNames) / sizeof(gFileNames[0]))
+#define kNumFileTypes		(sizeof(gFileTypes) / sizeof(gFileTypes[0]))
+#define kNumMIMETypes		(sizeof(gMIMETypes) / sizeof(gMIMETypes[0]))
+
+static int gFailures = 0;
+static long gChecks = 0;
+
+static void Check (Boolean theCondition, const char *theWhat)
+{
+	gChecks++;
+	if (!theCondition) {
+		printf("FAIL %s\n", theWhat);
+		gFailures++;
+	}
+}
+
+//////////
+//
+// AddExtensionsByChain
+// Add the extensions to theDataRef one PtrAndHand call at a time, as importTheMovie used to.
+//
+//////////
+
+static OSErr AddExtensionsByChain (Handle theDataRef, const char *theFileName, OSType theFileType, StringPtr theMIMEType)
+{
+	UInt8		myLength = 0;
+	UInt32		myAtom[3];
+	OSErr		myErr = noErr;
+
+	if (theFileName != NULL) {
+		// add a filenaming extension
+		myLength = (UInt8)strlen(theFileName);
+		myErr = PtrAndHand(&myLength, theDataRef, 1);
+		if (myErr == noErr)
+			myErr = PtrAndHand(theFileName, theDataRef, myLength);
+	} else if ((theFileType != 0) || (theMIMEType != NULL)) {
+		// when adding other extensions file name must be included even if it's just empty
+		myErr = PtrAndHand(&myLength, theDataRef, sizeof(myLength));
+	}
+	if (myErr != noErr)
+		return(myErr);
+
+	if (theFileType != 0) {
+		// add a file type extension
+		myAtom[0] = EndianU32_NtoB(sizeof(UInt32) * 3);
+		myAtom[1] = EndianU32_NtoB(kDataRefExtensionMacOSFileType);
+		myAtom[2] = EndianU32_NtoB(theFileType);
+		myErr = PtrAndHand(myAtom, theDataRef, sizeof(UInt32) * 3);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	if (theMIMEType != NULL) {
+		// add a MIME type extension
+		myAtom[0] = EndianU32_NtoB(sizeof(UInt32) * 2 + theMIMEType[0] + 1);
+		myAtom[1] = EndianU32_NtoB(kDataRefExtensionMIMEType);
+		myErr = PtrAndHand(myAtom, theDataRef, sizeof(UInt32) * 2);
+		if (myErr == noErr)
+			myErr = PtrAndHand(theMIMEType, theDataRef, theMIMEType[0] + 1);
+	}
+
+	return(myErr);
+}
+
+static Handle MakeHandleDataRefByChain (Handle theHandle, const char *theFileName, OSType theFileType, StringPtr theMIMEType)
+{
+	Handle		myDataRef = QTDR_MakeHandleDataRef(theHandle);
+
+	if ((myDataRef != NULL) && (AddExtensionsByChain(myDataRef, theFileName, theFileType, theMIMEType) != noErr)) {
+		DisposeHandle(myDataRef);
+		myDataRef = NULL;
+	}
+
+	return(myDataRef);
+}
+
+static Handle MakePointerDataRefByChain (void *thePtr, Size theLength, const char *theFileName, OSType theFileType, StringPtr theMIMEType)
+{
+	Handle		myDataRef = QTDR_MakePointerDataRef(thePtr, theLength);
+
+	if ((myDataRef != NULL) && (AddExtensionsByChain(myDataRef, theFileName, theFileType, theMIMEType) != noErr)) {
+		DisposeHandle(myDataRef);
+		myDataRef = NULL;
+	}
+
+	return(myDataRef);
+}
+
+static Boolean SameHandles (Handle theHandle1, Handle theHandle2)
+{
+	if ((theHandle1 == NULL) || (theHandle2 == NULL))
+		return(false);
+
+	return((GetHandleSize(theHandle1) == GetHandleSize(theHandle2)) &&
+		   (memcmp(*theHandle1, *theHandle2, GetHandleSize(theHandle1)) == 0));
+}
+
+static int RunChecks (void)
+{
+	Handle		myMovieHandle = NewHandle(1024);
+	char		myMovieBytes[1024];
+	Handle		myChain, myOnce;
+	size_t		myName, myType, myMIME;
+	char		myWhat[256];
+
+	for (myName = 0; myName < kNumFileNames; myName++) {
+		for (myType = 0; myType < kNumFileTypes; myType++) {
+			for (myMIME = 0; myMIME < kNumMIMETypes; myMIME++) {
+				const char		*myFileName = gFileNames[myName];
+				OSType			myFileType = gFileTypes[myType];
+				StringPtr		myMIMEType = gMIMETypes[myMIME];
+
+				snprintf(myWhat, sizeof(myWhat), "handle data ref, name %s, type %s, MIME type %s",
+						 (myFileName != NULL) ? myFileName : "(none)", myFileType ? "MooV" : "(none)", myMIMEType ? "video/quicktime" : "(none)");
+				myChain = MakeHandleDataRefByChain(myMovieHandle, myFileName, myFileType, myMIMEType);
+				myOnce = QTDR_MakeHandleDataRefWithExtensions(myMovieHandle, myFileName, myFileType, myMIMEType);
+				Check(SameHandles(myChain, myOnce), myWhat);
+				DisposeHandle(myChain);
+				DisposeHandle(myOnce);
+
+				snprintf(myWhat, sizeof(myWhat), "pointer data ref, name %s, type %s, MIME type %s",
+						 (myFileName != NULL) ? myFileName : "(none)", myFileType ? "MooV" : "(none)", myMIMEType ? "video/quicktime" : "(none)");
+				myChain = MakePointerDataRefByChain(myMovieBytes, sizeof(myMovieBytes), myFileName, myFileType, myMIMEType);
+				myOnce = QTDR_MakePointerDataRefWithExtensions(myMovieBytes, sizeof(myMovieBytes), myFileName, myFileType, myMIMEType);
+				Check(SameHandles(myChain, myOnce), myWhat);
+				DisposeHandle(myChain);
+				DisposeHandle(myOnce);
+			}
+		}
+	}
+
+	DisposeHandle(myMovieHandle);
+
+	printf("DataRefTest: %ld checks, %d failures\n", gChecks, gFailures);
+	return(gFailures);
+}
+
+static double TimeDataRefs (Boolean theChain, Boolean thePointer, int theIterations)
+{
+	static char		myMovieBytes[1024];
+	Handle			myMovieHandle = NewHandle(sizeof(myMovieBytes));
+	clock_t			myStart = clock();
+	int				myIteration;
+	Handle			myDataRef;
+
+	for (myIteration = 0; myIteration < theIterations; myIteration++) {
+		if (thePointer)
+			myDataRef = theChain ? MakePointerDataRefByChain(myMovieBytes, sizeof(myMovieBytes), gFileNames[2], 'MooV', gMIMEType)
+								 : QTDR_MakePointerDataRefWithExtensions(myMovieBytes, sizeof(myMovieBytes), gFileNames[2], 'MooV', gMIMEType);
+		else
+			myDataRef = theChain ? MakeHandleDataRefByChain(myMovieHandle, gFileNames[2], 'MooV', gMIMEType)
+								 : QTDR_MakeHandleDataRefWithExtensions(myMovieHandle, gFileNames[2], 'MooV', gMIMEType);
+		DisposeHandle(myDataRef);
+	}
+
+	DisposeHandle(myMovieHandle);
+	return((double)(clock() - myStart) / CLOCKS_PER_SEC / theIterations * 1000000000.0);
+}
+
+static void RunBenchmark (void)
+{
+	const int	kIterations = 2000000;
+	double		myChain, myOnce;
+	int			myPointer;
+
+	printf("%-32s %12s %12s %8s\n", "data ref, name + type + MIME", "chain ns", "once ns", "speedup");
+	for (myPointer = 0; myPointer <= 1; myPointer++) {
+		myChain = TimeDataRefs(true, myPointer, kIterations);
+		myOnce = TimeDataRefs(false, myPointer, kIterations);
+		printf("%-32s %12.1f %12.1f %7.2fx\n", myPointer ? "pointer" : "handle", myChain, myOnce, myOnce > 0 ? myChain / myOnce : 0.0);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	if ((argc > 1) && (strcmp(argv[1], "-bench") == 0)) {
+		RunBenchmark();
+		return(0);
+	}
+
+	return(RunChecks() == 0 ? 0 : 1);
+}
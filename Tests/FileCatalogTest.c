@@ -0,0 +1,122 @@
+/*
+	File:		FileCatalogTest.c
+
+	Description: Checks the URLs FileCatalog_MakeURLs and FileCatalog_MakeURLsWithBase make for
+				a catalog of files in more than one folder: file URLs of the full path names, or
+				the base URL followed by each file's encoded name, which is what a server of the
+				folder the file was found in (such as StandInServer.py) serves it as.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FileCatalog.h"
+
+typedef struct {
+	const char			*folder;
+	const char			*name;
+	const char			*fileURL;
+	const char			*baseURL;		// with gBase
+} CatalogCase;
+
+static const char *gBase = "http://127.0.0.1:8000//";
+
+static const CatalogCase gCases[] = {
+	{ "/Movies",			"dog.mov",			"file:///Movies/dog.mov",						"http://127.0.0.1:8000/dog.mov" },
+	{ "/Movies/Summer",		"my dog.mov",		"file:///Movies/Summer/my%20dog.mov",			"http://127.0.0.1:8000/my%20dog.mov" },
+	{ "/Volumes/Big Disk",	"100% #1.mp4",		"file:///Volumes/Big%20Disk/100%25%20%231.mp4",	"http://127.0.0.1:8000/100%25%20%231.mp4" }
+};
+
+#define kNumCases		(sizeof(gCases) / sizeof(gCases[0]))
+
+static int gFailures = 0;
+static long gChecks = 0;
+
+static void CheckString (const char *theGot, const char *theExpected, const char *theWhat)
+{
+	gChecks++;
+	if ((theGot == NULL) || (strcmp(theGot, theExpected) != 0)) {
+		printf("FAIL %s: expected \"%s\", got \"%s\"\n", theWhat, theExpected, (theGot != NULL) ? theGot : "(null)");
+		gFailures++;
+	}
+}
+
+static void Check (Boolean theCondition, const char *theWhat)
+{
+	gChecks++;
+	if (!theCondition) {
+		printf("FAIL %s\n", theWhat);
+		gFailures++;
+	}
+}
+
+//////////
+//
+// MakeCatalog
+// Return a new catalog of the files in gCases, or NULL if it couldn't be made.
+//
+//////////
+
+static FileCatalogRef MakeCatalog (void)
+{
+	FileCatalogRef		myCatalog = NULL;
+	UInt32				myIndex;
+	UInt32				myEntry;
+
+	if (FileCatalog_Create(&myCatalog) != noErr)
+		return(NULL);
+
+	for (myIndex = 0; myIndex < kNumCases; myIndex++) {
+		if ((FileCatalog_AddFile(myCatalog, gCases[myIndex].folder, gCases[myIndex].name, &myEntry) != noErr) || (myEntry != myIndex)) {
+			FileCatalog_Release(myCatalog);
+			return(NULL);
+		}
+	}
+
+	return(myCatalog);
+}
+
+int main (void)
+{
+	FileCatalogRef		myCatalog;
+	UInt32				myIndex;
+
+	// file URLs, one at a time and all at once
+	myCatalog = MakeCatalog();
+	Check(myCatalog != NULL, "make the catalog");
+	if (myCatalog != NULL) {
+		Check(FileCatalog_GetCount(myCatalog) == kNumCases, "count");
+		for (myIndex = 0; myIndex < kNumCases; myIndex++) {
+			CheckString(FileCatalog_GetFileName(myCatalog, myIndex), gCases[myIndex].name, "file name");
+			CheckString(FileCatalog_GetURL(myCatalog, myIndex), gCases[myIndex].fileURL, "file URL, made when asked for");
+		}
+		FileCatalog_Release(myCatalog);
+	}
+
+	myCatalog = MakeCatalog();
+	if (myCatalog != NULL) {
+		Check(FileCatalog_MakeURLsWithBase(myCatalog, NULL) == noErr, "make file URLs");
+		for (myIndex = 0; myIndex < kNumCases; myIndex++)
+			CheckString(FileCatalog_GetURL(myCatalog, myIndex), gCases[myIndex].fileURL, "file URL, made all at once");
+		FileCatalog_Release(myCatalog);
+	}
+
+	// URLs relative to the base, named by the file, not by its path; the base's trailing slashes are dropped
+	myCatalog = MakeCatalog();
+	if (myCatalog != NULL) {
+		Check(FileCatalog_MakeURLsWithBase(myCatalog, gBase) == noErr, "make URLs with a base");
+		for (myIndex = 0; myIndex < kNumCases; myIndex++)
+			CheckString(FileCatalog_GetURL(myCatalog, myIndex), gCases[myIndex].baseURL, "URL with a base");
+		FileCatalog_Release(myCatalog);
+	}
+
+	// an empty catalog has no URLs to make
+	if (FileCatalog_Create(&myCatalog) == noErr) {
+		Check(FileCatalog_MakeURLsWithBase(myCatalog, gBase) == noErr, "make URLs for an empty catalog");
+		Check(FileCatalog_GetURL(myCatalog, 0) == NULL, "no URL past the end");
+		FileCatalog_Release(myCatalog);
+	}
+
+	printf("FileCatalogTest: %ld checks, %d failures\n", gChecks, gFailures);
+	return(gFailures == 0 ? 0 : 1);
+}
@@ -0,0 +1,225 @@
+/*
+	File:		ImageScaleTest.c
+
+	Description: Checks that ImageScale_Box32 (the vector loop, where there is one) gives exactly
+				the same pixels as ImageScale_Box32Reference over a spread of sizes, pitches and
+				random contents, and that sources too big for 32-bit sums still average exactly.
+				Run with -bench to time the two against each other at the sizes the thumbnail path
+				actually uses; the CopyBits path they replace needs QuickDraw, so the application
+				times that (see -scalebench in BatchImport.h).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ImageScale.h"
+
+static unsigned long gSeed = 1;
+
+static UInt32 NextRandom (void)
+{
+	gSeed = gSeed * 1103515245 + 12345;
+	return((UInt32)(gSeed >> 16) & 0x7FFF);
+}
+
+static void FillRandom (UInt8 *theBytes, size_t theSize)
+{
+	size_t		myIndex;
+
+	for (myIndex = 0; myIndex < theSize; myIndex++)
+		theBytes[myIndex] = NextRandom() & 0xFF;
+}
+
+// shrink a flat source of one color to a single pixel with both loops; more than kMaxPixelsPerSum source pixels
+// fold into it, so the sums have to be flushed along the way. Returns the number of failures
+static int CheckHugeSource (UInt32 theSrcWidth, UInt32 theSrcHeight)
+{
+	static const UInt8	kColor[4] = { 0x10, 0x80, 0xFF, 0x01 };
+	UInt8		*mySrc = malloc((size_t)theSrcWidth * theSrcHeight * 4);
+	UInt8		myVector[4] = { 0 }, myScalar[4] = { 0 };
+	size_t		myIndex;
+	int			myFailures = 0;
+
+	if (mySrc == NULL) {
+		printf("FAIL %ux%u -> 1x1: no memory for the source\n", theSrcWidth, theSrcHeight);
+		return(1);
+	}
+
+	for (myIndex = 0; myIndex < (size_t)theSrcWidth * theSrcHeight; myIndex++)
+		memcpy(mySrc + myIndex * 4, kColor, 4);
+
+	if ((ImageScale_Box32(mySrc, theSrcWidth * 4, theSrcWidth, theSrcHeight, myVector, 4, 1, 1) != noErr) ||
+		(ImageScale_Box32Reference(mySrc, theSrcWidth * 4, theSrcWidth, theSrcHeight, myScalar, 4, 1, 1) != noErr)) {
+		printf("FAIL %ux%u -> 1x1: resample returned an error\n", theSrcWidth, theSrcHeight);
+		myFailures++;
+	} else if ((memcmp(myVector, kColor, 4) != 0) || (memcmp(myScalar, kColor, 4) != 0)) {
+		printf("FAIL %ux%u -> 1x1: got %02x%02x%02x%02x and %02x%02x%02x%02x\n", theSrcWidth, theSrcHeight,
+				myVector[0], myVector[1], myVector[2], myVector[3], myScalar[0], myScalar[1], myScalar[2], myScalar[3]);
+		myFailures++;
+	}
+
+	free(mySrc);
+	return(myFailures);
+}
+
+// resample one source with both loops and compare; returns the number of mismatches
+static int CompareOne (UInt32 theSrcWidth, UInt32 theSrcHeight, UInt32 theDstWidth, UInt32 theDstHeight, UInt32 thePad, Boolean theSaturate)
+{
+	long		mySrcRowBytes = theSrcWidth * 4 + thePad * 4;
+	long		myDstRowBytes = theDstWidth * 4 + thePad * 4;
+	UInt8		*mySrc = malloc(mySrcRowBytes * theSrcHeight);
+	UInt8		*myVector = malloc(myDstRowBytes * theDstHeight);
+	UInt8		*myScalar = malloc(myDstRowBytes * theDstHeight);
+	UInt32		myRow;
+	int			myFailures = 0;
+
+	if (theSaturate)
+		memset(mySrc, 0xFF, mySrcRowBytes * theSrcHeight);
+	else
+		FillRandom(mySrc, mySrcRowBytes * theSrcHeight);
+	memset(myVector, 0xAA, myDstRowBytes * theDstHeight);
+	memset(myScalar, 0xAA, myDstRowBytes * theDstHeight);
+
+	if ((ImageScale_Box32(mySrc, mySrcRowBytes, theSrcWidth, theSrcHeight, myVector, myDstRowBytes, theDstWidth, theDstHeight) != noErr) ||
+		(ImageScale_Box32Reference(mySrc, mySrcRowBytes, theSrcWidth, theSrcHeight, myScalar, myDstRowBytes, theDstWidth, theDstHeight) != noErr)) {
+		printf("FAIL %ux%u -> %ux%u: resample returned an error\n", theSrcWidth, theSrcHeight, theDstWidth, theDstHeight);
+		myFailures++;
+		goto bail;
+	}
+
+	// only the pixels count; the padding must be left alone by both
+	for (myRow = 0; myRow < theDstHeight; myRow++) {
+		if (memcmp(myVector + myRow * myDstRowBytes, myScalar + myRow * myDstRowBytes, myDstRowBytes) != 0) {
+			printf("FAIL %ux%u -> %ux%u pad %u: row %u differs\n", theSrcWidth, theSrcHeight, theDstWidth, theDstHeight, thePad, myRow);
+			myFailures++;
+			break;
+		}
+	}
+
+	// a flat white source has to come out flat white, whichever loop did it
+	if (theSaturate) {
+		for (myRow = 0; myRow < theDstHeight; myRow++) {
+			UInt32		myByte;
+
+			for (myByte = 0; myByte < theDstWidth * 4; myByte++)
+				if (myVector[myRow * myDstRowBytes + myByte] != 0xFF)
+					break;
+			if (myByte < theDstWidth * 4) {
+				printf("FAIL %ux%u -> %ux%u: white source is not white\n", theSrcWidth, theSrcHeight, theDstWidth, theDstHeight);
+				myFailures++;
+				break;
+			}
+		}
+	}
+
+bail:
+	free(myScalar);
+	free(myVector);
+	free(mySrc);
+	return(myFailures);
+}
+
+static int RunChecks (void)
+{
+	static const UInt32	kSizes[][4] = {
+		{ 1, 1, 1, 1 }, { 2, 2, 1, 1 }, { 3, 1, 1, 1 }, { 7, 5, 2, 3 },
+		{ 640, 480, 80, 60 }, { 640, 480, 160, 120 }, { 720, 486, 96, 64 },
+		{ 1920, 1080, 128, 72 }, { 1280, 720, 133, 75 }, { 33, 17, 32, 16 },
+		{ 100, 100, 100, 100 }, { 100, 100, 150, 150 }, { 5, 5, 13, 9 }
+	};
+	int			myFailures = 0;
+	int			myCount = 0;
+	size_t		myIndex;
+	int			myTrial;
+
+	// the interesting fixed cases: exact multiples, odd spans, upscales, and a flat white source at the largest size
+	for (myIndex = 0; myIndex < sizeof(kSizes) / sizeof(kSizes[0]); myIndex++) {
+		myFailures += CompareOne(kSizes[myIndex][0], kSizes[myIndex][1], kSizes[myIndex][2], kSizes[myIndex][3], 0, false);
+		myFailures += CompareOne(kSizes[myIndex][0], kSizes[myIndex][1], kSizes[myIndex][2], kSizes[myIndex][3], 3, false);
+		myCount += 2;
+	}
+	myFailures += CompareOne(4096, 64, 3, 1, 0, true);
+	myCount++;
+
+	// more pixels in one destination pixel than a 32-bit sum holds: a big square frame, and a tall thin one
+	myFailures += CompareOne(4200, 4200, 1, 1, 0, true);
+	myFailures += CheckHugeSource(4200, 4200);
+	myFailures += CheckHugeSource(64, 300000);
+	myCount += 3;
+
+	// and a few hundred random ones
+	for (myTrial = 0; myTrial < 400; myTrial++) {
+		UInt32		mySrcWidth = 1 + NextRandom() % 300;
+		UInt32		mySrcHeight = 1 + NextRandom() % 200;
+		UInt32		myDstWidth = 1 + NextRandom() % 160;
+		UInt32		myDstHeight = 1 + NextRandom() % 120;
+
+		myFailures += CompareOne(mySrcWidth, mySrcHeight, myDstWidth, myDstHeight, NextRandom() % 4, false);
+		myCount++;
+	}
+
+	// bad arguments are refused by both
+	if (ImageScale_Box32(NULL, 4, 1, 1, &gSeed, 4, 1, 1) != paramErr) {
+		printf("FAIL: NULL source accepted\n");
+		myFailures++;
+	}
+
+	printf("ImageScaleTest: %d comparisons, %d failures (%s loop)\n", myCount, myFailures, ImageScale_IsVectorized() ? "vector" : "scalar");
+	return(myFailures);
+}
+
+static double TimeResample (Boolean theVector, const UInt8 *theSrc, UInt32 theSrcWidth, UInt32 theSrcHeight, UInt8 *theDst, UInt32 theDstWidth, UInt32 theDstHeight, int theIterations)
+{
+	clock_t		myStart = clock();
+	int			myIteration;
+
+	for (myIteration = 0; myIteration < theIterations; myIteration++) {
+		if (theVector)
+			ImageScale_Box32(theSrc, theSrcWidth * 4, theSrcWidth, theSrcHeight, theDst, theDstWidth * 4, theDstWidth, theDstHeight);
+		else
+			ImageScale_Box32Reference(theSrc, theSrcWidth * 4, theSrcWidth, theSrcHeight, theDst, theDstWidth * 4, theDstWidth, theDstHeight);
+	}
+
+	return((double)(clock() - myStart) / CLOCKS_PER_SEC / theIterations * 1000.0);
+}
+
+static void RunBenchmark (void)
+{
+	static const UInt32	kSizes[][4] = {
+		{ 640, 480, 160, 120 }, { 720, 486, 96, 64 }, { 1280, 720, 160, 90 }, { 1920, 1080, 128, 72 }, { 1920, 1080, 480, 270 }
+	};
+	size_t		myIndex;
+
+	printf("%-24s %12s %12s %8s\n", "resample", "scalar ms", "vector ms", "speedup");
+	for (myIndex = 0; myIndex < sizeof(kSizes) / sizeof(kSizes[0]); myIndex++) {
+		UInt32		mySrcWidth = kSizes[myIndex][0], mySrcHeight = kSizes[myIndex][1];
+		UInt32		myDstWidth = kSizes[myIndex][2], myDstHeight = kSizes[myIndex][3];
+		UInt8		*mySrc = malloc(mySrcWidth * mySrcHeight * 4);
+		UInt8		*myDst = malloc(myDstWidth * myDstHeight * 4);
+		int			myIterations = (int)(200000000.0 / (mySrcWidth * mySrcHeight)) + 1;
+		double		myScalar, myVector;
+		char		myLabel[32];
+
+		FillRandom(mySrc, mySrcWidth * mySrcHeight * 4);
+		myScalar = TimeResample(false, mySrc, mySrcWidth, mySrcHeight, myDst, myDstWidth, myDstHeight, myIterations);
+		myVector = TimeResample(true, mySrc, mySrcWidth, mySrcHeight, myDst, myDstWidth, myDstHeight, myIterations);
+
+		snprintf(myLabel, sizeof(myLabel), "%ux%u -> %ux%u", mySrcWidth, mySrcHeight, myDstWidth, myDstHeight);
+		printf("%-24s %12.3f %12.3f %7.2fx\n", myLabel, myScalar, myVector, myVector > 0 ? myScalar / myVector : 0.0);
+
+		free(myDst);
+		free(mySrc);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	if ((argc > 1) && (strcmp(argv[1], "-bench") == 0)) {
+		RunBenchmark();
+		return(0);
+	}
+
+	return(RunChecks() == 0 ? 0 : 1);
+}
@@ -0,0 +1,1488 @@
+/*
+	File:		MacStubs.c
+
+	Description: Portable stand-ins for the Memory Manager, QuickDraw, File Manager and
+				QuickTime calls the code under test links against. Handles and pointers are
+				malloc'd blocks with the size in front. The File Manager works on real files,
+				each FSSpec naming a file in the current directory. There are two data handlers:
+				one for files, and one for URLs that reads file:// URLs from the disk and talks
+				HTTP/1.1 (with byte ranges and keep-alive) to a stand-in server for http:// URLs;
+				both complete their requests in DataHTask, in random order. The queues, semaphores
+				and event loop timers are enough for WorkerThread.c to run. QuickDraw isn't
+				reached by the tests, so those calls just stop the program. The only movies are
+				the stand-in movie files described in MacStubs.h, opened through file data
+				references; the Movie Toolbox calls fail for anything else.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <Carbon/Carbon.h>
+#include <QuickTime/QuickTime.h>
+
+#include "MacStubs.h"
+
+typedef struct {
+	Ptr			master;			// must be first, so a Handle is a pointer to it
+	Size		size;
+} StubHandleRecord;
+
+typedef union {
+	Size		size;
+	long double	align;			// so the block after the header is aligned for anything
+} StubPtrHeader;
+
+static OSErr gMemError = noErr;
+
+#pragma mark-
+
+//////////
+//
+// memory
+//
+//////////
+
+Handle NewHandle (Size theSize)
+{
+	StubHandleRecord	*myRecord = malloc(sizeof(StubHandleRecord));
+
+	gMemError = memFullErr;
+	if (myRecord == NULL)
+		return(NULL);
+
+	myRecord->master = malloc(theSize > 0 ? theSize : 1);
+	if (myRecord->master == NULL) {
+		free(myRecord);
+		return(NULL);
+	}
+
+	myRecord->size = theSize;
+	gMemError = noErr;
+	return((Handle)myRecord);
+}
+
+Handle NewHandleClear (Size theSize)
+{
+	Handle				myHandle = NewHandle(theSize);
+
+	if (myHandle != NULL)
+		memset(*myHandle, 0, theSize);
+
+	return(myHandle);
+}
+
+void DisposeHandle (Handle theHandle)
+{
+	if (theHandle != NULL) {
+		free(*theHandle);
+		free(theHandle);
+	}
+}
+
+Size GetHandleSize (Handle theHandle)
+{
+	return(((StubHandleRecord *)theHandle)->size);
+}
+
+void SetHandleSize (Handle theHandle, Size theSize)
+{
+	StubHandleRecord	*myRecord = (StubHandleRecord *)theHandle;
+	Ptr					myMaster = realloc(myRecord->master, theSize > 0 ? theSize : 1);
+
+	gMemError = memFullErr;
+	if (myMaster != NULL) {
+		myRecord->master = myMaster;
+		myRecord->size = theSize;
+		gMemError = noErr;
+	}
+}
+
+OSErr MemError (void)
+{
+	return(gMemError);
+}
+
+void HLock (Handle theHandle)
+{
+	(void)theHandle;
+}
+
+void HUnlock (Handle theHandle)
+{
+	(void)theHandle;
+}
+
+OSErr PtrToHand (const void *theSrc, Handle *theHandle, long theSize)
+{
+	*theHandle = NewHandle(theSize);
+	if (*theHandle == NULL)
+		return(memFullErr);
+
+	memcpy(**theHandle, theSrc, theSize);
+	return(noErr);
+}
+
+OSErr HandToHand (Handle *theHandle)
+{
+	return(PtrToHand(**theHandle, theHandle, GetHandleSize(*theHandle)));
+}
+
+void BlockMove (const void *theSrc, void *theDst, Size theSize)
+{
+	memmove(theDst, theSrc, theSize);
+}
+
+void BlockMoveData (const void *theSrc, void *theDst, Size theSize)
+{
+	memmove(theDst, theSrc, theSize);
+}
+
+Ptr NewPtr (Size theSize)
+{
+	StubPtrHeader		*myHeader = malloc(sizeof(StubPtrHeader) + (theSize > 0 ? theSize : 1));
+
+	gMemError = memFullErr;
+	if (myHeader == NULL)
+		return(NULL);
+
+	myHeader->size = theSize;
+	gMemError = noErr;
+	return((Ptr)(myHeader + 1));
+}
+
+Ptr NewPtrClear (Size theSize)
+{
+	Ptr					myPtr = NewPtr(theSize);
+
+	if (myPtr != NULL)
+		memset(myPtr, 0, theSize);
+
+	return(myPtr);
+}
+
+void DisposePtr (Ptr thePtr)
+{
+	if (thePtr != NULL)
+		free((StubPtrHeader *)thePtr - 1);
+}
+
+Size GetPtrSize (Ptr thePtr)
+{
+	return(((StubPtrHeader *)thePtr - 1)->size);
+}
+
+OSErr PtrAndHand (const void *thePtr, Handle theHandle, long theSize)
+{
+	Size				myOldSize = GetHandleSize(theHandle);
+
+	SetHandleSize(theHandle, myOldSize + theSize);
+	if (gMemError != noErr)
+		return(gMemError);
+
+	memcpy(*theHandle + myOldSize, thePtr, theSize);
+	return(noErr);
+}
+
+#pragma mark-
+
+//////////
+//
+// time
+//
+//////////
+
+void Microseconds (UnsignedWide *theMicroseconds)
+{
+	struct timeval		myTime;
+	UInt64				myMicroseconds;
+
+	gettimeofday(&myTime, NULL);
+	myMicroseconds = (UInt64)myTime.tv_sec * 1000000 + myTime.tv_usec;
+	theMicroseconds->hi = (UInt32)(myMicroseconds >> 32);
+	theMicroseconds->lo = (UInt32)myMicroseconds;
+}
+
+UInt64 UnsignedWideToUInt64 (UnsignedWide theValue)
+{
+	return(((UInt64)theValue.hi << 32) | theValue.lo);
+}
+
+wide SInt64ToWide (SInt64 theValue)
+{
+	wide				myWide;
+
+	myWide.hi = (SInt32)(theValue >> 32);
+	myWide.lo = (UInt32)theValue;
+	return(myWide);
+}
+
+SInt64 WideToSInt64 (wide theValue)
+{
+	return((SInt64)(((UInt64)(UInt32)theValue.hi << 32) | theValue.lo));
+}
+
+#pragma mark-
+
+//////////
+//
+// queues, atomic operations, semaphores and event loop timers
+//
+// One lock makes the queue and bit operations atomic with respect to each other, which is all that
+// WorkerThread.c asks of them. A timer can be armed on any thread, and fires on whichever thread is
+// in RunCurrentEventLoop, which stands in for the main thread.
+//
+//////////
+
+struct OpaqueMPSemaphoreID {
+	pthread_mutex_t				lock;
+	pthread_cond_t				signalled;
+	MPSemaphoreCount			value;
+	MPSemaphoreCount			maximum;
+};
+
+struct OpaqueEventLoopTimerRef {
+	EventLoopTimerUPP			proc;
+	void						*userData;
+	Boolean						armed;
+	UInt64						fireTime;			// in microseconds, if armed
+	EventLoopTimerRef			next;
+};
+
+static pthread_mutex_t			gAtomicLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t			gEventLoopLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t			gEventLoopChanged = PTHREAD_COND_INITIALIZER;
+static EventLoopTimerRef		gTimers = NULL;
+static EventLoopTimerRef		gFiringTimer = NULL;
+static Boolean					gQuitEventLoop = false;
+static int						gMainEventLoop;
+
+static UInt64 StubNow (void)
+{
+	UnsignedWide		myTime;
+
+	Microseconds(&myTime);
+	return(UnsignedWideToUInt64(myTime));
+}
+
+void Enqueue (QElemPtr theElement, QHdrPtr theQueue)
+{
+	pthread_mutex_lock(&gAtomicLock);
+	theElement->qLink = NULL;
+	if (theQueue->qTail != NULL)
+		theQueue->qTail->qLink = theElement;
+	else
+		theQueue->qHead = theElement;
+	theQueue->qTail = theElement;
+	pthread_mutex_unlock(&gAtomicLock);
+}
+
+OSErr Dequeue (QElemPtr theElement, QHdrPtr theQueue)
+{
+	QElemPtr			myPrevious = NULL;
+	QElemPtr			myElement;
+	OSErr				myErr = qErr;
+
+	pthread_mutex_lock(&gAtomicLock);
+	for (myElement = theQueue->qHead; myElement != NULL; myPrevious = myElement, myElement = myElement->qLink) {
+		if (myElement == theElement) {
+			if (myPrevious != NULL)
+				myPrevious->qLink = myElement->qLink;
+			else
+				theQueue->qHead = myElement->qLink;
+			if (theQueue->qTail == myElement)
+				theQueue->qTail = myPrevious;
+			myErr = noErr;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&gAtomicLock);
+
+	return(myErr);
+}
+
+// set or clear a bit, returning its old value; the bits are numbered from the high bit of the first byte, as on the 68K
+static Boolean StubChangeBit (UInt32 theBit, void *theAddress, Boolean theSet)
+{
+	UInt8				*myByte = (UInt8 *)theAddress + (theBit >> 3);
+	UInt8				myMask = 0x80 >> (theBit & 7);
+	Boolean				myWasSet;
+
+	pthread_mutex_lock(&gAtomicLock);
+	myWasSet = ((*myByte & myMask) != 0);
+	if (theSet)
+		*myByte |= myMask;
+	else
+		*myByte &= ~myMask;
+	pthread_mutex_unlock(&gAtomicLock);
+
+	return(myWasSet);
+}
+
+Boolean TestAndSet (UInt32 theBit, void *theAddress)			{ return(StubChangeBit(theBit, theAddress, true)); }
+Boolean TestAndClear (UInt32 theBit, void *theAddress)			{ return(StubChangeBit(theBit, theAddress, false)); }
+SInt32 IncrementAtomic (SInt32 *theValue)						{ return(__sync_fetch_and_add(theValue, 1)); }
+SInt32 DecrementAtomic (SInt32 *theValue)						{ return(__sync_fetch_and_sub(theValue, 1)); }
+OSErr Gestalt (OSType theSelector, long *theResponse)			{ (void)theSelector; *theResponse = 0x1030; return(noErr); }
+
+// an ordinary compiler makes a \p string literal into a C string that starts with a 'p'
+void DebugStr (ConstStr255Param theMessage)
+{
+	fprintf(stderr, "DebugStr: %s\n", (const char *)theMessage + 1);
+}
+
+OSStatus MPCreateSemaphore (MPSemaphoreCount theMaximumValue, MPSemaphoreCount theInitialValue, MPSemaphoreID *theSemaphore)
+{
+	MPSemaphoreID		mySemaphore = calloc(1, sizeof(struct OpaqueMPSemaphoreID));
+
+	*theSemaphore = mySemaphore;
+	if (mySemaphore == NULL)
+		return(memFullErr);
+
+	pthread_mutex_init(&mySemaphore->lock, NULL);
+	pthread_cond_init(&mySemaphore->signalled, NULL);
+	mySemaphore->value = theInitialValue;
+	mySemaphore->maximum = theMaximumValue;
+	return(noErr);
+}
+
+OSStatus MPDeleteSemaphore (MPSemaphoreID theSemaphore)
+{
+	pthread_cond_destroy(&theSemaphore->signalled);
+	pthread_mutex_destroy(&theSemaphore->lock);
+	free(theSemaphore);
+	return(noErr);
+}
+
+// signalling a semaphore that's already at its maximum leaves it there
+OSStatus MPSignalSemaphore (MPSemaphoreID theSemaphore)
+{
+	pthread_mutex_lock(&theSemaphore->lock);
+	if (theSemaphore->value < theSemaphore->maximum)
+		theSemaphore->value++;
+	pthread_cond_signal(&theSemaphore->signalled);
+	pthread_mutex_unlock(&theSemaphore->lock);
+	return(noErr);
+}
+
+// only waiting forever, or not at all, is supported
+OSStatus MPWaitOnSemaphore (MPSemaphoreID theSemaphore, Duration theTimeout)
+{
+	OSStatus			myErr = noErr;
+
+	pthread_mutex_lock(&theSemaphore->lock);
+	while ((theSemaphore->value == 0) && (theTimeout == kDurationForever))
+		pthread_cond_wait(&theSemaphore->signalled, &theSemaphore->lock);
+	if (theSemaphore->value > 0)
+		theSemaphore->value--;
+	else
+		myErr = kMPTimeoutErr;
+	pthread_mutex_unlock(&theSemaphore->lock);
+
+	return(myErr);
+}
+
+EventLoopTimerUPP NewEventLoopTimerUPP (EventLoopTimerProcPtr theProc)	{ return(theProc); }
+void DisposeEventLoopTimerUPP (EventLoopTimerUPP theUPP)		{ (void)theUPP; }
+EventLoopRef GetMainEventLoop (void)							{ return((EventLoopRef)&gMainEventLoop); }
+
+OSStatus InstallEventLoopTimer (EventLoopRef theLoop, EventTimerInterval theFireDelay, EventTimerInterval theInterval, EventLoopTimerUPP theProc, void *theUserData, EventLoopTimerRef *theTimer)
+{
+	EventLoopTimerRef	myTimer = calloc(1, sizeof(struct OpaqueEventLoopTimerRef));
+
+	(void)theLoop;
+	(void)theInterval;						// the stand-in timers are all one-shot
+	*theTimer = myTimer;
+	if (myTimer == NULL)
+		return(memFullErr);
+
+	myTimer->proc = theProc;
+	myTimer->userData = theUserData;
+
+	pthread_mutex_lock(&gEventLoopLock);
+	myTimer->next = gTimers;
+	gTimers = myTimer;
+	pthread_mutex_unlock(&gEventLoopLock);
+
+	return(SetEventLoopTimerNextFireTime(myTimer, theFireDelay));
+}
+
+OSStatus SetEventLoopTimerNextFireTime (EventLoopTimerRef theTimer, EventTimerInterval theNextFire)
+{
+	pthread_mutex_lock(&gEventLoopLock);
+	theTimer->armed = (theNextFire >= 0);
+	theTimer->fireTime = StubNow() + (UInt64)(theNextFire * 1000000.0);
+	pthread_cond_broadcast(&gEventLoopChanged);
+	pthread_mutex_unlock(&gEventLoopLock);
+	return(noErr);
+}
+
+// a timer can be removed on another thread while it's firing, so wait for it to finish
+OSStatus RemoveEventLoopTimer (EventLoopTimerRef theTimer)
+{
+	EventLoopTimerRef	*myLink;
+
+	pthread_mutex_lock(&gEventLoopLock);
+	while (gFiringTimer == theTimer)
+		pthread_cond_wait(&gEventLoopChanged, &gEventLoopLock);
+	for (myLink = &gTimers; *myLink != NULL; myLink = &(*myLink)->next) {
+		if (*myLink == theTimer) {
+			*myLink = theTimer->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&gEventLoopLock);
+
+	free(theTimer);
+	return(noErr);
+}
+
+// fire the timers as they come due, until the timeout passes or someone calls QuitEventLoop
+OSStatus RunCurrentEventLoop (EventTimeout theTimeout)
+{
+	UInt64				myDeadline = (theTimeout < 0) ? 0 : StubNow() + (UInt64)(theTimeout * 1000000.0);
+	UInt64				myNow, myWakeTime;
+	EventLoopTimerRef	myTimer;
+	struct timespec		myTimeSpec;
+	OSStatus			myErr;
+
+	pthread_mutex_lock(&gEventLoopLock);
+	while (true) {
+		if (gQuitEventLoop) {
+			gQuitEventLoop = false;
+			myErr = eventLoopQuitErr;
+			break;
+		}
+
+		myNow = StubNow();
+		myWakeTime = myDeadline;
+		for (myTimer = gTimers; myTimer != NULL; myTimer = myTimer->next) {
+			if (myTimer->armed && (myTimer->fireTime <= myNow))
+				break;
+			if (myTimer->armed && ((myWakeTime == 0) || (myTimer->fireTime < myWakeTime)))
+				myWakeTime = myTimer->fireTime;
+		}
+
+		if (myTimer != NULL) {
+			myTimer->armed = false;
+			gFiringTimer = myTimer;
+			pthread_mutex_unlock(&gEventLoopLock);
+			(*myTimer->proc)(myTimer, myTimer->userData);
+			pthread_mutex_lock(&gEventLoopLock);
+			gFiringTimer = NULL;
+			pthread_cond_broadcast(&gEventLoopChanged);
+			continue;
+		}
+
+		if ((theTimeout >= 0) && (myNow >= myDeadline)) {
+			myErr = eventLoopTimedOutErr;
+			break;
+		}
+
+		if (myWakeTime == 0) {
+			pthread_cond_wait(&gEventLoopChanged, &gEventLoopLock);
+		} else {
+			myTimeSpec.tv_sec = myWakeTime / 1000000;
+			myTimeSpec.tv_nsec = (myWakeTime % 1000000) * 1000;
+			pthread_cond_timedwait(&gEventLoopChanged, &gEventLoopLock, &myTimeSpec);
+		}
+	}
+	pthread_mutex_unlock(&gEventLoopLock);
+
+	return(myErr);
+}
+
+OSStatus QuitEventLoop (EventLoopRef theLoop)
+{
+	(void)theLoop;
+
+	pthread_mutex_lock(&gEventLoopLock);
+	gQuitEventLoop = true;
+	pthread_cond_broadcast(&gEventLoopChanged);
+	pthread_mutex_unlock(&gEventLoopLock);
+	return(noErr);
+}
+
+#pragma mark-
+
+//////////
+//
+// QuickDraw
+//
+//////////
+
+static void NotAvailable (const char *theName)
+{
+	fprintf(stderr, "%s is not available in the test build\n", theName);
+	abort();
+}
+
+PixMapHandle GetGWorldPixMap (GWorldPtr theGWorld)				{ (void)theGWorld; NotAvailable("GetGWorldPixMap"); return(NULL); }
+short GetPixDepth (PixMapHandle thePixMap)						{ (void)thePixMap; NotAvailable("GetPixDepth"); return(0); }
+Rect *GetPortBounds (CGrafPtr thePort, Rect *theRect)			{ (void)thePort; NotAvailable("GetPortBounds"); return(theRect); }
+GWorldFlags GetPixelsState (PixMapHandle thePixMap)				{ (void)thePixMap; NotAvailable("GetPixelsState"); return(0); }
+void SetPixelsState (PixMapHandle thePixMap, GWorldFlags theState)	{ (void)thePixMap; (void)theState; NotAvailable("SetPixelsState"); }
+Boolean LockPixels (PixMapHandle thePixMap)						{ (void)thePixMap; NotAvailable("LockPixels"); return(false); }
+Ptr GetPixBaseAddr (PixMapHandle thePixMap)						{ (void)thePixMap; NotAvailable("GetPixBaseAddr"); return(NULL); }
+long GetPixRowBytes (PixMapHandle thePixMap)					{ (void)thePixMap; NotAvailable("GetPixRowBytes"); return(0); }
+
+
+#pragma mark-
+
+//////////
+//
+// File Manager
+//
+// An FSSpec names a file in the current directory (its vRefNum and parID are ignored), and a file
+// reference number is a file descriptor.
+//
+//////////
+
+static char *StubFSSpecPath (const FSSpec *theSpec, char *thePath)
+{
+	memcpy(thePath, &theSpec->name[1], theSpec->name[0]);
+	thePath[theSpec->name[0]] = '\0';
+	return(thePath);
+}
+
+static OSErr StubErrnoToOSErr (int theErrno)
+{
+	switch (theErrno) {
+		case ENOENT:	return(fnfErr);
+		case EEXIST:	return(dupFNErr);
+		case ENOMEM:	return(memFullErr);
+		default:		return(ioErr);
+	}
+}
+
+OSErr PBGetCatInfoSync (CInfoPBRec *thePB)						{ (void)thePB; return(fnfErr); }
+
+// an FSSpec can't name a file by its full path, so there are no FSRefs
+OSErr FSPathMakeRef (const UInt8 *thePath, FSRef *theRef, Boolean *theIsDirectory)
+{
+	(void)thePath; (void)theRef; (void)theIsDirectory;
+	return(fnfErr);
+}
+
+OSErr FSGetCatalogInfo (const FSRef *theRef, UInt32 theWhichInfo, void *theCatalogInfo, void *theOutName, FSSpec *theFSSpec, FSRef *theParentRef)
+{
+	(void)theRef; (void)theWhichInfo; (void)theCatalogInfo; (void)theOutName; (void)theFSSpec; (void)theParentRef;
+	return(fnfErr);
+}
+
+OSErr FSMakeFSSpec (short theVRefNum, long theDirID, ConstStr255Param theName, FSSpec *theSpec)
+{
+	char				myPath[64];
+	struct stat			myStat;
+
+	if ((theName == NULL) || (theName[0] == 0) || (theName[0] > 63))
+		return(bdNamErr);
+
+	theSpec->vRefNum = theVRefNum;
+	theSpec->parID = theDirID;
+	memcpy(theSpec->name, theName, theName[0] + 1);
+
+	return((stat(StubFSSpecPath(theSpec, myPath), &myStat) == 0) ? noErr : fnfErr);
+}
+
+OSErr FSpCreate (const FSSpec *theSpec, OSType theCreator, OSType theType, ScriptCode theScript)
+{
+	char				myPath[64];
+	int					myFD;
+
+	(void)theCreator; (void)theType; (void)theScript;
+
+	myFD = open(StubFSSpecPath(theSpec, myPath), O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if (myFD < 0)
+		return(StubErrnoToOSErr(errno));
+
+	close(myFD);
+	return(noErr);
+}
+
+OSErr FSpDelete (const FSSpec *theSpec)
+{
+	char				myPath[64];
+
+	return((unlink(StubFSSpecPath(theSpec, myPath)) == 0) ? noErr : StubErrnoToOSErr(errno));
+}
+
+OSErr FSpGetFInfo (const FSSpec *theSpec, FInfo *theInfo)
+{
+	char				myPath[64];
+	struct stat			myStat;
+
+	if (stat(StubFSSpecPath(theSpec, myPath), &myStat) != 0)
+		return(StubErrnoToOSErr(errno));
+
+	memset(theInfo, 0, sizeof(FInfo));
+	return(noErr);
+}
+
+OSErr FSpOpenDF (const FSSpec *theSpec, SInt8 thePermission, short *theRefNum)
+{
+	char				myPath[64];
+	int					myFD;
+
+	myFD = open(StubFSSpecPath(theSpec, myPath), (thePermission == fsRdPerm) ? O_RDONLY : O_RDWR);
+	if (myFD < 0)
+		return(StubErrnoToOSErr(errno));
+
+	*theRefNum = myFD;
+	return(noErr);
+}
+
+OSErr FSRead (short theRefNum, long *theCount, void *theBuffer)
+{
+	ssize_t				myCount = read(theRefNum, theBuffer, *theCount);
+
+	if (myCount < 0) {
+		*theCount = 0;
+		return(ioErr);
+	}
+
+	if (myCount < *theCount) {
+		*theCount = myCount;
+		return(eofErr);
+	}
+
+	return(noErr);
+}
+
+OSErr FSWrite (short theRefNum, long *theCount, const void *theBuffer)
+{
+	ssize_t				myCount = write(theRefNum, theBuffer, *theCount);
+
+	if (myCount != *theCount) {
+		*theCount = (myCount > 0) ? myCount : 0;
+		return(ioErr);
+	}
+
+	return(noErr);
+}
+
+OSErr FSClose (short theRefNum)
+{
+	return((close(theRefNum) == 0) ? noErr : ioErr);
+}
+
+OSErr GetEOF (short theRefNum, long *theEOF)
+{
+	struct stat			myStat;
+
+	if (fstat(theRefNum, &myStat) != 0)
+		return(ioErr);
+
+	*theEOF = myStat.st_size;
+	return(noErr);
+}
+
+OSErr SetEOF (short theRefNum, long theEOF)
+{
+	return((ftruncate(theRefNum, theEOF) == 0) ? noErr : ioErr);
+}
+
+OSErr GetFPos (short theRefNum, long *thePosition)
+{
+	off_t				myPosition = lseek(theRefNum, 0, SEEK_CUR);
+
+	if (myPosition < 0)
+		return(ioErr);
+
+	*thePosition = myPosition;
+	return(noErr);
+}
+
+OSErr SetFPos (short theRefNum, short theMode, long theOffset)
+{
+	int					myWhence = (theMode == fsFromStart) ? SEEK_SET : (theMode == fsFromLEOF) ? SEEK_END : SEEK_CUR;
+
+	return((lseek(theRefNum, theOffset, myWhence) >= 0) ? noErr : eofErr);
+}
+
+OSErr NewAliasMinimalFromFullPath (short theFullPathLength, const void *theFullPath, ConstStr255Param theZoneName, ConstStr255Param theServerName, AliasHandle *theAlias)
+																{ (void)theFullPathLength; (void)theFullPath; (void)theZoneName; (void)theServerName; *theAlias = NULL; return(fnfErr); }
+OSErr ResolveAlias (const FSSpec *theFromFile, AliasHandle theAlias, FSSpec *theTarget, Boolean *theWasChanged)
+																{ (void)theFromFile; (void)theAlias; (void)theTarget; (void)theWasChanged; return(fnfErr); }
+long Munger (Handle theHandle, long theOffset, const void *thePtr1, long theLength1, const void *thePtr2, long theLength2)
+																{ (void)theHandle; (void)theOffset; (void)thePtr1; (void)theLength1; (void)thePtr2; (void)theLength2; return(-1); }
+
+#pragma mark-
+
+//////////
+//
+// data handlers
+//
+// A file data reference is an alias handle holding the FSSpec. A URL data reference is the URL, with its
+// terminating null. Reads and writes are queued, and each call to DataHTask completes one of the handler's
+// queued requests, chosen at random, so that requests (and the streams of a transfer) finish out of order.
+//
+//////////
+
+struct ComponentRecord {
+	OSType						subType;
+};
+
+typedef struct StubRequest {
+	Ptr							buffer;
+	SInt64						offset;
+	long						size;
+	Boolean						isWrite;
+	DataHCompletionUPP			completion;
+	long						refCon;
+	struct StubRequest			*next;
+} StubRequest;
+
+struct ComponentInstanceRecord {
+	OSType						subType;			// rAliasType or URLDataHandlerSubType
+	FSSpec						file;				// a file data handler's file
+	char						*url;				// a URL data handler's URL
+	int							fd;					// the open file, or the file:// URL's file
+	int							socket;				// the connection to an http:// URL's server
+	char						host[256];
+	char						port[16];
+	char						*path;
+	char						in[16384];			// bytes received but not yet consumed
+	long						inStart;
+	long						inEnd;
+	Boolean						streaming;			// reading a response that isn't a byte range?
+	long						streamRemaining;	// the bytes of that response not yet read
+	long						nextStreamOffset;	// the offset in the file of the next of them
+	Ptr							streamCache;		// the bytes of that response read so far
+	long						streamCacheSize;	// the size of the block allocated for them
+	SInt64						firstReadOffset;	// the offset of the first read queued, or -1
+	StubRequest					*requests;
+	long						numRequests;
+};
+
+static struct ComponentRecord	gFileDataHandler = { rAliasType };
+static struct ComponentRecord	gURLDataHandler = { URLDataHandlerSubType };
+static Boolean					gServesRanges = true;
+static long						gBytesServed = 0;
+static long						gFailAfter = -1;
+static OSErr					gMoviesError = noErr;
+
+void StubURL_SetServesRanges (Boolean theServesRanges)
+{
+	gServesRanges = theServesRanges;
+}
+
+long StubURL_GetBytesServed (void)
+{
+	return(gBytesServed);
+}
+
+void StubURL_SetFailAfter (long theBytes)
+{
+	gFailAfter = theBytes;
+}
+
+OSErr QTNewAlias (const FSSpec *theFile, AliasHandle *theAlias, Boolean theMinimal)
+{
+	Handle				myHandle = NULL;
+	OSErr				myErr;
+
+	(void)theMinimal;
+
+	myErr = PtrToHand(theFile, &myHandle, sizeof(FSSpec));
+	*theAlias = (AliasHandle)myHandle;
+	return(myErr);
+}
+
+Component GetDataHandler (Handle theDataRef, OSType theDataHandlerSubType, long theFlags)
+{
+	(void)theDataRef; (void)theFlags;
+
+	if (theDataHandlerSubType == rAliasType)
+		return(&gFileDataHandler);
+	if (theDataHandlerSubType == URLDataHandlerSubType)
+		return(&gURLDataHandler);
+
+	return(NULL);
+}
+
+ComponentInstance OpenComponent (Component theComponent)
+{
+	ComponentInstance	myHandler;
+
+	if (theComponent == NULL)
+		return(NULL);
+
+	myHandler = calloc(1, sizeof(struct ComponentInstanceRecord));
+	if (myHandler == NULL)
+		return(NULL);
+
+	myHandler->subType = theComponent->subType;
+	myHandler->fd = -1;
+	myHandler->socket = -1;
+	myHandler->firstReadOffset = -1;
+	return(myHandler);
+}
+
+OSErr OpenAComponent (Component theComponent, ComponentInstance *theInstance)
+{
+	*theInstance = OpenComponent(theComponent);
+	return((*theInstance != NULL) ? noErr : badComponentType);
+}
+
+static void StubHTTP_Disconnect (ComponentInstance theHandler)
+{
+	if (theHandler->socket >= 0)
+		close(theHandler->socket);
+
+	theHandler->socket = -1;
+	theHandler->inStart = theHandler->inEnd = 0;
+	theHandler->streaming = false;
+	theHandler->nextStreamOffset = 0;
+	free(theHandler->streamCache);
+	theHandler->streamCache = NULL;
+	theHandler->streamCacheSize = 0;
+}
+
+OSErr CloseComponent (ComponentInstance theInstance)
+{
+	StubRequest			*myRequest;
+
+	if (theInstance == NULL)
+		return(noErr);
+
+	while (theInstance->requests != NULL) {
+		myRequest = theInstance->requests;
+		theInstance->requests = myRequest->next;
+		free(myRequest);
+	}
+
+	if (theInstance->fd >= 0)
+		close(theInstance->fd);
+
+	StubHTTP_Disconnect(theInstance);
+	free(theInstance->url);
+	free(theInstance);
+	return(noErr);
+}
+
+DataHCompletionUPP NewDataHCompletionUPP (DataHCompletionProcPtr theProc)
+{
+	return(theProc);
+}
+
+void DisposeDataHCompletionUPP (DataHCompletionUPP theUPP)
+{
+	(void)theUPP;
+}
+
+ComponentResult DataHSetDataRef (ComponentInstance theHandler, Handle theDataRef)
+{
+	char				*myHost;
+	char				*myPort;
+	char				*myPath;
+
+	if (theHandler->subType == rAliasType) {
+		theHandler->file = *(FSSpec *)*theDataRef;
+		return(noErr);
+	}
+
+	free(theHandler->url);
+	theHandler->url = strdup(*theDataRef);
+	if (theHandler->url == NULL)
+		return(memFullErr);
+
+	// split http://host[:port]/path into its parts
+	if (strncmp(theHandler->url, "http://", 7) == 0) {
+		myHost = theHandler->url + 7;
+		myPath = strchr(myHost, '/');
+		if ((myPath == NULL) || (myPath - myHost >= (long)sizeof(theHandler->host)))
+			return(paramErr);
+
+		memcpy(theHandler->host, myHost, myPath - myHost);
+		theHandler->host[myPath - myHost] = '\0';
+		theHandler->path = myPath;
+
+		strcpy(theHandler->port, "80");
+		myPort = strchr(theHandler->host, ':');
+		if (myPort != NULL) {
+			*myPort++ = '\0';
+			snprintf(theHandler->port, sizeof(theHandler->port), "%s", myPort);
+		}
+	} else if (strncmp(theHandler->url, "file://", 7) != 0) {
+		return(paramErr);
+	}
+
+	return(noErr);
+}
+
+static OSErr StubHTTP_Connect (ComponentInstance theHandler)
+{
+	struct addrinfo		myHints;
+	struct addrinfo		*myAddresses = NULL;
+	int					myOne = 1;
+
+	memset(&myHints, 0, sizeof(myHints));
+	myHints.ai_family = AF_UNSPEC;
+	myHints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(theHandler->host, theHandler->port, &myHints, &myAddresses) != 0)
+		return(fnfErr);
+
+	theHandler->socket = socket(myAddresses->ai_family, myAddresses->ai_socktype, myAddresses->ai_protocol);
+	if ((theHandler->socket >= 0) && (connect(theHandler->socket, myAddresses->ai_addr, myAddresses->ai_addrlen) != 0)) {
+		close(theHandler->socket);
+		theHandler->socket = -1;
+	}
+
+	freeaddrinfo(myAddresses);
+	if (theHandler->socket < 0)
+		return(ioErr);
+
+	setsockopt(theHandler->socket, IPPROTO_TCP, TCP_NODELAY, &myOne, sizeof(myOne));
+	theHandler->inStart = theHandler->inEnd = 0;
+	return(noErr);
+}
+
+// read up to theSize bytes of what the server sent; return the number read, or 0 if the connection closed
+static long StubHTTP_Receive (ComponentInstance theHandler, char *theBuffer, long theSize)
+{
+	ssize_t				myCount;
+
+	if (theHandler->inStart == theHandler->inEnd) {
+		do {
+			myCount = recv(theHandler->socket, theHandler->in, sizeof(theHandler->in), 0);
+		} while ((myCount < 0) && (errno == EINTR));
+
+		if (myCount <= 0)
+			return(0);
+
+		theHandler->inStart = 0;
+		theHandler->inEnd = myCount;
+	}
+
+	if (theSize > theHandler->inEnd - theHandler->inStart)
+		theSize = theHandler->inEnd - theHandler->inStart;
+
+	if (theBuffer != NULL)
+		memcpy(theBuffer, theHandler->in + theHandler->inStart, theSize);
+
+	theHandler->inStart += theSize;
+	return(theSize);
+}
+
+// read exactly theSize bytes of what the server sent, or drop them if theBuffer is NULL
+static OSErr StubHTTP_ReceiveAll (ComponentInstance theHandler, char *theBuffer, long theSize)
+{
+	long				myCount;
+
+	while (theSize > 0) {
+		myCount = StubHTTP_Receive(theHandler, theBuffer, theSize);
+		if (myCount == 0)
+			return(ioErr);
+
+		if (theBuffer != NULL)
+			theBuffer += myCount;
+		theSize -= myCount;
+	}
+
+	return(noErr);
+}
+
+static OSErr StubHTTP_ReceiveLine (ComponentInstance theHandler, char *theLine, long theMaxLength)
+{
+	long				myLength = 0;
+	char				myChar;
+
+	for (;;) {
+		if (StubHTTP_Receive(theHandler, &myChar, 1) == 0)
+			return(ioErr);
+		if (myChar == '\n')
+			break;
+		if ((myChar != '\r') && (myLength < theMaxLength - 1))
+			theLine[myLength++] = myChar;
+	}
+
+	theLine[myLength] = '\0';
+	return(noErr);
+}
+
+// send a request for the handler's URL (for bytes theFirst through theLast, if theFirst isn't negative) and
+// read the headers of the response; if a kept-alive connection turns out to have been closed, try once more
+static OSErr StubHTTP_SendRequest (ComponentInstance theHandler, const char *theMethod, long theFirst, long theLast, int *theStatus, long *theContentLength)
+{
+	char				myRequest[1024];
+	char				myLine[1024];
+	char				myRange[64] = "";
+	long				myLength;
+	long				myTry;
+	OSErr				myErr = ioErr;
+
+	if (theFirst >= 0)
+		snprintf(myRange, sizeof(myRange), "Range: bytes=%ld-%ld\r\n", theFirst, theLast);
+
+	myLength = snprintf(myRequest, sizeof(myRequest), "%s %s HTTP/1.1\r\nHost: %s:%s\r\n%sConnection: keep-alive\r\n\r\n",
+						theMethod, theHandler->path, theHandler->host, theHandler->port, myRange);
+
+	for (myTry = 0; myTry < 2; myTry++) {
+		if (theHandler->socket < 0) {
+			myErr = StubHTTP_Connect(theHandler);
+			if (myErr != noErr)
+				return(myErr);
+		}
+
+		myErr = ioErr;
+		if ((send(theHandler->socket, myRequest, myLength, MSG_NOSIGNAL) == myLength) && (StubHTTP_ReceiveLine(theHandler, myLine, sizeof(myLine)) == noErr)) {
+			myErr = noErr;
+			break;
+		}
+
+		StubHTTP_Disconnect(theHandler);
+	}
+
+	if (myErr != noErr)
+		return(myErr);
+
+	if (sscanf(myLine, "HTTP/%*d.%*d %d", theStatus) != 1)
+		return(ioErr);
+
+	*theContentLength = -1;
+	for (;;) {
+		myErr = StubHTTP_ReceiveLine(theHandler, myLine, sizeof(myLine));
+		if (myErr != noErr)
+			return(myErr);
+		if (myLine[0] == '\0')
+			break;
+		if (strncasecmp(myLine, "Content-Length:", 15) == 0)
+			*theContentLength = atol(myLine + 15);
+	}
+
+	return((*theContentLength >= 0) ? noErr : ioErr);
+}
+
+ComponentResult DataHOpenForRead (ComponentInstance theHandler)
+{
+	char				myPath[64];
+
+	if (theHandler->subType == rAliasType) {
+		theHandler->fd = open(StubFSSpecPath(&theHandler->file, myPath), O_RDONLY);
+		return((theHandler->fd >= 0) ? noErr : StubErrnoToOSErr(errno));
+	}
+
+	if (theHandler->path == NULL) {
+		theHandler->fd = open(theHandler->url + 7, O_RDONLY);
+		return((theHandler->fd >= 0) ? noErr : StubErrnoToOSErr(errno));
+	}
+
+	return(noErr);
+}
+
+ComponentResult DataHCloseForRead (ComponentInstance theHandler)
+{
+	(void)theHandler;
+	return(noErr);
+}
+
+ComponentResult DataHOpenForWrite (ComponentInstance theHandler)
+{
+	char				myPath[64];
+
+	if (theHandler->subType != rAliasType)
+		return(paramErr);
+
+	theHandler->fd = open(StubFSSpecPath(&theHandler->file, myPath), O_RDWR);
+	return((theHandler->fd >= 0) ? noErr : StubErrnoToOSErr(errno));
+}
+
+ComponentResult DataHCloseForWrite (ComponentInstance theHandler)
+{
+	if (theHandler->fd >= 0)
+		close(theHandler->fd);
+
+	theHandler->fd = -1;
+	return(noErr);
+}
+
+ComponentResult DataHGetFileSize64 (ComponentInstance theHandler, wide *theFileSize)
+{
+	struct stat			myStat;
+	long				myContentLength;
+	int					myStatus;
+	OSErr				myErr;
+
+	if (theHandler->path != NULL) {
+		myErr = StubHTTP_SendRequest(theHandler, "HEAD", -1, -1, &myStatus, &myContentLength);
+		if (myErr != noErr)
+			return(myErr);
+
+		*theFileSize = SInt64ToWide(myContentLength);
+		return((myStatus == 200) ? noErr : fnfErr);
+	}
+
+	if ((theHandler->fd < 0) || (fstat(theHandler->fd, &myStat) != 0))
+		return(ioErr);
+
+	*theFileSize = SInt64ToWide(myStat.st_size);
+	return(noErr);
+}
+
+ComponentResult DataHSetFileSize64 (ComponentInstance theHandler, const wide *theFileSize)
+{
+	if ((theHandler->fd < 0) || (ftruncate(theHandler->fd, WideToSInt64(*theFileSize)) != 0))
+		return(ioErr);
+
+	return(noErr);
+}
+
+static ComponentResult StubQueueRequest (ComponentInstance theHandler, Ptr theBuffer, SInt64 theOffset, long theSize, Boolean theIsWrite, DataHCompletionUPP theCompletion, long theRefCon)
+{
+	StubRequest			*myRequest = malloc(sizeof(StubRequest));
+
+	if (myRequest == NULL)
+		return(memFullErr);
+
+	myRequest->buffer = theBuffer;
+	myRequest->offset = theOffset;
+	myRequest->size = theSize;
+	myRequest->isWrite = theIsWrite;
+	myRequest->completion = theCompletion;
+	myRequest->refCon = theRefCon;
+	myRequest->next = theHandler->requests;
+
+	if (!theIsWrite && (theHandler->firstReadOffset < 0))
+		theHandler->firstReadOffset = theOffset;
+
+	theHandler->requests = myRequest;
+	theHandler->numRequests++;
+	return(noErr);
+}
+
+ComponentResult DataHReadAsync (ComponentInstance theHandler, Ptr theBuffer, UInt32 theSize, const wide *theOffset, DataHCompletionUPP theCompletion, long theRefCon)
+{
+	return(StubQueueRequest(theHandler, theBuffer, WideToSInt64(*theOffset), theSize, false, theCompletion, theRefCon));
+}
+
+ComponentResult DataHWrite64 (ComponentInstance theHandler, Ptr theBuffer, const wide *theOffset, long theSize, DataHCompletionUPP theCompletion, long theRefCon)
+{
+	return(StubQueueRequest(theHandler, theBuffer, WideToSInt64(*theOffset), theSize, true, theCompletion, theRefCon));
+}
+
+// a server that doesn't serve byte ranges sends the whole file from the start instead. We read on through that
+// as far as each request needs, keeping what we've read (as QuickTime's URL data handler keeps it in its cache),
+// so that the requests can still be served in any order
+static OSErr StubURL_ReadFromStream (ComponentInstance theHandler, Ptr theBuffer, SInt64 theOffset, long theSize)
+{
+	long				myEnd = theOffset + theSize;
+	long				myCount = myEnd - theHandler->nextStreamOffset;
+	long				myCacheSize;
+	Ptr					myCache;
+	OSErr				myErr = noErr;
+
+	if (myCount > 0) {
+		if (myEnd > theHandler->streamCacheSize) {
+			myCacheSize = (myEnd > 2 * theHandler->streamCacheSize) ? myEnd : 2 * theHandler->streamCacheSize;
+			myCache = realloc(theHandler->streamCache, myCacheSize);
+			if (myCache == NULL)
+				return(memFullErr);
+			theHandler->streamCache = myCache;
+			theHandler->streamCacheSize = myCacheSize;
+		}
+
+		myCache = theHandler->streamCache + theHandler->nextStreamOffset;
+		if (theHandler->path != NULL) {
+			if (myCount > theHandler->streamRemaining)
+				return(eofErr);
+
+			myErr = StubHTTP_ReceiveAll(theHandler, myCache, myCount);
+			theHandler->streamRemaining -= myCount;
+		} else {
+			if (pread(theHandler->fd, myCache, myCount, theHandler->nextStreamOffset) != myCount)
+				myErr = eofErr;
+		}
+
+		if (myErr != noErr) {
+			StubHTTP_Disconnect(theHandler);
+			return(myErr);
+		}
+		theHandler->nextStreamOffset = myEnd;
+	}
+
+	memcpy(theBuffer, theHandler->streamCache + theOffset, theSize);
+	return(noErr);
+}
+
+// the requests are completed in random order, but a real handler sends them in the order they were queued;
+// from a server that won't serve ranges, it gets the whole file, which is only any use if the first read
+// queued was at the start of it
+static OSErr StubURL_Read (ComponentInstance theHandler, Ptr theBuffer, SInt64 theOffset, long theSize)
+{
+	long				myContentLength;
+	int					myStatus;
+	OSErr				myErr = noErr;
+
+	if (theHandler->streaming)
+		return(StubURL_ReadFromStream(theHandler, theBuffer, theOffset, theSize));
+
+	if (theHandler->path == NULL) {
+		// a file:// URL; it behaves like a server that serves byte ranges, unless we're told otherwise
+		if (!gServesRanges) {
+			if (theHandler->firstReadOffset != 0)
+				return(ioErr);
+
+			theHandler->streaming = true;
+			theHandler->nextStreamOffset = 0;
+			return(StubURL_ReadFromStream(theHandler, theBuffer, theOffset, theSize));
+		}
+
+		return((pread(theHandler->fd, theBuffer, theSize, theOffset) == theSize) ? noErr : eofErr);
+	}
+
+	myErr = StubHTTP_SendRequest(theHandler, "GET", theOffset, theOffset + theSize - 1, &myStatus, &myContentLength);
+	if (myErr != noErr)
+		return(myErr);
+
+	if ((myStatus == 206) && (myContentLength == theSize))
+		return(StubHTTP_ReceiveAll(theHandler, theBuffer, theSize));
+
+	if ((myStatus == 200) && (theHandler->firstReadOffset == 0)) {
+		theHandler->streaming = true;
+		theHandler->streamRemaining = myContentLength;
+		theHandler->nextStreamOffset = 0;
+		return(StubURL_ReadFromStream(theHandler, theBuffer, theOffset, theSize));
+	}
+
+	// we can't use the response, and we can't ask for another on this connection until it's been read
+	StubHTTP_Disconnect(theHandler);
+	return((myStatus == 404) ? fnfErr : ioErr);
+}
+
+// the stand-in data handlers know nothing about what's in a file
+ComponentResult DataHGetMacOSFileType (ComponentInstance theHandler, OSType *theFileType)
+{
+	(void)theHandler;
+	*theFileType = 0;
+	return(noErr);
+}
+
+ComponentResult DataHGetMIMEType (ComponentInstance theHandler, Str255 theMIMEType)
+{
+	(void)theHandler;
+	theMIMEType[0] = 0;
+	return(noErr);
+}
+
+ComponentResult DataHTask (ComponentInstance theHandler)
+{
+	StubRequest			**myLink;
+	StubRequest			*myRequest;
+	long				myIndex;
+	OSErr				myErr = noErr;
+
+	if (theHandler->numRequests == 0)
+		return(noErr);
+
+	// take a request at random off the queue
+	myLink = &theHandler->requests;
+	for (myIndex = rand() % theHandler->numRequests; myIndex > 0; myIndex--)
+		myLink = &(*myLink)->next;
+
+	myRequest = *myLink;
+	*myLink = myRequest->next;
+	theHandler->numRequests--;
+
+	if (myRequest->isWrite) {
+		if (pwrite(theHandler->fd, myRequest->buffer, myRequest->size, myRequest->offset) != myRequest->size)
+			myErr = ioErr;
+	} else if (theHandler->subType == rAliasType) {
+		if (pread(theHandler->fd, myRequest->buffer, myRequest->size, myRequest->offset) != myRequest->size)
+			myErr = eofErr;
+	} else if ((gFailAfter >= 0) && (gBytesServed + myRequest->size > gFailAfter)) {
+		myErr = ioErr;
+	} else {
+		myErr = StubURL_Read(theHandler, myRequest->buffer, myRequest->offset, myRequest->size);
+		if (myErr == noErr)
+			__sync_fetch_and_add(&gBytesServed, myRequest->size);
+	}
+
+	(*myRequest->completion)(myRequest->buffer, myRequest->refCon, myErr);
+	free(myRequest);
+	return(noErr);
+}
+
+#pragma mark-
+
+//////////
+//
+// movies
+//
+//////////
+
+// a stand-in movie has one visual track, whose media is the movie itself; the Track and the Media are
+// the same pointer as the Movie
+struct MovieType {
+	long						numSamples;
+	long						syncInterval;
+	UInt32						*samples;			// the offset and size of each sample
+};
+
+static UInt32 StubReadBigEndian (const UInt8 *theBytes)
+{
+	return(((UInt32)theBytes[0] << 24) | ((UInt32)theBytes[1] << 16) | ((UInt32)theBytes[2] << 8) | theBytes[3]);
+}
+
+// find the movie atom of a stand-in movie file by walking its top-level atoms, and read the movie from it
+OSErr NewMovieFromDataRef (Movie *theMovie, short theFlags, short *theID, Handle theDataRef, OSType theDataRefType)
+{
+	struct MovieType	*myMovie = NULL;
+	char				myPath[64];
+	UInt8				myHeader[8];
+	UInt8				*myAtom = NULL;
+	UInt32				myAtomSize;
+	off_t				myOffset = 0;
+	long				myIndex;
+	int					myFD = -1;
+	OSErr				myErr = noMovieFound;
+
+	(void)theFlags; (void)theID;
+	*theMovie = NULL;
+
+	if ((theDataRef == NULL) || (theDataRefType != rAliasType) || (GetHandleSize(theDataRef) != sizeof(FSSpec))) {
+		myErr = paramErr;
+		goto bail;
+	}
+
+	myFD = open(StubFSSpecPath((FSSpec *)*theDataRef, myPath), O_RDONLY);
+	if (myFD < 0) {
+		myErr = fnfErr;
+		goto bail;
+	}
+
+	while (pread(myFD, myHeader, sizeof(myHeader), myOffset) == sizeof(myHeader)) {
+		myAtomSize = StubReadBigEndian(&myHeader[0]);
+		if (myAtomSize < sizeof(myHeader))
+			break;
+
+		if (StubReadBigEndian(&myHeader[4]) != MovieAID) {
+			myOffset += myAtomSize;
+			continue;
+		}
+
+		// the movie atom holds the number of samples, the sync sample interval, and each sample's offset and size
+		myAtom = malloc(myAtomSize);
+		myMovie = calloc(1, sizeof(struct MovieType));
+		if ((myAtom == NULL) || (myMovie == NULL) || (myAtomSize < 16) || (pread(myFD, myAtom, myAtomSize, myOffset) != (ssize_t)myAtomSize))
+			break;
+
+		myMovie->numSamples = StubReadBigEndian(&myAtom[8]);
+		myMovie->syncInterval = StubReadBigEndian(&myAtom[12]);
+		if ((myMovie->numSamples < 1) || (myMovie->syncInterval < 1) || ((UInt32)myMovie->numSamples > (myAtomSize - 16) / 8))
+			break;
+
+		myMovie->samples = calloc(2 * myMovie->numSamples, sizeof(UInt32));
+		if (myMovie->samples == NULL)
+			break;
+		for (myIndex = 0; myIndex < 2 * myMovie->numSamples; myIndex++)
+			myMovie->samples[myIndex] = StubReadBigEndian(&myAtom[16 + 4 * myIndex]);
+
+		*theMovie = myMovie;
+		myMovie = NULL;
+		myErr = noErr;
+		break;
+	}
+
+bail:
+	if (myFD >= 0)
+		close(myFD);
+	free(myAtom);
+	if (myMovie != NULL)
+		free(myMovie->samples);
+	free(myMovie);
+
+	return(gMoviesError = myErr);
+}
+
+void DisposeMovie (Movie theMovie)
+{
+	if (theMovie != NULL)
+		free(theMovie->samples);
+	free(theMovie);
+}
+
+OSErr GetMoviesError (void)										{ return(gMoviesError); }
+OSErr EnterMoviesOnThread (UInt32 theFlags)						{ (void)theFlags; return(noErr); }
+OSErr ExitMoviesOnThread (void)									{ return(noErr); }
+long GetMovieTrackCount (Movie theMovie)						{ return((theMovie != NULL) ? 1 : 0); }
+Track GetMovieIndTrack (Movie theMovie, long theIndex)			{ return((theIndex == 1) ? (Track)theMovie : NULL); }
+Track GetMovieIndTrackType (Movie theMovie, long theIndex, OSType theType, long theFlags)
+																{ (void)theFlags; return((theType == VisualMediaCharacteristic) ? GetMovieIndTrack(theMovie, theIndex) : NULL); }
+Media GetTrackMedia (Track theTrack)							{ return((Media)theTrack); }
+
+// the track starts at the start of the movie, and each sample lasts one unit of time
+TimeValue TrackTimeToMediaTime (TimeValue theTime, Track theTrack)
+{
+	Movie				myMovie = (Movie)theTrack;
+
+	return(((myMovie != NULL) && (theTime >= 0) && (theTime < myMovie->numSamples)) ? theTime : -1);
+}
+
+// we only know where the sync samples are, looking backwards
+void GetMediaNextInterestingTime (Media theMedia, short theFlags, TimeValue theTime, Fixed theRate, TimeValue *theInterestingTime, TimeValue *theDuration)
+{
+	Movie				myMovie = (Movie)theMedia;
+
+	(void)theDuration;
+	*theInterestingTime = -1;
+	gMoviesError = paramErr;
+
+	if ((myMovie != NULL) && (theFlags & nextTimeSyncSample) && (theRate < 0) && (theTime >= 0) && (theTime < myMovie->numSamples)) {
+		*theInterestingTime = theTime - (theTime % myMovie->syncInterval);
+		gMoviesError = noErr;
+	}
+}
+
+// return one sample at a time
+OSErr GetMediaSampleReferences64 (Media theMedia, TimeValue theTime, TimeValue *theSampleTime, SampleReference64Ptr theSampleRefs, long theMaxNumberOfEntries, long *theNumberOfEntries)
+{
+	Movie				myMovie = (Movie)theMedia;
+
+	*theNumberOfEntries = 0;
+	if ((myMovie == NULL) || (theTime < 0) || (theTime >= myMovie->numSamples) || (theMaxNumberOfEntries < 1))
+		return(paramErr);
+
+	theSampleRefs->dataOffset = SInt64ToWide(myMovie->samples[2 * theTime]);
+	theSampleRefs->dataSize = myMovie->samples[2 * theTime + 1];
+	theSampleRefs->durationPerSample = 1;
+	theSampleRefs->numberOfSamples = 1;
+	theSampleRefs->sampleFlags = 0;
+	*theSampleTime = theTime;
+	*theNumberOfEntries = 1;
+	return(noErr);
+}
+
+// the media data is all in the movie file
+OSErr GetMediaDataRefCount (Media theMedia, short *theCount)
+{
+	*theCount = (theMedia != NULL) ? 1 : 0;
+	return((theMedia != NULL) ? noErr : paramErr);
+}
+
+OSErr GetMediaDataRef (Media theMedia, short theIndex, Handle *theDataRef, OSType *theDataRefType, long *theAttributes)
+{
+	(void)theDataRef; (void)theDataRefType;
+
+	if ((theMedia == NULL) || (theIndex != 1))
+		return(paramErr);
+
+	if (theAttributes != NULL)
+		*theAttributes = dataRefSelfReference;
+	return(noErr);
+}
+OSErr OpenADefaultComponent (OSType theType, OSType theSubType, ComponentInstance *theInstance)
+																{ (void)theType; (void)theSubType; *theInstance = NULL; return(paramErr); }
+ComponentResult MCDoAction (MovieController theController, short theAction, void *theParams)
+																{ (void)theController; (void)theAction; (void)theParams; return(paramErr); }
@@ -0,0 +1,23 @@
+/*
+	File:		MacStubs.h
+
+	Description: Controls for the stand-in URL data handler in MacStubs.c, and the layout of the
+				stand-in movie files that its Movie Toolbox calls open.
+*/
+
+#include <Carbon/Carbon.h>
+
+// make file:// URLs behave like a server that does (or doesn't) serve byte ranges; the default is true
+void StubURL_SetServesRanges (Boolean theServesRanges);
+
+// return the number of bytes that URL data handlers have read so far
+long StubURL_GetBytesServed (void);
+
+// make URL data handler reads fail (with ioErr) once they would take the bytes read past theBytes, as if
+// the connection had dropped; pass -1 to stop
+void StubURL_SetFailAfter (long theBytes);
+
+// A stand-in movie file is a series of QuickTime atoms (a 32-bit big-endian size, then the type); the
+// movie atom ('moov') can be anywhere among them. Its body is, all big-endian 32-bit numbers: the number
+// of samples, the interval between sync samples (0, k, 2k, ...), and then the offset and size of each
+// sample. The movie has one visual track, whose sample n plays from time n to time n + 1.
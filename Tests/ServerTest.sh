@@ -0,0 +1,48 @@
+#!/bin/sh
+#
+# ServerTest.sh
+#
+# Run TransferTest against StandInServer.py, so that the transfer engine's copies go over real HTTP
+# connections on the loopback interface: once to a server that serves byte ranges, and once to one that
+# doesn't, which the engine has to fall back to a single stream for. Skipped (successfully) if there's
+# no python3.
+#
+#	ServerTest.sh path/to/TransferTest
+#
+
+TEST=${1:-build/TransferTest}
+HERE=$(cd "$(dirname "$0")" && pwd)
+
+if ! command -v python3 >/dev/null 2>&1; then
+	echo "ServerTest: no python3, skipping the stand-in server tests"
+	exit 0
+fi
+
+DIR=$(mktemp -d "${TMPDIR:-/tmp}/ServerTest.XXXXXX") || exit 1
+SERVER=
+
+cleanup () {
+	[ -n "$SERVER" ] && kill "$SERVER" 2>/dev/null
+	rm -rf "$DIR"
+}
+trap cleanup EXIT INT TERM
+
+# start a server on a port of its choosing, and wait for it to say which
+start_server () {
+	rm -f "$DIR/port"
+	python3 "$HERE/StandInServer.py" --root "$DIR" --port-file "$DIR/port" "$@" &
+	SERVER=$!
+	for i in $(seq 100); do
+		[ -s "$DIR/port" ] && return 0
+		sleep 0.1
+	done
+	echo "ServerTest: the stand-in server didn't start"
+	exit 1
+}
+
+start_server
+"$TEST" -dir "$DIR" -url "http://127.0.0.1:$(cat "$DIR/port")/" || exit 1
+kill "$SERVER"; wait "$SERVER" 2>/dev/null
+
+start_server --no-ranges
+"$TEST" -dir "$DIR" -url "http://127.0.0.1:$(cat "$DIR/port")/" -noranges || exit 1
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+#
+# StandInServer.py
+#
+# A small HTTP/1.1 server that stands in for a remote movie server, so that the transfer engine in
+# QTDataRef.c (and the URL data handler path) can be tested and timed on one machine, offline. It
+# serves the files in one folder, on the loopback interface only, answers GET and HEAD, serves
+# single byte ranges (Range: bytes=first-last), and keeps connections alive.
+#
+#	StandInServer.py --root folder [--port n] [--port-file file] [--no-ranges]
+#		[--latency seconds] [--bandwidth bytes]
+#
+# With --port 0 (the default) the system picks the port; --port-file writes it to a file once the
+# server is listening, so that a script can wait for it. With --no-ranges, it ignores Range headers and
+# sends every file whole, as some servers do. --latency delays each response by that many seconds, and
+# --bandwidth caps each connection at that many bytes per second, so that the loopback interface looks
+# more like a real network link (see WorkerSweep.sh).
+#
+
+import argparse
+import os
+import posixpath
+import re
+import sys
+import time
+import urllib.parse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+CHUNK_SIZE = 64 * 1024
+
+
+class StandInHandler(BaseHTTPRequestHandler):
+	protocol_version = "HTTP/1.1"			# so connections are kept alive
+	disable_nagle_algorithm = True			# the headers and the body go out in separate writes
+	server_version = "StandInServer/1.0"
+
+	def log_message(self, format, *args):
+		if self.server.verbose:
+			BaseHTTPRequestHandler.log_message(self, format, *args)
+
+	def do_HEAD(self):
+		self.serve(False)
+
+	def do_GET(self):
+		self.serve(True)
+
+	# map the request path to a file in the root folder; nothing outside it is served
+	def local_path(self):
+		path = urllib.parse.unquote(urllib.parse.urlsplit(self.path).path)
+		path = posixpath.normpath(path).lstrip("/")
+		if path.startswith(".."):
+			return None
+		return os.path.join(self.server.root, path)
+
+	# return the (first, last) bytes asked for, None if the whole file is, or "bad" if the range can't be served
+	def requested_range(self, size):
+		header = self.headers.get("Range")
+		if header is None or self.server.no_ranges:
+			return None
+		match = re.fullmatch(r"\s*bytes=(\d*)-(\d*)\s*", header)
+		if match is None or match.group(1) + match.group(2) == "":
+			return None						# not a single byte range; send the whole file
+		if match.group(1) == "":
+			first, last = max(size - int(match.group(2)), 0), size - 1
+		else:
+			first = int(match.group(1))
+			last = int(match.group(2)) if match.group(2) else size - 1
+		last = min(last, size - 1)
+		if first > last:
+			return "bad"
+		return (first, last)
+
+	def send_error_response(self, status):
+		self.send_response(status)
+		self.send_header("Content-Length", "0")
+		self.end_headers()
+
+	def serve(self, send_body):
+		if self.server.latency > 0:
+			time.sleep(self.server.latency)
+		path = self.local_path()
+		if path is None or not os.path.isfile(path):
+			self.send_error_response(404)
+			return
+
+		size = os.path.getsize(path)
+		byte_range = self.requested_range(size)
+		if byte_range == "bad":
+			self.send_response(416)
+			self.send_header("Content-Range", "bytes */%d" % size)
+			self.send_header("Content-Length", "0")
+			self.end_headers()
+			return
+
+		if byte_range is None:
+			first, last = 0, size - 1
+			self.send_response(200)
+		else:
+			first, last = byte_range
+			self.send_response(206)
+			self.send_header("Content-Range", "bytes %d-%d/%d" % (first, last, size))
+		if not self.server.no_ranges:
+			self.send_header("Accept-Ranges", "bytes")
+		self.send_header("Content-Type", "application/octet-stream")
+		self.send_header("Content-Length", str(last - first + 1))
+		self.end_headers()
+
+		if send_body:
+			self.send_file(path, first, last - first + 1)
+
+	def send_file(self, path, offset, count):
+		bandwidth = self.server.bandwidth
+		chunk_size = CHUNK_SIZE if bandwidth <= 0 else max(min(CHUNK_SIZE, bandwidth // 10), 1)
+		start, sent = time.monotonic(), 0
+		with open(path, "rb") as file:
+			file.seek(offset)
+			while count > 0:
+				data = file.read(min(chunk_size, count))
+				if not data:
+					break
+				self.wfile.write(data)
+				count -= len(data)
+				sent += len(data)
+				# hold the connection to the cap: wait until the bytes sent so far would have taken that long
+				if bandwidth > 0:
+					delay = start + sent / bandwidth - time.monotonic()
+					if delay > 0:
+						time.sleep(delay)
+
+
+class StandInServer(ThreadingHTTPServer):
+	daemon_threads = True
+
+	# a client that only wanted part of a file hangs up on the rest of it; that isn't worth a traceback
+	def handle_error(self, request, client_address):
+		if not isinstance(sys.exc_info()[1], (BrokenPipeError, ConnectionResetError)):
+			ThreadingHTTPServer.handle_error(self, request, client_address)
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Serve a folder over HTTP/1.1 on the loopback interface.")
+	parser.add_argument("--root", required=True, help="the folder to serve")
+	parser.add_argument("--port", type=int, default=0, help="the port to listen on (0 lets the system pick)")
+	parser.add_argument("--port-file", help="write the port to this file once the server is listening")
+	parser.add_argument("--no-ranges", action="store_true", help="ignore Range headers and send whole files")
+	parser.add_argument("--latency", type=float, default=0, help="delay each response by this many seconds")
+	parser.add_argument("--bandwidth", type=int, default=0, help="cap each connection at this many bytes per second")
+	parser.add_argument("--verbose", action="store_true", help="log each request")
+	args = parser.parse_args()
+
+	server = StandInServer(("127.0.0.1", args.port), StandInHandler)
+	server.root = os.path.abspath(args.root)
+	server.no_ranges = args.no_ranges
+	server.latency = args.latency
+	server.bandwidth = args.bandwidth
+	server.verbose = args.verbose
+
+	if args.port_file:
+		with open(args.port_file + ".tmp", "w") as file:
+			file.write("%d\n" % server.server_address[1])
+		os.rename(args.port_file + ".tmp", args.port_file)
+
+	try:
+		server.serve_forever()
+	except KeyboardInterrupt:
+		pass
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
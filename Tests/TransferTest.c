@@ -0,0 +1,802 @@
+/*
+	File:		TransferTest.c
+
+	Description: Checks of the transfer engine in QTDataRef.c, which copies a remote file into a local
+				file with several reads and writes in flight at once. Every copy is compared byte for
+				byte with its source, and the throughput of each buffer layout is printed. A file big
+				enough to fetch in ranges is copied over several streams, and over one after falling
+				back, from a server that won't serve ranges. Copies that are cancelled, that fail, or
+				whose process dies partway are resumed from their checkpoints, unless the source has
+				changed. A stand-in movie whose movie atom is at the end is opened, and a frame from
+				its middle waited for, while it's still being copied; what hasn't been waited for
+				reads as zeros. A sparse file bigger than 4 GB is copied as far as a range past 4 GB,
+				and resumed. Queued transfers run on the worker threads in WorkerThread.c, under a
+				limit on how many run at once.
+
+				By default the sources are file:// URLs in a scratch folder. Pass -dir with a folder
+				that StandInServer.py is serving, and -url with the server's address, to make the same
+				copies over HTTP (ServerTest.sh does this); add -noranges if the server ignores ranges.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "QTDataRef.h"
+#include "MacStubs.h"
+
+#define kSourceSize			(1024 * 1024 + 17)
+#define kRangedSourceSize	(kMinRangedTransferSize + 1024 * 1024 + 1234)
+#define kResumeBufferSize	16384
+#define kMovieNumSamples	80
+#define kMovieSyncInterval	10
+#define kNumQueuedCopies	6
+#define kMaxQueuedRunning	2
+#define kQueuedSourceSize	(256 * 1024 + 3)
+#define kBigSourceSize		(5LL * 1024 * 1024 * 1024 + 17)
+#define kBigMarkerOffset	(4LL * 1024 * 1024 * 1024 + 512 * 1024 * 1024 + 5)
+
+typedef struct {
+	long				numBuffers;
+	long				bufferSize;
+} BufferLayout;
+
+typedef struct {
+	QTDRTransferPtr		transfer;
+	long				numDoneCalls;
+} QueuedCopy;
+
+static int gFailures = 0;
+static int gChecks = 0;
+static unsigned long gSeed = 1;
+static char gBaseURL[1024];
+static long gNumQueuedDone = 0;
+static Boolean gNoRanges = false;			// does the server ignore byte ranges?
+static long gLastNumStreams = 0;			// the streams CopySource's last transfer used
+static Boolean gLastFellBack = false;		// and whether it fell back to one of them
+
+static UInt32 NextRandom (void)
+{
+	gSeed = gSeed * 1103515245 + 12345;
+	return((UInt32)(gSeed >> 16) & 0x7FFF);
+}
+
+static void Check (Boolean theCondition, const char *theWhat, const char *theFile)
+{
+	gChecks++;
+	if (!theCondition) {
+		printf("FAIL %s: \"%s\"\n", theWhat, theFile);
+		gFailures++;
+	}
+}
+
+// write theSize bytes of noise into the named file in the current folder
+static void MakeSource (const char *theName, long theSize, unsigned long theSeed)
+{
+	FILE				*myFile = fopen(theName, "wb");
+	long				myIndex;
+
+	gSeed = theSeed;
+	for (myIndex = 0; (myFile != NULL) && (myIndex < theSize); myIndex++)
+		fputc(NextRandom() & 0xFF, myFile);
+
+	if (myFile != NULL)
+		fclose(myFile);
+}
+
+static Boolean SameContents (const char *theName1, const char *theName2)
+{
+	FILE				*myFile1 = fopen(theName1, "rb");
+	FILE				*myFile2 = fopen(theName2, "rb");
+	int					myChar1 = 0, myChar2 = 0;
+
+	while ((myFile1 != NULL) && (myFile2 != NULL) && (myChar1 == myChar2) && (myChar1 != EOF)) {
+		myChar1 = fgetc(myFile1);
+		myChar2 = fgetc(myFile2);
+	}
+
+	if (myFile1 != NULL)
+		fclose(myFile1);
+	if (myFile2 != NULL)
+		fclose(myFile2);
+
+	return((myFile1 != NULL) && (myFile2 != NULL) && (myChar1 == EOF) && (myChar2 == EOF));
+}
+
+static Boolean FileExists (const char *theName)
+{
+	struct stat			myStat;
+
+	return(stat(theName, &myStat) == 0);
+}
+
+static void MakeFileSpec (const char *theName, FSSpec *theSpec)
+{
+	Str255				myName;
+
+	myName[0] = strlen(theName);
+	memcpy(&myName[1], theName, myName[0]);
+	FSMakeFSSpec(0, 0L, myName, theSpec);
+}
+
+// copy the source (at the base URL) into the copy (in the current folder), tasking the transfer until it's done
+static OSErr CopySource (const char *theSource, const char *theCopy, SInt64 *theBytesTransferred, Float64 *theThroughput)
+{
+	QTDRTransferPtr		myTransfer = NULL;
+	FSSpec				myFile;
+	char				myURL[2048];
+	OSErr				myErr = noErr;
+
+	snprintf(myURL, sizeof(myURL), "%s%s", gBaseURL, theSource);
+	MakeFileSpec(theCopy, &myFile);
+
+	myErr = QTDR_NewTransfer(myURL, &myFile, &myTransfer);
+	if (myErr != noErr)
+		return(myErr);
+
+	QTDR_StartTransfer(myTransfer);
+	while (!QTDR_TaskTransfer(myTransfer))
+		;
+
+	QTDR_CloseTransfer(myTransfer);
+	myErr = QTDR_GetTransferError(myTransfer);
+	QTDR_GetTransferProgress(myTransfer, theBytesTransferred, NULL);
+	*theThroughput = QTDR_GetTransferThroughput(myTransfer);
+	gLastNumStreams = myTransfer->numStreams;
+	gLastFellBack = myTransfer->fellBack;
+	QTDR_DisposeTransfer(myTransfer);
+
+	return(myErr);
+}
+
+// copy one file with each layout of buffers, from one at a time to many small ones in flight at once
+static void RunBufferLayouts (void)
+{
+	static const BufferLayout	kLayouts[] = {
+		{ 1, 64 * 1024 }, { 4, 64 * 1024 }, { 8, 16 * 1024 }, { 3, 10000 }, { 32, 4096 }
+	};
+	long				myIndex;
+	SInt64				myBytes;
+	Float64				myThroughput;
+	char				myWhat[64];
+	OSErr				myErr;
+
+	MakeSource("layouts.dat", kSourceSize, 1);
+
+	for (myIndex = 0; myIndex < (long)(sizeof(kLayouts) / sizeof(kLayouts[0])); myIndex++) {
+		snprintf(myWhat, sizeof(myWhat), "%ld x %ld byte buffers", kLayouts[myIndex].numBuffers, kLayouts[myIndex].bufferSize);
+		QTDR_SetTransferBuffers(kLayouts[myIndex].numBuffers, kLayouts[myIndex].bufferSize);
+
+		myErr = CopySource("layouts.dat", "layouts-copy.dat", &myBytes, &myThroughput);
+		Check(myErr == noErr, myWhat, "layouts.dat");
+		Check(SameContents("layouts.dat", "layouts-copy.dat"), myWhat, "copy matches");
+		Check(myBytes == kSourceSize, myWhat, "bytes transferred");
+		Check(!FileExists("layouts-copy.dat.qtdc"), myWhat, "checkpoint removed");
+		Check(myThroughput > 0, myWhat, "throughput");
+
+		printf("%s: %.1f MB/s\n", myWhat, myThroughput / (1024.0 * 1024.0));
+	}
+}
+
+// files with no data, less than a buffer, and exactly a whole number of buffers
+static void RunEdgeCases (void)
+{
+	static const long	kSizes[] = { 0, 5, 4 * 16384 };
+	long				myIndex;
+	SInt64				myBytes;
+	Float64				myThroughput;
+	char				myName[64];
+	OSErr				myErr;
+
+	QTDR_SetTransferBuffers(4, 16384);
+
+	for (myIndex = 0; myIndex < (long)(sizeof(kSizes) / sizeof(kSizes[0])); myIndex++) {
+		snprintf(myName, sizeof(myName), "edge-%ld.dat", kSizes[myIndex]);
+		MakeSource(myName, kSizes[myIndex], myIndex + 2);
+
+		myErr = CopySource(myName, "edge-copy.dat", &myBytes, &myThroughput);
+		Check(myErr == noErr, "edge case copy", myName);
+		Check(SameContents(myName, "edge-copy.dat"), "edge case copy matches", myName);
+		Check(myBytes == kSizes[myIndex], "edge case bytes transferred", myName);
+	}
+}
+
+// copy a file big enough to fetch in ranges, over one stream and over several; if the server won't serve
+// ranges, the extra streams' first reads fail, and the transfer falls back to reading the rest over one
+static void CopyRangedSource (const char *theWhat, long theNumStreams, Boolean theServesRanges)
+{
+	SInt64				myBytes;
+	Float64				myThroughput;
+	OSErr				myErr;
+
+	QTDR_SetTransferStreams(theNumStreams);
+	myErr = CopySource("ranged.dat", "ranged-copy.dat", &myBytes, &myThroughput);
+	Check(myErr == noErr, theWhat, "ranged.dat");
+	Check(SameContents("ranged.dat", "ranged-copy.dat"), theWhat, "copy matches");
+	Check(myBytes == kRangedSourceSize, theWhat, "bytes transferred");
+
+	if (theNumStreams == 1) {
+		Check(gLastNumStreams == 1, theWhat, "one stream");
+		Check(!gLastFellBack, theWhat, "nothing to fall back from");
+	} else {
+		Check(gLastNumStreams == theNumStreams, theWhat, "a stream for each range");
+		Check(gLastFellBack == !theServesRanges, theWhat, theServesRanges ? "no fall back" : "fell back to one stream");
+	}
+
+	printf("%s: %.1f MB/s\n", theWhat, myThroughput / (1024.0 * 1024.0));
+}
+
+static void RunRangedTransfers (void)
+{
+	Boolean				myIsFileURL = (strncmp(gBaseURL, "file:", 5) == 0);
+
+	MakeSource("ranged.dat", kRangedSourceSize, 20);
+	QTDR_SetTransferBuffers(8, 64 * 1024);
+
+	CopyRangedSource("ranged file, 1 stream", 1, !gNoRanges);
+	CopyRangedSource("ranged file, 4 streams", 4, !gNoRanges);
+	CopyRangedSource("ranged file, 8 streams", kMaxTransferStreams, !gNoRanges);
+
+	// with file:// URLs, the stand-in data handler can pretend to be a server that won't serve ranges
+	if (myIsFileURL && !gNoRanges) {
+		StubURL_SetServesRanges(false);
+		CopyRangedSource("ranged file, no ranges served", 4, false);
+		StubURL_SetServesRanges(true);
+	}
+
+	QTDR_SetTransferStreams(kNumTransferStreams);
+}
+
+// like CopySource, but run the transfer with QTDR_RunTransfer, as the worker threads do
+static OSErr RunSource (const char *theSource, const char *theCopy)
+{
+	QTDRTransferPtr		myTransfer = NULL;
+	FSSpec				myFile;
+	char				myURL[2048];
+	OSErr				myErr = noErr;
+
+	snprintf(myURL, sizeof(myURL), "%s%s", gBaseURL, theSource);
+	MakeFileSpec(theCopy, &myFile);
+
+	myErr = QTDR_NewTransfer(myURL, &myFile, &myTransfer);
+	if (myErr == noErr)
+		myErr = QTDR_RunTransfer(myTransfer);
+
+	QTDR_DisposeTransfer(myTransfer);
+	return(myErr);
+}
+
+// start copying the source, and stop once about half of it is written: by cancelling the transfer, or
+// (if theCrash is true) by quitting, in a child process, without closing it, as if the application had crashed
+static void InterruptCopy (const char *theWhat, const char *theSource, const char *theCopy, Boolean theCrash)
+{
+	QTDRTransferPtr		myTransfer = NULL;
+	FSSpec				myFile;
+	char				myURL[2048];
+	SInt64				myBytes, myBytesToTransfer;
+	pid_t				myChild = 0;
+	int					myStatus = 0;
+
+	if (theCrash) {
+		fflush(stdout);
+		myChild = fork();
+		if (myChild != 0) {
+			Check((myChild > 0) && (waitpid(myChild, &myStatus, 0) == myChild) && WIFEXITED(myStatus), theWhat, "the copy was interrupted");
+			return;
+		}
+	}
+
+	snprintf(myURL, sizeof(myURL), "%s%s", gBaseURL, theSource);
+	MakeFileSpec(theCopy, &myFile);
+
+	if (QTDR_NewTransfer(myURL, &myFile, &myTransfer) != noErr) {
+		if (theCrash)
+			_exit(1);
+		Check(false, theWhat, "the copy was interrupted");
+		return;
+	}
+
+	QTDR_StartTransfer(myTransfer);
+	QTDR_GetTransferProgress(myTransfer, &myBytes, &myBytesToTransfer);
+	while (!QTDR_TaskTransfer(myTransfer) && (myBytes < myBytesToTransfer / 2))
+		QTDR_GetTransferProgress(myTransfer, &myBytes, &myBytesToTransfer);
+
+	if (theCrash)
+		_exit(0);
+
+	QTDR_CancelTransfer(myTransfer);
+	while (!QTDR_TaskTransfer(myTransfer))
+		;
+
+	QTDR_CloseTransfer(myTransfer);
+	Check(QTDR_GetTransferError(myTransfer) == userCanceledErr, theWhat, "the copy was interrupted");
+	QTDR_DisposeTransfer(myTransfer);
+}
+
+// finish an interrupted copy of the resume source; if the copy can pick up where it stopped, it should
+// fetch at most what's left after the chunks of one checkpoint interval, and otherwise the whole file
+static void ResumeCopy (const char *theWhat, long theSourceSize, Boolean theCanResume)
+{
+	long				myServed = StubURL_GetBytesServed();
+	SInt64				myBytes;
+	Float64				myThroughput;
+	OSErr				myErr;
+
+	Check(FileExists("resume-copy.dat.qtdc"), theWhat, "the interrupted copy left a checkpoint");
+
+	myErr = CopySource("resume.dat", "resume-copy.dat", &myBytes, &myThroughput);
+	myServed = StubURL_GetBytesServed() - myServed;
+	Check(myErr == noErr, theWhat, "resume.dat");
+	Check(SameContents("resume.dat", "resume-copy.dat"), theWhat, "copy matches");
+	Check(myBytes == theSourceSize, theWhat, "bytes transferred");
+	Check(!FileExists("resume-copy.dat.qtdc"), theWhat, "checkpoint removed");
+
+	if (theCanResume)
+		Check(myServed <= theSourceSize - kCheckpointInterval * kResumeBufferSize, theWhat, "only the rest of the file is fetched");
+	else
+		Check(myServed >= theSourceSize, theWhat, "the whole file is fetched again");
+}
+
+// interrupt copies in each way we can, and resume them
+static void RunResumedTransfers (void)
+{
+	Boolean				myIsFileURL = (strncmp(gBaseURL, "file:", 5) == 0);
+	SInt64				myBytes;
+	Float64				myThroughput;
+	OSErr				myErr;
+
+	MakeSource("resume.dat", kRangedSourceSize, 30);
+	QTDR_SetTransferBuffers(8, kResumeBufferSize);
+	QTDR_SetTransferStreams(4);
+
+	if (!gNoRanges) {
+		InterruptCopy("cancel a copy", "resume.dat", "resume-copy.dat", false);
+		ResumeCopy("resume a cancelled copy", kRangedSourceSize, true);
+
+		InterruptCopy("crash during a copy", "resume.dat", "resume-copy.dat", true);
+		ResumeCopy("resume a crashed copy", kRangedSourceSize, true);
+
+		// reads start failing halfway through, as if the connections had dropped
+		StubURL_SetFailAfter(StubURL_GetBytesServed() + kRangedSourceSize / 2);
+		myErr = CopySource("resume.dat", "resume-copy.dat", &myBytes, &myThroughput);
+		StubURL_SetFailAfter(-1);
+		Check(myErr == ioErr, "a copy whose reads fail", "resume.dat");
+		ResumeCopy("resume a failed copy", kRangedSourceSize, true);
+
+		// a checkpoint is no good once the remote file or the local file has changed size
+		InterruptCopy("cancel a copy", "resume.dat", "resume-copy.dat", false);
+		MakeSource("resume.dat", kRangedSourceSize + 100000, 31);
+		ResumeCopy("resume after the source changed size", kRangedSourceSize + 100000, false);
+
+		InterruptCopy("cancel a copy", "resume.dat", "resume-copy.dat", false);
+		Check(truncate("resume-copy.dat", 1000) == 0, "truncate the interrupted copy", "resume-copy.dat");
+		ResumeCopy("resume after the copy changed size", kRangedSourceSize + 100000, false);
+
+		// nor once the remote file has been replaced by another of the same size
+		InterruptCopy("cancel a copy", "resume.dat", "resume-copy.dat", false);
+		MakeSource("resume.dat", kRangedSourceSize + 100000, 32);
+		ResumeCopy("resume after the source was replaced", kRangedSourceSize + 100000, false);
+	}
+
+	// a server that won't serve ranges can't send the rest of a file, so resuming fails, and throws away the
+	// checkpoint; QTDR_RunTransfer then starts over. Unless the chunk the checkpoint keeps a checksum of is
+	// the first, the server can't send that either, so the copy starts over straight away
+	if (gNoRanges || myIsFileURL) {
+		StubURL_SetServesRanges(false);
+
+		InterruptCopy("cancel a copy", "resume.dat", "resume-copy.dat", false);
+		Check(FileExists("resume-copy.dat.qtdc"), "a cancelled copy", "leaves a checkpoint");
+		myErr = CopySource("resume.dat", "resume-copy.dat", &myBytes, &myThroughput);
+		Check((myErr != noErr) || SameContents("resume.dat", "resume-copy.dat"), "resume with no ranges served", "fails, or starts over");
+		Check(!FileExists("resume-copy.dat.qtdc"), "resume with no ranges served", "checkpoint thrown away");
+
+		InterruptCopy("cancel a copy", "resume.dat", "resume-copy.dat", false);
+		myErr = RunSource("resume.dat", "resume-copy.dat");
+		Check(myErr == noErr, "run a resumed copy with no ranges served", "resume.dat");
+		Check(SameContents("resume.dat", "resume-copy.dat"), "run a resumed copy with no ranges served", "copy matches");
+		Check(!FileExists("resume-copy.dat.qtdc"), "run a resumed copy with no ranges served", "checkpoint removed");
+
+		StubURL_SetServesRanges(!gNoRanges);
+	}
+
+	QTDR_SetTransferStreams(kNumTransferStreams);
+}
+
+static void PutBigEndian (UInt32 theValue, FILE *theFile)
+{
+	fputc((theValue >> 24) & 0xFF, theFile);
+	fputc((theValue >> 16) & 0xFF, theFile);
+	fputc((theValue >> 8) & 0xFF, theFile);
+	fputc(theValue & 0xFF, theFile);
+}
+
+// write a stand-in movie (see MacStubs.h) with its media data first and its movie atom at the end, as a
+// movie that's been recorded straight to disk has it; return the size of the file, and where the samples are
+static long MakeMovieSource (const char *theName, long *theSampleOffsets, long *theSampleSizes)
+{
+	FILE				*myFile = fopen(theName, "wb");
+	long				myDataSize = 0;
+	long				myIndex, myByte;
+
+	if (myFile == NULL)
+		return(0);
+
+	for (myIndex = 0; myIndex < kMovieNumSamples; myIndex++) {
+		theSampleOffsets[myIndex] = 16 + 8 + myDataSize;
+		theSampleSizes[myIndex] = 65536 + (myIndex * 977) % 4096;
+		myDataSize += theSampleSizes[myIndex];
+	}
+
+	PutBigEndian(16, myFile);
+	PutBigEndian('ftyp', myFile);
+	PutBigEndian('qt  ', myFile);
+	PutBigEndian(0, myFile);
+
+	PutBigEndian(8 + myDataSize, myFile);
+	PutBigEndian('mdat', myFile);
+	gSeed = 40;
+	for (myByte = 0; myByte < myDataSize; myByte++)
+		fputc(NextRandom() & 0xFF, myFile);
+
+	PutBigEndian(16 + 8 * kMovieNumSamples, myFile);
+	PutBigEndian(MovieAID, myFile);
+	PutBigEndian(kMovieNumSamples, myFile);
+	PutBigEndian(kMovieSyncInterval, myFile);
+	for (myIndex = 0; myIndex < kMovieNumSamples; myIndex++) {
+		PutBigEndian(theSampleOffsets[myIndex], myFile);
+		PutBigEndian(theSampleSizes[myIndex], myFile);
+	}
+
+	fclose(myFile);
+	return(16 + 8 + myDataSize + 16 + 8 * kMovieNumSamples);
+}
+
+// find the first chunk of theCopy that theTransfer hasn't written yet, and return true if it reads as zeros in
+// the local file, as it does to a movie opened by QTDR_GetMovieFromTransfer; return false if there's no such chunk
+static Boolean UnwrittenChunkReadsAsZeros (QTDRTransferPtr theTransfer, const char *theCopy, long theChunkSize, long theFileSize)
+{
+	char				myChunk[65536];
+	long				myOffset, myCount, myIndex;
+	Boolean				isZeros = false;
+	int					myFD;
+
+	if (theChunkSize > (long)sizeof(myChunk))
+		return(false);
+
+	for (myOffset = 0; myOffset < theFileSize; myOffset += theChunkSize) {
+		myCount = (theFileSize - myOffset < theChunkSize) ? theFileSize - myOffset : theChunkSize;
+		if (QTDR_IsRangeTransferred(theTransfer, myOffset, myCount))
+			continue;
+
+		myFD = open(theCopy, O_RDONLY);
+		if ((myFD >= 0) && (pread(myFD, myChunk, myCount, myOffset) == myCount)) {
+			isZeros = true;
+			for (myIndex = 0; myIndex < myCount; myIndex++)
+				isZeros = isZeros && (myChunk[myIndex] == 0);
+		}
+		if (myFD >= 0)
+			close(myFD);
+		break;
+	}
+
+	return(isZeros);
+}
+
+// open a movie while it's being copied, and wait for what's needed to draw its middle frame; with byte
+// ranges, the movie atom (at the end) and the samples for that frame are fetched ahead of the rest
+static void RunProgressiveTransfers (void)
+{
+	QTDRTransferPtr		myTransfer = NULL;
+	Movie				myMovie = NULL;
+	FSSpec				myFile;
+	char				myURL[2048];
+	long				myOffsets[kMovieNumSamples], mySizes[kMovieNumSamples];
+	long				mySize, myIndex;
+	SInt64				myBytes;
+	TimeValue			myTime = kMovieNumSamples / 2;
+	Boolean				myHasSamples = true;
+	OSErr				myErr;
+
+	mySize = MakeMovieSource("movie.dat", myOffsets, mySizes);
+	QTDR_SetTransferBuffers(8, 16384);
+	QTDR_SetTransferStreams(4);
+
+	snprintf(myURL, sizeof(myURL), "%smovie.dat", gBaseURL);
+	MakeFileSpec("movie-copy.dat", &myFile);
+
+	myErr = QTDR_NewTransfer(myURL, &myFile, &myTransfer);
+	if (myErr == noErr)
+		myErr = QTDR_StartTransfer(myTransfer);
+	Check(myErr == noErr, "start copying a movie", "movie.dat");
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTDR_GetMovieFromTransfer(myTransfer, &myMovie);
+	Check((myErr == noErr) && (myMovie != NULL), "open a movie while it's copied", "movie.dat");
+	if (myMovie == NULL)
+		goto bail;
+
+	QTDR_GetTransferProgress(myTransfer, &myBytes, NULL);
+	if (!gNoRanges)
+		Check(myBytes < mySize, "open a movie while it's copied", "the movie atom arrives first");
+
+	myErr = QTDR_WaitForMovieTime(myTransfer, myMovie, myTime);
+	Check(myErr == noErr, "wait for the middle of a movie", "movie.dat");
+	for (myIndex = myTime - (myTime % kMovieSyncInterval); myIndex <= myTime; myIndex++)
+		myHasSamples = myHasSamples && QTDR_IsRangeTransferred(myTransfer, myOffsets[myIndex], mySizes[myIndex]);
+	Check(myHasSamples, "wait for the middle of a movie", "the samples from the sync sample on are there");
+
+	QTDR_GetTransferProgress(myTransfer, &myBytes, NULL);
+	if (!gNoRanges)
+		Check(myBytes < mySize, "wait for the middle of a movie", "those samples arrive first");
+
+	// nothing gates the movie's own reads, so the data no one has waited for yet is there, but as zeros
+	if (!gNoRanges)
+		Check(UnwrittenChunkReadsAsZeros(myTransfer, "movie-copy.dat", 16384, mySize), "read data no one waited for", "it reads as zeros");
+
+	Check(QTDR_WaitForTransferRange(myTransfer, mySize - 10, 20) == eofErr, "wait for a range past the end", "movie.dat");
+
+	while (!QTDR_TaskTransfer(myTransfer))
+		;
+	QTDR_CloseTransfer(myTransfer);
+	Check(QTDR_GetTransferError(myTransfer) == noErr, "finish copying a movie", "movie.dat");
+	Check(SameContents("movie.dat", "movie-copy.dat"), "finish copying a movie", "copy matches");
+	Check(QTDR_WaitForTransferRange(myTransfer, 0, mySize) == noErr, "wait for a range of a finished copy", "movie.dat");
+
+bail:
+	if (myMovie != NULL)
+		DisposeMovie(myMovie);
+	QTDR_DisposeTransfer(myTransfer);
+	QTDR_SetTransferStreams(kNumTransferStreams);
+}
+
+// start copying a file bigger than 4 GB, wait for a range past 4 GB, and cancel; then resume the copy from
+// its checkpoint. The source and the copy are sparse files, so only the chunks fetched take up any room
+static void RunBigTransfer (void)
+{
+	static const char	kMarker[] = "past the first 4 GB";
+	QTDRTransferPtr		myTransfer = NULL;
+	FSSpec				myFile;
+	char				myURL[2048];
+	char				myBytesRead[sizeof(kMarker)];
+	SInt64				myBytes, myBytesToTransfer;
+	FILE				*mySource = fopen("big.dat", "wb");
+	int					myFD;
+	long				myPass;
+	OSErr				myErr;
+
+	if ((mySource == NULL) || (fseeko(mySource, kBigMarkerOffset, SEEK_SET) != 0) || (fwrite(kMarker, sizeof(kMarker), 1, mySource) != 1) ||
+		(ftruncate(fileno(mySource), kBigSourceSize) != 0)) {
+		if (mySource != NULL)
+			fclose(mySource);
+		printf("skipping the copy bigger than 4 GB: can't make a sparse source\n");
+		return;
+	}
+	fclose(mySource);
+
+	QTDR_SetTransferBuffers(8, 64 * 1024);
+	QTDR_SetTransferStreams(4);
+	snprintf(myURL, sizeof(myURL), "%sbig.dat", gBaseURL);
+	MakeFileSpec("big-copy.dat", &myFile);
+
+	// the first pass starts the copy, and the second resumes it
+	for (myPass = 0; myPass < 2; myPass++) {
+		myErr = QTDR_NewTransfer(myURL, &myFile, &myTransfer);
+		if (myErr == noErr)
+			myErr = QTDR_StartTransfer(myTransfer);
+		Check(myErr == noErr, myPass ? "resume a copy bigger than 4 GB" : "start a copy bigger than 4 GB", "big.dat");
+		if (myErr != noErr) {
+			QTDR_DisposeTransfer(myTransfer);
+			break;
+		}
+
+		QTDR_GetTransferProgress(myTransfer, &myBytes, &myBytesToTransfer);
+		Check(myBytesToTransfer == kBigSourceSize, "a copy bigger than 4 GB", "the size isn't truncated");
+		if (myPass == 1)
+			Check(myBytes > 0 && QTDR_IsRangeTransferred(myTransfer, kBigMarkerOffset, sizeof(kMarker)), "resume a copy bigger than 4 GB",
+				  "the checkpoint has the range past 4 GB");
+		Check(!QTDR_IsRangeTransferred(myTransfer, kBigSourceSize - 5, 10), "a copy bigger than 4 GB", "no range past the end");
+
+		Check(QTDR_WaitForTransferRange(myTransfer, kBigMarkerOffset, sizeof(kMarker)) == noErr, "a copy bigger than 4 GB", "wait for a range past 4 GB");
+		myFD = open("big-copy.dat", O_RDONLY);
+		Check((myFD >= 0) && (pread(myFD, myBytesRead, sizeof(myBytesRead), kBigMarkerOffset) == sizeof(myBytesRead)) &&
+			  (memcmp(myBytesRead, kMarker, sizeof(kMarker)) == 0), "a copy bigger than 4 GB", "the range past 4 GB is written where it belongs");
+		if (myFD >= 0)
+			close(myFD);
+
+		QTDR_CancelTransfer(myTransfer);
+		while (!QTDR_TaskTransfer(myTransfer))
+			;
+		QTDR_CloseTransfer(myTransfer);
+		QTDR_DisposeTransfer(myTransfer);
+		myTransfer = NULL;
+		Check(FileExists("big-copy.dat.qtdc"), "cancel a copy bigger than 4 GB", "leaves a checkpoint");
+	}
+
+	unlink("big.dat");
+	unlink("big-copy.dat");
+	unlink("big-copy.dat.qtdc");
+	QTDR_SetTransferStreams(kNumTransferStreams);
+}
+
+static void RunMissingSource (void)
+{
+	SInt64				myBytes;
+	Float64				myThroughput;
+
+	Check(CopySource("missing.dat", "missing-copy.dat", &myBytes, &myThroughput) != noErr, "a missing source fails", "missing.dat");
+}
+
+// called on the main thread (the one in RunCurrentEventLoop) as each queued transfer is done
+static void QueuedCopyDone (QTDRTransferPtr theTransfer, void *theRefCon)
+{
+	QueuedCopy			*myCopy = (QueuedCopy *)theRefCon;
+
+	Check(theTransfer == myCopy->transfer, "the done proc gets its own transfer", "queued");
+	myCopy->numDoneCalls++;
+
+	if (++gNumQueuedDone == kNumQueuedCopies)
+		QuitEventLoop(GetMainEventLoop());
+}
+
+// queue more transfers than may run at once, cancel the last while it's still waiting, and watch how many run
+static void RunQueuedTransfers (void)
+{
+	QueuedCopy			myCopies[kNumQueuedCopies];
+	char				mySource[64], myCopy[64], myURL[2048];
+	FSSpec				myFile;
+	long				myIndex, myRunning, myMaxRunning = 0;
+	SInt64				myBytes, myBytesToTransfer;
+	OSErr				myErr;
+
+	QTDR_SetTransferBuffers(4, 16384);
+	Check(QTDR_SetMaxConcurrentTransfers(0) == paramErr, "a limit of no transfers is refused", "queued");
+	Check(QTDR_SetMaxConcurrentTransfers(kMaxQueuedRunning) == noErr, "set the limit", "queued");
+
+	for (myIndex = 0; myIndex < kNumQueuedCopies; myIndex++) {
+		snprintf(mySource, sizeof(mySource), "queued-%ld.dat", myIndex);
+		MakeSource(mySource, kQueuedSourceSize, myIndex + 10);
+	}
+
+	memset(myCopies, 0, sizeof(myCopies));
+	gNumQueuedDone = 0;
+	for (myIndex = 0; myIndex < kNumQueuedCopies; myIndex++) {
+		snprintf(myURL, sizeof(myURL), "%squeued-%ld.dat", gBaseURL, myIndex);
+		snprintf(myCopy, sizeof(myCopy), "queued-%ld-copy.dat", myIndex);
+		MakeFileSpec(myCopy, &myFile);
+
+		myErr = QTDR_NewTransfer(myURL, &myFile, &myCopies[myIndex].transfer);
+		if (myErr == noErr)
+			myErr = QTDR_QueueTransfer(myCopies[myIndex].transfer, QueuedCopyDone, &myCopies[myIndex]);
+		Check(myErr == noErr, "queue a transfer", myCopy);
+		if (myErr != noErr) {
+			QTDR_DisposeTransfer(myCopies[myIndex].transfer);
+			myCopies[myIndex].transfer = NULL;
+			gNumQueuedDone++;
+		}
+	}
+
+	Check(QTDR_SetMaxConcurrentTransfers(kMaxQueuedRunning + 1) == paramErr, "the limit can't change while there are workers", "queued");
+
+	// the last transfer is behind others on its worker, so cancelling it now stops it before it starts
+	QTDR_CancelTransfer(myCopies[kNumQueuedCopies - 1].transfer);
+
+	// count the transfers that have started and aren't done every millisecond, until they're all done
+	while (gNumQueuedDone < kNumQueuedCopies) {
+		if (RunCurrentEventLoop(0.001) == eventLoopQuitErr)
+			break;
+
+		myRunning = 0;
+		for (myIndex = 0; myIndex < kNumQueuedCopies; myIndex++) {
+			if (myCopies[myIndex].transfer == NULL)
+				continue;
+			QTDR_GetTransferProgress(myCopies[myIndex].transfer, &myBytes, &myBytesToTransfer);
+			if ((myBytesToTransfer > 0) && !QTDR_IsTransferDone(myCopies[myIndex].transfer))
+				myRunning++;
+		}
+		if (myRunning > myMaxRunning)
+			myMaxRunning = myRunning;
+	}
+
+	Check(myMaxRunning <= kMaxQueuedRunning, "no more transfers run at once than the limit", "queued");
+
+	for (myIndex = 0; myIndex < kNumQueuedCopies; myIndex++) {
+		snprintf(mySource, sizeof(mySource), "queued-%ld.dat", myIndex);
+		snprintf(myCopy, sizeof(myCopy), "queued-%ld-copy.dat", myIndex);
+		if (myCopies[myIndex].transfer == NULL)
+			continue;
+
+		Check(myCopies[myIndex].numDoneCalls == 1, "the done proc is called once", myCopy);
+		QTDR_GetTransferProgress(myCopies[myIndex].transfer, &myBytes, NULL);
+		myErr = QTDR_GetTransferError(myCopies[myIndex].transfer);
+		if (myIndex == kNumQueuedCopies - 1) {
+			Check(myErr == userCanceledErr, "a transfer cancelled before it starts", myCopy);
+			Check(myBytes == 0, "a transfer cancelled before it starts copies nothing", myCopy);
+		} else {
+			Check(myErr == noErr, "a queued transfer", myCopy);
+			Check(myBytes == kQueuedSourceSize, "queued transfer bytes transferred", myCopy);
+			Check(SameContents(mySource, myCopy), "queued copy matches", myCopy);
+		}
+
+		QTDR_DisposeTransfer(myCopies[myIndex].transfer);
+		unlink(mySource);
+		unlink(myCopy);
+	}
+
+	QTDR_ReleaseTransferWorkers();
+	Check(QTDR_SetMaxConcurrentTransfers(kNumTransferWorkers) == noErr, "the limit can change once the workers are released", "queued");
+}
+
+static void RemoveScratchFiles (void)
+{
+	static const char	*kNames[] = {
+		"big.dat", "big-copy.dat", "big-copy.dat.qtdc", "layouts.dat", "layouts-copy.dat", "ranged.dat", "ranged-copy.dat", "resume.dat", "resume-copy.dat", "resume-copy.dat.qtdc", "movie.dat", "movie-copy.dat", "edge-0.dat", "edge-5.dat", "edge-65536.dat", "edge-copy.dat", "missing-copy.dat"
+	};
+	long				myIndex;
+
+	for (myIndex = 0; myIndex < (long)(sizeof(kNames) / sizeof(kNames[0])); myIndex++)
+		unlink(kNames[myIndex]);
+}
+
+int main (int argc, char *argv[])
+{
+	char				myScratch[] = "/tmp/TransferTest.XXXXXX";
+	const char			*myFolder = NULL;
+	const char			*myURL = NULL;
+	int					myArg;
+
+	for (myArg = 1; myArg < argc; myArg++) {
+		if (strcmp(argv[myArg], "-noranges") == 0)
+			gNoRanges = true;
+		else if ((strcmp(argv[myArg], "-dir") == 0) && (myArg + 1 < argc))
+			myFolder = argv[++myArg];
+		else if ((strcmp(argv[myArg], "-url") == 0) && (myArg + 1 < argc))
+			myURL = argv[++myArg];
+		else
+			break;
+	}
+
+	if ((myArg != argc) || ((myURL != NULL) && (myFolder == NULL))) {
+		fprintf(stderr, "usage: TransferTest [-dir folder -url base-url] [-noranges]\n");
+		return(2);
+	}
+
+	if (myFolder == NULL)
+		myFolder = mkdtemp(myScratch);
+
+	if ((myFolder == NULL) || (chdir(myFolder) != 0)) {
+		fprintf(stderr, "TransferTest: can't use folder \"%s\"\n", (myFolder != NULL) ? myFolder : myScratch);
+		return(1);
+	}
+
+	// the sources are in the same folder as the copies, but the copies are made through the URLs
+	if (myURL != NULL)
+		snprintf(gBaseURL, sizeof(gBaseURL), "%s", myURL);
+	else
+		snprintf(gBaseURL, sizeof(gBaseURL), "file://%s/", myFolder);
+
+	if (gNoRanges)
+		StubURL_SetServesRanges(false);
+
+	srand(1);
+	RunBufferLayouts();
+	RunEdgeCases();
+	RunRangedTransfers();
+	RunResumedTransfers();
+	RunProgressiveTransfers();
+	if (!gNoRanges)
+		RunBigTransfer();
+	RunMissingSource();
+	RunQueuedTransfers();
+
+	RemoveScratchFiles();
+	if (myFolder == myScratch)
+		rmdir(myScratch);
+
+	printf("TransferTest (%s%s): %d checks, %d failures\n", gBaseURL, gNoRanges ? ", no ranges" : "", gChecks, gFailures);
+	return(gFailures == 0 ? 0 : 1);
+}
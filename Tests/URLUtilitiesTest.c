@@ -0,0 +1,340 @@
+/*
+	File:		URLUtilitiesTest.c
+
+	Description: Checks of the URL encoding routines in URLUtilities.c: fixed cases, including the
+				malformed escapes that URLUtils_DecodeBytes must copy through unchanged, a round trip
+				of every byte value, and a fuzz run that compares URLUtils_DecodeBytes against a
+				plain byte-at-a-time decoder and checks that neither routine writes past its buffer.
+				Where URLUtils_EncodeBytes classifies 16 characters at a time, it and URLUtils_GetEncodedLength
+				are also checked against their one-at-a-time reference versions. Run with -bench to time
+				the two against each other.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "URLUtilities.h"
+
+#define kGuardByte			0xA5
+#define kGuardLength		16
+#define kFuzzIterations		20000
+#define kFuzzMaxLength		200
+
+static int gFailures = 0;
+static int gChecks = 0;
+static unsigned long gSeed = 1;
+
+static UInt32 NextRandom (void)
+{
+	gSeed = gSeed * 1103515245 + 12345;
+	return((UInt32)(gSeed >> 16) & 0x7FFF);
+}
+
+static void Check (Boolean theCondition, const char *theWhat, const char *theInput)
+{
+	gChecks++;
+	if (!theCondition) {
+		printf("FAIL %s: \"%s\"\n", theWhat, theInput);
+		gFailures++;
+	}
+}
+
+static int HexValue (char theChar)
+{
+	if ((theChar >= '0') && (theChar <= '9'))
+		return(theChar - '0');
+	if ((theChar >= 'a') && (theChar <= 'f'))
+		return(theChar - 'a' + 10);
+	if ((theChar >= 'A') && (theChar <= 'F'))
+		return(theChar - 'A' + 10);
+	return(-1);
+}
+
+// the obvious decoder, one byte at a time: "%" and two hex digits is a byte, and anything else is itself
+static size_t ReferenceDecode (const char *theString, size_t theLength, char *theBuffer)
+{
+	size_t		myIn = 0, myOut = 0;
+
+	while (myIn < theLength) {
+		if ((theString[myIn] == '%') && (myIn + 2 < theLength) && (HexValue(theString[myIn + 1]) >= 0) && (HexValue(theString[myIn + 2]) >= 0)) {
+			theBuffer[myOut++] = (char)((HexValue(theString[myIn + 1]) << 4) | HexValue(theString[myIn + 2]));
+			myIn += 3;
+		} else {
+			theBuffer[myOut++] = theString[myIn++];
+		}
+	}
+
+	theBuffer[myOut] = '\0';
+	return(myOut);
+}
+
+// decode theString into a guarded buffer and compare with theExpected
+static void CheckDecode (const char *theString, const char *theExpected)
+{
+	size_t		myLength = strlen(theString);
+	char		*myBuffer = malloc(myLength + 1 + kGuardLength);
+	size_t		myDecodedLength;
+	size_t		myIndex;
+
+	memset(myBuffer, kGuardByte, myLength + 1 + kGuardLength);
+	myDecodedLength = URLUtils_DecodeBytes(theString, myLength, myBuffer);
+	Check((myDecodedLength == strlen(theExpected)) && (strcmp(myBuffer, theExpected) == 0), "decode", theString);
+
+	for (myIndex = myLength + 1; myIndex < myLength + 1 + kGuardLength; myIndex++)
+		if ((UInt8)myBuffer[myIndex] != kGuardByte)
+			break;
+	Check(myIndex == myLength + 1 + kGuardLength, "decode stays inside its buffer", theString);
+
+	// decoding in place gives the same result
+	strcpy(myBuffer, theString);
+	myDecodedLength = URLUtils_DecodeBytes(myBuffer, myLength, myBuffer);
+	Check((myDecodedLength == strlen(theExpected)) && (strcmp(myBuffer, theExpected) == 0), "decode in place", theString);
+
+	free(myBuffer);
+}
+
+// encode theString and compare with theExpected; the length estimate must be exact
+static void CheckEncode (const char *theString, const char *theExpected)
+{
+	size_t		myLength = strlen(theString);
+	size_t		myEncodedLength = URLUtils_GetEncodedLength(theString, myLength);
+	char		*myBuffer = malloc(myEncodedLength + 1);
+
+	Check(myEncodedLength == strlen(theExpected), "encoded length", theString);
+	Check(URLUtils_EncodeBytes(theString, myLength, myBuffer) == myEncodedLength, "encode returns its length", theString);
+	Check(strcmp(myBuffer, theExpected) == 0, "encode", theString);
+
+	free(myBuffer);
+}
+
+static void RunFixedCases (void)
+{
+	CheckEncode("", "");
+	CheckEncode("movie.mov", "movie.mov");
+	CheckEncode("My Movie.mov", "My%20Movie.mov");
+	CheckEncode("100%", "100%25");
+	CheckEncode("a<b>#c", "a%3Cb%3E%23c");
+	CheckEncode("{|}\\^~[]`", "%7B%7C%7D%5C%5E%7E%5B%5D%60");
+	CheckEncode("/path/with;reserved?chars=&@:", "/path/with;reserved?chars=&@:");
+	CheckEncode("tab\there", "tab%09here");
+	CheckEncode("caf\xE9", "caf%E9");
+	CheckEncode("\x7F", "%7F");
+
+	CheckDecode("", "");
+	CheckDecode("movie.mov", "movie.mov");
+	CheckDecode("My%20Movie.mov", "My Movie.mov");
+	CheckDecode("%2f%2F", "//");
+	CheckDecode("%41%42%43", "ABC");
+	CheckDecode("caf%E9", "caf\xE9");
+
+	// an escape character that isn't followed by two hex digits is copied through, and so is what follows it
+	CheckDecode("%", "%");
+	CheckDecode("100%", "100%");
+	CheckDecode("%4", "%4");
+	CheckDecode("abc%4", "abc%4");
+	CheckDecode("%G1", "%G1");
+	CheckDecode("%1G", "%1G");
+	CheckDecode("%%41", "%A");
+	CheckDecode("%%%", "%%%");
+	CheckDecode("50% off", "50% off");
+	CheckDecode("%2", "%2");
+	CheckDecode("%-1%+1", "%-1%+1");
+	CheckDecode("%2541", "%41");
+
+	// a %00 is a byte like any other, so the decoded length counts past it
+	{
+		char	myBuffer[8];
+
+		Check((URLUtils_DecodeBytes("a%00b", 5, myBuffer) == 3) && (myBuffer[0] == 'a') && (myBuffer[1] == '\0') && (myBuffer[2] == 'b'), "decode %00", "a%00b");
+	}
+
+	// only theLength bytes are looked at, even if the escape would continue past them
+	{
+		char	myBuffer[8];
+
+		Check((URLUtils_DecodeBytes("x%41", 3, myBuffer) == 3) && (strcmp(myBuffer, "x%4") == 0), "decode stops at theLength", "x%41");
+	}
+}
+
+static void RunRoundTrip (void)
+{
+	char		myString[256];
+	char		myEncoded[256 * 3 + 1];
+	char		myDecoded[256 * 3 + 1];
+	size_t		myEncodedLength, myDecodedLength;
+	size_t		myIndex;
+
+	// every byte value, including NUL, survives encoding and decoding
+	for (myIndex = 0; myIndex < 256; myIndex++)
+		myString[myIndex] = (char)myIndex;
+
+	myEncodedLength = URLUtils_EncodeBytes(myString, 256, myEncoded);
+	Check(myEncodedLength == URLUtils_GetEncodedLength(myString, 256), "encoded length of every byte", "0x00-0xFF");
+
+	// and the encoded form has no characters that need encoding
+	for (myIndex = 0; myIndex < myEncodedLength; myIndex++)
+		if (URLUtils_IsEncodableChar(myEncoded[myIndex]) && (myEncoded[myIndex] != '%'))
+			break;
+	Check(myIndex == myEncodedLength, "encoded form is clean", "0x00-0xFF");
+
+	myDecodedLength = URLUtils_DecodeBytes(myEncoded, myEncodedLength, myDecoded);
+	Check((myDecodedLength == 256) && (memcmp(myDecoded, myString, 256) == 0), "round trip of every byte", "0x00-0xFF");
+}
+
+static void RunFuzz (void)
+{
+	static const char	kAlphabet[] = "%%%%0123456789abcdefABCDEFgG/?:# \x80\xFF";
+	char				myString[kFuzzMaxLength];
+	char				myEncoded[kFuzzMaxLength * 3 + 1 + kGuardLength];
+	char				myDecoded[kFuzzMaxLength * 3 + 1 + kGuardLength];
+	char				myExpected[kFuzzMaxLength + 1];
+	size_t				myLength, myEncodedLength, myDecodedLength, myIndex;
+	int					myIteration;
+	int					myFailuresBefore = gFailures;
+
+	for (myIteration = 0; myIteration < kFuzzIterations; myIteration++) {
+		myLength = NextRandom() % kFuzzMaxLength;
+
+		// half the time any bytes at all, and half the time mostly escapes and hex digits, to hit the malformed cases
+		for (myIndex = 0; myIndex < myLength; myIndex++)
+			myString[myIndex] = (myIteration & 1) ? (char)(NextRandom() & 0xFF) : kAlphabet[NextRandom() % (sizeof(kAlphabet) - 1)];
+
+		// encoding then decoding gives back the original
+		memset(myEncoded, kGuardByte, sizeof(myEncoded));
+		myEncodedLength = URLUtils_EncodeBytes(myString, myLength, myEncoded);
+		Check(myEncodedLength == URLUtils_GetEncodedLength(myString, myLength), "fuzz: encoded length", "(random)");
+		Check((UInt8)myEncoded[myEncodedLength + 1] == kGuardByte, "fuzz: encode stays inside its buffer", "(random)");
+
+		myDecodedLength = URLUtils_DecodeBytes(myEncoded, myEncodedLength, myDecoded);
+		Check((myDecodedLength == myLength) && (memcmp(myDecoded, myString, myLength) == 0), "fuzz: round trip", "(random)");
+
+		// decoding the raw string, malformed escapes and all, agrees with the plain decoder
+		memset(myDecoded, kGuardByte, sizeof(myDecoded));
+		myDecodedLength = URLUtils_DecodeBytes(myString, myLength, myDecoded);
+		Check((myDecodedLength == ReferenceDecode(myString, myLength, myExpected)) &&
+			  (memcmp(myDecoded, myExpected, myDecodedLength + 1) == 0), "fuzz: decode matches the reference", "(random)");
+		Check((UInt8)myDecoded[myLength + 1] == kGuardByte, "fuzz: decode stays inside its buffer", "(random)");
+
+		if (gFailures - myFailuresBefore > 10)
+			break;
+	}
+}
+
+// encode theLength bytes of theString with both the vector and the reference versions and compare
+static void CheckEncodeAgainstReference (const char *theString, size_t theLength, const char *theWhat)
+{
+	char		*myEncoded = malloc(theLength * 3 + 1);
+	char		*myExpected = malloc(theLength * 3 + 1);
+	size_t		myLength, myExpectedLength;
+
+	myExpectedLength = URLUtils_EncodeBytesReference(theString, theLength, myExpected);
+	myLength = URLUtils_EncodeBytes(theString, theLength, myEncoded);
+	Check((myLength == myExpectedLength) && (memcmp(myEncoded, myExpected, myLength + 1) == 0), "encode matches the reference", theWhat);
+	Check(URLUtils_GetEncodedLength(theString, theLength) == URLUtils_GetEncodedLengthReference(theString, theLength), "encoded length matches the reference", theWhat);
+	Check(URLUtils_GetEncodedLength(theString, theLength) == myExpectedLength, "encoded length", theWhat);
+
+	free(myExpected);
+	free(myEncoded);
+}
+
+static void RunVectorChecks (void)
+{
+	char		myString[64];
+	char		*myLong;
+	size_t		myLength, myIndex, myPosition;
+	int			myByte, myIteration;
+
+	// every byte value, at every position of a block and its neighbours, in a string of characters that need no encoding
+	for (myByte = 0; myByte < 256; myByte++) {
+		for (myPosition = 0; myPosition < 48; myPosition++) {
+			memset(myString, 'a', sizeof(myString));
+			myString[myPosition] = (char)myByte;
+			CheckEncodeAgainstReference(myString, 48, "one byte in a block");
+		}
+	}
+
+	// random strings of every length, from clean to dense
+	for (myIteration = 0; myIteration < kFuzzIterations; myIteration++) {
+		UInt32		myDensity = NextRandom() % 64;
+
+		myLength = NextRandom() % kFuzzMaxLength;
+		myLong = malloc(myLength + 1);
+		for (myIndex = 0; myIndex < myLength; myIndex++)
+			myLong[myIndex] = ((NextRandom() % 64) < myDensity) ? (char)(NextRandom() & 0xFF) : (char)('a' + (NextRandom() % 26));
+		CheckEncodeAgainstReference(myLong, myLength, "(random)");
+		free(myLong);
+	}
+
+	// long enough that the vector count has to add up its lanes more than once
+	myLength = 255 * 16 * 3 + 5;
+	myLong = malloc(myLength);
+	memset(myLong, ' ', myLength);
+	CheckEncodeAgainstReference(myLong, myLength, "(all spaces)");
+	free(myLong);
+}
+
+static double TimeEncode (Boolean theVector, Boolean theLengthOnly, const char *theString, size_t theLength, char *theBuffer, int theIterations)
+{
+	clock_t		myStart = clock();
+	int			myIteration;
+
+	for (myIteration = 0; myIteration < theIterations; myIteration++) {
+		if (theLengthOnly)
+			theBuffer[myIteration & 0xFF] = (char)(theVector ? URLUtils_GetEncodedLength(theString, theLength) : URLUtils_GetEncodedLengthReference(theString, theLength));
+		else if (theVector)
+			URLUtils_EncodeBytes(theString, theLength, theBuffer);
+		else
+			URLUtils_EncodeBytesReference(theString, theLength, theBuffer);
+	}
+
+	// megabytes of input per second
+	return((double)theLength * theIterations / 1000000.0 / ((double)(clock() - myStart) / CLOCKS_PER_SEC));
+}
+
+static void RunBenchmark (void)
+{
+	static const char	*kInputs[] = { "/Volumes/Movies/Summer/dog_on_the_beach.mov", "/Volumes/Big Disk/My Movies/Dog on the beach #2.mov", NULL };
+	static const char	*kLabels[] = { "path, nothing to encode", "path with spaces", "random bytes" };
+	const size_t		kLength = 1 << 20;
+	char				*myString = malloc(kLength);
+	char				*myBuffer = malloc(kLength * 3 + 1);
+	size_t				myInput, myIndex;
+	int					myLengthOnly;
+
+	printf("%-32s %12s %12s %8s\n", "encode (MB/s of input)", "scalar", "vector", "speedup");
+	for (myInput = 0; myInput < sizeof(kLabels) / sizeof(kLabels[0]); myInput++) {
+		// a megabyte of the same path over and over, or of random bytes
+		for (myIndex = 0; myIndex < kLength; myIndex++)
+			myString[myIndex] = (kInputs[myInput] != NULL) ? kInputs[myInput][myIndex % strlen(kInputs[myInput])] : (char)(NextRandom() & 0xFF);
+
+		for (myLengthOnly = 1; myLengthOnly >= 0; myLengthOnly--) {
+			double		myScalar = TimeEncode(false, myLengthOnly, myString, kLength, myBuffer, 200);
+			double		myVector = TimeEncode(true, myLengthOnly, myString, kLength, myBuffer, 200);
+			char		myLabel[64];
+
+			snprintf(myLabel, sizeof(myLabel), "%s, %s", kLabels[myInput], myLengthOnly ? "length" : "bytes");
+			printf("%-32s %12.1f %12.1f %7.2fx\n", myLabel, myScalar, myVector, myScalar > 0 ? myVector / myScalar : 0.0);
+		}
+	}
+
+	free(myBuffer);
+	free(myString);
+}
+
+int main (int argc, char *argv[])
+{
+	if ((argc > 1) && (strcmp(argv[1], "-bench") == 0)) {
+		RunBenchmark();
+		return(0);
+	}
+
+	RunFixedCases();
+	RunRoundTrip();
+	RunFuzz();
+	RunVectorChecks();
+
+	printf("URLUtilitiesTest: %d checks, %d failures (%s classification)\n", gChecks, gFailures, URLUtils_IsVectorized() ? "vector" : "scalar");
+	return(gFailures == 0 ? 0 : 1);
+}
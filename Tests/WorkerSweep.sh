@@ -0,0 +1,89 @@
+#!/bin/sh
+#
+# WorkerSweep.sh
+#
+# Time a batch import of one folder of movies with different -workers counts, over HTTP from
+# StandInServer.py, so that the URL data handler and the transfer engine can be measured against a
+# network with some latency and a capped bandwidth rather than against the local disk. For each count,
+# the batch's summary goes to <out>/workers-<n>.txt and its per-file metrics to <out>/workers-<n>.csv;
+# the summary lines are also collected in <out>/sweep.txt.
+#
+#	WorkerSweep.sh [-dh url|copy|progressive] [-workers "1 2 4 8 16"] [-latency seconds]
+#		[-bandwidth bytes] [-out folder] path/to/ThreadsImportMovie folder
+#
+# The defaults are -dh url, -workers "1 2 4 8 16", -latency 0.05, -bandwidth 4000000 (about 32 Mb/s
+# per connection), and -out sweep in the current folder. Any other batch arguments (-size, -contact,
+# -transfers...) can be passed in BATCH_ARGS.
+#
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+DH=url
+WORKERS="1 2 4 8 16"
+LATENCY=0.05
+BANDWIDTH=4000000
+OUT=sweep
+
+usage () {
+	echo "usage: WorkerSweep.sh [-dh url|copy|progressive] [-workers \"n ...\"] [-latency seconds]" >&2
+	echo "                      [-bandwidth bytes] [-out folder] path/to/ThreadsImportMovie folder" >&2
+	exit 2
+}
+
+while [ $# -gt 2 ]; do
+	case "$1" in
+	-dh) DH=$2 ;;
+	-workers) WORKERS=$2 ;;
+	-latency) LATENCY=$2 ;;
+	-bandwidth) BANDWIDTH=$2 ;;
+	-out) OUT=$2 ;;
+	*) usage ;;
+	esac
+	shift 2
+done
+[ $# -eq 2 ] || usage
+APP=$1
+MOVIES=$(cd "$2" && pwd) || exit 1
+
+if ! command -v python3 >/dev/null 2>&1; then
+	echo "WorkerSweep: needs python3 to run the stand-in server" >&2
+	exit 1
+fi
+
+mkdir -p "$OUT" || exit 1
+OUT=$(cd "$OUT" && pwd)
+DIR=$(mktemp -d "${TMPDIR:-/tmp}/WorkerSweep.XXXXXX") || exit 1
+SERVER=
+
+cleanup () {
+	[ -n "$SERVER" ] && kill "$SERVER" 2>/dev/null
+	rm -rf "$DIR"
+}
+trap cleanup EXIT INT TERM
+
+# serve the movie folder, so that each file's URL is the base followed by its name
+python3 "$HERE/StandInServer.py" --root "$MOVIES" --port-file "$DIR/port" \
+	--latency "$LATENCY" --bandwidth "$BANDWIDTH" &
+SERVER=$!
+for i in $(seq 100); do
+	[ -s "$DIR/port" ] && break
+	sleep 0.1
+done
+if [ ! -s "$DIR/port" ]; then
+	echo "WorkerSweep: the stand-in server didn't start" >&2
+	exit 1
+fi
+BASE="http://127.0.0.1:$(cat "$DIR/port")"
+
+echo "-dh $DH, latency $LATENCY s, bandwidth $BANDWIDTH bytes/s, $BASE" > "$OUT/sweep.txt"
+for n in $WORKERS; do
+	# each run gets fresh copies and frames, so that no run finds the last one's work done
+	rm -rf "$DIR/frames"
+	mkdir "$DIR/frames" || exit 1
+	"$APP" -batch -workers "$n" -dh "$DH" -urlbase "$BASE" -out "$DIR/frames" \
+		-metrics "$OUT/workers-$n.csv" $BATCH_ARGS "$MOVIES" 2> "$OUT/workers-$n.txt"
+	status=$?
+	echo "workers $n (exit status $status):" >> "$OUT/sweep.txt"
+	grep -E "workers:|import time|copied|imported" "$OUT/workers-$n.txt" | sed 's/^/    /' >> "$OUT/sweep.txt"
+done
+
+cat "$OUT/sweep.txt"
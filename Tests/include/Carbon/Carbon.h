@@ -0,0 +1,332 @@
+/*
+	File:		Carbon.h (test stand-in)
+
+	Description: Just enough of the Carbon types, constants and prototypes for the portable
+				parts of ThreadsImportMovie (the sniffer, the URL utilities, the resampler and
+				the file-transfer engine) to compile on a system without the Mac OS X frameworks,
+				so that Tests/ can build them with an ordinary C compiler. Nothing here is used
+				by the application.
+*/
+
+#ifndef TESTS_CARBON_H
+#define TESTS_CARBON_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef TARGET_OS_MAC
+#define TARGET_OS_MAC				0
+#endif
+#ifndef TARGET_OS_WIN32
+#define TARGET_OS_WIN32				0
+#endif
+
+#ifndef true
+#define true						1
+#endif
+#ifndef false
+#define false						0
+#endif
+
+#define FOUR_CHAR_CODE(x)			(x)
+#define pascal
+
+//////////
+//
+// basic types
+//
+//////////
+
+typedef uint8_t					UInt8;
+typedef int8_t					SInt8;
+typedef uint16_t				UInt16;
+typedef int16_t					SInt16;
+typedef uint32_t				UInt32;
+typedef int32_t					SInt32;
+typedef uint64_t				UInt64;
+typedef int64_t					SInt64;
+typedef float					Float32;
+typedef double					Float64;
+typedef SInt32					Fixed;
+typedef unsigned char			Boolean;
+typedef SInt16					OSErr;
+typedef SInt32					OSStatus;
+typedef UInt32					OSType;
+typedef long					Size;
+typedef char					*Ptr;
+typedef Ptr						*Handle;
+typedef unsigned char			Str255[256];
+typedef unsigned char			Str63[64];
+typedef unsigned char			Str32[33];
+typedef unsigned char			*StringPtr;
+typedef const unsigned char		*ConstStr255Param;
+typedef const unsigned char		*ConstStringPtr;
+
+typedef struct { short top, left, bottom, right; } Rect;
+typedef struct { short v, h; } Point;
+
+typedef struct { SInt32 hi; UInt32 lo; } wide;
+typedef struct { UInt32 hi; UInt32 lo; } UnsignedWide;
+
+enum {
+	noErr						= 0,
+	paramErr					= -50,
+	memFullErr					= -108,
+	fnfErr						= -43,
+	ioErr						= -36,
+	eofErr						= -39,
+	bdNamErr					= -37,
+	dirNFErr					= -120,
+	dupFNErr					= -48,
+	badFileFormat				= -208,
+	qErr						= -1,
+	userCanceledErr				= -128,
+	eventLoopTimedOutErr		= -9875,
+	eventLoopQuitErr			= -9876
+};
+
+//////////
+//
+// byte order; the stand-ins only build on little-endian machines
+//
+//////////
+
+#define EndianU16_BtoN(x)			__builtin_bswap16(x)
+#define EndianS16_BtoN(x)			((SInt16)__builtin_bswap16(x))
+#define EndianU32_BtoN(x)			__builtin_bswap32(x)
+#define EndianS32_BtoN(x)			((SInt32)__builtin_bswap32(x))
+#define EndianU16_NtoB(x)			__builtin_bswap16(x)
+#define EndianS16_NtoB(x)			((SInt16)__builtin_bswap16(x))
+#define EndianU32_NtoB(x)			__builtin_bswap32(x)
+#define EndianS32_NtoB(x)			((SInt32)__builtin_bswap32(x))
+#define EndianS64_BtoN(x)			((SInt64)__builtin_bswap64(x))
+#define EndianS64_NtoB(x)			((SInt64)__builtin_bswap64(x))
+
+//////////
+//
+// 64-bit integers
+//
+//////////
+
+wide SInt64ToWide (SInt64 theValue);
+SInt64 WideToSInt64 (wide theValue);
+
+//////////
+//
+// time
+//
+//////////
+
+void Microseconds (UnsignedWide *theMicroseconds);
+UInt64 UnsignedWideToUInt64 (UnsignedWide theValue);
+
+//////////
+//
+// memory
+//
+//////////
+
+Handle NewHandle (Size theSize);
+Handle NewHandleClear (Size theSize);
+void DisposeHandle (Handle theHandle);
+Size GetHandleSize (Handle theHandle);
+void SetHandleSize (Handle theHandle, Size theSize);
+OSErr MemError (void);
+void HLock (Handle theHandle);
+void HUnlock (Handle theHandle);
+OSErr PtrToHand (const void *theSrc, Handle *theHandle, long theSize);
+OSErr HandToHand (Handle *theHandle);
+void BlockMove (const void *theSrc, void *theDst, Size theSize);
+void BlockMoveData (const void *theSrc, void *theDst, Size theSize);
+Ptr NewPtr (Size theSize);
+Ptr NewPtrClear (Size theSize);
+void DisposePtr (Ptr thePtr);
+Size GetPtrSize (Ptr thePtr);
+OSErr PtrAndHand (const void *thePtr, Handle theHandle, long theSize);
+
+//////////
+//
+// queues, atomic operations and the rest of the system calls WorkerThread.c makes; the queue and bit
+// operations are atomic with respect to each other, as the Mac OS versions are
+//
+//////////
+
+typedef struct QElem {
+	struct QElem			*qLink;
+	short					qType;
+	short					qData[1];
+} QElem, *QElemPtr;
+
+typedef struct {
+	volatile short			qFlags;
+	volatile QElemPtr		qHead;
+	volatile QElemPtr		qTail;
+} QHdr, *QHdrPtr;
+
+enum {
+	gestaltSystemVersion		= 'sysv'
+};
+
+void Enqueue (QElemPtr theElement, QHdrPtr theQueue);
+OSErr Dequeue (QElemPtr theElement, QHdrPtr theQueue);
+Boolean TestAndSet (UInt32 theBit, void *theAddress);
+Boolean TestAndClear (UInt32 theBit, void *theAddress);
+SInt32 IncrementAtomic (SInt32 *theValue);
+SInt32 DecrementAtomic (SInt32 *theValue);
+OSErr Gestalt (OSType theSelector, long *theResponse);
+void DebugStr (ConstStr255Param theMessage);
+
+//////////
+//
+// Multiprocessing Services semaphores
+//
+//////////
+
+typedef struct OpaqueMPSemaphoreID	*MPSemaphoreID;
+typedef UInt32					MPSemaphoreCount;
+typedef SInt32					Duration;
+
+enum {
+	kDurationForever			= 0x7FFFFFFF,
+	kMPTimeoutErr				= -29296
+};
+
+OSStatus MPCreateSemaphore (MPSemaphoreCount theMaximumValue, MPSemaphoreCount theInitialValue, MPSemaphoreID *theSemaphore);
+OSStatus MPDeleteSemaphore (MPSemaphoreID theSemaphore);
+OSStatus MPSignalSemaphore (MPSemaphoreID theSemaphore);
+OSStatus MPWaitOnSemaphore (MPSemaphoreID theSemaphore, Duration theTimeout);
+
+//////////
+//
+// Carbon event loop timers; RunCurrentEventLoop fires the timers that are due on the calling thread,
+// which stands in for the main thread
+//
+//////////
+
+typedef struct OpaqueEventLoopRef		*EventLoopRef;
+typedef struct OpaqueEventLoopTimerRef	*EventLoopTimerRef;
+typedef double					EventTimeout;
+typedef double					EventTimerInterval;
+typedef void (*EventLoopTimerProcPtr) (EventLoopTimerRef theTimer, void *theUserData);
+typedef EventLoopTimerProcPtr	EventLoopTimerUPP;
+
+#define kEventDurationForever		(-1.0)
+#define kEventDurationNoWait		(0.0)
+
+EventLoopTimerUPP NewEventLoopTimerUPP (EventLoopTimerProcPtr theProc);
+void DisposeEventLoopTimerUPP (EventLoopTimerUPP theUPP);
+EventLoopRef GetMainEventLoop (void);
+OSStatus InstallEventLoopTimer (EventLoopRef theLoop, EventTimerInterval theFireDelay, EventTimerInterval theInterval, EventLoopTimerUPP theProc, void *theUserData, EventLoopTimerRef *theTimer);
+OSStatus SetEventLoopTimerNextFireTime (EventLoopTimerRef theTimer, EventTimerInterval theNextFire);
+OSStatus RemoveEventLoopTimer (EventLoopTimerRef theTimer);
+OSStatus RunCurrentEventLoop (EventTimeout theTimeout);
+OSStatus QuitEventLoop (EventLoopRef theLoop);
+
+//////////
+//
+// QuickDraw
+//
+//////////
+
+typedef struct OpaqueGrafPtr	*GrafPtr;
+typedef GrafPtr					CGrafPtr;
+typedef CGrafPtr				GWorldPtr;
+typedef struct PixMap			**PixMapHandle;
+typedef UInt32					GWorldFlags;
+
+PixMapHandle GetGWorldPixMap (GWorldPtr theGWorld);
+short GetPixDepth (PixMapHandle thePixMap);
+Rect *GetPortBounds (CGrafPtr thePort, Rect *theRect);
+GWorldFlags GetPixelsState (PixMapHandle thePixMap);
+void SetPixelsState (PixMapHandle thePixMap, GWorldFlags theState);
+Boolean LockPixels (PixMapHandle thePixMap);
+Ptr GetPixBaseAddr (PixMapHandle thePixMap);
+long GetPixRowBytes (PixMapHandle thePixMap);
+
+//////////
+//
+// files
+//
+//////////
+
+typedef struct {
+	short					vRefNum;
+	long					parID;
+	Str63					name;
+} FSSpec, *FSSpecPtr;
+
+typedef struct {
+	StringPtr				ioNamePtr;
+	short					ioVRefNum;
+	short					ioFDirIndex;
+	long					ioDrDirID;
+	long					ioDrParID;
+} DirInfo;
+
+typedef struct {
+	StringPtr				ioNamePtr;
+	short					ioVRefNum;
+	short					ioFDirIndex;
+	SInt8					ioFlAttrib;
+} HFileInfo;
+
+typedef union {
+	HFileInfo				hFileInfo;
+	DirInfo					dirInfo;
+} CInfoPBRec;
+
+typedef struct {
+	UInt8					hidden[80];
+} FSRef;
+
+typedef struct AliasRecord	**AliasHandle;
+
+typedef struct {
+	OSType					fdType;
+	OSType					fdCreator;
+	UInt16					fdFlags;
+	Point					fdLocation;
+	SInt16					fdFldr;
+} FInfo;
+
+typedef SInt16				ScriptCode;
+
+enum {
+	ioDirMask					= 0x10,
+	fsRtParID					= 1,
+	fsRtDirID					= 2,
+	fsCurPerm					= 0,
+	fsRdPerm					= 1,
+	fsWrPerm					= 2,
+	fsRdWrPerm					= 3,
+	fsAtMark					= 0,
+	fsFromStart					= 1,
+	fsFromLEOF					= 2,
+	smSystemScript				= -1,
+	kFSCatInfoNone				= 0,
+	rAliasType					= 'alis'
+};
+
+OSErr PBGetCatInfoSync (CInfoPBRec *thePB);
+OSErr FSPathMakeRef (const UInt8 *thePath, FSRef *theRef, Boolean *theIsDirectory);
+OSErr FSGetCatalogInfo (const FSRef *theRef, UInt32 theWhichInfo, void *theCatalogInfo, void *theOutName, FSSpec *theFSSpec, FSRef *theParentRef);
+OSErr FSMakeFSSpec (short theVRefNum, long theDirID, ConstStr255Param theName, FSSpec *theSpec);
+OSErr NewAliasMinimalFromFullPath (short theFullPathLength, const void *theFullPath, ConstStr255Param theZoneName, ConstStr255Param theServerName, AliasHandle *theAlias);
+OSErr ResolveAlias (const FSSpec *theFromFile, AliasHandle theAlias, FSSpec *theTarget, Boolean *theWasChanged);
+OSErr FSpCreate (const FSSpec *theSpec, OSType theCreator, OSType theType, ScriptCode theScript);
+OSErr FSpDelete (const FSSpec *theSpec);
+OSErr FSpGetFInfo (const FSSpec *theSpec, FInfo *theInfo);
+OSErr FSpOpenDF (const FSSpec *theSpec, SInt8 thePermission, short *theRefNum);
+OSErr FSRead (short theRefNum, long *theCount, void *theBuffer);
+OSErr FSWrite (short theRefNum, long *theCount, const void *theBuffer);
+OSErr FSClose (short theRefNum);
+OSErr GetEOF (short theRefNum, long *theEOF);
+OSErr SetEOF (short theRefNum, long theEOF);
+OSErr GetFPos (short theRefNum, long *thePosition);
+OSErr SetFPos (short theRefNum, short theMode, long theOffset);
+long Munger (Handle theHandle, long theOffset, const void *thePtr1, long theLength1, const void *thePtr2, long theLength2);
+
+#endif	// TESTS_CARBON_H
@@ -0,0 +1,8 @@
+/*
+	File:		CoreServices.h (test stand-in)
+
+	Description: WorkerThread.h includes CoreServices; the test stand-in for Carbon.h declares
+				everything it uses.
+*/
+
+#include <Carbon/Carbon.h>
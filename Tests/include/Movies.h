@@ -0,0 +1,8 @@
+/*
+	File:		Movies.h (test stand-in)
+
+	Description: See Carbon.h in the carbon folder; QTDataRef.h includes this name when it is
+				not built with the Mac OS X frameworks.
+*/
+
+#include <QuickTime/QuickTime.h>
@@ -0,0 +1,121 @@
+/*
+	File:		QuickTime.h (test stand-in)
+
+	Description: See Carbon.h in the same folder.
+*/
+
+#ifndef TESTS_QUICKTIME_H
+#define TESTS_QUICKTIME_H
+
+#include <Carbon/Carbon.h>
+
+typedef struct MovieType				*Movie;
+typedef struct TrackType				*Track;
+typedef struct MediaType				*Media;
+typedef SInt32							TimeValue;
+typedef struct ComponentRecord			*Component;
+typedef struct ComponentInstanceRecord	*ComponentInstance;
+typedef ComponentInstance				MovieController;
+typedef ComponentInstance				DataHandler;
+typedef long							ComponentResult;
+
+typedef struct {
+	void *								data;
+	Size								dataLength;
+} PointerDataRefRecord, *PointerDataRefPtr, **PointerDataRef;
+
+typedef struct {
+	wide								dataOffset;
+	unsigned long						dataSize;
+	TimeValue							durationPerSample;
+	unsigned long						numberOfSamples;
+	short								sampleFlags;
+} SampleReference64Record, *SampleReference64Ptr;
+
+typedef void (*DataHCompletionProcPtr) (Ptr theRequest, long theRefCon, OSErr theErr);
+typedef DataHCompletionProcPtr			DataHCompletionUPP;
+
+#define fixed1							((Fixed)0x00010000)
+
+enum {
+	URLDataHandlerSubType			= 'url ',
+	HandleDataHandlerSubType		= 'hndl',
+	ResourceDataHandlerSubType		= 'rsrc',
+	MovieControllerComponentType	= 'play',
+	mcActionLinkToURL				= 89,
+	MovieAID						= 'moov',
+	VisualMediaCharacteristic		= 'eyes',
+	kDataRefExtensionMacOSFileType	= 'ftyp',
+	kDataRefExtensionMIMEType		= 'mime',
+	kDataRefExtensionInitializationData	= 'data',
+	kDataHCanRead					= 1L << 0,
+	kDataHCanWrite					= 1L << 3,
+	newMovieActive					= 1 << 0,
+	movieTrackMediaType				= 1 << 0,
+	movieTrackCharacteristic		= 1 << 1,
+	movieTrackEnabledOnly			= 1 << 2,
+	nextTimeSyncSample				= 1 << 4,
+	nextTimeEdgeOK					= 1 << 14,
+	dataRefSelfReference			= 1 << 0,
+	noMovieFound					= -2048,
+	badComponentType				= (long)0x80008002
+};
+
+//////////
+//
+// data handlers; see MacStubs.c for what the stand-in ones do
+//
+//////////
+
+Component GetDataHandler (Handle theDataRef, OSType theDataHandlerSubType, long theFlags);
+ComponentInstance OpenComponent (Component theComponent);
+OSErr OpenAComponent (Component theComponent, ComponentInstance *theInstance);
+DataHCompletionUPP NewDataHCompletionUPP (DataHCompletionProcPtr theProc);
+void DisposeDataHCompletionUPP (DataHCompletionUPP theUPP);
+ComponentResult DataHSetDataRef (ComponentInstance theHandler, Handle theDataRef);
+ComponentResult DataHOpenForRead (ComponentInstance theHandler);
+ComponentResult DataHCloseForRead (ComponentInstance theHandler);
+ComponentResult DataHOpenForWrite (ComponentInstance theHandler);
+ComponentResult DataHCloseForWrite (ComponentInstance theHandler);
+ComponentResult DataHGetFileSize64 (ComponentInstance theHandler, wide *theFileSize);
+ComponentResult DataHSetFileSize64 (ComponentInstance theHandler, const wide *theFileSize);
+ComponentResult DataHReadAsync (ComponentInstance theHandler, Ptr theBuffer, UInt32 theSize, const wide *theOffset, DataHCompletionUPP theCompletion, long theRefCon);
+ComponentResult DataHWrite64 (ComponentInstance theHandler, Ptr theBuffer, const wide *theOffset, long theSize, DataHCompletionUPP theCompletion, long theRefCon);
+ComponentResult DataHTask (ComponentInstance theHandler);
+ComponentResult DataHGetMacOSFileType (ComponentInstance theHandler, OSType *theFileType);
+ComponentResult DataHGetMIMEType (ComponentInstance theHandler, Str255 theMIMEType);
+
+//////////
+//
+// threads; the stand-ins are all thread-safe, so these do nothing
+//
+//////////
+
+OSErr EnterMoviesOnThread (UInt32 theFlags);
+OSErr ExitMoviesOnThread (void);
+
+//////////
+//
+// movies; the stand-ins open the stand-in movie files described in MacStubs.h
+//
+//////////
+
+OSErr QTNewAlias (const FSSpec *theFile, AliasHandle *theAlias, Boolean theMinimal);
+OSErr GetMoviesError (void);
+void DisposeMovie (Movie theMovie);
+long GetMovieTrackCount (Movie theMovie);
+Track GetMovieIndTrack (Movie theMovie, long theIndex);
+Track GetMovieIndTrackType (Movie theMovie, long theIndex, OSType theType, long theFlags);
+Media GetTrackMedia (Track theTrack);
+TimeValue TrackTimeToMediaTime (TimeValue theTime, Track theTrack);
+void GetMediaNextInterestingTime (Media theMedia, short theFlags, TimeValue theTime, Fixed theRate, TimeValue *theInterestingTime, TimeValue *theDuration);
+OSErr GetMediaSampleReferences64 (Media theMedia, TimeValue theTime, TimeValue *theSampleTime, SampleReference64Ptr theSampleRefs, long theMaxNumberOfEntries, long *theNumberOfEntries);
+OSErr GetMediaDataRefCount (Media theMedia, short *theCount);
+OSErr GetMediaDataRef (Media theMedia, short theIndex, Handle *theDataRef, OSType *theDataRefType, long *theAttributes);
+
+OSErr NewMovieFromDataRef (Movie *theMovie, short theFlags, short *theID, Handle theDataRef, OSType theDataRefType);
+OSErr OpenADefaultComponent (OSType theType, OSType theSubType, ComponentInstance *theInstance);
+OSErr CloseComponent (ComponentInstance theInstance);
+ComponentResult MCDoAction (MovieController theController, short theAction, void *theParams);
+
+#endif	// TESTS_QUICKTIME_H
@@ -0,0 +1,436 @@
+/*
+	File:		ThumbnailCache.c
+	
+	Description: A persistent on-disk cache of imported frames, keyed by file path, size and modification date.
+			     Entries are memory-mapped on lookup; the least recently used entries are evicted when the cache grows too large.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+//////////
+//
+// header files
+//
+//////////
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ThumbnailCache.h"
+#include "GWorldPool.h"
+
+//////////
+//
+// data structures
+//
+//////////
+
+typedef struct {
+    char				name[32];
+    time_t				useDate;		// entries are touched on every hit, so this is the last use
+    off_t				size;
+} CacheFolderEntry;
+
+//////////
+//
+// static global variables
+//
+//////////
+
+static pthread_mutex_t	gCacheMutex = PTHREAD_MUTEX_INITIALIZER;	// protects everything below
+static char				gCacheFolder[PATH_MAX];						// empty until the folder is created
+static UInt64			gCacheMaxBytes = kThumbnailCacheMaxBytes;
+static UInt64			gCacheBytes = 0;							// running estimate of the size of the cache
+static Boolean			gCacheMeasured = false;						// has gCacheBytes been measured from disk?
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static Boolean getCacheFolder (char *outPath, size_t theSize);
+static Boolean makeEntryPath (const char *thePath, UInt32 theVariant, const struct stat *theStat, char *outPath, size_t theSize);
+static void trimCache (const char *theFolder, Boolean evict);
+static int compareEntries (const void *a, const void *b);
+
+#pragma mark-
+
+//////////
+//
+// public routines
+//
+//////////
+
+OSErr ThumbnailCache_Lookup (const char *thePath, UInt32 theVariant, GWorldPtr *outGWorld, UInt32 *outNaturalWidth, UInt32 *outNaturalHeight)
+{
+    struct stat fileStat;
+    struct stat entryStat;
+    char entryPath[PATH_MAX];
+    int fd = -1;
+    UInt8 *entry = MAP_FAILED;
+    size_t entrySize = 0;
+    size_t pathLength;
+    ThumbnailCacheHeader *header;
+    PixMapHandle pixMap;
+    UInt8 *srcRow, *dstRow;
+    long rowBytes;
+    UInt32 row;
+    Rect bounds;
+    OSErr err = fnfErr;
+
+    if ((thePath == NULL) || (outGWorld == NULL))
+        return paramErr;
+
+    *outGWorld = NULL;
+
+    if (stat(thePath, &fileStat) != 0)
+        return fnfErr;
+
+    if (!makeEntryPath(thePath, theVariant, &fileStat, entryPath, sizeof(entryPath)))
+        return fnfErr;
+
+    fd = open(entryPath, O_RDONLY);
+    if (fd < 0)
+        goto bail;
+
+    if ((fstat(fd, &entryStat) != 0) || (entryStat.st_size < (off_t)sizeof(ThumbnailCacheHeader)))
+        goto bail;
+
+    entrySize = entryStat.st_size;
+    entry = mmap(NULL, entrySize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (entry == MAP_FAILED)
+        goto bail;
+
+    // make sure the entry is for this version of this file; the hash in the entry name could collide
+    header = (ThumbnailCacheHeader *)entry;
+    pathLength = strlen(thePath);
+    if ((header->magic != kThumbnailCacheMagic) || (header->version != kThumbnailCacheVersion))
+        goto bail;
+    if ((header->fileSize != (UInt64)fileStat.st_size) || (header->fileModDate != (SInt64)fileStat.st_mtime) || (header->variant != theVariant))
+        goto bail;
+    if ((header->pathLength != pathLength) || (memcmp(entry + sizeof(ThumbnailCacheHeader), thePath, pathLength) != 0))
+        goto bail;
+    if ((header->width == 0) || (header->height == 0) ||
+        (entrySize != sizeof(ThumbnailCacheHeader) + pathLength + (size_t)header->width * header->height * 4))
+        goto bail;
+
+    MacSetRect(&bounds, 0, 0, header->width, header->height);
+    err = GWorldPool_Get(&bounds, k32ARGBPixelFormat, outGWorld);
+    if (err != noErr)
+        goto bail;
+
+    pixMap = GetGWorldPixMap(*outGWorld);
+    LockPixels(pixMap);
+    rowBytes = GetPixRowBytes(pixMap);
+    srcRow = entry + sizeof(ThumbnailCacheHeader) + pathLength;
+    dstRow = (UInt8 *)GetPixBaseAddr(pixMap);
+    for (row = 0; row < header->height; row++) {
+        memcpy(dstRow, srcRow, header->width * 4);
+        srcRow += header->width * 4;
+        dstRow += rowBytes;
+    }
+
+    if (outNaturalWidth != NULL)
+        *outNaturalWidth = header->naturalWidth;
+    if (outNaturalHeight != NULL)
+        *outNaturalHeight = header->naturalHeight;
+
+    // touch the entry so that eviction sees it as recently used
+    utimes(entryPath, NULL);
+
+bail:
+    if (entry != MAP_FAILED)
+        munmap(entry, entrySize);
+
+    if (fd >= 0)
+        close(fd);
+
+    return err;
+}
+
+OSErr ThumbnailCache_Store (const char *thePath, UInt32 theVariant, GWorldPtr theGWorld, UInt32 theNaturalWidth, UInt32 theNaturalHeight)
+{
+    struct stat fileStat;
+    char folder[PATH_MAX];
+    char entryPath[PATH_MAX];
+    char tempPath[PATH_MAX];
+    ThumbnailCacheHeader header;
+    PixMapHandle pixMap;
+    GWorldFlags pixelsState;
+    UInt8 *srcRow;
+    long rowBytes;
+    UInt32 row;
+    UInt64 entryBytes;
+    Rect bounds;
+    int fd = -1;
+    OSErr err = noErr;
+
+    if ((thePath == NULL) || (theGWorld == NULL))
+        return paramErr;
+
+    if ((stat(thePath, &fileStat) != 0) || !getCacheFolder(folder, sizeof(folder)))
+        return fnfErr;
+
+    if (!makeEntryPath(thePath, theVariant, &fileStat, entryPath, sizeof(entryPath)))
+        return fnfErr;
+
+    GetPortBounds(theGWorld, &bounds);
+    memset(&header, 0, sizeof(header));
+    header.magic = kThumbnailCacheMagic;
+    header.version = kThumbnailCacheVersion;
+    header.fileSize = fileStat.st_size;
+    header.fileModDate = fileStat.st_mtime;
+    header.variant = theVariant;
+    header.naturalWidth = theNaturalWidth;
+    header.naturalHeight = theNaturalHeight;
+    header.width = bounds.right - bounds.left;
+    header.height = bounds.bottom - bounds.top;
+    header.pathLength = strlen(thePath);
+
+    entryBytes = sizeof(header) + header.pathLength + (UInt64)header.width * header.height * 4;
+    if ((header.width == 0) || (header.height == 0) || (entryBytes > kThumbnailCacheMaxEntryBytes))
+        return paramErr;
+
+    // write the entry under a private name and rename it into place, so that concurrent
+    // lookups from other documents or processes only ever see complete entries
+    snprintf(tempPath, sizeof(tempPath), "%s.%d.%lx.tmp", entryPath, (int)getpid(), (unsigned long)pthread_self());
+    fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return ioErr;
+
+    if ((write(fd, &header, sizeof(header)) != sizeof(header)) ||
+        (write(fd, thePath, header.pathLength) != (ssize_t)header.pathLength))
+        err = ioErr;
+
+    pixMap = GetGWorldPixMap(theGWorld);
+    pixelsState = GetPixelsState(pixMap);
+    LockPixels(pixMap);
+    rowBytes = GetPixRowBytes(pixMap);
+    srcRow = (UInt8 *)GetPixBaseAddr(pixMap);
+    for (row = 0; (row < header.height) && (err == noErr); row++) {
+        if (write(fd, srcRow, header.width * 4) != (ssize_t)(header.width * 4))
+            err = ioErr;
+        srcRow += rowBytes;
+    }
+    SetPixelsState(pixMap, pixelsState);
+
+    if (close(fd) != 0)
+        err = ioErr;
+
+    if ((err == noErr) && (rename(tempPath, entryPath) != 0))
+        err = ioErr;
+
+    if (err != noErr) {
+        unlink(tempPath);
+        return err;
+    }
+
+    // account for the new entry and evict old ones if we're over the limit
+    pthread_mutex_lock(&gCacheMutex);
+    if (!gCacheMeasured) {
+        trimCache(folder, false);
+        gCacheMeasured = true;
+    } else {
+        gCacheBytes += entryBytes;
+    }
+
+    if (gCacheBytes > gCacheMaxBytes)
+        trimCache(folder, true);
+    pthread_mutex_unlock(&gCacheMutex);
+
+    return noErr;
+}
+
+void ThumbnailCache_SetMaxBytes (UInt64 theMaxBytes)
+{
+    pthread_mutex_lock(&gCacheMutex);
+    gCacheMaxBytes = theMaxBytes;
+    pthread_mutex_unlock(&gCacheMutex);
+}
+
+#pragma mark-
+
+//////////
+//
+// static functions
+//
+//////////
+
+// get the path of the cache folder, creating it if necessary
+static Boolean getCacheFolder (char *outPath, size_t theSize)
+{
+    char path[PATH_MAX];
+    char *home = getenv("HOME");
+    char *sep;
+    Boolean ok = true;
+
+    pthread_mutex_lock(&gCacheMutex);
+    if (gCacheFolder[0] == 0) {
+        if ((home == NULL) || (snprintf(path, sizeof(path), "%s/%s", home, kThumbnailCacheFolder) >= (int)sizeof(path))) {
+            ok = false;
+        } else {
+            // create each folder along the way
+            for (sep = strchr(path + strlen(home) + 1, '/'); ok; sep = strchr(sep + 1, '/')) {
+                if (sep != NULL)
+                    *sep = 0;
+                if ((mkdir(path, 0755) != 0) && (errno != EEXIST))
+                    ok = false;
+                if (sep == NULL)
+                    break;
+                *sep = '/';
+            }
+
+            if (ok)
+                strlcpy(gCacheFolder, path, sizeof(gCacheFolder));
+        }
+    }
+
+    if (ok)
+        strlcpy(outPath, gCacheFolder, theSize);
+    pthread_mutex_unlock(&gCacheMutex);
+
+    return ok;
+}
+
+// build the path of the cache entry for a file; the entry name is a 64-bit FNV-1a hash of the
+// path, size and modification date, so a changed file simply misses and its old entry ages out
+static Boolean makeEntryPath (const char *thePath, UInt32 theVariant, const struct stat *theStat, char *outPath, size_t theSize)
+{
+    char folder[PATH_MAX];
+    UInt64 hash = 14695981039346656037ULL;
+    UInt64 keys[3];
+    const UInt8 *p;
+    size_t i;
+
+    if (!getCacheFolder(folder, sizeof(folder)))
+        return false;
+
+    for (p = (const UInt8 *)thePath; *p; p++)
+        hash = (hash ^ *p) * 1099511628211ULL;
+
+    keys[0] = theStat->st_size;
+    keys[1] = theStat->st_mtime;
+    keys[2] = theVariant;
+    for (p = (const UInt8 *)keys, i = 0; i < sizeof(keys); i++)
+        hash = (hash ^ p[i]) * 1099511628211ULL;
+
+    return (snprintf(outPath, theSize, "%s/%016llx%s", folder, (unsigned long long)hash, kThumbnailCacheFileSuffix) < (int)theSize);
+}
+
+// measure the cache folder and, if evict is true, delete least recently used entries until
+// we're back under kThumbnailCacheTrimRatio of the limit; called with gCacheMutex held
+static void trimCache (const char *theFolder, Boolean evict)
+{
+    DIR *dir;
+    struct dirent *dirEntry;
+    struct stat entryStat;
+    char entryPath[PATH_MAX];
+    CacheFolderEntry *entries = NULL;
+    CacheFolderEntry *newEntries;
+    size_t numEntries = 0, maxEntries = 0, i;
+    size_t nameLength, suffixLength = strlen(kThumbnailCacheFileSuffix);
+    UInt64 totalBytes = 0;
+
+    dir = opendir(theFolder);
+    if (dir == NULL)
+        return;
+
+    while ((dirEntry = readdir(dir)) != NULL) {
+        nameLength = strlen(dirEntry->d_name);
+        if ((nameLength <= suffixLength) || (nameLength >= sizeof(entries->name)) ||
+            (strcmp(dirEntry->d_name + nameLength - suffixLength, kThumbnailCacheFileSuffix) != 0))
+            continue;
+
+        snprintf(entryPath, sizeof(entryPath), "%s/%s", theFolder, dirEntry->d_name);
+        if (stat(entryPath, &entryStat) != 0)
+            continue;
+
+        if (numEntries == maxEntries) {
+            maxEntries = maxEntries ? maxEntries * 2 : 256;
+            newEntries = realloc(entries, maxEntries * sizeof(CacheFolderEntry));
+            if (newEntries == NULL)
+                break;
+            entries = newEntries;
+        }
+
+        strlcpy(entries[numEntries].name, dirEntry->d_name, sizeof(entries->name));
+        entries[numEntries].useDate = entryStat.st_mtime;
+        entries[numEntries].size = entryStat.st_size;
+        totalBytes += entryStat.st_size;
+        numEntries++;
+    }
+    closedir(dir);
+
+    if (evict && (totalBytes > gCacheMaxBytes)) {
+        qsort(entries, numEntries, sizeof(CacheFolderEntry), compareEntries);
+
+        for (i = 0; (i < numEntries) && (totalBytes > gCacheMaxBytes * kThumbnailCacheTrimRatio); i++) {
+            snprintf(entryPath, sizeof(entryPath), "%s/%s", theFolder, entries[i].name);
+            if (unlink(entryPath) == 0)
+                totalBytes -= entries[i].size;
+        }
+    }
+
+    gCacheBytes = totalBytes;
+    free(entries);
+}
+
+// oldest first
+static int compareEntries (const void *a, const void *b)
+{
+    time_t dateA = ((const CacheFolderEntry *)a)->useDate;
+    time_t dateB = ((const CacheFolderEntry *)b)->useDate;
+
+    return (dateA < dateB) ? -1 : ((dateA > dateB) ? 1 : 0);
+}
@@ -0,0 +1,111 @@
+/*
+	File:		ThumbnailCache.h
+	
+	Description: A persistent on-disk cache of imported frames, keyed by file path, size and modification date.
+			     A cache hit hands back a ready-to-draw GWorld without opening any QuickTime components.
+
+	Author:		QuickTime Engineering
+
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	
+	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
+				("Apple") in consideration of your agreement to the following terms, and your
+				use, installation, modification or redistribution of this Apple software
+				constitutes acceptance of these terms.  If you do not agree with these terms,
+				please do not use, install, modify or redistribute this Apple software.
+
+				In consideration of your agreement to abide by the following terms, and subject
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
+				copyrights in this original Apple software (the "Apple Software"), to use,
+				reproduce, modify and redistribute the Apple Software, with or without
+				modifications, in source and/or binary forms; provided that if you redistribute
+				the Apple Software in its entirety and without modifications, you must retain
+				this notice and the following text and disclaimers in all such redistributions of
+				the Apple Software.  Neither the name, trademarks, service marks or logos of
+				Apple Computer, Inc. may be used to endorse or promote products derived from the
+				Apple Software without specific prior written permission from Apple.  Except as
+				expressly stated in this notice, no other rights or licenses, express or implied,
+				are granted by Apple herein, including but not limited to any patent rights that
+				may be infringed by your derivative works or by other works in which the Apple
+				Software may be incorporated.
+
+				The Apple Software is provided by Apple on an "AS IS" basis.  APPLE MAKES NO
+				WARRANTIES, EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION THE IMPLIED
+				WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+				PURPOSE, REGARDING THE APPLE SOFTWARE OR ITS USE AND OPERATION ALONE OR IN
+				COMBINATION WITH YOUR PRODUCTS.
+
+				IN NO EVENT SHALL APPLE BE LIABLE FOR ANY SPECIAL, INDIRECT, INCIDENTAL OR
+				CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+				GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+				ARISING IN ANY WAY OUT OF THE USE, REPRODUCTION, MODIFICATION AND/OR DISTRIBUTION
+				OF THE APPLE SOFTWARE, HOWEVER CAUSED AND WHETHER UNDER THEORY OF CONTRACT, TORT
+				(INCLUDING NEGLIGENCE), STRICT LIABILITY OR OTHERWISE, EVEN IF APPLE HAS BEEN
+				ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+				
+	Change History (most recent first):  <1> initial release
+*/
+
+#ifndef THUMBNAIL_CACHE_H
+#define THUMBNAIL_CACHE_H
+
+#include <Carbon/Carbon.h>
+#include <QuickTime/QuickTime.h>
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kThumbnailCacheFolder			"Library/Caches/ThreadsImportMovie/Thumbnails"	// relative to $HOME
+#define kThumbnailCacheFileSuffix		".thm"
+
+#define kThumbnailCacheMagic			FOUR_CHAR_CODE('TIMc')
+#define kThumbnailCacheVersion			4
+
+#define kThumbnailCacheMaxBytes			(64 * 1024 * 1024)	// default limit on the total size of the cache
+#define kThumbnailCacheMaxEntryBytes	(8 * 1024 * 1024)	// frames larger than this are never cached
+#define kThumbnailCacheTrimRatio		0.75				// when trimming, evict down to this fraction of the limit
+
+//////////
+//
+// data types
+//
+//////////
+
+// Each cache entry is a single file: this header, then the source path (not null-terminated),
+// then width * height 32-bit ARGB pixels, tightly packed. Entries are written to a temporary file
+// and renamed into place, so readers in other documents (or other processes) never see a partial entry.
+typedef struct {
+    UInt32			magic;
+    UInt32			version;
+    UInt64			fileSize;		// size of the source file when the entry was made
+    SInt64			fileModDate;	// modification date (seconds since 1970) of the source file
+    UInt32			variant;		// which rendering of the source file this is
+    UInt32			naturalWidth;	// natural size of the movie
+    UInt32			naturalHeight;
+    UInt32			width;			// size of the stored frame
+    UInt32			height;
+    UInt32			pathLength;		// length of the source path that follows this header
+} ThumbnailCacheHeader;
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+// Look up the frame for the file at thePath; on a hit, *outGWorld is a new 32-bit GWorld (owned by the caller)
+// holding the frame. theVariant tells different renderings of the same file apart (for instance, a single frame
+// and a contact sheet); entries only match lookups with the same variant. Returns fnfErr on a miss.
+// Safe to call from any thread.
+OSErr ThumbnailCache_Lookup (const char *thePath, UInt32 theVariant, GWorldPtr *outGWorld, UInt32 *outNaturalWidth, UInt32 *outNaturalHeight);
+
+// Store the contents of theGWorld as the given variant of the frame for the file at thePath. Safe to call from any thread.
+OSErr ThumbnailCache_Store (const char *thePath, UInt32 theVariant, GWorldPtr theGWorld, UInt32 theNaturalWidth, UInt32 theNaturalHeight);
+
+// Set the limit on the total size of the cache; least recently used entries are evicted beyond it.
+void ThumbnailCache_SetMaxBytes (UInt64 theMaxBytes);
+
+#endif // THUMBNAIL_CACHE_H
@@ -6,7 +6,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -15,7 +15,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -72,6 +72,74 @@
 #ifndef __URLUtilities__
 #include "URLUtilities.h"
 
+#if URL_UTILS_SSE2
+#include <emmintrin.h>
+#endif
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+// the characters that URLUtils_IsEncodableChar accepts, indexed by (unsigned) character value;
+// the string encoding and decoding functions classify each character with a single table lookup
+static const UInt8		gURLEncodableChars[256] = {
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0x00
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0x10
+	1, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 0x20
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0,		// 0x30
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 0x40
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0,		// 0x50
+	1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,		// 0x60
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1,		// 0x70
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0x80
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0x90
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0xA0
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0xB0
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0xC0
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0xD0
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,		// 0xE0
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1		// 0xF0
+};
+
+// the value of each hexadecimal digit, or kURLNotHexDigit for all other characters
+#define kURLNotHexDigit			0xFF
+
+static const UInt8		gURLHexDigitValues[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x00
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x10
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x20
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x30
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x40
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x50
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x60
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x70
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x80
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0x90
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0xA0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0xB0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0xC0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0xD0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,		// 0xE0
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF		// 0xF0
+};
+
+static const char		gURLHexDigits[] = "0123456789ABCDEF";
+
+
+//////////
+//
+// static function declarations
+//
+//////////
+
+static size_t URLUtils_FindEncodableChar (const UInt8 *theBytes, size_t theLength, Boolean theUseVector);
+static size_t URLUtils_CountEncodableChars (const UInt8 *theBytes, size_t theLength, Boolean theUseVector);
+static size_t URLUtils_Encode (const char *theString, size_t theLength, char *theBuffer, Boolean theUseVector);
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // Syntax utilities.
@@ -80,6 +148,139 @@
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+//////////
+//
+// URLUtils_ParseURL
+// Find all the distinguishable parts of the specified URL in a single pass, without allocating any memory.
+//
+// Each part is returned as an offset and a length within theURL; a part that the URL doesn't contain has
+// the offset kURLComponentAbsent (see URLUtils_HasComponent). The scheme is filled in only if the URL is
+// absolute, and the path only if the URL has an authority (which is how the functions below behave).
+// The basename is everything following the rightmost URL path separator.
+//
+//////////
+
+OSErr URLUtils_ParseURL (const char *theURL, URLComponentsPtr theComponents)
+{
+	size_t		myIndex;
+	size_t		mySchemeEnd = kURLComponentAbsent;
+	size_t		myAuthBegin = kURLComponentAbsent;
+	size_t		myAuthEnd = kURLComponentAbsent;
+	size_t		myPathEnd = kURLComponentAbsent;
+	size_t		myQueryBegin = kURLComponentAbsent;
+	size_t		myLastSlash = kURLComponentAbsent;
+	char		myChar;
+	
+	if ((theURL == NULL) || (theComponents == NULL))
+		return(paramErr);
+		
+	for (myIndex = 0; (myChar = theURL[myIndex]) != '\0'; myIndex++) {
+		switch (myChar) {
+			case kURLSchemeSeparator:
+				if (mySchemeEnd == kURLComponentAbsent)
+					mySchemeEnd = myIndex;
+					
+				// the authority begins after the first occurrence of kURLAuthPrefix
+				if ((myAuthBegin == kURLComponentAbsent) && (theURL[myIndex + 1] == kURLPathSeparator) && (theURL[myIndex + 2] == kURLPathSeparator))
+					myAuthBegin = myIndex + strlen(kURLAuthPrefix);
+				break;
+				
+			case kURLPathSeparator:
+				myLastSlash = myIndex;
+				
+				// the authority ends at the first slash or question mark that follows it
+				if ((myAuthBegin != kURLComponentAbsent) && (myAuthEnd == kURLComponentAbsent) && (myIndex >= myAuthBegin))
+					myAuthEnd = myIndex;
+				break;
+				
+			case kURLQuerySeparator:
+				if (myQueryBegin == kURLComponentAbsent)
+					myQueryBegin = myIndex + 1;
+					
+				if ((myAuthBegin != kURLComponentAbsent) && (myAuthEnd == kURLComponentAbsent) && (myIndex >= myAuthBegin))
+					myAuthEnd = myIndex;
+				
+				// the path ends at the first question mark that follows the authority
+				if ((myAuthEnd != kURLComponentAbsent) && (myPathEnd == kURLComponentAbsent))
+					myPathEnd = myIndex;
+				break;
+				
+			default:
+				break;
+		}
+	}
+	
+	theComponents->length = myIndex;
+	theComponents->isAbsolute = URLUtils_IsAlphabetic(theURL[0]) && (mySchemeEnd != kURLComponentAbsent);
+	
+	// the scheme
+	theComponents->scheme.offset = kURLComponentAbsent;
+	theComponents->scheme.length = 0;
+	if (theComponents->isAbsolute) {
+		theComponents->scheme.offset = 0;
+		theComponents->scheme.length = mySchemeEnd;
+	}
+	
+	// the authority and the path
+	theComponents->authority.offset = kURLComponentAbsent;
+	theComponents->authority.length = 0;
+	theComponents->path.offset = kURLComponentAbsent;
+	theComponents->path.length = 0;
+	if (myAuthBegin != kURLComponentAbsent) {
+		if (myAuthEnd == kURLComponentAbsent)
+			myAuthEnd = myIndex;
+		if (myPathEnd == kURLComponentAbsent)
+			myPathEnd = myIndex;
+			
+		theComponents->authority.offset = myAuthBegin;
+		theComponents->authority.length = myAuthEnd - myAuthBegin;
+		theComponents->path.offset = myAuthEnd;
+		theComponents->path.length = myPathEnd - myAuthEnd;
+	}
+	
+	// the query
+	theComponents->query.offset = kURLComponentAbsent;
+	theComponents->query.length = 0;
+	if (myQueryBegin != kURLComponentAbsent) {
+		theComponents->query.offset = myQueryBegin;
+		theComponents->query.length = myIndex - myQueryBegin;
+	}
+	
+	// the basename
+	theComponents->basename.offset = (myLastSlash != kURLComponentAbsent) ? myLastSlash + 1 : 0;
+	theComponents->basename.length = myIndex - theComponents->basename.offset;
+	
+	return(noErr);
+}
+
+
+//////////
+//
+// URLUtils_CopyComponent
+// Return a null-terminated copy of the specified part of the specified URL, or NULL if the URL doesn't
+// contain that part.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+//
+//////////
+
+char *URLUtils_CopyComponent (const char *theURL, const URLComponent *theComponent)
+{
+	char	*myCopy = NULL;
+	
+	if ((theURL == NULL) || (theComponent == NULL) || !URLUtils_HasComponent(*theComponent))
+		return(myCopy);
+		
+	myCopy = malloc(theComponent->length + 1);
+	if (myCopy != NULL) {
+		BlockMoveData(theURL + theComponent->offset, myCopy, theComponent->length);
+		myCopy[theComponent->length] = '\0';
+	}
+	
+	return(myCopy);
+}
+
+
 //////////
 //
 // URLUtils_GetScheme
@@ -95,25 +296,20 @@
 
 char *URLUtils_GetScheme (char *theURL)
 {
-	char	*myScheme = NULL;
-	short	myLength = 0;
-	short	myIndex;
+	URLComponents	myComponents;
+	char			*myScheme = NULL;
+	size_t			myIndex;
 	
 	// make sure we were passed an absolute URL
-	if (!URLUtils_IsAbsoluteURL(theURL))
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(myScheme);
+	if (!myComponents.isAbsolute)
 		return(myScheme);
 
-	// find the length of the scheme
-	while (theURL[myLength] != kURLSchemeSeparator)
-		myLength++;
-	
-	myScheme = malloc(myLength + 1);
-	if (myScheme != NULL) {
-		for (myIndex = 0; myIndex < myLength; myIndex++)
-			myScheme[myIndex] = URLUtils_ToLowercase(theURL[myIndex]);
-			
-		myScheme[myLength] = '\0';
-	}
+	myScheme = URLUtils_CopyComponent(theURL, &myComponents.scheme);
+	if (myScheme != NULL)
+		for (myIndex = 0; myIndex < myComponents.scheme.length; myIndex++)
+			myScheme[myIndex] = URLUtils_ToLowercase(myScheme[myIndex]);
 	
 	return(myScheme);
 }
@@ -135,28 +331,15 @@ char *URLUtils_GetScheme (char *theURL)
 
 char *URLUtils_GetAuthority (char *theURL)
 {
-	char	*myAuthority = NULL;
-	char	*myString = NULL;
-	short	myLength = 0;
+	URLComponents	myComponents;
 	
 	// make sure we were passed an absolute URL
-	if (!URLUtils_IsAbsoluteURL(theURL))
-		return(myAuthority);
-
-	// find the place in theURL where the authority prefix begins
-	myString = URLUtils_GetAuthBegin(theURL);
-	if (myString != NULL) {
-		// get the length of the authority portion
-		myLength = strcspn(myString + strlen(kURLAuthPrefix), kURLAuthSuffix);
-		
-		myAuthority = malloc(myLength + 1);
-		if (myAuthority != NULL) {
-			strncpy(myAuthority, myString + strlen(kURLAuthPrefix), myLength);
-			myAuthority[myLength] = '\0';
-		}
-	}
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(NULL);
+	if (!myComponents.isAbsolute)
+		return(NULL);
 
-	return(myAuthority);
+	return(URLUtils_CopyComponent(theURL, &myComponents.authority));
 }
 
 
@@ -171,28 +354,15 @@ char *URLUtils_GetAuthority (char *theURL)
 
 char *URLUtils_GetPath (char *theURL)
 {
-	char	*myPath = NULL;
-	char	*myString = NULL;
-	short	myLength = 0;
+	URLComponents	myComponents;
 	
 	// make sure we were passed an absolute URL
-	if (!URLUtils_IsAbsoluteURL(theURL))
-		return(myPath);
-
-	// find the place in theURL where the path prefix begins
-	myString = URLUtils_GetPathBegin(theURL);
-	if (myString != NULL) {
-		// get the length of the path portion
-		myLength = strcspn(myString, kURLPathSuffix);
-		
-		myPath = malloc(myLength + 1);
-		if (myPath != NULL) {
-			strncpy(myPath, myString, myLength);
-			myPath[myLength] = '\0';
-		}
-	}
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(NULL);
+	if (!myComponents.isAbsolute)
+		return(NULL);
 
-	return(myPath);
+	return(URLUtils_CopyComponent(theURL, &myComponents.path));
 }
 
 
@@ -207,24 +377,15 @@ char *URLUtils_GetPath (char *theURL)
 
 char *URLUtils_GetQuery (char *theURL)
 {
-	char	*myQuery = NULL;
-	char	*myString = NULL;
+	URLComponents	myComponents;
 	
 	// make sure we were passed an absolute URL
-	if (!URLUtils_IsAbsoluteURL(theURL))
-		return(myQuery);
-
-	// find the place in theURL where the query begins
-	myString = URLUtils_GetQueryBegin(theURL);
-	if (myString != NULL) {
-		myQuery = malloc(strlen(myString) + 1);
-		if (myQuery != NULL) {
-			strcpy(myQuery, myString);
-			myQuery[strlen(myString)] = '\0';
-		}
-	}
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(NULL);
+	if (!myComponents.isAbsolute)
+		return(NULL);
 
-	return(myQuery);
+	return(URLUtils_CopyComponent(theURL, &myComponents.query));
 }
 
 
@@ -237,7 +398,15 @@ char *URLUtils_GetQuery (char *theURL)
 
 char *URLUtils_GetAuthBegin (char *theURL)
 {
-	return(strstr(theURL, kURLAuthPrefix));
+	URLComponents	myComponents;
+	
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(NULL);
+	if (!URLUtils_HasComponent(myComponents.authority))
+		return(NULL);
+		
+	// point at the authority prefix, not the authority itself
+	return(theURL + myComponents.authority.offset - strlen(kURLAuthPrefix));
 }
 
 
@@ -250,19 +419,14 @@ char *URLUtils_GetAuthBegin (char *theURL)
 
 char *URLUtils_GetPathBegin (char *theURL)
 {
-	char	*myString = NULL;
-	short	myLength = 0;
+	URLComponents	myComponents;
 	
-	myString = URLUtils_GetAuthBegin(theURL);
-	if (myString != NULL) {
-		// get the length of the authority portion
-		myLength = strcspn(myString + strlen(kURLAuthPrefix), kURLAuthSuffix);
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(NULL);
+	if (!URLUtils_HasComponent(myComponents.path))
+		return(NULL);
 		
-		// determine the beginning of the path portion
-		myString += (myLength + strlen(kURLAuthPrefix));
-	}
-	
-	return(myString);
+	return(theURL + myComponents.path.offset);
 }
 
 
@@ -275,13 +439,14 @@ char *URLUtils_GetPathBegin (char *theURL)
 
 char *URLUtils_GetQueryBegin (char *theURL)
 {
-	char	*myString = NULL;
-	
-	myString = strchr(theURL, kURLQuerySeparator);
-	if (myString != NULL)
-		myString++;			// to skip over the query separator
+	URLComponents	myComponents;
 	
-	return(myString);
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(NULL);
+	if (!URLUtils_HasComponent(myComponents.query))
+		return(NULL);
+		
+	return(theURL + myComponents.query.offset);
 }
 
 
@@ -293,6 +458,242 @@ char *URLUtils_GetQueryBegin (char *theURL)
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+//////////
+//
+// URLUtils_NativeToURLChar
+// Return the character that stands for the specified full native pathname character in a URL (before
+// it is encoded).
+//
+// On MacOS, a full pathname is of the form <vol>:<dir>:...:<dir>:<name>; to convert this into a form
+// appropriate to URLs, we need only convert the colon (:) into the URL separator (/).
+//
+// On Windows, a full pathname has the form <vol>:\<dir>\<dir>\...\<name>; to convert this into a form
+// appropriate to URLs, we need to convert the colon (:) into '|' and the backslash (\) into the URL
+// separator (/).
+//
+//////////
+
+static char URLUtils_NativeToURLChar (char theChar)
+{
+	if (theChar == kFilePathSeparator)
+		return(kURLPathSeparator);
+#if TARGET_OS_WIN32
+	if (theChar == kWinVolumeNameChar)
+		return(kURLVolumeNameChar);
+#endif
+	return(theChar);
+}
+
+
+//////////
+//
+// URLUtils_URLToNativeChar
+// Return the full native pathname character that stands for the specified (decoded) URL character.
+//
+//////////
+
+static char URLUtils_URLToNativeChar (char theChar)
+{
+	if (theChar == kURLPathSeparator)
+		return(kFilePathSeparator);
+#if TARGET_OS_WIN32
+	if (theChar == kURLVolumeNameChar)
+		return(kWinVolumeNameChar);
+#endif
+	return(theChar);
+}
+
+
+//////////
+//
+// URLUtils_GetNativePathURLLength
+// Return the exact length of the local file URL for the specified full native pathname, not including
+// the terminating null byte.
+//
+//////////
+
+size_t URLUtils_GetNativePathURLLength (const char *thePath, size_t theLength)
+{
+	size_t		myCount = 0;
+	size_t		myIndex;
+
+	for (myIndex = 0; myIndex < theLength; myIndex++)
+		myCount += gURLEncodableChars[(UInt8)URLUtils_NativeToURLChar(thePath[myIndex])];
+
+	// each encoded character increases the length of the path by 2 bytes
+	return(strlen(kFilePrefix) + strlen(kLocalhostAuth) + 1 + theLength + (myCount * 2));
+}
+
+
+//////////
+//
+// URLUtils_NativePathToURLBuffer
+// Convert a full native pathname into a local file URL in a single pass, writing the URL into the specified
+// buffer; the buffer must be at least URLUtils_GetNativePathURLLength(thePath, theLength) + 1 bytes long.
+// Return the length of the URL, not including the terminating null byte that this function appends.
+//
+//////////
+
+size_t URLUtils_NativePathToURLBuffer (const char *thePath, size_t theLength, char *theBuffer)
+{
+	size_t		myCount = 0;
+	size_t		myIndex;
+	UInt8		myChar;
+
+	// start with the appropriate URL head
+	BlockMoveData(kFilePrefix, theBuffer, strlen(kFilePrefix));
+	myCount += strlen(kFilePrefix);
+	BlockMoveData(kLocalhostAuth, theBuffer + myCount, strlen(kLocalhostAuth));
+	myCount += strlen(kLocalhostAuth);
+	theBuffer[myCount++] = kURLPathSeparator;
+
+	// append the converted and encoded path name
+	for (myIndex = 0; myIndex < theLength; myIndex++) {
+		myChar = (UInt8)URLUtils_NativeToURLChar(thePath[myIndex]);
+		if (gURLEncodableChars[myChar]) {
+			theBuffer[myCount + 0] = kURLEscapeCharacter;
+			theBuffer[myCount + 1] = gURLHexDigits[(myChar >> 4) & 0x0f];
+			theBuffer[myCount + 2] = gURLHexDigits[myChar & 0x0f];
+			myCount += 3;
+		} else {
+			theBuffer[myCount++] = (char)myChar;
+		}
+	}
+
+	theBuffer[myCount] = '\0';
+
+	return(myCount);
+}
+
+
+//////////
+//
+// URLUtils_GetPOSIXPathURLLength
+// Return the exact length of the local file URL for the specified POSIX (absolute) pathname, not including
+// the terminating null byte.
+//
+//////////
+
+size_t URLUtils_GetPOSIXPathURLLength (const char *thePath, size_t theLength)
+{
+	return(strlen(kFilePrefix) + strlen(kLocalhostAuth) + URLUtils_GetEncodedLength(thePath, theLength));
+}
+
+
+//////////
+//
+// URLUtils_POSIXPathToURLBuffer
+// Convert a POSIX (absolute) pathname, such as "/Users/me/Movies/dog.mov", into a local file URL in a single
+// pass, writing the URL into the specified buffer; the buffer must be at least
+// URLUtils_GetPOSIXPathURLLength(thePath, theLength) + 1 bytes long. Return the length of the URL, not
+// including the terminating null byte that this function appends.
+//
+// A POSIX pathname already uses the URL path separator and begins with one, so it needs only to be encoded.
+//
+//////////
+
+size_t URLUtils_POSIXPathToURLBuffer (const char *thePath, size_t theLength, char *theBuffer)
+{
+	size_t		myCount = 0;
+
+	BlockMoveData(kFilePrefix, theBuffer, strlen(kFilePrefix));
+	myCount += strlen(kFilePrefix);
+	BlockMoveData(kLocalhostAuth, theBuffer + myCount, strlen(kLocalhostAuth));
+	myCount += strlen(kLocalhostAuth);
+
+	return(myCount + URLUtils_EncodeBytes(thePath, theLength, theBuffer + myCount));
+}
+
+
+//////////
+//
+// URLUtils_GetPOSIXPathsURLLength
+// Return the number of bytes needed to hold the local file URLs for all of the specified POSIX pathnames,
+// including each URL's terminating null byte.
+//
+//////////
+
+size_t URLUtils_GetPOSIXPathsURLLength (const char * const *thePaths, UInt32 theCount)
+{
+	size_t		myLength = 0;
+	UInt32		myIndex;
+
+	for (myIndex = 0; myIndex < theCount; myIndex++)
+		myLength += URLUtils_GetPOSIXPathURLLength(thePaths[myIndex], strlen(thePaths[myIndex])) + 1;
+
+	return(myLength);
+}
+
+
+//////////
+//
+// URLUtils_POSIXPathsToURLs
+// Convert all of the specified POSIX pathnames into local file URLs at once, packing the URLs one after
+// another into the specified buffer, which must be at least URLUtils_GetPOSIXPathsURLLength(thePaths,
+// theCount) bytes long. On return, theURLs[i] points to the URL for thePaths[i] within the buffer.
+// Return the number of bytes of the buffer used.
+//
+//////////
+
+size_t URLUtils_POSIXPathsToURLs (const char * const *thePaths, UInt32 theCount, char *theBuffer, const char **theURLs)
+{
+	size_t		myCount = 0;
+	UInt32		myIndex;
+
+	for (myIndex = 0; myIndex < theCount; myIndex++) {
+		theURLs[myIndex] = theBuffer + myCount;
+		myCount += URLUtils_POSIXPathToURLBuffer(thePaths[myIndex], strlen(thePaths[myIndex]), theBuffer + myCount) + 1;
+	}
+
+	return(myCount);
+}
+
+
+//////////
+//
+// URLUtils_URLToNativePathBuffer
+// Convert a local file URL into a full native pathname, writing the pathname into the specified buffer;
+// the buffer must be at least theLength + 1 bytes long (the buffer may be the URL itself). Return the length
+// of the pathname in *thePathLength, not including the terminating null byte that this function appends.
+//
+//////////
+
+OSErr URLUtils_URLToNativePathBuffer (const char *theURL, size_t theLength, char *theBuffer, size_t *thePathLength)
+{
+	const char	*myPath;
+	size_t		myLength;
+	size_t		myIndex;
+
+	if ((theURL == NULL) || (theBuffer == NULL))
+		return(paramErr);
+
+	// make sure we were passed a file URL; the URL must begin with the file prefix
+	if ((theLength < strlen(kFilePrefix)) || (strncmp(theURL, kFilePrefix, strlen(kFilePrefix)) != 0))
+		return(paramErr);
+
+	// strip off the URL head
+	myPath = theURL + strlen(kFilePrefix);
+
+	// strip off the authority portion, if it's non-empty
+	if ((theLength - (myPath - theURL) >= strlen(kLocalhostStr)) && (strncmp(myPath, kLocalhostStr, strlen(kLocalhostStr)) == 0))
+		myPath += strlen(kLocalhostStr);
+
+	// strip off the authority portion, if it's just '/'
+	if ((myPath < theURL + theLength) && (myPath[0] == kURLPathSeparator))
+		myPath++;
+
+	// decode the path string, and then transform it as required by the target operating system
+	myLength = URLUtils_DecodeBytes(myPath, theLength - (myPath - theURL), theBuffer);
+	for (myIndex = 0; myIndex < myLength; myIndex++)
+		theBuffer[myIndex] = URLUtils_URLToNativeChar(theBuffer[myIndex]);
+
+	if (thePathLength != NULL)
+		*thePathLength = myLength;
+
+	return(noErr);
+}
+
+
 //////////
 //
 // URLUtils_FullNativePathToURL 
@@ -305,78 +706,20 @@ char *URLUtils_GetQueryBegin (char *theURL)
 char *URLUtils_FullNativePathToURL (char *thePath)
 {
 	char		*myURL = NULL;	
-	char		*myScratchStr = NULL;	
-	char		*myEncodedStr = NULL;	
-	short		myIndex;
+	size_t		myLength;
 	
 	if (thePath == NULL)
 		goto bail;
 
-	//////////
-	//
-	// transform thePath as required by the target operating system
-	//
-	// on MacOS, a full pathname is of the form <vol>:<dir>:...:<dir>:<name>
-	// to convert this into a form appropriate to URLs, we need only convert
-	// the colon (:) into the URL separator (/)
-	//
-	// on Windows, a full pathname has the form <vol>:\<dir>\<dir>\...\<name>
-	// to convert this into a form appropriate to URLs, we need to convert
-	// the colon (:) into '|' and the backslash (\) into the URL separator (/)
-	//
-	//////////
-	
-	myScratchStr = malloc(strlen(thePath) + 1);
-	if (myScratchStr == NULL)
-		goto bail;
-	
-	for (myIndex = 0; myIndex <= strlen(thePath); myIndex++)
-		if (thePath[myIndex] == kFilePathSeparator)
-			myScratchStr[myIndex] = kURLPathSeparator;
-#if TARGET_OS_WIN32
-		else if (thePath[myIndex] == kWinVolumeNameChar)
-			myScratchStr[myIndex] = kURLVolumeNameChar;
-#endif
-		else
-			myScratchStr[myIndex] = thePath[myIndex];
-
-	//////////
-	//
-	// encode the transformed string
-	//
-	//////////
-	
-	myEncodedStr = URLUtils_EncodeString(myScratchStr);
-	if (myEncodedStr == NULL)
-		goto bail;
-
-	myURL = malloc(strlen(myEncodedStr) + strlen(kFilePrefix) + strlen(kLocalhostAuth) + strlen("/") + 1);
+	// work out exactly how long the URL will be, and then build it in one pass
+	myLength = strlen(thePath);
+	myURL = malloc(URLUtils_GetNativePathURLLength(thePath, myLength) + 1);
 	if (myURL == NULL)
 		goto bail;
 		
-	//////////
-	//
-	// prepend the appropriate URL head
-	//
-	//////////
-	
-	myURL[0] = '\0';
-	strcat(myURL, kFilePrefix);
-	strcat(myURL, kLocalhostAuth);
-	strcat(myURL, "/");
-
-	//////////
-	//
-	// append the converted and encoded path name to the URL head
-	//
-	//////////
-	
-	strcat(myURL, myEncodedStr);
+	URLUtils_NativePathToURLBuffer(thePath, myLength, myURL);
 	
 bail:
-	free(myScratchStr);
-	free(myEncodedStr);
-		
 	return(myURL);
 }
 
@@ -392,45 +735,25 @@ bail:
 
 char *URLUtils_URLToFullNativePath (char *theURL)
 {
-	char		*myScratchStr = NULL;	
-	char		*myDecodedStr = NULL;	
-	short		myIndex;
+	char		*myPath = NULL;	
+	size_t		myLength;
 
 	if (theURL == NULL)
 		goto bail;
 
-	// make sure we were passed a file URL; the URL must begin with the file prefix
-	myScratchStr = strstr(theURL, kFilePrefix);
-	if ((myScratchStr == NULL) || (myScratchStr != theURL))
-		goto bail;
-	
-	// strip off the URL head
-	myScratchStr += strlen(kFilePrefix);
-	
-	// strip off the authority portion, if it's non-empty
-	if (strstr(theURL, kLocalhostStr) == myScratchStr)
-		myScratchStr += strlen(kLocalhostStr);
-		
-	// strip off the authority portion, if it's just '/'
-	if (myScratchStr[0] == kURLPathSeparator)
-		myScratchStr++;
-	
-	// decode the path string
-	myDecodedStr = URLUtils_DecodeString(myScratchStr);
-	if (myDecodedStr == NULL)
+	// the pathname is never longer than the URL
+	myLength = strlen(theURL);
+	myPath = malloc(myLength + 1);
+	if (myPath == NULL)
 		goto bail;
 
-	// transform the decoded path as required by the target operating system
-	for (myIndex = 0; myIndex <= strlen(myDecodedStr); myIndex++)
-		if (myDecodedStr[myIndex] == kURLPathSeparator)
-			myDecodedStr[myIndex] = kFilePathSeparator;
-#if TARGET_OS_WIN32
-		else if (myDecodedStr[myIndex] == kURLVolumeNameChar)
-			myDecodedStr[myIndex] = kWinVolumeNameChar;
-#endif
+	if (URLUtils_URLToNativePathBuffer(theURL, myLength, myPath, NULL) != noErr) {
+		free(myPath);
+		myPath = NULL;
+	}
 
 bail:
-	return(myDecodedStr);
+	return(myPath);
 }
 
 
@@ -810,44 +1133,13 @@ bail:
 
 char *URLUtils_GetURLBasename (char *theURL)
 {
-	char	*myBasename = NULL;
-	short	myLength = 0;
-	short	myIndex;
+	URLComponents	myComponents;
 
 	// make sure we got a URL passed in
-	if (theURL == NULL)
-		goto bail;
-		
-	// get the length of the URL
-	myLength = strlen(theURL);
-	
-	// find the position of the rightmost URL path separator in theURL
-	if (strchr(theURL, kURLPathSeparator) != NULL) {
-
-		myIndex = myLength - 1;
-		while (theURL[myIndex] != kURLPathSeparator)
-			myIndex--;
-			
-		// calculate the length of the basename
-		myLength = myLength - myIndex - 1;
-
-	} else {
-		// there is no rightmost URL path separator in theURL;
-		// set myIndex so that myIndex + 1 == 0, for the call to BlockMove below
-		myIndex = -1;
-	}
-	
-	// allocate space to hold the string that we return to the caller
-	myBasename = malloc(myLength + 1);
-	if (myBasename == NULL)
-		goto bail;
+	if (URLUtils_ParseURL(theURL, &myComponents) != noErr)
+		return(NULL);
 		
-	// copy into myBasename the substring of theURL from myIndex + 1 to the end
-	BlockMove(&theURL[myIndex + 1], myBasename, myLength);
-	myBasename[myLength] = '\0';
-	
-bail:	
-	return(myBasename);
+	return(URLUtils_CopyComponent(theURL, &myComponents.basename));
 }
 
 
@@ -975,72 +1267,320 @@ Boolean URLUtils_IsPunctMarkChar (char theChar)
 
 Boolean URLUtils_IsEncodableChar (char theChar)
 {
-	// all control characters and high-ASCII characters are encodable
-	if ((theChar <= 0x1f) || (theChar >= 0x7f))
-		return(true);
+	// all control characters, high-ASCII characters, the space character, delimiters,
+	// and unsafe characters are encodable; see gURLEncodableChars
+	return(gURLEncodableChars[(UInt8)theChar] != 0);
+}
+
+
+//////////
+//
+// URLUtils_GetEncodedLength
+// Return the length of the encoded version of the first theLength bytes of the specified string,
+// not including the terminating null byte.
+//
+//////////
+
+size_t URLUtils_GetEncodedLength (const char *theString, size_t theLength)
+{
+	// each encoded character increases the length of the original string by 2 bytes
+	return(theLength + (URLUtils_CountEncodableChars((const UInt8 *)theString, theLength, true) * 2));
+}
+
+
+//////////
+//
+// URLUtils_GetEncodedLengthReference
+// The same as URLUtils_GetEncodedLength, but always one character at a time; the two give the same
+// result, and this is what the vector version is tested and timed against.
+//
+//////////
+
+size_t URLUtils_GetEncodedLengthReference (const char *theString, size_t theLength)
+{
+	return(theLength + (URLUtils_CountEncodableChars((const UInt8 *)theString, theLength, false) * 2));
+}
+
+
+//////////
+//
+// URLUtils_EncodeBytes
+// Encode the first theLength bytes of the specified string into the specified buffer, which must be
+// at least URLUtils_GetEncodedLength(theString, theLength) + 1 bytes long; return the length of the
+// encoded string, not including the terminating null byte that this function appends.
+//
+//////////
+
+size_t URLUtils_EncodeBytes (const char *theString, size_t theLength, char *theBuffer)
+{
+	return(URLUtils_Encode(theString, theLength, theBuffer, true));
+}
+
+
+//////////
+//
+// URLUtils_EncodeBytesReference
+// The same as URLUtils_EncodeBytes, but always finding the characters to encode one at a time; the two
+// give the same result, and this is what the vector version is tested and timed against.
+//
+//////////
+
+size_t URLUtils_EncodeBytesReference (const char *theString, size_t theLength, char *theBuffer)
+{
+	return(URLUtils_Encode(theString, theLength, theBuffer, false));
+}
+
+
+//////////
+//
+// URLUtils_IsVectorized
+// Do URLUtils_EncodeBytes and URLUtils_GetEncodedLength use a vector unit on this processor?
+//
+//////////
+
+Boolean URLUtils_IsVectorized (void)
+{
+#if URL_UTILS_SSE2
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+
+#if URL_UTILS_SSE2
+//////////
+//
+// URLUtils_ClassifySSE2
+// Return a mask of the 16 characters in theBlock that should be encoded (0xFF for each one that should);
+// this is the same set as gURLEncodableChars, worked out with comparisons rather than a table.
+//
+//////////
+
+static __m128i URLUtils_ClassifySSE2 (__m128i theBlock)
+{
+	__m128i		myMask;
+
+	// control characters, the space character, and high-ASCII characters (which are negative, as signed bytes)
+	myMask = _mm_cmplt_epi8(theBlock, _mm_set1_epi8(0x21));
+
+	// '{', '|', '}', '~' and DEL, then '[', '\\', ']' and '^'
+	myMask = _mm_or_si128(myMask, _mm_cmpgt_epi8(theBlock, _mm_set1_epi8(0x7A)));
+	myMask = _mm_or_si128(myMask, _mm_and_si128(_mm_cmpgt_epi8(theBlock, _mm_set1_epi8(0x5A)), _mm_cmplt_epi8(theBlock, _mm_set1_epi8(0x5F))));
+
+	// and the rest one at a time
+	myMask = _mm_or_si128(myMask, _mm_cmpeq_epi8(theBlock, _mm_set1_epi8('#')));
+	myMask = _mm_or_si128(myMask, _mm_cmpeq_epi8(theBlock, _mm_set1_epi8('%')));
+	myMask = _mm_or_si128(myMask, _mm_cmpeq_epi8(theBlock, _mm_set1_epi8('<')));
+	myMask = _mm_or_si128(myMask, _mm_cmpeq_epi8(theBlock, _mm_set1_epi8('>')));
+	myMask = _mm_or_si128(myMask, _mm_cmpeq_epi8(theBlock, _mm_set1_epi8('`')));
+
+	return(myMask);
+}
+#endif
+
+
+//////////
+//
+// URLUtils_FindEncodableChar
+// Return the index of the first of the first theLength bytes of the specified string that should be encoded,
+// or theLength if none of them should.
+//
+//////////
+
+static size_t URLUtils_FindEncodableChar (const UInt8 *theBytes, size_t theLength, Boolean theUseVector)
+{
+	size_t		myIndex = 0;
+
+#if URL_UTILS_SSE2
+	// in a string that's mostly encoded the run ends right away, so look at the first character on its own;
+	// then classify 16 characters at a time, and find the first to encode from the block's mask
+	if (theUseVector && (theLength >= 16) && (gURLEncodableChars[theBytes[0]] == 0)) {
+		int			myMask;
+
+		for (myIndex = 0; myIndex + 16 <= theLength; myIndex += 16) {
+			myMask = _mm_movemask_epi8(URLUtils_ClassifySSE2(_mm_loadu_si128((const __m128i *)(theBytes + myIndex))));
+			if (myMask != 0) {
+				while ((myMask & 1) == 0) {
+					myMask >>= 1;
+					myIndex++;
+				}
+				return(myIndex);
+			}
+		}
+	}
+#else
+	(void)theUseVector;
+#endif
+
+	while ((myIndex < theLength) && (gURLEncodableChars[theBytes[myIndex]] == 0))
+		myIndex++;
+
+	return(myIndex);
+}
+
+
+//////////
+//
+// URLUtils_CountEncodableChars
+// Return how many of the first theLength bytes of the specified string should be encoded.
+//
+//////////
+
+static size_t URLUtils_CountEncodableChars (const UInt8 *theBytes, size_t theLength, Boolean theUseVector)
+{
+	size_t		myCount = 0;
+	size_t		myIndex = 0;
+
+#if URL_UTILS_SSE2
+	// each byte of the mask is 0 or -1, so subtracting it counts in each of the 16 lanes; the lanes
+	// are added up (with _mm_sad_epu8) every 255 blocks, before any of them can wrap
+	if (theUseVector) {
+		while (myIndex + 16 <= theLength) {
+			__m128i		myLanes = _mm_setzero_si128();
+			UInt32		myBlocks;
+
+			for (myBlocks = 0; (myBlocks < 255) && (myIndex + 16 <= theLength); myBlocks++, myIndex += 16)
+				myLanes = _mm_sub_epi8(myLanes, URLUtils_ClassifySSE2(_mm_loadu_si128((const __m128i *)(theBytes + myIndex))));
+
+			myLanes = _mm_sad_epu8(myLanes, _mm_setzero_si128());
+			myCount += (size_t)_mm_cvtsi128_si32(myLanes) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(myLanes, 8));
+		}
+	}
+#else
+	(void)theUseVector;
+#endif
+
+	for (; myIndex < theLength; myIndex++)
+		myCount += gURLEncodableChars[theBytes[myIndex]];
+
+	return(myCount);
+}
+
+
+//////////
+//
+// URLUtils_Encode
+// Do the work of URLUtils_EncodeBytes, classifying 16 characters at a time if theUseVector is true
+// and the vector unit is there.
+//
+//////////
+
+static size_t URLUtils_Encode (const char *theString, size_t theLength, char *theBuffer, Boolean theUseVector)
+{
+	const UInt8	*myBytes = (const UInt8 *)theString;
+	size_t		myCount = 0;
+	size_t		myIndex = 0;
+	size_t		myRunEnd;
+
+	while (myIndex < theLength) {
 	
-	// the space character is encodable
-	if (theChar == 0x20)
-		return(true);
+		// copy any run of characters that don't need encoding in one go
+		myRunEnd = myIndex + URLUtils_FindEncodableChar(myBytes + myIndex, theLength - myIndex, theUseVector);
+			
+		if (myRunEnd > myIndex) {
+			BlockMoveData(theString + myIndex, theBuffer + myCount, myRunEnd - myIndex);
+			myCount += myRunEnd - myIndex;
+			myIndex = myRunEnd;
+			if (myIndex == theLength)
+				break;
+		}
+		
+		// encode the character that ended the run
+		theBuffer[myCount + 0] = kURLEscapeCharacter;
+		theBuffer[myCount + 1] = gURLHexDigits[(myBytes[myIndex] >> 4) & 0x0f];
+		theBuffer[myCount + 2] = gURLHexDigits[myBytes[myIndex] & 0x0f];
+		myCount += 3;
+		myIndex++;
+	}
 	
-	// all delimiters are encodable
-	if (URLUtils_IsDelimiterChar(theChar))
-		return(true);
+	theBuffer[myCount] = '\0';
 	
-	// all unsafe characters are encodable
-	if (URLUtils_IsUnsafeChar(theChar))
-		return(true);
+	return(myCount);
+}
+
+
+//////////
+//
+// URLUtils_DecodeBytes
+// Decode the first theLength bytes of the specified string into the specified buffer, which must be
+// at least theLength + 1 bytes long (the buffer may be the string itself); return the length of the
+// decoded string, not including the terminating null byte that this function appends.
+//
+// An escape character that is not followed by two hexadecimal digits is copied unchanged.
+//
+//////////
+
+size_t URLUtils_DecodeBytes (const char *theString, size_t theLength, char *theBuffer)
+{
+	const UInt8	*myBytes = (const UInt8 *)theString;
+	const char	*myEscape;
+	size_t		myCount = 0;
+	size_t		myIndex = 0;
+	size_t		myRunLength;
+	UInt8		myHigh, myLow;
+
+	while (myIndex < theLength) {
 	
-	return(false);
+		// copy everything up to the next escape character in one go
+		myEscape = memchr(theString + myIndex, kURLEscapeCharacter, theLength - myIndex);
+		myRunLength = (myEscape != NULL) ? (size_t)(myEscape - (theString + myIndex)) : (theLength - myIndex);
+		
+		if (myRunLength > 0) {
+			if (theBuffer + myCount != theString + myIndex)
+				memmove(theBuffer + myCount, theString + myIndex, myRunLength);
+			myCount += myRunLength;
+			myIndex += myRunLength;
+			if (myIndex == theLength)
+				break;
+		}
+		
+		// decode the escape sequence, if it is one
+		myHigh = (myIndex + 2 < theLength) ? gURLHexDigitValues[myBytes[myIndex + 1]] : kURLNotHexDigit;
+		myLow = (myIndex + 2 < theLength) ? gURLHexDigitValues[myBytes[myIndex + 2]] : kURLNotHexDigit;
+		
+		if ((myHigh == kURLNotHexDigit) || (myLow == kURLNotHexDigit)) {
+			theBuffer[myCount++] = kURLEscapeCharacter;
+			myIndex++;
+		} else {
+			theBuffer[myCount++] = (char)((myHigh << 4) | myLow);
+			myIndex += 3;
+		}
+	}
+	
+	theBuffer[myCount] = '\0';
+	
+	return(myCount);
 }
 
 
 //////////
 //
-// URLUtils_EncodeString 
-// Convert any special characters in the specified string into their encoded versions.
+// URLUtils_EncodeStringWithLength 
+// Convert any special characters in the first theLength bytes of the specified string into their
+// encoded versions. If theEncodedLength is not NULL, return the length of the encoded string in it.
 //
 // The caller is responsible for disposing of the pointer returned by this function (by calling free).
 //
 //////////
 
-char *URLUtils_EncodeString (char *theString)
+char *URLUtils_EncodeStringWithLength (const char *theString, size_t theLength, size_t *theEncodedLength)
 {
 	char		*myEncodedStr = NULL;	
-	char		myChar;
-	short		myCount = 0;
-	short		myIndex;
+	size_t		myLength;
 
 	if (theString == NULL)
 		goto bail;
 
-	// count the number of special characters that need converting
-	for (myIndex = 0; myIndex < strlen(theString); myIndex++)
-		if (URLUtils_IsEncodableChar(theString[myIndex]))
-			myCount++;
-
-	// allocate a character string of the proper size;
-	// each encoded character increases the length of the original string by 2 bytes
-	myEncodedStr = malloc(strlen(theString) + (myCount * 2) + 1);
+	myLength = URLUtils_GetEncodedLength(theString, theLength);
+	myEncodedStr = malloc(myLength + 1);
 	if (myEncodedStr == NULL)
 		goto bail;
 
-	// traverse the URL, encoding encodable characters as we go
-	for (myCount = 0, myIndex = 0; myIndex < strlen(theString); myIndex++) {
-		if (URLUtils_IsEncodableChar(theString[myIndex])) {
-			myEncodedStr[myCount + 0] = kURLEscapeCharacter;
-	        myChar = (theString[myIndex] >> 4) & 0x0f;
-	        myEncodedStr[myCount + 1] = myChar + ((myChar <= 9) ? '0' : ('A' - 10));
-	        myChar = theString[myIndex] & 0x0f;
-	        myEncodedStr[myCount + 2] = myChar + ((myChar <= 9) ? '0' : ('A' - 10));
-			myCount += 3;		
-		} else {
-			myEncodedStr[myCount] = theString[myIndex];
-			myCount++;		
-		}
-	}
+	URLUtils_EncodeBytes(theString, theLength, myEncodedStr);
 	
-	myEncodedStr[myCount] = '\0';
+	if (theEncodedLength != NULL)
+		*theEncodedLength = myLength;
 	
 bail:
 	return(myEncodedStr);
@@ -1049,61 +1589,73 @@ bail:
 
 //////////
 //
-// URLUtils_DecodeString 
-// Convert any encoded characters in the specified string into their unencoded versions.
+// URLUtils_DecodeStringWithLength 
+// Convert any encoded characters in the first theLength bytes of the specified string into their
+// unencoded versions. If theDecodedLength is not NULL, return the length of the decoded string in it.
 //
 // The caller is responsible for disposing of the pointer returned by this function (by calling free).
 //
 //////////
 
-char *URLUtils_DecodeString (char *theString)
+char *URLUtils_DecodeStringWithLength (const char *theString, size_t theLength, size_t *theDecodedLength)
 {
 	char		*myDecodedStr = NULL;	
-	char		myChar, myTemp1, myTemp2;
-	short		myCount = 0;
-	short		myIndex;
-	short		myLength;
+	size_t		myLength;
 
 	if (theString == NULL)
 		goto bail;
 
-	// count the number of escape characters in the string
-	for (myIndex = 0; myIndex < strlen(theString); myIndex++)
-		if (theString[myIndex] == kURLEscapeCharacter)
-			myCount++;
-
-	// allocate a character string of the proper size;
-	// each encoded character decreases the length of the original string by 2 bytes
-	myLength = strlen(theString) + 1 - (myCount * 2);
-	myDecodedStr = malloc(myLength);
+	// decoding never makes a string longer
+	myDecodedStr = malloc(theLength + 1);
 	if (myDecodedStr == NULL)
 		goto bail;
 
-	// traverse the URL, decoding encoded characters as we go
-	for (myCount = 0, myIndex = 0; myIndex < myLength; myIndex++) {
-		if (theString[myCount] == kURLEscapeCharacter) {
-		
-			// make sure that any hex digits are uppercase
-			myTemp1 = URLUtils_ToUppercase(theString[myCount + 1]);
-			myTemp2 = URLUtils_ToUppercase(theString[myCount + 2]);
-		
-			myChar = ((myTemp1 - ((myTemp1 <= '9' ? '0' : 'A' - 10))) << 4) & 0xf0;
-			myChar += (myTemp2 - ((myTemp2 <= '9' ? '0' : 'A' - 10))) & 0x0f;
-			myDecodedStr[myIndex] = myChar;
-			myCount += 3;
-		} else {
-			myDecodedStr[myIndex] = theString[myCount];
-			myCount++;
-		}
-	}
+	myLength = URLUtils_DecodeBytes(theString, theLength, myDecodedStr);
 	
-	myDecodedStr[myLength] = '\0';
+	if (theDecodedLength != NULL)
+		*theDecodedLength = myLength;
 	
 bail:
 	return(myDecodedStr);
 }
 
 
+//////////
+//
+// URLUtils_EncodeString 
+// Convert any special characters in the specified string into their encoded versions.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+//
+//////////
+
+char *URLUtils_EncodeString (char *theString)
+{
+	if (theString == NULL)
+		return(NULL);
+		
+	return(URLUtils_EncodeStringWithLength(theString, strlen(theString), NULL));
+}
+
+
+//////////
+//
+// URLUtils_DecodeString
+// Convert any encoded characters in the specified string into their unencoded versions.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+//
+//////////
+
+char *URLUtils_DecodeString (char *theString)
+{
+	if (theString == NULL)
+		return(NULL);
+		
+	return(URLUtils_DecodeStringWithLength(theString, strlen(theString), NULL));
+}
+
+
 //////////
 //
 // URLUtils_ConvertCToPascalString
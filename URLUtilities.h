@@ -6,7 +6,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -15,7 +15,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -69,6 +69,15 @@
 
 #define USE_EMPTY_LOCALHOST			1				// use "" instead of "localhost" for the local hostname in file URLs
 
+// classify 16 characters at a time when encoding, where the compiler targets a processor that has SSE2
+#ifndef URL_UTILS_SSE2
+#if defined(__SSE2__)
+#define URL_UTILS_SSE2				1
+#else
+#define URL_UTILS_SSE2				0
+#endif
+#endif
+
 
 //////////
 //
@@ -120,6 +129,8 @@
 #define kWinVolumeNameChar			(char)':'		// on Windows, the character that follows volume names in full pathnames
 #define kURLVolumeNameChar			(char)'|'		// on Windows, the character that follows volume names in URLs
 
+#define kURLComponentAbsent			((size_t)-1)	// the offset of a part that a URL doesn't contain
+
 #ifndef MAX_PATH
 #define MAX_PATH					512				// maximum size of a path name
 #endif
@@ -138,6 +149,31 @@
 #define URLUtils_ToLowercase(x)		((URLUtils_IsUppercase(x)) ? x + 'a' - 'A' : x)
 #define URLUtils_IsAlphabetic(x)	((URLUtils_IsUppercase(x) || URLUtils_IsLowercase(x)) ? 1 : 0)
 #define URLUtils_IsAlphanumeric(x)	((URLUtils_IsAlphabetic(x) || URLUtils_IsDigit(x)) ? 1 : 0)
+#define URLUtils_HasComponent(x)	(((x).offset != kURLComponentAbsent) ? 1 : 0)
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// one part of a URL, as an offset and length within the URL string
+typedef struct URLComponent {
+	size_t					offset;					// offset of the part from the start of the URL, or kURLComponentAbsent
+	size_t					length;					// length of the part, not null-terminated
+} URLComponent;
+
+// all the distinguishable parts of a URL, as filled in by URLUtils_ParseURL
+typedef struct URLComponents {
+	size_t					length;					// length of the entire URL
+	Boolean					isAbsolute;				// is the URL absolute?
+	URLComponent			scheme;
+	URLComponent			authority;
+	URLComponent			path;
+	URLComponent			query;
+	URLComponent			basename;				// everything after the rightmost URL path separator
+} URLComponents, *URLComponentsPtr;
 
 
 //////////
@@ -146,6 +182,8 @@
 //
 //////////
 
+OSErr							URLUtils_ParseURL (const char *theURL, URLComponentsPtr theComponents);
+char *							URLUtils_CopyComponent (const char *theURL, const URLComponent *theComponent);
 char *							URLUtils_GetScheme (char *theURL);
 char *							URLUtils_GetAuthority (char *theURL);
 char *							URLUtils_GetPath (char *theURL);
@@ -156,6 +194,13 @@ char *					URLUtils_GetQueryBegin (char *theURL);
 
 char *							URLUtils_FullNativePathToURL (char *thePath);
 char *							URLUtils_URLToFullNativePath (char *theURL);
+size_t							URLUtils_GetNativePathURLLength (const char *thePath, size_t theLength);
+size_t							URLUtils_NativePathToURLBuffer (const char *thePath, size_t theLength, char *theBuffer);
+size_t							URLUtils_GetPOSIXPathURLLength (const char *thePath, size_t theLength);
+size_t							URLUtils_POSIXPathToURLBuffer (const char *thePath, size_t theLength, char *theBuffer);
+size_t							URLUtils_GetPOSIXPathsURLLength (const char * const *thePaths, UInt32 theCount);
+size_t							URLUtils_POSIXPathsToURLs (const char * const *thePaths, UInt32 theCount, char *theBuffer, const char **theURLs);
+OSErr							URLUtils_URLToNativePathBuffer (const char *theURL, size_t theLength, char *theBuffer, size_t *thePathLength);
 FSSpecPtr						URLUtils_FullNativePathToFSSpec (char *thePath);
 char *							URLUtils_FSSpecToFullNativePath (const FSSpecPtr theFSSpecPtr);
 char *							URLUtils_FSSpecToURL (const FSSpecPtr theFSSpecPtr);
@@ -179,6 +224,14 @@ Boolean					URLUtils_IsEncodableChar (char theChar);
 
 char *							URLUtils_EncodeString (char *theString);
 char *							URLUtils_DecodeString (char *theString);
+char *							URLUtils_EncodeStringWithLength (const char *theString, size_t theLength, size_t *theEncodedLength);
+char *							URLUtils_DecodeStringWithLength (const char *theString, size_t theLength, size_t *theDecodedLength);
+size_t							URLUtils_GetEncodedLength (const char *theString, size_t theLength);
+size_t							URLUtils_EncodeBytes (const char *theString, size_t theLength, char *theBuffer);
+size_t							URLUtils_DecodeBytes (const char *theString, size_t theLength, char *theBuffer);
+size_t							URLUtils_GetEncodedLengthReference (const char *theString, size_t theLength);
+size_t							URLUtils_EncodeBytesReference (const char *theString, size_t theLength, char *theBuffer);
+Boolean							URLUtils_IsVectorized (void);
 
 StringPtr						URLUtils_ConvertCToPascalString (char *theString);
 
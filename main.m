@@ -5,7 +5,7 @@
 
 	Author:		QuickTime Engineering
 
-	Copyright: 	 Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
+	Copyright: 	© Copyright 2003-2004 Apple Computer, Inc. All rights reserved.
 	
 	Disclaimer:	IMPORTANT:  This Apple software is supplied to you by Apple Computer, Inc.
 				("Apple") in consideration of your agreement to the following terms, and your
@@ -14,7 +14,7 @@
 				please do not use, install, modify or redistribute this Apple software.
 
 				In consideration of your agreement to abide by the following terms, and subject
-				to these terms, Apple grants you a personal, non-exclusive license, under Apples
+				to these terms, Apple grants you a personal, non-exclusive license, under Apple’s
 				copyrights in this original Apple software (the "Apple Software"), to use,
 				reproduce, modify and redistribute the Apple Software, with or without
 				modifications, in source and/or binary forms; provided that if you redistribute
@@ -49,9 +49,15 @@
 #import <Cocoa/Cocoa.h>
 #import <QuickTime/QuickTime.h>
 
+#import "BatchImport.h"
+
 int main(int argc, const char *argv[])
 {
     EnterMovies();
     
+    // run headless if we've been asked to import a batch of files
+    if ((argc > 1) && (strcmp(argv[1], kBatchImportFlag) == 0))
+        return runBatchImport(argc - 2, argv + 2);
+    
     return NSApplicationMain(argc, argv);
 }